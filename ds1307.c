@@ -8,37 +8,328 @@
 
 /* Include Files */
 #include "ds1307.h"
+#ifndef DS1307_NO_HAL
+#include "ds1307_hal.h"
+#endif
 #include <stdio.h>
 #include <string.h>
 
 /**
- * @brief Converts binary values in an array to binary-coded decimal (BCD) format.
- * This function converts each element of the provided data array from binary format
- * to binary-coded decimal (BCD) format. The conversion is performed by calculating
- * the tens and units place of each value and combining them into a BCD representation.
- * @param[in,out] data Pointer to the array of binary values to be converted to BCD.
- * @param[in] len Length of the data array.
- * @note The function assumes that the input data array contains values in binary format.
+ * @brief Converts one packed BCD byte to binary.
+ * @param[in] bcd BCD value (two decimal digits).
+ * @return uint8_t Binary value.
  */
-static void DS1307_Bin_to_BCD(uint8_t* data, uint8_t len);
+static uint8_t DS1307_BCD_to_Bin(uint8_t bcd);
 
 /**
- * @brief I2C handle for DS1307 operations.
- * 
- * This static variable holds the I2C handle structure used for communicating
- * with the DS1307 real-time clock (RTC) device.
+ * @brief Converts a binary value (0-99) to one packed BCD byte.
+ * @param[in] bin Binary value.
+ * @return uint8_t BCD value.
+ */
+static uint8_t DS1307_Bin_to_BCD(uint8_t bin);
+
+/**
+ * @brief Decodes raw seconds/minutes/hours registers into a DS1307_Time_t structure.
+ * @param[in] raw Pointer to the 3 bytes read from registers 0x00-0x02.
+ * @param[out] dataRead Pointer to the DS1307_Time_t structure to fill.
+ * @param[in] bcd Non-zero to return masked BCD values, zero for binary values.
+ */
+static void DS1307_Raw_to_Time(const uint8_t* raw, DS1307_Time_t* dataRead, uint8_t bcd);
+
+/**
+ * @brief Decodes raw day/date/month/year registers into a DS1307_Date_t structure.
+ * @param[in] raw Pointer to the 4 bytes read from registers 0x03-0x06.
+ * @param[out] dataRead Pointer to the DS1307_Date_t structure to fill.
+ * @param[in] bcd Non-zero to return masked BCD values, zero for binary values.
+ */
+static void DS1307_Raw_to_Date(const uint8_t* raw, DS1307_Date_t* dataRead, uint8_t bcd);
+
+/**
+ * @brief Decodes a raw timekeeping register snapshot into a DS1307_DateTime_t structure.
+ * @param[in] raw Pointer to the 7 bytes read from registers 0x00-0x06 (seconds to year).
+ * @param[out] dataRead Pointer to the DS1307_DateTime_t structure to fill.
+ * @param[in] bcd Non-zero to return masked BCD values, zero for binary values.
+ */
+static void DS1307_Raw_to_DateTime(const uint8_t* raw, DS1307_DateTime_t* dataRead, uint8_t bcd);
+
+/**
+ * @brief Advances a binary date and time by one second.
+ * Handles minute, hour, weekday, month and year rollovers including leap years
+ * (years 2000-2099, where every year divisible by 4 is a leap year).
+ * @param[in,out] dateTime Pointer to the date and time to advance.
+ */
+static void DS1307_DateTime_Increment(DS1307_DateTime_t* dateTime);
+
+/**
+ * @brief Returns the number of days in a month.
+ * @param[in] month Month, 1-12.
+ * @param[in] year Years since 2000 (every year divisible by 4 is a leap year).
+ * @return uint8_t Days in the month, 0 if month is out of range.
+ */
+static uint8_t DS1307_DaysInMonth(uint8_t month, uint8_t year);
+
+/**
+ * @brief Checks that a binary time is in range (24-hour format).
+ * @param[in] time Pointer to the time to check.
+ * @return uint8_t 1 if every field is in range, 0 otherwise.
+ */
+static uint8_t DS1307_Time_Valid(const DS1307_Time_t* time);
+
+/**
+ * @brief Checks that a binary date is in range and exists (years 2000-2099).
+ * @param[in] date Pointer to the date to check; a Day of 0 is accepted.
+ * @return uint8_t 1 if every field is in range, 0 otherwise.
+ */
+static uint8_t DS1307_Date_Valid(const DS1307_Date_t* date);
+
+/**
+ * @brief Resolves DS1307_HOURS_KEEP and DS1307_CH_KEEP from the registers of the RTC.
+ * Registers 0x00-0x02 are read only if one of the settings is a KEEP.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] hourMode Hour format, replaced by the current one if DS1307_HOURS_KEEP.
+ * @param[in,out] clockHalt CH setting, replaced by the current one if DS1307_CH_KEEP.
+ * @return DS1307_Status_t Status of the read, DS1307_OK if none was needed.
+ */
+static DS1307_Status_t DS1307_ResolveModes(DS1307_Handle_t *dev, DS1307_HourMode_t* hourMode, DS1307_ClockHalt_t* clockHalt);
+
+/**
+ * @brief Encodes a binary time into the seconds, minutes and hours registers.
+ * @param[in] time Pointer to the binary time (24-hour format).
+ * @param[out] raw Pointer to the 3 register bytes 0x00-0x02.
+ * @param[in] hourMode DS1307_HOURS_24 or DS1307_HOURS_12.
+ * @param[in] clockHalt DS1307_CH_RUN or DS1307_CH_HALT.
+ */
+static void DS1307_Time_to_Raw(const DS1307_Time_t* time, uint8_t* raw, DS1307_HourMode_t hourMode, DS1307_ClockHalt_t clockHalt);
+
+/**
+ * @brief Encodes a binary date into the day, date, month and year registers.
+ * @param[in] date Pointer to the binary date; a Day of 0 is replaced by the weekday.
+ * @param[out] raw Pointer to the 4 register bytes 0x03-0x06.
+ */
+static void DS1307_Date_to_Raw(const DS1307_Date_t* date, uint8_t* raw);
+
+/**
+ * @brief Starts an asynchronous register read on behalf of one of the _IT functions.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] op Operation code (DS1307_OP_*) selecting the decode applied on completion.
+ * @param[in] regAdd Address of the first register to read.
+ * @param[out] data Buffer receiving the raw register contents.
+ * @param[in] len Number of registers to read.
+ * @param[out] dst Destination structure of the decoded result (unused for raw reads).
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code.
+ */
+static DS1307_Status_t DS1307_AsyncRead(DS1307_Handle_t *dev, uint8_t op, uint8_t regAdd, uint8_t *data, uint8_t len,
+                                        void *dst, DS1307_Callback_t callback, void *userData);
+
+/**
+ * @brief Marks the device busy with an asynchronous transfer, unless it already is.
+ * The check and the set are one atomic step, since the _IT functions may be called from
+ * interrupts (e.g. the SQW sampler) that preempt a task starting a transfer.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @return uint8_t 1 if the caller now owns the device, 0 if a transfer is in flight.
+ */
+static uint8_t DS1307_Async_Claim(DS1307_Handle_t *dev);
+
+/* Value bits of the timekeeping registers, control bits (CH, 12/24, AM/PM) excluded */
+#define DS1307_MASK_SEC                          0x7F  /**< Seconds, CH bit removed. */
+#define DS1307_MASK_MIN                          0x7F  /**< Minutes. */
+#define DS1307_MASK_HRS_24                       0x3F  /**< Hours in 24-hour mode. */
+#define DS1307_MASK_HRS_12                       0x1F  /**< Hours in 12-hour mode, AM/PM bit removed. */
+#define DS1307_MASK_DAY                          0x07  /**< Day of week. */
+#define DS1307_MASK_DATE                         0x3F  /**< Date. */
+#define DS1307_MASK_MONTH                        0x1F  /**< Month. */
+#define DS1307_MASK_YEAR                         0xFF  /**< Year. */
+
+/* Per-register value masks packed in register order, register 0x00 in the low byte */
+#define DS1307_SWAR_MASK                         (((uint64_t)DS1307_MASK_YEAR   << 48) | \
+                                                  ((uint64_t)DS1307_MASK_MONTH  << 40) | \
+                                                  ((uint64_t)DS1307_MASK_DATE   << 32) | \
+                                                  ((uint64_t)DS1307_MASK_DAY    << 24) | \
+                                                  ((uint64_t)DS1307_MASK_HRS_24 << 16) | \
+                                                  ((uint64_t)DS1307_MASK_MIN    << 8)  | \
+                                                  ((uint64_t)DS1307_MASK_SEC))
+
+/* Registers held in the shadow: control register and RAM, 0x07-0x3F */
+#define DS1307_SHADOW_CACHED                     (~(uint64_t)0 << D_DS1307_REG_CTRL)
+
+/* Control register bits selected by DS1307_SQWO_t */
+#define DS1307_CTRL_SQW_MASK                     ((1 << D_DS1307_BIT_OUT) | (1 << D_DS1307_BIT_SQWE) | \
+                                                  (1 << D_DS1307_BIT_RS1) | (1 << D_DS1307_BIT_RS0))
+
+/* Calendar constants of the epoch conversions; the year starts on 1 March */
+#define DS1307_DAYS_TO_1996_03_01                9556u  /**< Days from 1970-01-01 to 1996-03-01. */
+#define DS1307_DAYS_PER_4_YEARS                  1461u  /**< Days in a four-year cycle. */
+#define DS1307_SECONDS_PER_DAY                   86400u /**< Seconds in a day. */
+
+/* Operation codes of the asynchronous API, stored in DS1307_Async_t.op */
+#define DS1307_OP_REG                            0  /**< Raw register read or write, no decode. */
+#define DS1307_OP_TIME_BIN                       1  /**< DS1307_ReadTime_Bin_IT(). */
+#define DS1307_OP_TIME_BCD                       2  /**< DS1307_ReadTime_BCD_IT(). */
+#define DS1307_OP_DATE_BIN                       3  /**< DS1307_ReadDate_Bin_IT(). */
+#define DS1307_OP_DATE_BCD                       4  /**< DS1307_ReadDate_BCD_IT(). */
+#define DS1307_OP_DATETIME_BIN                   5  /**< DS1307_ReadDateTime_Bin_IT(). */
+#define DS1307_OP_DATETIME_BCD                   6  /**< DS1307_ReadDateTime_BCD_IT(). */
+#define DS1307_OP_SNAPSHOT                       7  /**< Sampler snapshot, published into the ring. */
+
+/* Orders the accesses of the sequence-counter readers and writers (SQW edge interrupt vs
+   task), so the compiler cannot move the protected copy outside the counter reads */
+#ifndef DS1307_NO_HAL
+#define DS1307_BARRIER()                         __DMB()
+#elif defined(__GNUC__)
+#define DS1307_BARRIER()                         __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#define DS1307_BARRIER()                         ((void)0)
+#endif
+
+/* Attribution of the next blocking transfer to a DS1307_Api_t histogram; the transfer
+   consumes it, and paths that return without a transfer clear it */
+#ifndef DS1307_NO_METRICS
+#define DS1307_METRICS_TAG(dev, tag)             ((dev)->metrics.api = (uint8_t)(tag))
+#else
+#define DS1307_METRICS_TAG(dev, tag)             ((void)0)
+#endif
+
+/**
+ * @brief Reads consecutive registers through the device transport and updates the statistics.
+ * Failed transactions are retried and the breaker updated as set by DS1307_SetRecovery().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Address of the first register to read.
+ * @param[out] data Buffer receiving the register contents.
+ * @param[in] len Number of registers to read.
+ * @return DS1307_Status_t Status of the last attempt, or DS1307_CIRCUIT_OPEN if the breaker
+ *         is open.
+ */
+static DS1307_Status_t DS1307_Xfer_Read(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t *data, uint8_t len);
+
+/**
+ * @brief Writes consecutive registers through the device transport and updates the statistics.
+ * Failed transactions are retried and the breaker updated as set by DS1307_SetRecovery().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Address of the first register to write.
+ * @param[in] data Buffer holding the bytes to write.
+ * @param[in] len Number of registers to write.
+ * @return DS1307_Status_t Status of the last attempt, or DS1307_CIRCUIT_OPEN if the breaker
+ *         is open.
+ */
+static DS1307_Status_t DS1307_Xfer_Write(DS1307_Handle_t *dev, uint8_t regAdd, const uint8_t *data, uint8_t len);
+
+#ifndef DS1307_NO_METRICS
+/**
+ * @brief Reads the clock of the metrics.
+ * @param[in] dev Pointer to the DS1307 device handle.
+ * @return uint32_t Current counter value, or 0 without a clock.
+ */
+static uint32_t DS1307_Metrics_Now(const DS1307_Handle_t *dev);
+
+/**
+ * @brief Files a failed bus transaction under its status.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] status Status of the transaction.
+ */
+static void DS1307_Metrics_Error(DS1307_Handle_t *dev, DS1307_Status_t status);
+
+/**
+ * @brief Counts the bytes of a finished transfer and files its latency.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] api DS1307_Api_t histogram of the transfer.
+ * @param[in] start Clock counter value when the transfer started.
+ * @param[in] bytesRead Register bytes read, 0 if the transfer failed.
+ * @param[in] bytesWritten Register bytes written, 0 if the transfer failed.
+ */
+static void DS1307_Metrics_Transfer(DS1307_Handle_t *dev, uint8_t api, uint32_t start, uint8_t bytesRead, uint8_t bytesWritten);
+
+/**
+ * @brief Records the asynchronous transfer about to start, for its completion.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] op Operation code (DS1307_OP_*) of the transfer.
+ * @param[in] len Register bytes of the transfer.
+ * @param[in] write Non-zero for a write, zero for a read.
+ */
+static void DS1307_Metrics_AsyncStart(DS1307_Handle_t *dev, uint8_t op, uint8_t len, uint8_t write);
+#endif
+
+/**
+ * @brief Computes the timeout of a transaction from its length.
+ * @param[in] dev Pointer to the DS1307 device handle.
+ * @param[in] bytes Bytes on the wire, address and register bytes included.
+ * @return uint32_t Timeout in microseconds.
+ */
+static uint32_t DS1307_Timeout_For(const DS1307_Handle_t *dev, uint16_t bytes);
+
+/**
+ * @brief Adds the latency of a successful transaction to the per-byte histogram.
+ * The measurement counts one tick more than elapsed: the transfer may have started just
+ * after a tick and ended just before the next, so a coarse clock (the 1 kHz HAL tick)
+ * would otherwise learn a latency of zero and starve every later transfer.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] start Clock counter value when the transaction started.
+ * @param[in] bytes Bytes on the wire, address and register bytes included.
+ */
+static void DS1307_Timeout_Learn(DS1307_Handle_t *dev, uint32_t start, uint16_t bytes);
+
+/**
+ * @brief Checks the circuit breaker before an operation reaches the bus.
+ * Once the cooldown of an open breaker has elapsed, the breaker turns half-open and lets
+ * one trial operation through.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @return uint8_t 1 if the operation may start, 0 if it must fail fast.
+ */
+static uint8_t DS1307_Recovery_Admit(DS1307_Handle_t *dev);
+
+/**
+ * @brief Prepares the retry of a failed transaction.
+ * Runs the bus clear and re-init hooks after a timeout or a repeated DS1307_BUSY, then
+ * waits the backoff delay of this attempt.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] status Status of the failed transaction.
+ * @param[in] attempt Number of retries already made for this operation.
+ * @return uint8_t 1 if the transaction should be retried, 0 to give up.
+ */
+static uint8_t DS1307_Recovery_Retry(DS1307_Handle_t *dev, DS1307_Status_t status, uint8_t attempt);
+
+/**
+ * @brief Updates the circuit breaker with the outcome of an operation.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] status Final status of the operation, after its retries.
+ */
+static void DS1307_Recovery_Done(DS1307_Handle_t *dev, DS1307_Status_t status);
+
+/**
+ * @brief Bitmap of registers regAdd..regAdd+len-1.
+ * @param[in] regAdd Address of the first register.
+ * @param[in] len Number of registers, 1-64.
+ * @return uint64_t Bit n set for every register n in the range.
+ */
+static uint64_t DS1307_RegMask(uint8_t regAdd, uint8_t len);
+
+/**
+ * @brief Records registers just read from the device in the shadow.
+ * Registers with unflushed local changes keep their local value.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Address of the first register read.
+ * @param[in] data Register contents.
+ * @param[in] len Number of registers read.
  */
-static I2C_HandleTypeDef DS1307_I2C;
+static void DS1307_Shadow_Update(DS1307_Handle_t *dev, uint8_t regAdd, const uint8_t *data, uint8_t len);
 
 /**
  * @brief Initializes the DS1307 RTC with the specified I2C handler and square wave output setting.
  * This function initializes the DS1307 real-time clock (RTC) by configuring its I2C 
  * handler and setting the square wave output (SQW/OUT) according to the provided 
- * configuration. The initialization process includes resetting the CH bit to enable 
- * the oscillator and configuring the square wave output frequency.
+ * configuration. The initialization keeps the running time: the seconds and the
+ * control register are read in one burst, the CH bit is cleared only if it is set
+ * (keeping the seconds value), and the control register is written only when it differs
+ * from sqwOut. A warm boot therefore costs a single read transaction.
+ * dev->oscStopped reports whether the oscillator had been halted, i.e. whether the time
+ * was lost (battery backup failure) or never set. The recovery policy is cleared; to
+ * initialize with one, call DS1307_InitTransport() with DS1307_Transport_HAL.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[in] handler Pointer to an I2C_HandleTypeDef structure that contains the configuration 
  *                    information for the I2C peripheral to be used for communication with 
- *                    the DS1307 RTC.
+ *                    the DS1307 RTC. The handle is referenced by the device handle and must
+ *                    outlive it.
  * @param[in] sqwOut Square wave output configuration. This parameter sets the frequency of 
  *                    the square wave output or disables it. The configuration should be 
  *                    specified using the DS1307_SQWO_t enumeration.
@@ -46,37 +337,86 @@ static I2C_HandleTypeDef DS1307_I2C;
  *         success, or an error code if the initialization fails. Specifically, it returns 
  *         DS1307_NOT_FOUND if the DS1307 RTC is not detected.
  */
-DS1307_Status_t DS1307_Init(I2C_HandleTypeDef *handler, DS1307_SQWO_t sqwOut)
+#ifndef DS1307_NO_HAL
+DS1307_Status_t DS1307_Init(DS1307_Handle_t *dev, I2C_HandleTypeDef *handler, DS1307_SQWO_t sqwOut)
+{
+    /* The HAL handle is referenced, not copied, so its state and lock stay shared with the application */
+    return DS1307_InitTransport(dev, &DS1307_Transport_HAL, handler, sqwOut, NULL);
+}
+#endif
+
+/**
+ * @brief Initializes the DS1307 RTC over an arbitrary bus transport.
+ * This function performs the same initialization sequence as DS1307_Init() but uses the
+ * supplied transport for every bus access instead of the STM32 HAL. It is the entry point
+ * for non-HAL backends (Linux i2c-dev, simulators, ...).
+ * The handle is cleared first and then given the recovery policy, so the initialization
+ * transfers already run under it; pass the same policy again when re-initializing.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] transport Pointer to the transport operations. Must remain valid while the
+ *                      driver is in use.
+ * @param[in] bus Backend-specific bus context passed back to every transport operation.
+ * @param[in] sqwOut Square wave output configuration, see DS1307_SQWO_t.
+ * @param[in] policy Recovery policy copied into the handle as by DS1307_SetRecovery(), or
+ *                   NULL for none.
+ * @return DS1307_Status_t Status of the initialization operation. Returns DS1307_OK on
+ *         success, DS1307_NOT_FOUND if the DS1307 RTC is not detected, or the status of
+ *         the failed register write.
+ */
+DS1307_Status_t DS1307_InitTransport(DS1307_Handle_t *dev, const DS1307_Transport_t *transport, void *bus, DS1307_SQWO_t sqwOut,
+                                     const DS1307_RecoveryPolicy_t *policy)
 {
     DS1307_Status_t status; /**< Status of the initialization operation. */
-    uint8_t value = 0;      /**< Temporary variable for I2C operations. */
+    uint8_t value[8];       /**< Registers 0x00 (seconds) to 0x07 (control). */
 
-    /* Initialize the I2C handler for DS1307 communication */
-    memset(&DS1307_I2C, 0, sizeof(DS1307_I2C));   /**< Clear the DS1307_I2C structure. */
-    memcpy(&DS1307_I2C, handler, sizeof(DS1307_I2C)); /**< Copy the user-provided I2C handler to DS1307_I2C. */
+    /* Bind the device handle to its bus */
+    memset(dev, 0, sizeof(*dev));
+    dev->transport = transport;
+    dev->bus = bus;
+    dev->addr = D_DS1307_ADDR;
+    if (policy != NULL)
+    {
+        dev->recovery.policy = *policy;
+    }
 
-    /* Reset the CH bit in the seconds register (REG0) to enable the oscillator */
-    value &= ~(1 << D_DS1307_BIT_CH);  /**< Clear the CH bit (bit 7) to enable the oscillator. */
-    status = HAL_I2C_Mem_Write(&DS1307_I2C, D_DS1307_ADDR, D_DS1307_REG_SEC, 1, &value, 1, DS1307_TIMEOUT); /**< Write to the seconds register. */
-    
-    if (status == DS1307_ERROR) {
+    /* Read the seconds and the control register in one burst, without disturbing the clock;
+       this also fills the shadow of the control register */
+    status = DS1307_ReadReg(dev, D_DS1307_REG_SEC, value, sizeof(value));
+    if (status == DS1307_ERROR)
+    {
 #ifdef DS1307_Debug
-        printf("\nDS1307 with Slave Address %02X is Not Found", D_DS1307_ADDR); /**< Print error message if DS1307 is not found. */
+        printf("\nDS1307 with Slave Address %02X is Not Found", dev->addr); /**< Print error message if DS1307 is not found. */
 #endif
         return DS1307_NOT_FOUND; /**< Return error code if DS1307 is not found. */
     }
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
 
-    /* Set the square wave output frequency */
-    value = sqwOut;  /**< Set the square wave output configuration. */
-    status = HAL_I2C_Mem_Write(&DS1307_I2C, D_DS1307_ADDR, D_DS1307_REG_CTRL, 1, &value, 1, DS1307_TIMEOUT); /**< Write to the control register. */
+    /* CH set means the oscillator is halted: restart it, keeping the seconds value */
+    if (value[D_DS1307_REG_SEC] & (1 << D_DS1307_BIT_CH))
+    {
+        dev->oscStopped = 1;
+        value[D_DS1307_REG_SEC] &= ~(1 << D_DS1307_BIT_CH);
+        status = DS1307_Xfer_Write(dev, D_DS1307_REG_SEC, &value[D_DS1307_REG_SEC], 1);
+        if (status != DS1307_OK)
+        {
+            return status;
+        }
+    }
 
-    /* Verify the square wave output setting */
-    value = 0; /**< Clear the value variable. */
-    status = HAL_I2C_Mem_Read(&DS1307_I2C, D_DS1307_ADDR, D_DS1307_REG_CTRL, 1, &value, 1, DS1307_TIMEOUT); /**< Read back the control register. */
+    /* Set the square wave output frequency; the flush writes only if it differs */
+    DS1307_SetSQW(dev, sqwOut);
+    status = DS1307_Shadow_Flush(dev);
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
 
 #ifdef DS1307_Debug
     /* Print the current square wave output setting */
-    switch (value)
+    switch (dev->shadow.reg[D_DS1307_REG_CTRL])
     {
     case _1Hz:
         printf("\n1Hz Square Wave Output is Selected");
@@ -110,69 +450,276 @@ DS1307_Status_t DS1307_Init(I2C_HandleTypeDef *handler, DS1307_SQWO_t sqwOut)
  * 
  * This function reads data from a specific register of the DS1307 real-time clock (RTC)
  * and stores it in the provided buffer. It uses I2C communication to access the register
- * and retrieves the requested number of bytes.
+ * and retrieves the requested number of bytes directly into the caller's buffer.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[in] regAdd The address of the register to read from.
  * @param[out] dataRead Pointer to the buffer where the read data will be stored.
  * @param[in] readLen The number of bytes to read from the register.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success,
- *         or an error code if the operation fails.
+ *         or an error code if the operation fails. Returns DS1307_DATA_SIZE_ERROR if
+ *         readLen is 0 or the read would run past register 0x3F.
  */
-DS1307_Status_t DS1307_ReadReg(uint8_t regAdd, uint8_t *dataRead, uint8_t readLen)
+DS1307_Status_t DS1307_ReadReg(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t *dataRead, uint8_t readLen)
 {
-    DS1307_Status_t status; /**< Status of the I2C read operation. */
-    uint8_t value[DS1307_MAX_BUFF_SIZE] = {0}, /**< Buffer to hold the read data. */
-            dataLen = 0; /**< Length of data to read. Initialized to 0. */
+    DS1307_Status_t status; /**< Status of the transfer. */
 
-    /* Perform I2C read operation to read data from the specified register */
-    status = HAL_I2C_Mem_Read(&DS1307_I2C, D_DS1307_ADDR, regAdd, 1, value, dataLen, DS1307_TIMEOUT);
+    /* Reject empty transfers and transfers that would wrap past register 0x3F */
+    if ((readLen == 0) || ((uint16_t)regAdd + readLen > DS1307_MAX_BUFF_SIZE))
+    {
+#ifdef DS1307_Debug
+        printf("\nDatasize Exceeded");
+#endif
+        DS1307_METRICS_TAG(dev, DS1307_API_OTHER);
+        return DS1307_DATA_SIZE_ERROR;
+    }
 
-    /* Copy the read data from the buffer to the output buffer */
-    for (int i = 0; i < readLen; i++)
+    /* Read the registers directly into the caller's buffer */
+    status = DS1307_Xfer_Read(dev, regAdd, dataRead, readLen);
+    if (status == DS1307_OK)
     {
-        dataRead[i] = value[i];
+        DS1307_Shadow_Update(dev, regAdd, dataRead, readLen);
     }
 
-    return status; /**< Return the status of the read operation. */
+    return status;
 }
 
 /**
  * @brief Writes data to a specified register of the DS1307 RTC.
  * This function writes a specified number of bytes to a register in the DS1307 real-time 
- * clock (RTC) using I2C communication. It first checks if the data size exceeds the maximum 
- * buffer size and then performs the write operation if valid.
+ * clock (RTC) using I2C communication. It first checks that the write stays inside the
+ * register file and then transfers the caller's buffer directly.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[in] regAdd The address of the register to write to.
  * @param[in] dataWrite Pointer to the buffer containing the data to be written.
  * @param[in] writeLen The number of bytes to write to the register.
  * @return DS1307_Status_t Status of the write operation. Returns DS1307_OK on success, 
  *         or an error code if the operation fails. Specifically, returns DS1307_DATA_SIZE_ERROR 
- *         if the data length exceeds the maximum buffer size.
+ *         if writeLen is 0 or the write would run past register 0x3F.
  */
-DS1307_Status_t DS1307_WriteReg(uint8_t regAdd, uint8_t *dataWrite, uint8_t writeLen)
+DS1307_Status_t DS1307_WriteReg(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t *dataWrite, uint8_t writeLen)
 {
-    DS1307_Status_t status; /**< Status of the I2C write operation. */
-    uint8_t value[DS1307_MAX_BUFF_SIZE] = {0}, /**< Buffer to hold the data to be written. */
-            dataLen = writeLen; /**< Length of data to write, set to the input writeLen. */
+    DS1307_Status_t status; /**< Status of the transfer. */
 
-    /* Check if the data length exceeds the maximum buffer size */
-    if (dataLen > DS1307_MAX_BUFF_SIZE)
+    /* Reject empty transfers and transfers that would wrap past register 0x3F */
+    if ((writeLen == 0) || ((uint16_t)regAdd + writeLen > DS1307_MAX_BUFF_SIZE))
     {
 #ifdef DS1307_Debug
         /* Print an error message if data size exceeds the limit */
         printf("\nDatasize Exceeded");
 #endif
-        return DS1307_DATA_SIZE_ERROR; /**< Return error status for data size exceeding buffer. */
+        DS1307_METRICS_TAG(dev, DS1307_API_OTHER);
+        return DS1307_DATA_SIZE_ERROR; /**< Return error status for data size exceeding the register file. */
+    }
+
+    /* Write the caller's buffer directly to the specified registers */
+    DS1307_METRICS_TAG(dev, DS1307_API_WRITE_REG);
+    status = DS1307_Xfer_Write(dev, regAdd, dataWrite, writeLen);
+    if (status == DS1307_OK)
+    {
+        /* The device now holds these values, overriding any unflushed change */
+        dev->shadow.dirty &= ~DS1307_RegMask(regAdd, writeLen);
+        DS1307_Shadow_Update(dev, regAdd, dataWrite, writeLen);
+    }
+    else
+    {
+        /* A failed burst may have landed partly: the device contents are unknown */
+        dev->shadow.valid &= ~(DS1307_RegMask(regAdd, writeLen) & ~dev->shadow.dirty);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Checks whether the DS1307 acknowledges its slave address.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @return DS1307_Status_t Returns DS1307_OK if the device answers, DS1307_NOT_FOUND
+ *         otherwise.
+ */
+DS1307_Status_t DS1307_Probe(DS1307_Handle_t *dev)
+{
+    if (dev->transport->Probe(dev->bus, dev->addr, DS1307_Timeout_For(dev, 1)) != DS1307_OK)
+    {
+        return DS1307_NOT_FOUND; /**< Device did not acknowledge its address. */
+    }
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Sets the retry, bus recovery and circuit breaker policy of a device.
+ * DS1307_InitTransport() takes the policy as a parameter and DS1307_Init() clears it; this
+ * function changes it at any time afterwards. The breaker is closed and its failure count
+ * cleared. The policy applies to the blocking transfers; asynchronous transfers and
+ * DS1307_Probe() bypass it, so a probe can check the device while the breaker is open.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] policy Policy to copy into the handle.
+ */
+void DS1307_SetRecovery(DS1307_Handle_t *dev, const DS1307_RecoveryPolicy_t *policy)
+{
+    dev->recovery.policy = *policy;
+    dev->recovery.failures = 0;
+    dev->recovery.state = DS1307_BREAKER_CLOSED;
+}
+
+/**
+ * @brief Enables adaptive transaction timeouts.
+ * Must be called after DS1307_Init() / DS1307_InitTransport(), which leave every transaction
+ * with the DS1307_TIMEOUT ceiling. The learned latencies are cleared. Backends round the
+ * timeouts to the resolution of their bus layer; on Linux i2c-dev that is 10 ms, which is
+ * then also the shortest timeout.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] clock Tick source timing the transactions, or NULL to use busHz only.
+ * @param[in] busHz Nominal SCL frequency used until latencies are learned, 0 if unknown.
+ * @param[in] slackUs Fixed allowance added to every timeout, in microseconds.
+ * @param[in] ceilingUs Hard ceiling of every timeout in microseconds, 0 for DS1307_TIMEOUT
+ *                      milliseconds.
+ */
+void DS1307_SetTimeouts(DS1307_Handle_t *dev, const DS1307_TickSource_t *clock, uint32_t busHz, uint32_t slackUs, uint32_t ceilingUs)
+{
+    memset(&dev->timeout, 0, sizeof(dev->timeout));
+    if (clock != NULL)
+    {
+        dev->timeout.clock = *clock;
+    }
+    dev->timeout.busHz = busHz;
+    dev->timeout.slackUs = slackUs;
+    dev->timeout.ceilingUs = ceilingUs;
+}
+
+#ifndef DS1307_NO_METRICS
+/**
+ * @brief Sets the tick source timing the transfers for the latency histograms.
+ * DS1307_Init() / DS1307_InitTransport() clear the metrics and leave them without a clock:
+ * counters run, histograms stay empty.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] clock Tick source, or NULL to stop timing.
+ */
+void DS1307_Metrics_SetClock(DS1307_Handle_t *dev, const DS1307_TickSource_t *clock)
+{
+    if (clock != NULL)
+    {
+        dev->metrics.clock = *clock;
+    }
+    else
+    {
+        memset(&dev->metrics.clock, 0, sizeof(dev->metrics.clock));
+    }
+}
+
+/**
+ * @brief Copies the counters and histograms of a device, optionally clearing them.
+ * The device statistics (dev->stats) are part of the metrics: they are copied into the
+ * snapshot and cleared with the rest. Not atomic with respect to an asynchronous
+ * completion of the same device.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] snapshot Receives the metrics, or NULL to only clear them.
+ * @param[in] reset Non-zero to clear the metrics after the copy.
+ */
+void DS1307_Metrics_Snapshot(DS1307_Handle_t *dev, DS1307_Metrics_t *snapshot, uint8_t reset)
+{
+    if (snapshot != NULL)
+    {
+        memcpy(snapshot, &dev->metrics.data, sizeof(*snapshot));
+        snapshot->stats = dev->stats;
+        snapshot->errors[DS1307_CIRCUIT_OPEN] = dev->stats.Rejected;
+    }
+    if (reset)
+    {
+        memset(&dev->metrics.data, 0, sizeof(dev->metrics.data));
+        memset(&dev->stats, 0, sizeof(dev->stats));
+    }
+}
+#endif
+
+/**
+ * @brief Sets the date and time of the DS1307 RTC in one transaction.
+ * The binary values are encoded to BCD and registers 0x00-0x06 are written in a single
+ * burst, so the RTC cannot roll over between the fields and no torn value is ever
+ * visible. The internal divider chain is reset by the write to the seconds register.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] dataWrite Binary date and time, hour in 24-hour format. A Day of 0 is
+ *                      replaced by the weekday of the date (1 = Sunday).
+ * @param[in] hourMode Hour format to store, or DS1307_HOURS_KEEP.
+ * @param[in] clockHalt CH bit to store, or DS1307_CH_KEEP.
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_INVALID_PARAM if a field is
+ *         out of range, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_WriteDateTime(DS1307_Handle_t *dev, const DS1307_DateTime_t *dataWrite, DS1307_HourMode_t hourMode, DS1307_ClockHalt_t clockHalt)
+{
+    DS1307_Status_t status; /**< Status of the mode read. */
+    uint8_t value[7];       /**< Timekeeping registers 0x00-0x06 in BCD. */
+
+    if (!DS1307_Time_Valid(&dataWrite->time) || !DS1307_Date_Valid(&dataWrite->date))
+    {
+        return DS1307_INVALID_PARAM;
+    }
+
+    status = DS1307_ResolveModes(dev, &hourMode, &clockHalt);
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+
+    DS1307_Time_to_Raw(&dataWrite->time, &value[D_DS1307_REG_SEC], hourMode, clockHalt);
+    DS1307_Date_to_Raw(&dataWrite->date, &value[D_DS1307_REG_DAY]);
+
+    /* One burst, so the RTC cannot roll over between the fields */
+    return DS1307_WriteReg(dev, D_DS1307_REG_SEC, value, sizeof(value));
+}
+
+/**
+ * @brief Sets the time of the DS1307 RTC in one transaction.
+ * Registers 0x00-0x02 are written in a single burst; the date is not touched.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] dataWrite Binary time, hour in 24-hour format.
+ * @param[in] hourMode Hour format to store, or DS1307_HOURS_KEEP.
+ * @param[in] clockHalt CH bit to store, or DS1307_CH_KEEP.
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_INVALID_PARAM if a field is
+ *         out of range, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_WriteTime(DS1307_Handle_t *dev, const DS1307_Time_t *dataWrite, DS1307_HourMode_t hourMode, DS1307_ClockHalt_t clockHalt)
+{
+    DS1307_Status_t status; /**< Status of the mode read. */
+    uint8_t value[3];       /**< Registers 0x00-0x02 in BCD. */
+
+    if (!DS1307_Time_Valid(dataWrite))
+    {
+        return DS1307_INVALID_PARAM;
     }
 
-    /* Copy data from the input buffer to the internal buffer */
-    for (int i = 0; i < dataLen; i++)
+    status = DS1307_ResolveModes(dev, &hourMode, &clockHalt);
+    if (status != DS1307_OK)
     {
-        value[i] = dataWrite[i];
+        return status;
     }
 
-    /* Perform I2C write operation to the specified register */
-    status = HAL_I2C_Mem_Write(&DS1307_I2C, D_DS1307_ADDR, regAdd, 1, value, dataLen, DS1307_TIMEOUT);
+    DS1307_Time_to_Raw(dataWrite, value, hourMode, clockHalt);
 
-    return status; /**< Return the status of the write operation. */
+    return DS1307_WriteReg(dev, D_DS1307_REG_SEC, value, sizeof(value));
+}
+
+/**
+ * @brief Sets the date of the DS1307 RTC in one transaction.
+ * Registers 0x03-0x06 are written in a single burst; the time, the CH bit and the hour
+ * format are not touched.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] dataWrite Binary date. A Day of 0 is replaced by the weekday of the date
+ *                      (1 = Sunday).
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_INVALID_PARAM if a field is
+ *         out of range, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_WriteDate(DS1307_Handle_t *dev, const DS1307_Date_t *dataWrite)
+{
+    uint8_t value[4]; /**< Registers 0x03-0x06 in BCD. */
+
+    if (!DS1307_Date_Valid(dataWrite))
+    {
+        return DS1307_INVALID_PARAM;
+    }
+
+    DS1307_Date_to_Raw(dataWrite, value);
+
+    return DS1307_WriteReg(dev, D_DS1307_REG_DAY, value, sizeof(value));
 }
 
 /**
@@ -181,24 +728,26 @@ DS1307_Status_t DS1307_WriteReg(uint8_t regAdd, uint8_t *dataWrite, uint8_t writ
  * This function reads the seconds, minutes, and hours from the DS1307 real-time 
  * clock (RTC) in binary format and stores the values in the provided DS1307_Time_t 
  * structure.
+ * The CH bit and the 12/24-hour control bits are masked off, and the hour is always
+ * returned in 24-hour format whatever mode the RTC runs in.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_Time_t structure where the read time values 
  *                      will be stored. The structure's fields are updated with the 
  *                      current time read from the RTC.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
  *         or an error code if the operation fails. 
  */
-DS1307_Status_t DS1307_ReadTime_Bin(DS1307_Time_t* dataRead)
+DS1307_Status_t DS1307_ReadTime_Bin(DS1307_Handle_t *dev, DS1307_Time_t* dataRead)
 {
     DS1307_Status_t status; /**< Status of the read operation. */
     uint8_t value[3] = {0}; /**< Buffer to hold the raw time data read from the RTC. */
 
     /* Read the seconds, minutes, and hours from the DS1307 registers */
-    status = DS1307_ReadReg(D_DS1307_REG_SEC, value, 3);
+    DS1307_METRICS_TAG(dev, DS1307_API_READ_TIME);
+    status = DS1307_ReadReg(dev, D_DS1307_REG_SEC, value, 3);
 
-    /* Store the read values into the DS1307_Time_t structure */
-    dataRead->Sec = value[0];  /**< Assign the seconds value to the structure. */
-    dataRead->Min = value[1];  /**< Assign the minutes value to the structure. */
-    dataRead->Hour = value[2]; /**< Assign the hours value to the structure. */
+    /* Decode the registers into binary values */
+    DS1307_Raw_to_Time(value, dataRead, 0);
 
 #ifdef DS1307_Debug
     /* Print the current time in HH:MM:SS format if debugging is enabled */
@@ -214,27 +763,26 @@ DS1307_Status_t DS1307_ReadTime_Bin(DS1307_Time_t* dataRead)
  * This function reads the seconds, minutes, and hours from the DS1307 real-time 
  * clock (RTC) in Binary-Coded Decimal (BCD) format and stores the values in the 
  * provided DS1307_Time_t structure.
+ * The CH bit and the 12/24-hour control bits are masked off, and the hour is always
+ * returned in 24-hour format whatever mode the RTC runs in.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_Time_t structure where the read time values 
  *                      will be stored. The structure's fields are updated with the 
  *                      current time read from the RTC in BCD format.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
  *         or an error code if the operation fails.
  */
-DS1307_Status_t DS1307_ReadTime_BCD(DS1307_Time_t* dataRead)
+DS1307_Status_t DS1307_ReadTime_BCD(DS1307_Handle_t *dev, DS1307_Time_t* dataRead)
 {
     DS1307_Status_t status; /**< Status of the read operation. */
     uint8_t value[3] = {0}; /**< Buffer to hold the raw time data read from the RTC in BCD format. */
 
     /* Read the seconds, minutes, and hours from the DS1307 registers in BCD format */
-    status = DS1307_ReadReg(D_DS1307_REG_SEC, value, 3);
+    DS1307_METRICS_TAG(dev, DS1307_API_READ_TIME);
+    status = DS1307_ReadReg(dev, D_DS1307_REG_SEC, value, 3);
 
-    /* Convert the BCD values to binary format */
-    DS1307_Bin_to_BCD(value, sizeof(value));
-
-    /* Store the converted values into the DS1307_Time_t structure */
-    dataRead->Sec = value[0];  /**< Assign the seconds value to the structure. */
-    dataRead->Min = value[1];  /**< Assign the minutes value to the structure. */
-    dataRead->Hour = value[2]; /**< Assign the hours value to the structure. */
+    /* Strip the control bits and keep the BCD values */
+    DS1307_Raw_to_Time(value, dataRead, 1);
 
 #ifdef DS1307_Debug
     /* Print the current time in HH:MM:SS format in BCD if debugging is enabled */
@@ -249,25 +797,23 @@ DS1307_Status_t DS1307_ReadTime_BCD(DS1307_Time_t* dataRead)
  * This function reads the day, date, month, and year from the DS1307 real-time 
  * clock (RTC) in binary format and stores the values in the provided DS1307_Date_t 
  * structure.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_Date_t structure where the read date values 
  *                      will be stored. The structure's fields are updated with the 
  *                      current date read from the RTC in binary format.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
  *         or an error code if the operation fails.
  */
-DS1307_Status_t DS1307_ReadDate_Bin(DS1307_Date_t* dataRead)
+DS1307_Status_t DS1307_ReadDate_Bin(DS1307_Handle_t *dev, DS1307_Date_t* dataRead)
 {
     DS1307_Status_t status; /**< Status of the read operation. */
     uint8_t value[4] = {0}; /**< Buffer to hold the raw date data read from the RTC in binary format. */
 
     /* Read the day, date, month, and year from the DS1307 registers in binary format */
-    status = DS1307_ReadReg(D_DS1307_REG_DAY, value, 4);
+    status = DS1307_ReadReg(dev, D_DS1307_REG_DAY, value, 4);
 
-    /* Store the read values into the DS1307_Date_t structure */
-    dataRead->Day = value[0];   /**< Assign the day value to the structure. */
-    dataRead->Date = value[1];  /**< Assign the date value to the structure. */
-    dataRead->Month = value[2]; /**< Assign the month value to the structure. */
-    dataRead->Year = value[3];  /**< Assign the year value to the structure. */
+    /* Decode the registers into binary values */
+    DS1307_Raw_to_Date(value, dataRead, 0);
 
 #ifdef DS1307_Debug
     /* Print the current date in Day: Date-Month-Year format if debugging is enabled */
@@ -282,28 +828,23 @@ DS1307_Status_t DS1307_ReadDate_Bin(DS1307_Date_t* dataRead)
  * This function reads the day, date, month, and year from the DS1307 real-time 
  * clock (RTC) in Binary-Coded Decimal (BCD) format and stores the values in the 
  * provided DS1307_Date_t structure.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_Date_t structure where the read date values 
  *                      will be stored. The structure's fields are updated with the 
  *                      current date read from the RTC in BCD format.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
  *         or an error code if the operation fails.
  */
-DS1307_Status_t DS1307_ReadDate_BCD(DS1307_Date_t *dataRead)
+DS1307_Status_t DS1307_ReadDate_BCD(DS1307_Handle_t *dev, DS1307_Date_t *dataRead)
 {
     DS1307_Status_t status; /**< Status of the read operation. */
     uint8_t value[4] = {0}; /**< Buffer to hold the raw date data read from the RTC in BCD format. */
 
     /* Read the day, date, month, and year from the DS1307 registers in binary format */
-    status = DS1307_ReadReg(D_DS1307_REG_DAY, value, 4);
-
-    /* Convert the binary data to BCD format */
-    DS1307_Bin_to_BCD(value, sizeof(value));
+    status = DS1307_ReadReg(dev, D_DS1307_REG_DAY, value, 4);
 
-    /* Store the converted BCD values into the DS1307_Date_t structure */
-    dataRead->Day = value[0];   /**< Assign the BCD day value to the structure. */
-    dataRead->Date = value[1];  /**< Assign the BCD date value to the structure. */
-    dataRead->Month = value[2]; /**< Assign the BCD month value to the structure. */
-    dataRead->Year = value[3];  /**< Assign the BCD year value to the structure. */
+    /* Strip the control bits and keep the BCD values */
+    DS1307_Raw_to_Date(value, dataRead, 1);
 
 #ifdef DS1307_Debug
     /* Print the current date in BCD format if debugging is enabled */
@@ -317,25 +858,36 @@ DS1307_Status_t DS1307_ReadDate_BCD(DS1307_Date_t *dataRead)
  * @brief Reads the current date and time from the DS1307 RTC in binary format.
  * This function reads the date and time from the DS1307 real-time clock (RTC) in 
  * binary format and stores the values in the provided DS1307_DateTime_t structure. 
- * The function first reads the date and then reads the time.
+ * Registers 0x00-0x06 are fetched in a single I2C burst, so the date and the time are
+ * sampled at the same instant and cannot tear across a midnight rollover.
+ * The CH bit and the 12/24-hour control bits are masked off, and the hour is always
+ * returned in 24-hour format whatever mode the RTC runs in.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_DateTime_t structure where the read date and 
  *                      time values will be stored. The structure's fields are updated 
  *                      with the current date and time read from the RTC in binary format.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
- *         or an error code if the operation fails. If an error occurs during either 
- *         date or time read, the function returns the status of the last operation.
+ *         or an error code if the burst read fails.
  */
-DS1307_Status_t DS1307_ReadDateTime_Bin(DS1307_DateTime_t *dataRead)
+DS1307_Status_t DS1307_ReadDateTime_Bin(DS1307_Handle_t *dev, DS1307_DateTime_t *dataRead)
 {
-    DS1307_Status_t status; /**< Status of the read operation. */
+    DS1307_Status_t status;  /**< Status of the read operation. */
+    uint8_t value[7] = {0};  /**< Buffer to hold the raw timekeeping registers 0x00-0x06. */
+
+    /* Read seconds through year in a single burst so date and time come from the same instant */
+    DS1307_METRICS_TAG(dev, DS1307_API_READ_DATETIME);
+    status = DS1307_ReadReg(dev, D_DS1307_REG_SEC, value, sizeof(value));
 
-    /* Read the current date in binary format and store it in the date field of the structure */
-    status = DS1307_ReadDate_Bin(&dataRead->date);
+    /* Decode the registers into binary values */
+    DS1307_Raw_to_DateTime(value, dataRead, 0);
 
-    /* Read the current time in binary format and store it in the time field of the structure */
-    status = DS1307_ReadTime_Bin(&dataRead->time);
+#ifdef DS1307_Debug
+    /* Print the current date and time if debugging is enabled */
+    printf("\nDay: %d Date: %d-%d-%d Time is %d:%d:%d", dataRead->date.Day, dataRead->date.Date,
+           dataRead->date.Month, dataRead->date.Year, dataRead->time.Hour, dataRead->time.Min, dataRead->time.Sec);
+#endif
 
-    return status; /**< Return the status of the last read operation (time read). */
+    return status; /**< Return the status of the burst read operation. */
 }
 
 /**
@@ -343,40 +895,2147 @@ DS1307_Status_t DS1307_ReadDateTime_Bin(DS1307_DateTime_t *dataRead)
  * 
  * This function reads the date and time from the DS1307 real-time clock (RTC) in 
  * Binary-Coded Decimal (BCD) format and stores the values in the provided 
- * DS1307_DateTime_t structure. The function first reads the date and then reads the time.
+ * DS1307_DateTime_t structure. Registers 0x00-0x06 are fetched in a single I2C burst,
+ * so the date and the time are sampled at the same instant.
+ * The CH bit and the 12/24-hour control bits are masked off, and the hour is always
+ * returned in 24-hour format whatever mode the RTC runs in.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_DateTime_t structure where the read date and 
  *                      time values will be stored. The structure's fields are updated 
  *                      with the current date and time read from the RTC in BCD format.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
- *         or an error code if the operation fails. If an error occurs during either 
- *         date or time read, the function returns the status of the last operation.
+ *         or an error code if the burst read fails.
  */
-DS1307_Status_t DS1307_ReadDateTime_BCD(DS1307_DateTime_t *dataRead)
+DS1307_Status_t DS1307_ReadDateTime_BCD(DS1307_Handle_t *dev, DS1307_DateTime_t *dataRead)
 {
-    DS1307_Status_t status; /**< Status of the read operation. */
+    DS1307_Status_t status;  /**< Status of the read operation. */
+    uint8_t value[7] = {0};  /**< Buffer to hold the raw timekeeping registers 0x00-0x06. */
+
+    /* Read seconds through year in a single burst so date and time come from the same instant */
+    DS1307_METRICS_TAG(dev, DS1307_API_READ_DATETIME);
+    status = DS1307_ReadReg(dev, D_DS1307_REG_SEC, value, sizeof(value));
+
+    /* Strip the control bits and keep the BCD values */
+    DS1307_Raw_to_DateTime(value, dataRead, 1);
+
+#ifdef DS1307_Debug
+    /* Print the current date and time in BCD if debugging is enabled */
+    printf("\nDay: %02X Date: %02X-%02X-%02X Time is %02X:%02X:%02X", dataRead->date.Day, dataRead->date.Date,
+           dataRead->date.Month, dataRead->date.Year, dataRead->time.Hour, dataRead->time.Min, dataRead->time.Sec);
+#endif
+
+    return status; /**< Return the status of the burst read operation. */
+}
+
+/**
+ * @brief Starts a non-blocking read of consecutive DS1307 registers.
+ * The transfer runs in the background; @p callback is invoked from interrupt context once
+ * @p dataRead holds the register contents.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd The address of the register to read from.
+ * @param[out] dataRead Pointer to the buffer receiving the data. Must stay valid until the
+ *                      callback has run.
+ * @param[in] readLen The number of bytes to read.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, DS1307_BUSY if a
+ *         transfer is already in flight on the device or bus, DS1307_DATA_SIZE_ERROR for
+ *         an invalid length, or DS1307_ERROR if the transport has no asynchronous mode.
+ */
+DS1307_Status_t DS1307_ReadReg_IT(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t *dataRead, uint8_t readLen, DS1307_Callback_t callback, void *userData)
+{
+    /* Reject empty transfers and transfers that would wrap past register 0x3F */
+    if ((readLen == 0) || ((uint16_t)regAdd + readLen > DS1307_MAX_BUFF_SIZE))
+    {
+        return DS1307_DATA_SIZE_ERROR;
+    }
+
+    return DS1307_AsyncRead(dev, DS1307_OP_REG, regAdd, dataRead, readLen, NULL, callback, userData);
+}
+
+/**
+ * @brief Starts a non-blocking write of consecutive DS1307 registers.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd The address of the register to write to.
+ * @param[in] dataWrite Pointer to the data to write. Must stay valid until the callback
+ *                      has run.
+ * @param[in] writeLen The number of bytes to write.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_WriteReg_IT(DS1307_Handle_t *dev, uint8_t regAdd, const uint8_t *dataWrite, uint8_t writeLen, DS1307_Callback_t callback, void *userData)
+{
+    DS1307_Status_t status; /**< Status of the transfer start. */
+
+    /* Reject empty transfers and transfers that would wrap past register 0x3F */
+    if ((writeLen == 0) || ((uint16_t)regAdd + writeLen > DS1307_MAX_BUFF_SIZE))
+    {
+        return DS1307_DATA_SIZE_ERROR;
+    }
+
+    if (dev->transport->WriteRegsAsync == NULL)
+    {
+        return DS1307_ERROR; /**< The transport has no asynchronous mode. */
+    }
+
+    if (!DS1307_Async_Claim(dev))
+    {
+        return DS1307_BUSY; /**< A transfer is already in flight on this device. */
+    }
+
+    dev->async.op = DS1307_OP_REG;
+    dev->async.dst = NULL;
+    dev->async.cb = callback;
+    dev->async.userData = userData;
 
-    /* Read the current date in BCD format and store it in the date field of the structure */
-    status = DS1307_ReadDate_BCD(&dataRead->date);
+    /* The outcome is only known in the completion interrupt: forget the shadow of the range */
+    dev->shadow.valid &= ~DS1307_RegMask(regAdd, writeLen);
+    dev->shadow.dirty &= ~DS1307_RegMask(regAdd, writeLen);
+#ifndef DS1307_NO_METRICS
+    DS1307_Metrics_AsyncStart(dev, DS1307_OP_REG, writeLen, 1);
+#endif
+
+    status = dev->transport->WriteRegsAsync(dev->bus, dev->addr, regAdd, dataWrite, writeLen, dev);
+    if (status != DS1307_OK)
+    {
+        dev->async.busy = 0; /**< The transfer was not started, release the device. */
+    }
+
+    return status;
+}
+
+/**
+ * @brief Starts a non-blocking read of the current time in binary format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadTime_Bin() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the time. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_ReadTime_Bin_IT(DS1307_Handle_t *dev, DS1307_Time_t* dataRead, DS1307_Callback_t callback, void *userData)
+{
+    return DS1307_AsyncRead(dev, DS1307_OP_TIME_BIN, D_DS1307_REG_SEC, dev->async.raw, 3, dataRead, callback, userData);
+}
+
+/**
+ * @brief Starts a non-blocking read of the current time in BCD format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadTime_BCD() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the time. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_ReadTime_BCD_IT(DS1307_Handle_t *dev, DS1307_Time_t* dataRead, DS1307_Callback_t callback, void *userData)
+{
+    return DS1307_AsyncRead(dev, DS1307_OP_TIME_BCD, D_DS1307_REG_SEC, dev->async.raw, 3, dataRead, callback, userData);
+}
 
-    /* Read the current time in BCD format and store it in the time field of the structure */
-    status = DS1307_ReadTime_BCD(&dataRead->time);
+/**
+ * @brief Starts a non-blocking read of the current date in binary format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadDate_Bin() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the date. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_ReadDate_Bin_IT(DS1307_Handle_t *dev, DS1307_Date_t* dataRead, DS1307_Callback_t callback, void *userData)
+{
+    return DS1307_AsyncRead(dev, DS1307_OP_DATE_BIN, D_DS1307_REG_DAY, dev->async.raw, 4, dataRead, callback, userData);
+}
+
+/**
+ * @brief Starts a non-blocking read of the current date in BCD format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadDate_BCD() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the date. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_ReadDate_BCD_IT(DS1307_Handle_t *dev, DS1307_Date_t* dataRead, DS1307_Callback_t callback, void *userData)
+{
+    return DS1307_AsyncRead(dev, DS1307_OP_DATE_BCD, D_DS1307_REG_DAY, dev->async.raw, 4, dataRead, callback, userData);
+}
 
-    return status; /**< Return the status of the last read operation (time read). */
+/**
+ * @brief Starts a non-blocking read of the current date and time in binary format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadDateTime_Bin() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the date and time. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_ReadDateTime_Bin_IT(DS1307_Handle_t *dev, DS1307_DateTime_t* dataRead, DS1307_Callback_t callback, void *userData)
+{
+    return DS1307_AsyncRead(dev, DS1307_OP_DATETIME_BIN, D_DS1307_REG_SEC, dev->async.raw, 7, dataRead, callback, userData);
 }
 
 /**
- * @brief Converts binary values in an array to binary-coded decimal (BCD) format.
- * This function converts each element of the provided data array from binary format
- * to binary-coded decimal (BCD) format. The conversion is performed by calculating
- * the tens and units place of each value and combining them into a BCD representation.
- * @param[in,out] data Pointer to the array of binary values to be converted to BCD.
- * @param[in] len Length of the data array.
- * @note The function assumes that the input data array contains values in binary format.
+ * @brief Starts a non-blocking read of the current date and time in BCD format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadDateTime_BCD() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the date and time. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
  */
-void DS1307_Bin_to_BCD(uint8_t* data, uint8_t len)
+DS1307_Status_t DS1307_ReadDateTime_BCD_IT(DS1307_Handle_t *dev, DS1307_DateTime_t* dataRead, DS1307_Callback_t callback, void *userData)
 {
-    for (int i = 0; i < len; i++)
+    return DS1307_AsyncRead(dev, DS1307_OP_DATETIME_BCD, D_DS1307_REG_SEC, dev->async.raw, 7, dataRead, callback, userData);
+}
+
+/**
+ * @brief Reports the end of an asynchronous transfer to the driver.
+ * Called by transport backends (typically from the I2C transfer-complete or error
+ * interrupt) for the device passed to ReadRegsAsync / WriteRegsAsync. Decodes the
+ * result if needed, releases the device and invokes the user callback.
+ * @param[in,out] dev Pointer to the DS1307 device handle that started the transfer.
+ * @param[in] status DS1307_OK if the transfer completed, or an error code.
+ */
+void DS1307_AsyncComplete(DS1307_Handle_t *dev, DS1307_Status_t status)
+{
+    DS1307_Callback_t callback = dev->async.cb;     /**< Callback captured before the device is released. */
+    void *userData = dev->async.userData;           /**< User pointer captured before the device is released. */
+    uint8_t *raw = dev->async.raw;                  /**< Raw registers of time/date reads. */
+
+    dev->stats.Transactions++;
+#ifndef DS1307_NO_METRICS
+    if (status != DS1307_OK)
+    {
+        DS1307_Metrics_Error(dev, status);
+    }
+    DS1307_Metrics_Transfer(dev, dev->metrics.asyncApi, dev->metrics.asyncStart,
+                            ((status == DS1307_OK) && !dev->metrics.asyncWrite) ? dev->metrics.asyncLen : 0,
+                            ((status == DS1307_OK) && dev->metrics.asyncWrite) ? dev->metrics.asyncLen : 0);
+#endif
+    if (status != DS1307_OK)
+    {
+        dev->stats.Errors++;
+    }
+    else
+    {
+        /* Apply the same decode as the blocking variant of the operation */
+        switch (dev->async.op)
+        {
+        case DS1307_OP_TIME_BIN:
+        case DS1307_OP_TIME_BCD:
+            DS1307_Raw_to_Time(raw, (DS1307_Time_t *)dev->async.dst, dev->async.op == DS1307_OP_TIME_BCD);
+            break;
+        case DS1307_OP_DATE_BIN:
+        case DS1307_OP_DATE_BCD:
+            DS1307_Raw_to_Date(raw, (DS1307_Date_t *)dev->async.dst, dev->async.op == DS1307_OP_DATE_BCD);
+            break;
+        case DS1307_OP_DATETIME_BIN:
+        case DS1307_OP_DATETIME_BCD:
+            DS1307_Raw_to_DateTime(raw, (DS1307_DateTime_t *)dev->async.dst, dev->async.op == DS1307_OP_DATETIME_BCD);
+            break;
+        case DS1307_OP_SNAPSHOT:
+            /* The registers were read straight into the ring slot, publish it */
+            dev->sampler.head = (uint16_t)((dev->sampler.head + 1) % dev->sampler.size);
+            break;
+        default:
+            break;
+        }
+    }
+
+    /* Release the device before the callback so it can chain the next transfer */
+    dev->async.busy = 0;
+
+    if (callback != NULL)
+    {
+        callback(dev, status, userData);
+    }
+}
+
+/**
+ * @brief Starts sampling the timekeeping registers on every 1 Hz SQW edge.
+ * Programs the SQW/OUT pin for a 1 Hz square wave (_1Hz) and arms the sampler. From then
+ * on each call to DS1307_Sampler_OnEdge() starts an asynchronous burst read of registers
+ * 0x00-0x06 straight into the next free ring slot; the transfer-complete interrupt only
+ * publishes the slot. With DS1307_Transport_HAL_DMA the register bytes are moved by DMA,
+ * so the CPU is not involved until a consumer drains the ring.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] slots Ring storage for the snapshots. Must stay valid until
+ *                   DS1307_Sampler_Stop(). With DMA, it must be DMA-accessible memory.
+ * @param[in] size Number of slots (at least 2; one slot is always kept free).
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_DATA_SIZE_ERROR if size is
+ *         below 2, DS1307_ERROR if the transport has no asynchronous mode, or the status
+ *         of the control register write.
+ */
+DS1307_Status_t DS1307_Sampler_Start(DS1307_Handle_t *dev, DS1307_Snapshot_t *slots, uint16_t size)
+{
+    DS1307_Status_t status = DS1307_OK; /**< Status of the control register update. */
+
+    if (size < 2)
+    {
+        return DS1307_DATA_SIZE_ERROR; /**< A ring needs one free slot to tell full from empty. */
+    }
+
+    if (dev->transport->ReadRegsAsync == NULL)
+    {
+        return DS1307_ERROR; /**< The transport has no asynchronous mode. */
+    }
+
+    /* Route the 1 Hz square wave to SQW/OUT; the flush writes only if it differs */
+    DS1307_SetSQW(dev, _1Hz);
+    status = DS1307_Shadow_Flush(dev);
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+
+    dev->sampler.active = 0;
+    dev->sampler.slots = slots;
+    dev->sampler.size = size;
+    dev->sampler.head = 0;
+    dev->sampler.tail = 0;
+    dev->sampler.overruns = 0;
+    dev->sampler.active = 1;
+
+    return status;
+}
+
+/**
+ * @brief Reports a SQW edge to the sampler.
+ * Call from the EXTI interrupt of the pin wired to SQW/OUT. Starts the snapshot read if
+ * the ring has room and the device is idle, otherwise counts an overrun.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_Sampler_OnEdge(DS1307_Handle_t *dev)
+{
+    DS1307_Sampler_t *sampler = &dev->sampler; /**< Sampler state. */
+    uint16_t next;                             /**< Slot after the one to fill. */
+
+    if (!sampler->active)
+    {
+        return;
+    }
+
+    next = (uint16_t)((sampler->head + 1) % sampler->size);
+
+    /* Drop the edge if the ring is full or the previous read has not finished */
+    if ((next == sampler->tail) ||
+        (DS1307_AsyncRead(dev, DS1307_OP_SNAPSHOT, D_DS1307_REG_SEC, sampler->slots[sampler->head].reg,
+                          sizeof(sampler->slots[0].reg), NULL, NULL, NULL) != DS1307_OK))
+    {
+        sampler->overruns++;
+    }
+}
+
+/**
+ * @brief Takes the oldest snapshot out of the ring.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] snapshot Pointer receiving the raw registers.
+ * @return uint8_t 1 if a snapshot was returned, 0 if the ring is empty.
+ */
+uint8_t DS1307_Sampler_Pop(DS1307_Handle_t *dev, DS1307_Snapshot_t *snapshot)
+{
+    DS1307_Sampler_t *sampler = &dev->sampler; /**< Sampler state. */
+    uint16_t tail = sampler->tail;             /**< Oldest unread slot. */
+
+    if (tail == sampler->head)
+    {
+        return 0; /**< Ring is empty. */
+    }
+
+    *snapshot = sampler->slots[tail];
+    sampler->tail = (uint16_t)((tail + 1) % sampler->size);
+
+    return 1;
+}
+
+/**
+ * @brief Stops the sampler. Edges are ignored afterwards; a read already in flight
+ *        still completes into the ring.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_Sampler_Stop(DS1307_Handle_t *dev)
+{
+    dev->sampler.active = 0;
+}
+
+/**
+ * @brief Decodes a raw timekeeping snapshot (registers 0x00-0x06) to binary values.
+ * The seven bytes are loaded into one 64-bit word. The CH, 12/24-hour and AM/PM bits are
+ * masked and every field is converted from BCD with a single SWAR step,
+ * value - 6 * (value >> 4), applied to all bytes at once. Only a 12-hour hour needs a
+ * fix-up afterwards, done without branches. The result matches DS1307_ReadDateTime_Bin():
+ * the hour is always reported in 24-hour format. No bus access is made, so the function
+ * can be used on snapshots returned by DS1307_Sampler_Pop() or on register dumps
+ * collected elsewhere.
+ * @param[in] raw Pointer to the 7 bytes read from registers 0x00-0x06 (seconds to year).
+ * @param[out] dataRead Pointer to the DS1307_DateTime_t structure to fill.
+ */
+void DS1307_DecodeSnapshot(const uint8_t *raw, DS1307_DateTime_t *dataRead)
+{
+    uint64_t word;                       /**< Registers 0x00-0x06, register 0x00 in the low byte. */
+    uint64_t tens;                       /**< Tens digit of every field, one per byte. */
+    uint8_t hrs = raw[D_DS1307_REG_HRS]; /**< Raw hours register, for the 12-hour fix-up. */
+    uint8_t mode12;                      /**< 1 in 12-hour mode. */
+    uint8_t pm;                          /**< 1 for a 12-hour PM hour. */
+    uint8_t hour;                        /**< Decoded hour. */
+
+    mode12 = (uint8_t)((hrs >> D_DS1307_BIT_HRS) & 1);
+    pm = (uint8_t)((hrs >> D_DS1307_BIT_AMPM) & mode12);
+
+    /* Shift-or of each half: independent of host endianness and alignment, and compilers
+       fold it into plain loads on little-endian hosts */
+    word = (uint64_t)((uint32_t)raw[0] | ((uint32_t)raw[1] << 8) | ((uint32_t)raw[2] << 16) |
+                      ((uint32_t)raw[3] << 24)) |
+           ((uint64_t)((uint32_t)raw[4] | ((uint32_t)raw[5] << 8) | ((uint32_t)raw[6] << 16)) << 32);
+
+    /* In 12-hour mode bit 5 of the hours register is AM/PM, not the tens of the hour */
+    word &= DS1307_SWAR_MASK & ~((uint64_t)(mode12 << D_DS1307_BIT_AMPM) << (8 * D_DS1307_REG_HRS));
+
+    /* tens*10 + units == bcd - 6*tens, and no byte can borrow from its neighbour */
+    tens = (word >> 4) & 0x0F0F0F0F0F0F0F0FULL;
+    word -= tens * 6;
+
+    /* 12 AM is 00, 12 PM is 12, PM adds 12; branch-free, as snapshots of mixed modes
+       would otherwise mispredict */
+    hour = (uint8_t)(word >> (8 * D_DS1307_REG_HRS));
+    hour = (uint8_t)(hour - 12 * (mode12 & (hour == 12)) + 12 * pm);
+
+    dataRead->time.Sec = (uint8_t)(word >> (8 * D_DS1307_REG_SEC));
+    dataRead->time.Min = (uint8_t)(word >> (8 * D_DS1307_REG_MIN));
+    dataRead->time.Hour = hour;
+    dataRead->date.Day = (uint8_t)(word >> (8 * D_DS1307_REG_DAY));
+    dataRead->date.Date = (uint8_t)(word >> (8 * D_DS1307_REG_DATE));
+    dataRead->date.Month = (uint8_t)(word >> (8 * D_DS1307_REG_MONTH));
+    dataRead->date.Year = (uint8_t)(word >> (8 * D_DS1307_REG_YEAR));
+}
+
+/**
+ * @brief Converts a binary date and time to Unix time.
+ * Uses a days-from-civil computation on a year that starts on 1 March, which puts the
+ * leap day at the end of the year and needs no month table and no loop. Valid for years
+ * 2000-2099 (Year 0-99), where every year divisible by 4 is a leap year. The Day field is
+ * ignored and the fields are not range-checked.
+ * @param[in] dateTime Pointer to the binary date and time (24-hour format).
+ * @return uint32_t Seconds since 1970-01-01 00:00:00.
+ */
+uint32_t DS1307_DateTime_to_Epoch(const DS1307_DateTime_t* dateTime)
+{
+    uint32_t month = dateTime->date.Month;                     /**< Month, 1-12. */
+    uint32_t early = (month <= 2u) ? 1u : 0u;                  /**< 1 for January and February, which belong to the previous year. */
+    uint32_t year = dateTime->date.Year + 4u - early;          /**< Years since 1996-03-01. */
+    uint32_t monthIndex = month + (12u * early) - 3u;          /**< Month of the year, March = 0. */
+    uint32_t days;                                             /**< Days since 1970-01-01. */
+
+    days = DS1307_DAYS_TO_1996_03_01 + (365u * year) + (year >> 2) + (((153u * monthIndex) + 2u) / 5u) + dateTime->date.Date - 1u;
+
+    return (days * DS1307_SECONDS_PER_DAY) + (dateTime->time.Hour * 3600u) + (dateTime->time.Min * 60u) + dateTime->time.Sec;
+}
+
+/**
+ * @brief Converts Unix time to a binary date and time.
+ * Inverse of DS1307_DateTime_to_Epoch(). The day of week is computed as well, with
+ * 1 = Sunday through 7 = Saturday.
+ * @param[in] epoch Seconds since 1970-01-01 00:00:00, DS1307_EPOCH_MIN to DS1307_EPOCH_MAX.
+ * @param[out] dateTime Pointer to the DS1307_DateTime_t structure to fill (24-hour format).
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_INVALID_PARAM if epoch lies outside
+ *         the years 2000-2099.
+ */
+DS1307_Status_t DS1307_Epoch_to_DateTime(uint32_t epoch, DS1307_DateTime_t* dateTime)
+{
+    uint32_t days;         /**< Days since 1970-01-01. */
+    uint32_t secs;         /**< Seconds into the day. */
+    uint32_t year;         /**< Years since 1996-03-01. */
+    uint32_t dayOfYear;    /**< Day of the year, 1 March = 0. */
+    uint32_t monthIndex;   /**< Month of the year, March = 0. */
+    uint32_t early;        /**< 1 for January and February. */
+
+    if ((epoch < DS1307_EPOCH_MIN) || (epoch > DS1307_EPOCH_MAX))
+    {
+        return DS1307_INVALID_PARAM;
+    }
+
+    days = epoch / DS1307_SECONDS_PER_DAY;
+    secs = epoch - (days * DS1307_SECONDS_PER_DAY);
+
+    /* 1970-01-01 was a Thursday (5) */
+    dateTime->date.Day = (uint8_t)(((days + 4u) % 7u) + 1u);
+
+    days -= DS1307_DAYS_TO_1996_03_01;
+    year = ((4u * days) + 3u) / DS1307_DAYS_PER_4_YEARS;
+    dayOfYear = days - ((365u * year) + (year >> 2));
+    monthIndex = ((5u * dayOfYear) + 2u) / 153u;
+    early = (monthIndex >= 10u) ? 1u : 0u;
+
+    dateTime->date.Date = (uint8_t)(dayOfYear - (((153u * monthIndex) + 2u) / 5u) + 1u);
+    dateTime->date.Month = (uint8_t)(monthIndex + 3u - (12u * early));
+    dateTime->date.Year = (uint8_t)(year + early - 4u);
+    dateTime->time.Hour = (uint8_t)(secs / 3600u);
+    secs -= dateTime->time.Hour * 3600u;
+    dateTime->time.Min = (uint8_t)(secs / 60u);
+    dateTime->time.Sec = (uint8_t)(secs - (dateTime->time.Min * 60u));
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Reads the current date and time from the DS1307 RTC as Unix time.
+ * Registers 0x00-0x06 are fetched in a single burst, as in DS1307_ReadDateTime_Bin().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] epoch Pointer to the seconds since 1970-01-01 00:00:00.
+ * @return DS1307_Status_t Status of the burst read operation.
+ */
+DS1307_Status_t DS1307_ReadEpoch(DS1307_Handle_t *dev, uint32_t *epoch)
+{
+    DS1307_DateTime_t dateTime; /**< Decoded date and time. */
+    DS1307_Status_t status;     /**< Status of the read operation. */
+
+    status = DS1307_ReadDateTime_Bin(dev, &dateTime);
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+
+    *epoch = DS1307_DateTime_to_Epoch(&dateTime);
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Sets the DS1307 RTC from Unix time.
+ * The date, time and day of week are written to registers 0x00-0x06 in a single burst.
+ * The clock is left running (CH cleared) in 24-hour mode.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] epoch Seconds since 1970-01-01 00:00:00, DS1307_EPOCH_MIN to DS1307_EPOCH_MAX.
+ * @return DS1307_Status_t Status of the burst write operation, or DS1307_INVALID_PARAM if
+ *         epoch lies outside the years 2000-2099.
+ */
+DS1307_Status_t DS1307_WriteEpoch(DS1307_Handle_t *dev, uint32_t epoch)
+{
+    DS1307_DateTime_t dateTime; /**< Date and time to write. */
+    DS1307_Status_t status;     /**< Status of the conversion. */
+
+    status = DS1307_Epoch_to_DateTime(epoch, &dateTime);
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+
+    /* Keep the oscillator running in 24-hour mode */
+    return DS1307_WriteDateTime(dev, &dateTime, DS1307_HOURS_24, DS1307_CH_RUN);
+}
+
+/**
+ * @brief Starts the SQW-driven software clock.
+ * Programs the SQW/OUT pin for a 1 Hz square wave (_1Hz), reads the date and time once
+ * from the RTC and from then on keeps them in RAM. DS1307_SoftClock_Tick() must be called
+ * on every SQW edge at which the seconds register increments (the falling edge of the
+ * 1 Hz output); DS1307_SoftClock_Get() then returns the time without any bus access.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] resyncInterval Number of seconds after which the clock is re-read from the
+ *                           RTC by DS1307_SoftClock_Service(), 0 to never resynchronise.
+ * @return DS1307_Status_t Returns DS1307_OK on success, or the status of the failed
+ *         control register write or time read.
+ */
+DS1307_Status_t DS1307_SoftClock_Start(DS1307_Handle_t *dev, uint32_t resyncInterval)
+{
+    DS1307_SoftClock_t *clock = &dev->softClock; /**< Software clock state. */
+    DS1307_Status_t status;                      /**< Status of the bus operations. */
+    uint8_t raw[7];                              /**< Raw timekeeping registers 0x00-0x06. */
+
+    clock->active = 0;
+
+    /* Route the 1 Hz square wave to SQW/OUT; the flush writes only if it differs */
+    DS1307_SetSQW(dev, _1Hz);
+    status = DS1307_Shadow_Flush(dev);
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+
+    /* Seed the RAM copy from the hardware */
+    status = DS1307_ReadReg(dev, D_DS1307_REG_SEC, raw, sizeof(raw));
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+
+    DS1307_Raw_to_DateTime(raw, &clock->now, 0);
+    clock->seq = 0;
+    clock->ticks = 0;
+    clock->sinceSync = 0;
+    clock->resyncInterval = resyncInterval;
+    clock->resyncPending = 0;
+    clock->syncReady = 0;
+
+    /* The edge handler must see the seeded state before it sees the clock active */
+    DS1307_BARRIER();
+    clock->active = 1;
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Advances the software clock by one second.
+ * Call from the EXTI interrupt of the pin wired to SQW/OUT. Handles minute, hour, day,
+ * month, year and leap-year rollovers (years 2000-2099) and flags a resynchronisation
+ * once the configured interval has elapsed.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_SoftClock_Tick(DS1307_Handle_t *dev)
+{
+    DS1307_SoftClock_t *clock = &dev->softClock; /**< Software clock state. */
+    uint32_t lag;                                /**< Edges seen since syncValue was read. */
+
+    if (!clock->active)
+    {
+        return;
+    }
+
+    clock->ticks++;
+    clock->seq++; /**< Odd: readers retry until the update is finished. */
+    DS1307_BARRIER();
+
+    if (clock->syncReady)
+    {
+        /* Apply the hardware reading, advanced by the edges that passed since it was taken */
+        DS1307_BARRIER();
+        clock->now = clock->syncValue;
+        for (lag = clock->ticks - clock->syncTicks; lag > 0; lag--)
+        {
+            DS1307_DateTime_Increment(&clock->now);
+        }
+        clock->syncReady = 0;
+        clock->sinceSync = 0;
+    }
+    else
+    {
+        DS1307_DateTime_Increment(&clock->now);
+        clock->sinceSync++;
+    }
+
+    DS1307_BARRIER();
+    clock->seq++; /**< Even again: the update is complete. */
+
+    if ((clock->resyncInterval != 0) && (clock->sinceSync >= clock->resyncInterval))
+    {
+        clock->resyncPending = 1;
+    }
+}
+
+/**
+ * @brief Returns the current date and time of the software clock.
+ * Reads only RAM; safe to call at any rate and concurrently with DS1307_SoftClock_Tick().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer receiving the date and time (binary, 24-hour format).
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_ERROR if the software clock is
+ *         not running.
+ */
+DS1307_Status_t DS1307_SoftClock_Get(DS1307_Handle_t *dev, DS1307_DateTime_t *dataRead)
+{
+    DS1307_SoftClock_t *clock = &dev->softClock; /**< Software clock state. */
+    uint32_t seq;                                /**< Sequence counter before the copy. */
+
+    if (!clock->active)
+    {
+        return DS1307_ERROR;
+    }
+
+    /* Copy until no edge handler update overlapped the copy */
+    do
+    {
+        seq = clock->seq;
+        DS1307_BARRIER();
+        *dataRead = clock->now;
+        DS1307_BARRIER();
+    } while ((seq & 1u) || (seq != clock->seq));
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Performs a pending hardware resynchronisation of the software clock.
+ * Call periodically from task context (not from an interrupt). Does nothing unless the
+ * resynchronisation interval has elapsed; otherwise re-reads the RTC in one burst and
+ * replaces the RAM copy.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @return DS1307_Status_t Returns DS1307_OK if nothing was due or the resynchronisation
+ *         succeeded, or the status of the failed read (the RAM copy is kept and the
+ *         resynchronisation is retried on the next call).
+ */
+DS1307_Status_t DS1307_SoftClock_Service(DS1307_Handle_t *dev)
+{
+    DS1307_SoftClock_t *clock = &dev->softClock; /**< Software clock state. */
+    DS1307_Status_t status;                      /**< Status of the hardware read. */
+    uint32_t ticks;                              /**< Edge count before the hardware read. */
+    uint8_t raw[7];                              /**< Raw timekeeping registers 0x00-0x06. */
+
+    if (!clock->active || !clock->resyncPending || clock->syncReady)
+    {
+        return DS1307_OK; /**< Nothing due, or a reading is already waiting for the next edge. */
+    }
+
+    ticks = clock->ticks;
+    status = DS1307_ReadReg(dev, D_DS1307_REG_SEC, raw, sizeof(raw));
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+
+    /* A reading that straddles an edge is ambiguous by one second: retry on the next call */
+    if (ticks != clock->ticks)
+    {
+        return DS1307_OK;
+    }
+
+    /* Hand the reading to the edge handler, which is the only writer of the RAM copy */
+    DS1307_Raw_to_DateTime(raw, &clock->syncValue, 0);
+    clock->syncTicks = ticks;
+    clock->resyncPending = 0;
+
+    /* Publish the reading only once it is complete: the edge handler may run at any point */
+    DS1307_BARRIER();
+    clock->syncReady = 1;
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Stops the software clock. SQW edges are ignored afterwards.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_SoftClock_Stop(DS1307_Handle_t *dev)
+{
+    dev->softClock.active = 0;
+}
+
+/**
+ * @brief Anchors the sub-second timestamp interpolator on an RTC seconds change.
+ * Polls the timekeeping registers until the seconds value changes and records the tick
+ * counter at that instant. The change is bracketed between the previous and the current
+ * read; the anchor is placed at the midpoint of the two reads, so the alignment error is
+ * bounded by half the duration of one burst read. Call once at start-up, and again
+ * whenever drift between the tick source and the RTC should be removed if no SQW edges
+ * are delivered to DS1307_SubSec_OnEdge().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] src Tick source used for interpolation; copied into the handle.
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_TIMEOUT_ERR if no seconds
+ *         change was seen within 1.5 s (oscillator halted), or the status of a failed read.
+ */
+DS1307_Status_t DS1307_SubSec_Align(DS1307_Handle_t *dev, const DS1307_TickSource_t *src)
+{
+    DS1307_SubSec_t *subSec = &dev->subSec; /**< Interpolator state. */
+    DS1307_DateTime_t dateTime;             /**< Decoded time at the seconds change. */
+    DS1307_Status_t status;                 /**< Status of the register reads. */
+    uint8_t raw[7];                         /**< Raw timekeeping registers 0x00-0x06. */
+    uint8_t firstSec;                       /**< Seconds register of the first read. */
+    uint32_t start, before, after;          /**< Counter values around the reads. */
+    uint32_t prevMid;                       /**< Midpoint of the previous read. */
+
+    subSec->active = 0;
+    subSec->src = *src;
+
+    start = src->Now(src->ctx);
+    status = DS1307_ReadReg(dev, D_DS1307_REG_SEC, raw, sizeof(raw));
+    after = src->Now(src->ctx);
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+    firstSec = raw[D_DS1307_REG_SEC];
+    prevMid = start + ((after - start) / 2);
+
+    /* Poll until the seconds register changes */
+    do
+    {
+        if ((after - start) > (src->hz + (src->hz / 2)))
+        {
+            return DS1307_TIMEOUT_ERR; /**< No change within 1.5 s: the oscillator is halted. */
+        }
+
+        before = src->Now(src->ctx);
+        status = DS1307_ReadReg(dev, D_DS1307_REG_SEC, raw, sizeof(raw));
+        after = src->Now(src->ctx);
+        if (status != DS1307_OK)
+        {
+            return status;
+        }
+
+        if (raw[D_DS1307_REG_SEC] == firstSec)
+        {
+            prevMid = before + ((after - before) / 2);
+        }
+    } while (raw[D_DS1307_REG_SEC] == firstSec);
+
+    /* The change happened between the previous and the current sample: anchor in between */
+    DS1307_Raw_to_DateTime(raw, &dateTime, 0);
+    subSec->seq++;
+    DS1307_BARRIER();
+    subSec->anchorTick = prevMid + (((before + ((after - before) / 2)) - prevMid) / 2);
+    subSec->anchorEpoch = DS1307_DateTime_to_Epoch(&dateTime);
+    subSec->edges = 0;
+    DS1307_BARRIER();
+    subSec->seq++;
+    subSec->active = 1;
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Re-anchors the interpolator on an SQW second edge.
+ * Call from the EXTI interrupt of the pin wired to SQW/OUT (1 Hz, falling edge) after
+ * DS1307_SubSec_Align(). Missed edges are accounted for by rounding the elapsed ticks to
+ * whole seconds.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_SubSec_OnEdge(DS1307_Handle_t *dev)
+{
+    DS1307_SubSec_t *subSec = &dev->subSec; /**< Interpolator state. */
+    uint32_t tick;                          /**< Counter value at the edge. */
+    uint32_t seconds;                       /**< Whole seconds since the previous anchor. */
+
+    if (!subSec->active)
+    {
+        return;
+    }
+
+    tick = subSec->src.Now(subSec->src.ctx);
+
+    /* Edges that stopped long enough for the counter to wrap leave no usable anchor */
+    if (subSec->edges && ((uint64_t)(tick - subSec->anchorTick) >= 3ull * subSec->src.hz))
+    {
+        subSec->active = 0;
+        return;
+    }
+
+    /* Round to whole seconds so a missed edge does not lose a second */
+    seconds = ((tick - subSec->anchorTick) + (subSec->src.hz / 2)) / subSec->src.hz;
+    if (seconds == 0)
+    {
+        return; /**< Spurious edge (bounce) within half a second of the anchor. */
+    }
+
+    subSec->seq++;
+    DS1307_BARRIER();
+    subSec->anchorEpoch += seconds;
+    subSec->anchorTick = tick;
+    subSec->edges = 1;
+    DS1307_BARRIER();
+    subSec->seq++;
+}
+
+/**
+ * @brief Returns the current Unix time in microseconds.
+ * Computed from the anchor and the tick source only; no bus access. Once SQW edges
+ * re-anchor the interpolator, the fraction is held at 999999 us until the next edge, so
+ * timestamps never step backwards when a slow edge arrives. The tick difference is only
+ * valid within one counter wrap (2^32 / hz ticks): an anchor older than half a wrap, or
+ * two seconds once edges are expected, is reported with DS1307_ERROR until
+ * DS1307_SubSec_OnEdge() or DS1307_SubSec_Align() replaces it. The query never modifies
+ * the anchor, so without edges run DS1307_SubSec_Align() again within half a wrap.
+ * @param[in] dev Pointer to the DS1307 device handle.
+ * @param[out] epochUs Pointer receiving microseconds since 1970-01-01 00:00:00.
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_ERROR if no valid anchor is
+ *         available.
+ */
+DS1307_Status_t DS1307_SubSec_GetUs(DS1307_Handle_t *dev, uint64_t *epochUs)
+{
+    DS1307_SubSec_t *subSec = &dev->subSec; /**< Interpolator state. */
+    uint32_t seq;                           /**< Sequence counter before the anchor copy. */
+    uint32_t epoch;                         /**< Anchored Unix second. */
+    uint32_t elapsed;                       /**< Ticks since the anchor. */
+    uint32_t hz = subSec->src.hz;           /**< Tick source frequency. */
+    uint8_t edges;                          /**< Set if SQW edges keep the anchor fresh. */
+    uint64_t limit;                         /**< Oldest usable anchor, in ticks. */
+    uint32_t seconds;                       /**< Whole seconds since the anchor. */
+    uint32_t fraction;                      /**< Microseconds into the current second. */
+
+    if (!subSec->active)
+    {
+        return DS1307_ERROR;
+    }
+
+    /* Take a consistent anchor even if an edge interrupt updates it meanwhile */
+    do
+    {
+        seq = subSec->seq;
+        DS1307_BARRIER();
+        epoch = subSec->anchorEpoch;
+        edges = subSec->edges;
+        elapsed = subSec->src.Now(subSec->src.ctx) - subSec->anchorTick;
+        DS1307_BARRIER();
+    } while ((seq & 1u) || (seq != subSec->seq));
+
+    /* Past this age the 32-bit difference may have wrapped: the anchor is unusable */
+    limit = edges ? (2ull * hz) : 0x80000000ull;
+    if (elapsed >= limit)
+    {
+        return DS1307_ERROR;
+    }
+
+    seconds = elapsed / hz;
+    fraction = (uint32_t)(((uint64_t)(elapsed % hz) * 1000000u) / hz);
+    if (edges && (seconds != 0))
+    {
+        /* The edge is late: stay at the end of the anchored second until it re-anchors */
+        seconds = 0;
+        fraction = 999999u;
+    }
+
+    *epochUs = (((uint64_t)epoch + seconds) * 1000000u) + fraction;
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Returns the current Unix time in milliseconds.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] epochMs Pointer receiving milliseconds since 1970-01-01 00:00:00.
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_ERROR if no anchor is available.
+ */
+DS1307_Status_t DS1307_SubSec_GetMs(DS1307_Handle_t *dev, uint64_t *epochMs)
+{
+    DS1307_Status_t status; /**< Status of the microsecond query. */
+    uint64_t epochUs;       /**< Current Unix time in microseconds. */
+
+    status = DS1307_SubSec_GetUs(dev, &epochUs);
+    if (status == DS1307_OK)
+    {
+        *epochMs = epochUs / 1000u;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Loads registers into the shadow register file.
+ * Reads the range in one burst. Registers modified locally and not yet flushed keep their
+ * local value.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Address of the first register to load.
+ * @param[in] len Number of registers to load.
+ * @return DS1307_Status_t Status of the burst read.
+ */
+DS1307_Status_t DS1307_Shadow_Load(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t len)
+{
+    uint8_t value[DS1307_MAX_BUFF_SIZE]; /**< Burst read buffer. */
+
+    return DS1307_ReadReg(dev, regAdd, value, len);
+}
+
+/**
+ * @brief Returns the value of a register, from the shadow when possible.
+ * Control and RAM registers (0x07-0x3F) are served from the shadow without bus traffic
+ * once known; timekeeping registers are always read from the device.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Register address, 0x00-0x3F.
+ * @param[out] value Pointer receiving the register value.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR for an address beyond
+ *         0x3F, or the status of the read.
+ */
+DS1307_Status_t DS1307_Shadow_Get(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t *value)
+{
+    uint64_t bit; /**< Bitmap bit of the register. */
+
+    if (regAdd >= DS1307_MAX_BUFF_SIZE)
+    {
+        return DS1307_DATA_SIZE_ERROR;
+    }
+
+    bit = (uint64_t)1 << regAdd;
+    if (dev->shadow.valid & bit & DS1307_SHADOW_CACHED)
+    {
+        *value = dev->shadow.reg[regAdd];
+        return DS1307_OK;
+    }
+
+    return DS1307_ReadReg(dev, regAdd, value, 1);
+}
+
+/**
+ * @brief Changes bits of a control or RAM register in the shadow.
+ * The register is loaded first if its value is unknown. The change reaches the device with
+ * the next DS1307_Shadow_Flush(); setting bits to their current value marks nothing dirty.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Register address, 0x07-0x3F.
+ * @param[in] mask Bits to change.
+ * @param[in] bits New value of the bits selected by mask.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_INVALID_PARAM for a timekeeping or
+ *         out-of-range register, or the status of the load.
+ */
+DS1307_Status_t DS1307_Shadow_Modify(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t mask, uint8_t bits)
+{
+    DS1307_Shadow_t *shadow = &dev->shadow; /**< Shadow register file. */
+    DS1307_Status_t status;                 /**< Status of the load. */
+    uint64_t bit;                           /**< Bitmap bit of the register. */
+    uint8_t value;                          /**< New register value. */
+
+    if ((regAdd >= DS1307_MAX_BUFF_SIZE) || !(((uint64_t)1 << regAdd) & DS1307_SHADOW_CACHED))
+    {
+        return DS1307_INVALID_PARAM;
+    }
+
+    bit = (uint64_t)1 << regAdd;
+    if (!(shadow->valid & bit) && (mask != 0xFF))
+    {
+        status = DS1307_Shadow_Load(dev, regAdd, 1);
+        if (status != DS1307_OK)
+        {
+            return status;
+        }
+    }
+
+    value = (uint8_t)((shadow->reg[regAdd] & ~mask) | (bits & mask));
+    if (!(shadow->valid & bit) || (value != shadow->reg[regAdd]))
+    {
+        shadow->reg[regAdd] = value;
+        shadow->valid |= bit;
+        shadow->dirty |= bit;
+    }
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Sets a control or RAM register in the shadow.
+ * Equivalent to DS1307_Shadow_Modify() with a mask of 0xFF, without loading the register.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Register address, 0x07-0x3F.
+ * @param[in] value New register value.
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_INVALID_PARAM for a timekeeping or
+ *         out-of-range register.
+ */
+DS1307_Status_t DS1307_Shadow_Set(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t value)
+{
+    return DS1307_Shadow_Modify(dev, regAdd, 0xFF, value);
+}
+
+/**
+ * @brief Writes the dirty registers of the shadow to the device.
+ * Consecutive dirty registers are written as one burst. Runs separated by at most
+ * DS1307_SHADOW_MAX_GAP known registers are merged, rewriting the unchanged registers in
+ * between, since that is cheaper than starting another transaction.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the first failed burst; runs
+ *         not written stay dirty.
+ */
+DS1307_Status_t DS1307_Shadow_Flush(DS1307_Handle_t *dev)
+{
+    DS1307_Shadow_t *shadow = &dev->shadow; /**< Shadow register file. */
+    DS1307_Status_t status;                 /**< Status of the burst writes. */
+    uint8_t start;                          /**< First register of the current run. */
+    uint8_t end;                            /**< Last register of the current run. */
+    uint8_t next;                           /**< Candidate register to extend the run. */
+    uint64_t run;                           /**< Bitmap of the current run. */
+
+    for (start = 0; (start < DS1307_MAX_BUFF_SIZE) && (shadow->dirty >> start); start = end + 1)
+    {
+        /* Find the next dirty register */
+        while (!((shadow->dirty >> start) & 1))
+        {
+            start++;
+        }
+
+        /* Extend over dirty registers, and over short gaps of known registers */
+        end = start;
+        for (next = start + 1; next < DS1307_MAX_BUFF_SIZE; next++)
+        {
+            if (!((shadow->valid >> next) & 1) || ((uint8_t)(next - end) > DS1307_SHADOW_MAX_GAP + 1))
+            {
+                break;
+            }
+            if ((shadow->dirty >> next) & 1)
+            {
+                end = next;
+            }
+        }
+
+        run = DS1307_RegMask(start, (uint8_t)(end - start + 1));
+        status = DS1307_Xfer_Write(dev, start, &shadow->reg[start], (uint8_t)(end - start + 1));
+        if (status != DS1307_OK)
+        {
+            /* A failed burst may have landed partly: only the dirty values are still meaningful */
+            shadow->valid &= ~(run & ~shadow->dirty);
+            return status;
+        }
+
+        shadow->dirty &= ~run;
+    }
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Forgets the shadow contents, including unflushed changes.
+ * Use when another bus master may have changed the registers.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_Shadow_Invalidate(DS1307_Handle_t *dev)
+{
+    dev->shadow.valid = 0;
+    dev->shadow.dirty = 0;
+}
+
+/**
+ * @brief Selects the SQW/OUT configuration (OUT, SQWE, RS1 and RS0 bits) in the shadow.
+ * Takes effect with the next DS1307_Shadow_Flush().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] sqwOut Square wave output configuration, see DS1307_SQWO_t.
+ * @return DS1307_Status_t Status of DS1307_Shadow_Modify().
+ */
+DS1307_Status_t DS1307_SetSQW(DS1307_Handle_t *dev, DS1307_SQWO_t sqwOut)
+{
+    return DS1307_Shadow_Modify(dev, D_DS1307_REG_CTRL, DS1307_CTRL_SQW_MASK, (uint8_t)sqwOut);
+}
+
+/**
+ * @brief Sets the level of SQW/OUT while the square wave is disabled (OUT bit) in the shadow.
+ * Takes effect with the next DS1307_Shadow_Flush().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] level Non-zero for a high output.
+ * @return DS1307_Status_t Status of DS1307_Shadow_Modify().
+ */
+DS1307_Status_t DS1307_SetOUT(DS1307_Handle_t *dev, uint8_t level)
+{
+    return DS1307_Shadow_Modify(dev, D_DS1307_REG_CTRL, (1 << D_DS1307_BIT_OUT), level ? (1 << D_DS1307_BIT_OUT) : 0);
+}
+
+/**
+ * @brief Starts or stops the oscillator (CH bit).
+ * The seconds register is volatile and not shadowed, so this is an immediate
+ * read-modify-write; the write is skipped when CH already has the requested value.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] halt Non-zero to stop the oscillator, zero to start it.
+ * @return DS1307_Status_t Status of the register access.
+ */
+DS1307_Status_t DS1307_SetClockHalt(DS1307_Handle_t *dev, uint8_t halt)
+{
+    DS1307_Status_t status; /**< Status of the register accesses. */
+    uint8_t value;          /**< Seconds register. */
+
+    status = DS1307_ReadReg(dev, D_DS1307_REG_SEC, &value, 1);
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+
+    if (((value >> D_DS1307_BIT_CH) & 1) == (halt ? 1 : 0))
+    {
+        return DS1307_OK; /**< CH already has the requested value. */
+    }
+
+    value ^= (1 << D_DS1307_BIT_CH);
+
+    return DS1307_WriteReg(dev, D_DS1307_REG_SEC, &value, 1);
+}
+
+/**
+ * @brief Reads from the battery-backed RAM.
+ * Served from the shadow register file when every byte is known; otherwise read straight
+ * into buf in bursts of at most DS1307_NVRAM_MAX_BURST bytes. Transfers never reach past
+ * register 0x3F, so the register pointer cannot wrap into the clock registers.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] offset Offset in the RAM, 0-55 (register 0x08 + offset).
+ * @param[out] buf Buffer receiving len bytes.
+ * @param[in] len Number of bytes to read.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR if the range is empty
+ *         or exceeds the 56 bytes of RAM, or the status of the failed burst.
+ */
+DS1307_Status_t DS1307_NvramRead(DS1307_Handle_t *dev, uint8_t offset, uint8_t *buf, uint8_t len)
+{
+    DS1307_Shadow_t *shadow = &dev->shadow; /**< Shadow register file. */
+    DS1307_Status_t status;                 /**< Status of the burst reads. */
+    uint8_t regAdd;                         /**< First register of the range. */
+    uint8_t done;                           /**< Bytes transferred so far. */
+    uint8_t chunk;                          /**< Bytes in the current burst. */
+    uint8_t i;                              /**< Loop index. */
+    uint64_t range;                         /**< Bitmap of the registers read. */
+
+    if ((len == 0) || ((uint16_t)offset + len > DS1307_NVRAM_SIZE))
+    {
+        DS1307_METRICS_TAG(dev, DS1307_API_OTHER);
+        return DS1307_DATA_SIZE_ERROR;
+    }
+
+    regAdd = (uint8_t)(D_DS1307_REG_RAM01 + offset);
+    range = DS1307_RegMask(regAdd, len);
+
+    /* Every byte known: no bus traffic */
+    if ((shadow->valid & range) == range)
+    {
+        memcpy(buf, &shadow->reg[regAdd], len);
+        DS1307_METRICS_TAG(dev, DS1307_API_OTHER);
+        return DS1307_OK;
+    }
+
+    for (done = 0; done < len; done += chunk)
+    {
+        chunk = (uint8_t)(len - done);
+        if (chunk > DS1307_NVRAM_MAX_BURST)
+        {
+            chunk = DS1307_NVRAM_MAX_BURST;
+        }
+        DS1307_METRICS_TAG(dev, DS1307_API_NVRAM);
+        status = DS1307_ReadReg(dev, (uint8_t)(regAdd + done), &buf[done], chunk);
+        if (status != DS1307_OK)
+        {
+            return status;
+        }
+    }
+
+    /* Unflushed local changes take precedence over the device contents */
+    for (i = 0; i < len; i++)
+    {
+        if ((shadow->dirty >> (regAdd + i)) & 1)
+        {
+            buf[i] = shadow->reg[regAdd + i];
+        }
+    }
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Writes to the battery-backed RAM.
+ * Bytes the shadow register file already knows to hold the same value are trimmed from
+ * both ends of the range; the rest is written from buf in bursts of at most
+ * DS1307_NVRAM_MAX_BURST bytes. Transfers never reach past register 0x3F.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] offset Offset in the RAM, 0-55 (register 0x08 + offset).
+ * @param[in] buf Buffer holding len bytes.
+ * @param[in] len Number of bytes to write.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR if the range is empty
+ *         or exceeds the 56 bytes of RAM, or the status of the failed burst.
+ */
+DS1307_Status_t DS1307_NvramWrite(DS1307_Handle_t *dev, uint8_t offset, const uint8_t *buf, uint8_t len)
+{
+    DS1307_Shadow_t *shadow = &dev->shadow; /**< Shadow register file. */
+    DS1307_Status_t status;                 /**< Status of the burst writes. */
+    uint8_t regAdd;                         /**< First register of the range. */
+    uint8_t first = 0;                      /**< First byte that must be written. */
+    uint8_t last;                           /**< One past the last byte that must be written. */
+    uint8_t chunk;                          /**< Bytes in the current burst. */
+    uint64_t run;                           /**< Bitmap of the registers of a burst. */
+
+    if ((len == 0) || ((uint16_t)offset + len > DS1307_NVRAM_SIZE))
+    {
+        DS1307_METRICS_TAG(dev, DS1307_API_OTHER);
+        return DS1307_DATA_SIZE_ERROR;
+    }
+
+    regAdd = (uint8_t)(D_DS1307_REG_RAM01 + offset);
+
+    /* Trim bytes the device is known to hold already; dirty bytes must be written */
+    last = len;
+    while ((first < last) && ((shadow->valid & ~shadow->dirty) >> (regAdd + first) & 1) &&
+           (shadow->reg[regAdd + first] == buf[first]))
+    {
+        first++;
+    }
+    while ((last > first) && ((shadow->valid & ~shadow->dirty) >> (regAdd + last - 1) & 1) &&
+           (shadow->reg[regAdd + last - 1] == buf[last - 1]))
+    {
+        last--;
+    }
+
+    for (; first < last; first += chunk)
+    {
+        chunk = (uint8_t)(last - first);
+        if (chunk > DS1307_NVRAM_MAX_BURST)
+        {
+            chunk = DS1307_NVRAM_MAX_BURST;
+        }
+        run = DS1307_RegMask((uint8_t)(regAdd + first), chunk);
+        DS1307_METRICS_TAG(dev, DS1307_API_NVRAM);
+        status = DS1307_Xfer_Write(dev, (uint8_t)(regAdd + first), &buf[first], chunk);
+        if (status != DS1307_OK)
+        {
+            /* A failed burst may have landed partly: the device contents are unknown */
+            shadow->valid &= ~(run & ~shadow->dirty);
+            return status;
+        }
+
+        shadow->dirty &= ~run;
+        DS1307_Shadow_Update(dev, (uint8_t)(regAdd + first), &buf[first], chunk);
+    }
+
+    /* Clear the tag in case trimming left nothing to write */
+    DS1307_METRICS_TAG(dev, DS1307_API_OTHER);
+    return DS1307_OK;
+}
+
+/**
+ * @brief Reads consecutive registers through the device transport and updates the statistics.
+ * Failed transactions are retried and the breaker updated as set by DS1307_SetRecovery().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Address of the first register to read.
+ * @param[out] data Buffer receiving the register contents.
+ * @param[in] len Number of registers to read.
+ * @return DS1307_Status_t Status of the last attempt, or DS1307_CIRCUIT_OPEN if the breaker
+ *         is open.
+ */
+static DS1307_Status_t DS1307_Xfer_Read(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t *data, uint8_t len)
+{
+    const DS1307_TickSource_t *clock = &dev->timeout.clock; /**< Time base of the latency measurement. */
+    uint16_t bytes = (uint16_t)(len + 3u);                 /**< Bytes on the wire. */
+    uint32_t timeout = DS1307_Timeout_For(dev, bytes);      /**< Timeout of each attempt, in microseconds. */
+    uint32_t start = 0;                                     /**< Clock counter value when the attempt started. */
+    DS1307_Status_t status;                                 /**< Status of the transfer. */
+    uint8_t attempt;                                        /**< Retries made so far. */
+#ifndef DS1307_NO_METRICS
+    uint8_t api = dev->metrics.api;                         /**< Histogram the transfer is filed in. */
+    uint32_t begin = DS1307_Metrics_Now(dev);               /**< Metrics clock value when the transfer started. */
+
+    dev->metrics.api = DS1307_API_OTHER;
+#endif
+
+    if (!DS1307_Recovery_Admit(dev))
+    {
+        dev->stats.Rejected++;
+        return DS1307_CIRCUIT_OPEN;
+    }
+
+    for (attempt = 0; ; attempt++)
+    {
+        if (clock->Now != NULL)
+        {
+            start = clock->Now(clock->ctx);
+        }
+        status = dev->transport->ReadRegs(dev->bus, dev->addr, regAdd, data, len, timeout);
+
+        dev->stats.Transactions++;
+        if (status == DS1307_OK)
+        {
+            DS1307_Timeout_Learn(dev, start, bytes);
+            break;
+        }
+        dev->stats.Errors++;
+#ifndef DS1307_NO_METRICS
+        DS1307_Metrics_Error(dev, status);
+#endif
+
+        if (!DS1307_Recovery_Retry(dev, status, attempt))
+        {
+            break;
+        }
+        dev->stats.Retries++;
+    }
+
+    DS1307_Recovery_Done(dev, status);
+#ifndef DS1307_NO_METRICS
+    DS1307_Metrics_Transfer(dev, api, begin, (status == DS1307_OK) ? len : 0, 0);
+#endif
+    return status;
+}
+
+/**
+ * @brief Writes consecutive registers through the device transport and updates the statistics.
+ * Failed transactions are retried and the breaker updated as set by DS1307_SetRecovery().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Address of the first register to write.
+ * @param[in] data Buffer holding the bytes to write.
+ * @param[in] len Number of registers to write.
+ * @return DS1307_Status_t Status of the last attempt, or DS1307_CIRCUIT_OPEN if the breaker
+ *         is open.
+ */
+static DS1307_Status_t DS1307_Xfer_Write(DS1307_Handle_t *dev, uint8_t regAdd, const uint8_t *data, uint8_t len)
+{
+    const DS1307_TickSource_t *clock = &dev->timeout.clock; /**< Time base of the latency measurement. */
+    uint16_t bytes = (uint16_t)(len + 2u);                 /**< Bytes on the wire. */
+    uint32_t timeout = DS1307_Timeout_For(dev, bytes);      /**< Timeout of each attempt, in microseconds. */
+    uint32_t start = 0;                                     /**< Clock counter value when the attempt started. */
+    DS1307_Status_t status;                                 /**< Status of the transfer. */
+    uint8_t attempt;                                        /**< Retries made so far. */
+#ifndef DS1307_NO_METRICS
+    uint8_t api = dev->metrics.api;                         /**< Histogram the transfer is filed in. */
+    uint32_t begin = DS1307_Metrics_Now(dev);               /**< Metrics clock value when the transfer started. */
+
+    dev->metrics.api = DS1307_API_OTHER;
+#endif
+
+    if (!DS1307_Recovery_Admit(dev))
+    {
+        dev->stats.Rejected++;
+        return DS1307_CIRCUIT_OPEN;
+    }
+
+    for (attempt = 0; ; attempt++)
+    {
+        if (clock->Now != NULL)
+        {
+            start = clock->Now(clock->ctx);
+        }
+        status = dev->transport->WriteRegs(dev->bus, dev->addr, regAdd, data, len, timeout);
+
+        dev->stats.Transactions++;
+        if (status == DS1307_OK)
+        {
+            DS1307_Timeout_Learn(dev, start, bytes);
+            break;
+        }
+        dev->stats.Errors++;
+#ifndef DS1307_NO_METRICS
+        DS1307_Metrics_Error(dev, status);
+#endif
+
+        if (!DS1307_Recovery_Retry(dev, status, attempt))
+        {
+            break;
+        }
+        dev->stats.Retries++;
+    }
+
+    DS1307_Recovery_Done(dev, status);
+#ifndef DS1307_NO_METRICS
+    DS1307_Metrics_Transfer(dev, api, begin, 0, (status == DS1307_OK) ? len : 0);
+#endif
+    return status;
+}
+
+/**
+ * @brief Computes the timeout of a transaction from its length.
+ * @param[in] dev Pointer to the DS1307 device handle.
+ * @param[in] bytes Bytes on the wire, address and register bytes included.
+ * @return uint32_t Timeout in microseconds.
+ */
+static uint32_t DS1307_Timeout_For(const DS1307_Handle_t *dev, uint16_t bytes)
+{
+    const DS1307_Timeout_t *timeout = &dev->timeout; /**< Timeout state. */
+    uint64_t ceiling = DS1307_TIMEOUT * 1000u;       /**< Hard ceiling, in microseconds. */
+    uint64_t ns;                                     /**< Time allowed for the bytes, in nanoseconds. */
+    uint64_t us;                                     /**< Timeout in microseconds. */
+
+    if (timeout->ceilingUs != 0)
+    {
+        ceiling = timeout->ceilingUs;
+    }
+
+    if (timeout->p99NsPerByte != 0)
+    {
+        ns = (uint64_t)timeout->p99NsPerByte * bytes * DS1307_TIMEOUT_MARGIN;
+    }
+    else if (timeout->busHz != 0)
+    {
+        /* 8 data bits and the acknowledge per byte */
+        ns = 9000000000ull / timeout->busHz * bytes * DS1307_TIMEOUT_MARGIN;
+    }
+    else
+    {
+        return (uint32_t)ceiling;
+    }
+
+    us = timeout->slackUs + (ns + 999u) / 1000u;
+    return (uint32_t)((us < ceiling) ? us : ceiling);
+}
+
+/**
+ * @brief Adds the latency of a successful transaction to the per-byte histogram.
+ * The measurement counts one tick more than elapsed: the transfer may have started just
+ * after a tick and ended just before the next, so a coarse clock (the 1 kHz HAL tick)
+ * would otherwise learn a latency of zero and starve every later transfer.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] start Clock counter value when the transaction started.
+ * @param[in] bytes Bytes on the wire, address and register bytes included.
+ */
+static void DS1307_Timeout_Learn(DS1307_Handle_t *dev, uint32_t start, uint16_t bytes)
+{
+    DS1307_Timeout_t *timeout = &dev->timeout;          /**< Timeout state. */
+    const DS1307_TickSource_t *clock = &timeout->clock; /**< Time base of the measurement. */
+    uint32_t perByte;                                   /**< Latency per byte, in nanoseconds. */
+    uint32_t quota;                                     /**< Samples at or below the 99th percentile. */
+    uint32_t seen = 0;                                  /**< Samples in the buckets walked so far. */
+    uint8_t bucket = 0;                                 /**< Histogram bucket of the sample. */
+    uint8_t i;                                          /**< Bucket index. */
+
+    if ((clock->Now == NULL) || (clock->hz == 0))
+    {
+        return;
+    }
+
+    perByte = (uint32_t)(((uint64_t)(clock->Now(clock->ctx) - start) + 1u) * 1000000000u / clock->hz / bytes);
+    while (((perByte >> (bucket + 1)) != 0) && (bucket < DS1307_TIMEOUT_BUCKETS - 1))
+    {
+        bucket++;
+    }
+
+    /* Halve the history once the window is full, so the estimate follows the bus */
+    if (timeout->samples >= DS1307_TIMEOUT_WINDOW)
+    {
+        timeout->samples = 0;
+        for (i = 0; i < DS1307_TIMEOUT_BUCKETS; i++)
+        {
+            timeout->hist[i] >>= 1;
+            timeout->samples += timeout->hist[i];
+        }
+    }
+    timeout->hist[bucket]++;
+    timeout->samples++;
+
+    if (timeout->samples < DS1307_TIMEOUT_MIN_SAMPLES)
+    {
+        return;
+    }
+
+    /* The p99 is the upper bound of the first bucket reaching 99 % of the samples */
+    quota = ((uint32_t)timeout->samples * 99u + 99u) / 100u;
+    for (i = 0; i < DS1307_TIMEOUT_BUCKETS - 1; i++)
+    {
+        seen += timeout->hist[i];
+        if (seen >= quota)
+        {
+            break;
+        }
+    }
+    timeout->p99NsPerByte = (uint32_t)2u << i;
+}
+
+/**
+ * @brief Checks the circuit breaker before an operation reaches the bus.
+ * Once the cooldown of an open breaker has elapsed, the breaker turns half-open and lets
+ * one trial operation through.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @return uint8_t 1 if the operation may start, 0 if it must fail fast.
+ */
+static uint8_t DS1307_Recovery_Admit(DS1307_Handle_t *dev)
+{
+    DS1307_Recovery_t *recovery = &dev->recovery;               /**< Breaker state. */
+    const DS1307_TickSource_t *clock = &recovery->policy.clock; /**< Time base of the cooldown. */
+    uint32_t elapsed;                                           /**< Ticks since the breaker opened. */
+
+    if (recovery->state != DS1307_BREAKER_OPEN)
+    {
+        return 1;
+    }
+
+    /* Compare in microseconds without dividing: elapsed / hz < cooldownUs / 1e6 */
+    elapsed = clock->Now(clock->ctx) - recovery->openedAt;
+    if ((uint64_t)elapsed * 1000000u < (uint64_t)recovery->policy.cooldownUs * clock->hz)
+    {
+        return 0;
+    }
+
+    recovery->state = DS1307_BREAKER_HALF_OPEN;
+    return 1;
+}
+
+/**
+ * @brief Prepares the retry of a failed transaction.
+ * Runs the bus clear and re-init hooks after a timeout or a repeated DS1307_BUSY, then
+ * waits the backoff delay of this attempt.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] status Status of the failed transaction.
+ * @param[in] attempt Number of retries already made for this operation.
+ * @return uint8_t 1 if the transaction should be retried, 0 to give up.
+ */
+static uint8_t DS1307_Recovery_Retry(DS1307_Handle_t *dev, DS1307_Status_t status, uint8_t attempt)
+{
+    const DS1307_RecoveryPolicy_t *policy = &dev->recovery.policy; /**< Recovery policy of the device. */
+    uint32_t delay = policy->backoffUs;                            /**< Backoff delay of this attempt. */
+    uint8_t i;                                                     /**< Doubling counter. */
+
+    /* The trial operation of a half-open breaker gets no retry */
+    if ((attempt >= policy->maxRetries) || (dev->recovery.state == DS1307_BREAKER_HALF_OPEN))
+    {
+        return 0;
+    }
+
+    /* A timeout, or a bus still busy after a retry, means SDA is likely held low: clock the
+       slave out of its byte, then restart the peripheral, whose state machine is stuck too */
+    if ((status == DS1307_TIMEOUT_ERR) || ((status == DS1307_BUSY) && (attempt > 0)))
+    {
+        if ((policy->BusClear != NULL) || (policy->Reinit != NULL))
+        {
+            dev->stats.Recoveries++;
+        }
+        if ((policy->BusClear != NULL) && (policy->BusClear(policy->ctx) != DS1307_OK))
+        {
+            return 0;
+        }
+        if ((policy->Reinit != NULL) && (policy->Reinit(policy->ctx) != DS1307_OK))
+        {
+            return 0;
+        }
+    }
+
+    /* Exponential backoff, saturating at backoffMaxUs and at the uint32_t range */
+    if ((policy->Delay != NULL) && (delay != 0))
+    {
+        for (i = 0; (i < attempt) && (delay <= 0x7FFFFFFFu); i++)
+        {
+            delay <<= 1;
+        }
+        if ((policy->backoffMaxUs != 0) && (delay > policy->backoffMaxUs))
+        {
+            delay = policy->backoffMaxUs;
+        }
+        policy->Delay(policy->ctx, delay);
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Updates the circuit breaker with the outcome of an operation.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] status Final status of the operation, after its retries.
+ */
+static void DS1307_Recovery_Done(DS1307_Handle_t *dev, DS1307_Status_t status)
+{
+    DS1307_Recovery_t *recovery = &dev->recovery;               /**< Breaker state. */
+    const DS1307_TickSource_t *clock = &recovery->policy.clock; /**< Time base of the cooldown. */
+
+    if (status == DS1307_OK)
+    {
+        recovery->failures = 0;
+        recovery->state = DS1307_BREAKER_CLOSED;
+        return;
+    }
+
+    if (recovery->failures < 0xFFu)
+    {
+        recovery->failures++;
+    }
+
+    /* A failed trial reopens the breaker at once */
+    if ((recovery->policy.breakerThreshold != 0) && (clock->Now != NULL) &&
+        ((recovery->state == DS1307_BREAKER_HALF_OPEN) || (recovery->failures >= recovery->policy.breakerThreshold)))
+    {
+        recovery->state = DS1307_BREAKER_OPEN;
+        recovery->openedAt = clock->Now(clock->ctx);
+    }
+}
+
+#ifndef DS1307_NO_METRICS
+/**
+ * @brief Reads the clock of the metrics.
+ * @param[in] dev Pointer to the DS1307 device handle.
+ * @return uint32_t Current counter value, or 0 without a clock.
+ */
+static uint32_t DS1307_Metrics_Now(const DS1307_Handle_t *dev)
+{
+    const DS1307_TickSource_t *clock = &dev->metrics.clock; /**< Time base of the histograms. */
+
+    return (clock->Now != NULL) ? clock->Now(clock->ctx) : 0;
+}
+
+/**
+ * @brief Files a failed bus transaction under its status.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] status Status of the transaction.
+ */
+static void DS1307_Metrics_Error(DS1307_Handle_t *dev, DS1307_Status_t status)
+{
+    if ((uint32_t)status < DS1307_METRICS_STATUSES)
+    {
+        dev->metrics.data.errors[status]++;
+    }
+}
+
+/**
+ * @brief Counts the bytes of a finished transfer and files its latency.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] api DS1307_Api_t histogram of the transfer.
+ * @param[in] start Clock counter value when the transfer started.
+ * @param[in] bytesRead Register bytes read, 0 if the transfer failed.
+ * @param[in] bytesWritten Register bytes written, 0 if the transfer failed.
+ */
+static void DS1307_Metrics_Transfer(DS1307_Handle_t *dev, uint8_t api, uint32_t start, uint8_t bytesRead, uint8_t bytesWritten)
+{
+    DS1307_Metrics_t *data = &dev->metrics.data;            /**< Counters of the device. */
+    const DS1307_TickSource_t *clock = &dev->metrics.clock; /**< Time base of the histograms. */
+    uint64_t us;                                            /**< Latency of the transfer, in microseconds. */
+    uint8_t bucket = 0;                                     /**< Histogram bucket of the latency. */
+
+    data->bytesRead += bytesRead;
+    data->bytesWritten += bytesWritten;
+
+    if ((clock->Now == NULL) || (clock->hz == 0))
+    {
+        return;
+    }
+
+    us = (uint64_t)(uint32_t)(clock->Now(clock->ctx) - start) * 1000000u / clock->hz;
+    while (((us >> (bucket + 1)) != 0) && (bucket < DS1307_METRICS_BUCKETS - 1))
+    {
+        bucket++;
+    }
+    data->latency[api][bucket]++;
+    data->busyUs[api] += us;
+}
+
+/**
+ * @brief Records the asynchronous transfer about to start, for its completion.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] op Operation code (DS1307_OP_*) of the transfer.
+ * @param[in] len Register bytes of the transfer.
+ * @param[in] write Non-zero for a write, zero for a read.
+ */
+static void DS1307_Metrics_AsyncStart(DS1307_Handle_t *dev, uint8_t op, uint8_t len, uint8_t write)
+{
+    switch (op)
+    {
+    case DS1307_OP_TIME_BIN:
+    case DS1307_OP_TIME_BCD:
+        dev->metrics.asyncApi = DS1307_API_READ_TIME;
+        break;
+    case DS1307_OP_DATETIME_BIN:
+    case DS1307_OP_DATETIME_BCD:
+        dev->metrics.asyncApi = DS1307_API_READ_DATETIME;
+        break;
+    default:
+        dev->metrics.asyncApi = write ? DS1307_API_WRITE_REG : DS1307_API_OTHER;
+        break;
+    }
+    dev->metrics.asyncLen = len;
+    dev->metrics.asyncWrite = write;
+    dev->metrics.asyncStart = DS1307_Metrics_Now(dev);
+}
+#endif
+
+/**
+ * @brief Marks the device busy with an asynchronous transfer, unless it already is.
+ * The check and the set are one atomic step, since the _IT functions may be called from
+ * interrupts (e.g. the SQW sampler) that preempt a task starting a transfer.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @return uint8_t 1 if the caller now owns the device, 0 if a transfer is in flight.
+ */
+static uint8_t DS1307_Async_Claim(DS1307_Handle_t *dev)
+{
+#ifndef DS1307_NO_HAL
+    uint32_t primask = __get_PRIMASK(); /**< Interrupt mask of the caller. */
+    uint8_t claimed;                    /**< Set if the device was idle. */
+
+    __disable_irq();
+    claimed = (dev->async.busy == 0);
+    dev->async.busy = 1;
+    __set_PRIMASK(primask);
+
+    return claimed;
+#elif defined(__GNUC__)
+    return (uint8_t)(__atomic_exchange_n(&dev->async.busy, 1, __ATOMIC_ACQUIRE) == 0);
+#else
+    if (dev->async.busy)
+    {
+        return 0;
+    }
+    dev->async.busy = 1;
+    return 1;
+#endif
+}
+
+/**
+ * @brief Starts an asynchronous register read on behalf of one of the _IT functions.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] op Operation code (DS1307_OP_*) selecting the decode applied on completion.
+ * @param[in] regAdd Address of the first register to read.
+ * @param[out] data Buffer receiving the raw register contents.
+ * @param[in] len Number of registers to read.
+ * @param[out] dst Destination structure of the decoded result (unused for raw reads).
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code.
+ */
+static DS1307_Status_t DS1307_AsyncRead(DS1307_Handle_t *dev, uint8_t op, uint8_t regAdd, uint8_t *data, uint8_t len,
+                                        void *dst, DS1307_Callback_t callback, void *userData)
+{
+    DS1307_Status_t status; /**< Status of the transfer start. */
+
+    if (dev->transport->ReadRegsAsync == NULL)
+    {
+        return DS1307_ERROR; /**< The transport has no asynchronous mode. */
+    }
+
+    if (!DS1307_Async_Claim(dev))
+    {
+        return DS1307_BUSY; /**< A transfer is already in flight on this device. */
+    }
+
+    dev->async.op = op;
+    dev->async.dst = dst;
+    dev->async.cb = callback;
+    dev->async.userData = userData;
+#ifndef DS1307_NO_METRICS
+    DS1307_Metrics_AsyncStart(dev, op, len, 0);
+#endif
+
+    status = dev->transport->ReadRegsAsync(dev->bus, dev->addr, regAdd, data, len, dev);
+    if (status != DS1307_OK)
+    {
+        dev->async.busy = 0; /**< The transfer was not started, release the device. */
+    }
+
+    return status;
+}
+
+/**
+ * @brief Advances a binary date and time by one second.
+ * Handles minute, hour, weekday, month and year rollovers including leap years
+ * (years 2000-2099, where every year divisible by 4 is a leap year).
+ * @param[in,out] dateTime Pointer to the date and time to advance.
+ */
+static void DS1307_DateTime_Increment(DS1307_DateTime_t* dateTime)
+{
+    DS1307_Time_t *time = &dateTime->time; /**< Time part. */
+    DS1307_Date_t *date = &dateTime->date; /**< Date part. */
+    uint8_t monthDays;                     /**< Length of the current month. */
+
+    if (++time->Sec < 60)
+    {
+        return;
+    }
+    time->Sec = 0;
+
+    if (++time->Min < 60)
+    {
+        return;
+    }
+    time->Min = 0;
+
+    if (++time->Hour < 24)
+    {
+        return;
+    }
+    time->Hour = 0;
+
+    /* New day: weekday wraps Saturday (7) to Sunday (1) */
+    date->Day = (uint8_t)((date->Day % 7) + 1);
+
+    monthDays = DS1307_DaysInMonth(date->Month, date->Year);
+    if (monthDays == 0)
+    {
+        monthDays = 31;
+    }
+
+    if (++date->Date <= monthDays)
+    {
+        return;
+    }
+    date->Date = 1;
+
+    if (++date->Month <= 12)
+    {
+        return;
+    }
+    date->Month = 1;
+    date->Year = (uint8_t)((date->Year + 1) % 100);
+}
+
+/**
+ * @brief Converts one packed BCD byte to binary.
+ * Uses bcd - 6 * tens, which equals tens * 10 + units, with shifts only.
+ * @param[in] bcd BCD value (two decimal digits).
+ * @return uint8_t Binary value.
+ */
+static uint8_t DS1307_BCD_to_Bin(uint8_t bcd)
+{
+    uint8_t tens = (uint8_t)(bcd >> 4); /**< Tens digit. */
+
+    return (uint8_t)(bcd - (tens << 2) - (tens << 1));
+}
+
+/**
+ * @brief Converts a binary value (0-99) to one packed BCD byte.
+ * The tens digit is (bin * 205) >> 11, which equals bin / 10 for 0-99, and
+ * bin + 6 * tens places it in the upper nibble.
+ * @param[in] bin Binary value.
+ * @return uint8_t BCD value.
+ */
+static uint8_t DS1307_Bin_to_BCD(uint8_t bin)
+{
+    uint8_t tens = (uint8_t)((bin * 205u) >> 11); /**< Tens digit. */
+
+    return (uint8_t)(bin + (tens << 2) + (tens << 1));
+}
+
+/**
+ * @brief Decodes raw seconds/minutes/hours registers into a DS1307_Time_t structure.
+ * The CH bit and the 12/24-hour control bits are masked off and the hour is always
+ * returned in 24-hour format, whatever mode the RTC runs in.
+ * @param[in] raw Pointer to the 3 bytes read from registers 0x00-0x02.
+ * @param[out] dataRead Pointer to the DS1307_Time_t structure to fill.
+ * @param[in] bcd Non-zero to return masked BCD values, zero for binary values.
+ */
+static void DS1307_Raw_to_Time(const uint8_t* raw, DS1307_Time_t* dataRead, uint8_t bcd)
+{
+    uint8_t sec = (uint8_t)(raw[0] & DS1307_MASK_SEC); /**< Seconds in BCD, CH bit removed. */
+    uint8_t min = (uint8_t)(raw[1] & DS1307_MASK_MIN); /**< Minutes in BCD. */
+    uint8_t hrs = raw[2];                              /**< Raw hours register. */
+    uint8_t hour;                                      /**< Hour in BCD, 24-hour format. */
+
+    if (hrs & (1 << D_DS1307_BIT_HRS))
+    {
+        /* 12-hour mode: 12 AM is 00, 12 PM is 12, PM adds 12 */
+        hour = DS1307_BCD_to_Bin(hrs & DS1307_MASK_HRS_12);
+        if (hour == 12)
+        {
+            hour = 0;
+        }
+        if (hrs & (1 << D_DS1307_BIT_AMPM))
+        {
+            hour += 12;
+        }
+        hour = DS1307_Bin_to_BCD(hour);
+    }
+    else
+    {
+        hour = (uint8_t)(hrs & DS1307_MASK_HRS_24);
+    }
+
+    if (bcd)
+    {
+        dataRead->Sec = sec;
+        dataRead->Min = min;
+        dataRead->Hour = hour;
+    }
+    else
+    {
+        dataRead->Sec = DS1307_BCD_to_Bin(sec);
+        dataRead->Min = DS1307_BCD_to_Bin(min);
+        dataRead->Hour = DS1307_BCD_to_Bin(hour);
+    }
+}
+
+/**
+ * @brief Decodes raw day/date/month/year registers into a DS1307_Date_t structure.
+ * @param[in] raw Pointer to the 4 bytes read from registers 0x03-0x06.
+ * @param[out] dataRead Pointer to the DS1307_Date_t structure to fill.
+ * @param[in] bcd Non-zero to return masked BCD values, zero for binary values.
+ */
+static void DS1307_Raw_to_Date(const uint8_t* raw, DS1307_Date_t* dataRead, uint8_t bcd)
+{
+    uint8_t date = (uint8_t)(raw[1] & DS1307_MASK_DATE);   /**< Date in BCD. */
+    uint8_t month = (uint8_t)(raw[2] & DS1307_MASK_MONTH); /**< Month in BCD. */
+    uint8_t year = (uint8_t)(raw[3] & DS1307_MASK_YEAR);   /**< Year in BCD. */
+
+    /* Day of week is 1-7, identical in BCD and binary */
+    dataRead->Day = (uint8_t)(raw[0] & DS1307_MASK_DAY);
+
+    if (bcd)
+    {
+        dataRead->Date = date;
+        dataRead->Month = month;
+        dataRead->Year = year;
+    }
+    else
+    {
+        dataRead->Date = DS1307_BCD_to_Bin(date);
+        dataRead->Month = DS1307_BCD_to_Bin(month);
+        dataRead->Year = DS1307_BCD_to_Bin(year);
+    }
+}
+
+/**
+ * @brief Decodes a raw timekeeping register snapshot into a DS1307_DateTime_t structure.
+ * @param[in] raw Pointer to the 7 bytes read from registers 0x00-0x06 (seconds to year).
+ * @param[out] dataRead Pointer to the DS1307_DateTime_t structure to fill.
+ * @param[in] bcd Non-zero to return masked BCD values, zero for binary values.
+ */
+static void DS1307_Raw_to_DateTime(const uint8_t* raw, DS1307_DateTime_t* dataRead, uint8_t bcd)
+{
+    DS1307_Raw_to_Time(&raw[D_DS1307_REG_SEC], &dataRead->time, bcd); /**< Registers 0x00-0x02. */
+    DS1307_Raw_to_Date(&raw[D_DS1307_REG_DAY], &dataRead->date, bcd); /**< Registers 0x03-0x06. */
+}
+
+/**
+ * @brief Returns the number of days in a month.
+ * @param[in] month Month, 1-12.
+ * @param[in] year Years since 2000 (every year divisible by 4 is a leap year).
+ * @return uint8_t Days in the month, 0 if month is out of range.
+ */
+static uint8_t DS1307_DaysInMonth(uint8_t month, uint8_t year)
+{
+    static const uint8_t daysInMonth[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}; /**< Days per month, non-leap year. */
+
+    if ((month < 1) || (month > 12))
+    {
+        return 0;
+    }
+    if ((month == 2) && ((year & 3) == 0))
+    {
+        return 29;
+    }
+
+    return daysInMonth[month - 1];
+}
+
+/**
+ * @brief Checks that a binary time is in range (24-hour format).
+ * @param[in] time Pointer to the time to check.
+ * @return uint8_t 1 if every field is in range, 0 otherwise.
+ */
+static uint8_t DS1307_Time_Valid(const DS1307_Time_t* time)
+{
+    return (time->Sec < 60) && (time->Min < 60) && (time->Hour < 24);
+}
+
+/**
+ * @brief Checks that a binary date is in range and exists (years 2000-2099).
+ * @param[in] date Pointer to the date to check; a Day of 0 is accepted.
+ * @return uint8_t 1 if every field is in range, 0 otherwise.
+ */
+static uint8_t DS1307_Date_Valid(const DS1307_Date_t* date)
+{
+    return (date->Day <= 7) && (date->Year <= 99) && (date->Date >= 1) &&
+           (date->Date <= DS1307_DaysInMonth(date->Month, date->Year));
+}
+
+/**
+ * @brief Resolves DS1307_HOURS_KEEP and DS1307_CH_KEEP from the registers of the RTC.
+ * Registers 0x00-0x02 are read only if one of the settings is a KEEP.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] hourMode Hour format, replaced by the current one if DS1307_HOURS_KEEP.
+ * @param[in,out] clockHalt CH setting, replaced by the current one if DS1307_CH_KEEP.
+ * @return DS1307_Status_t Status of the read, DS1307_OK if none was needed.
+ */
+static DS1307_Status_t DS1307_ResolveModes(DS1307_Handle_t *dev, DS1307_HourMode_t* hourMode, DS1307_ClockHalt_t* clockHalt)
+{
+    DS1307_Status_t status; /**< Status of the register read. */
+    uint8_t raw[3];         /**< Registers 0x00-0x02. */
+
+    if ((*hourMode != DS1307_HOURS_KEEP) && (*clockHalt != DS1307_CH_KEEP))
+    {
+        return DS1307_OK;
+    }
+
+    status = DS1307_ReadReg(dev, D_DS1307_REG_SEC, raw, sizeof(raw));
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+
+    if (*hourMode == DS1307_HOURS_KEEP)
+    {
+        *hourMode = (raw[D_DS1307_REG_HRS] & (1 << D_DS1307_BIT_HRS)) ? DS1307_HOURS_12 : DS1307_HOURS_24;
+    }
+    if (*clockHalt == DS1307_CH_KEEP)
+    {
+        *clockHalt = (raw[D_DS1307_REG_SEC] & (1 << D_DS1307_BIT_CH)) ? DS1307_CH_HALT : DS1307_CH_RUN;
+    }
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Encodes a binary time into the seconds, minutes and hours registers.
+ * @param[in] time Pointer to the binary time (24-hour format).
+ * @param[out] raw Pointer to the 3 register bytes 0x00-0x02.
+ * @param[in] hourMode DS1307_HOURS_24 or DS1307_HOURS_12.
+ * @param[in] clockHalt DS1307_CH_RUN or DS1307_CH_HALT.
+ */
+static void DS1307_Time_to_Raw(const DS1307_Time_t* time, uint8_t* raw, DS1307_HourMode_t hourMode, DS1307_ClockHalt_t clockHalt)
+{
+    uint8_t hour = time->Hour; /**< Hour in the format being written. */
+
+    raw[D_DS1307_REG_SEC] = DS1307_Bin_to_BCD(time->Sec);
+    if (clockHalt == DS1307_CH_HALT)
+    {
+        raw[D_DS1307_REG_SEC] |= (1 << D_DS1307_BIT_CH);
+    }
+
+    raw[D_DS1307_REG_MIN] = DS1307_Bin_to_BCD(time->Min);
+
+    if (hourMode == DS1307_HOURS_12)
+    {
+        /* 00 is 12 AM, 12 is 12 PM, 13-23 are 1-11 PM */
+        if (hour >= 12)
+        {
+            hour -= 12;
+        }
+        if (hour == 0)
+        {
+            hour = 12;
+        }
+        raw[D_DS1307_REG_HRS] = (uint8_t)((1 << D_DS1307_BIT_HRS) | DS1307_Bin_to_BCD(hour));
+        if (time->Hour >= 12)
+        {
+            raw[D_DS1307_REG_HRS] |= (1 << D_DS1307_BIT_AMPM);
+        }
+    }
+    else
+    {
+        raw[D_DS1307_REG_HRS] = DS1307_Bin_to_BCD(hour);
+    }
+}
+
+/**
+ * @brief Encodes a binary date into the day, date, month and year registers.
+ * @param[in] date Pointer to the binary date; a Day of 0 is replaced by the weekday.
+ * @param[out] raw Pointer to the 4 register bytes 0x03-0x06.
+ */
+static void DS1307_Date_to_Raw(const DS1307_Date_t* date, uint8_t* raw)
+{
+    DS1307_DateTime_t midnight; /**< Date at 00:00:00, for the weekday. */
+    uint8_t day = date->Day;    /**< Day of week to write. */
+
+    if (day == 0)
+    {
+        /* 1970-01-01 was a Thursday (5) */
+        midnight.date = *date;
+        midnight.time.Hour = 0;
+        midnight.time.Min = 0;
+        midnight.time.Sec = 0;
+        day = (uint8_t)(((DS1307_DateTime_to_Epoch(&midnight) / DS1307_SECONDS_PER_DAY) + 4u) % 7u + 1u);
+    }
+
+    raw[0] = day;
+    raw[1] = DS1307_Bin_to_BCD(date->Date);
+    raw[2] = DS1307_Bin_to_BCD(date->Month);
+    raw[3] = DS1307_Bin_to_BCD(date->Year);
+}
+
+/**
+ * @brief Bitmap of registers regAdd..regAdd+len-1.
+ * @param[in] regAdd Address of the first register.
+ * @param[in] len Number of registers, 1-64.
+ * @return uint64_t Bit n set for every register n in the range.
+ */
+static uint64_t DS1307_RegMask(uint8_t regAdd, uint8_t len)
+{
+    uint64_t run = (len >= 64) ? ~(uint64_t)0 : (((uint64_t)1 << len) - 1); /**< len low bits set. */
+
+    return run << regAdd;
+}
+
+/**
+ * @brief Records registers just read from the device in the shadow.
+ * Registers with unflushed local changes keep their local value.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Address of the first register read.
+ * @param[in] data Register contents.
+ * @param[in] len Number of registers read.
+ */
+static void DS1307_Shadow_Update(DS1307_Handle_t *dev, uint8_t regAdd, const uint8_t *data, uint8_t len)
+{
+    DS1307_Shadow_t *shadow = &dev->shadow; /**< Shadow register file. */
+    uint64_t bit;                           /**< Bitmap bit of the current register. */
+    uint8_t i;                              /**< Loop index. */
+
+    for (i = 0; i < len; i++)
     {
-        data[i] = ((data[i] / 10) << 4) | (data[i] % 10);
+        bit = (uint64_t)1 << (regAdd + i);
+        if ((bit & DS1307_SHADOW_CACHED) && !(shadow->dirty & bit))
+        {
+            shadow->reg[regAdd + i] = data[i];
+            shadow->valid |= bit;
+        }
     }
 }
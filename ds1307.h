@@ -26,9 +26,11 @@
  * 4. Initialize the DS1307 RTC by calling the `DS1307_Init` function with the appropriate
  *    I2C handler and SQW output settings:
  *    @code
- *    DS1307_Status_t status = DS1307_Init(&hi2c1, DS1307_SQWO_DISABLE);
+ *    DS1307_Handle_t rtc;
+ *    DS1307_Status_t status = DS1307_Init(&rtc, &hi2c1, _No_Output_0);
  *    @endcode
- *    where `hi2c1` is your I2C handler and `DS1307_SQWO_DISABLE` configures the Square Wave Output.
+ *    where `rtc` is the device handle passed to every other driver function, `hi2c1` is
+ *    your I2C handler and `_No_Output_0` configures the Square Wave Output.
  *
  * 5. Use the provided functions to read date and time whenever needed:
  *    - Call functions like `DS1307_ReadDate()` or `DS1307_ReadTime()` as needed in your application.
@@ -41,12 +43,42 @@
 #define _INC_DS1307_H_
 
 /* Include Files */
+#ifndef DS1307_NO_HAL
 #include <main.h>
+#else
+#include <stdint.h>
+#endif
 
 #define DS1307_Debug /* Uncomment this line to get printf debugging statements */
 
-#define DS1307_TIMEOUT                           10
-#define DS1307_MAX_BUFF_SIZE                     64
+/* Define DS1307_NO_HAL (e.g. -DDS1307_NO_HAL) to build the driver without the STM32 HAL,
+ * for example on a Linux host with a non-HAL transport. */
+
+/* Define DS1307_NO_METRICS to build the driver without the per-device counters and latency
+ * histograms (DS1307_Metrics_*). */
+
+#ifndef DS1307_TIMEOUT
+#define DS1307_TIMEOUT                           10          /**< Default hard ceiling of a transaction timeout, in milliseconds. */
+#endif
+#ifndef DS1307_TIMEOUT_MARGIN
+#define DS1307_TIMEOUT_MARGIN                    4u          /**< Factor between the p99 per-byte latency and the per-byte timeout. */
+#endif
+#define DS1307_TIMEOUT_BUCKETS                   20u         /**< Buckets of the per-byte latency histogram; bucket b counts 2^b to 2^(b+1)-1 ns. */
+#define DS1307_TIMEOUT_WINDOW                    256u        /**< Samples after which the histogram is halved, so old latencies fade. */
+#define DS1307_TIMEOUT_MIN_SAMPLES               32u         /**< Samples needed before the learned latency replaces the nominal bus speed. */
+#define DS1307_METRICS_BUCKETS                   16u         /**< Buckets of each latency histogram; bucket b counts 2^b to 2^(b+1)-1 us. */
+#define DS1307_METRICS_STATUSES                  8u          /**< Status values counted by the metrics, DS1307_OK to DS1307_CIRCUIT_OPEN. */
+#define DS1307_MAX_BUFF_SIZE                     64 /* Size of the register file, 0x00-0x3F */
+#define DS1307_NVRAM_SIZE                        56u         /**< Bytes of battery-backed RAM, registers 0x08-0x3F. */
+#ifndef DS1307_NVRAM_MAX_BURST
+#define DS1307_NVRAM_MAX_BURST                   DS1307_NVRAM_SIZE /**< Largest NVRAM transfer issued at once; lower it for buses with short transfers. */
+#endif
+#if DS1307_NVRAM_MAX_BURST < 1
+#error "DS1307_NVRAM_MAX_BURST must be at least 1"
+#endif
+#define DS1307_SHADOW_MAX_GAP                    2u          /**< Known registers a flush may rewrite to merge two dirty runs. */
+#define DS1307_EPOCH_MIN                         946684800u  /**< 2000-01-01 00:00:00, first second the DS1307 can hold. */
+#define DS1307_EPOCH_MAX                         4102444799u /**< 2099-12-31 23:59:59, last second the DS1307 can hold. */
 
 /* DS1307 IMPORTANT CONFIGURATIONS AND DEFINATIONS*/
 /**
@@ -530,6 +562,8 @@ typedef enum
     DS1307_TIMEOUT_ERR = 3,      /**< Operation timed out. */
     DS1307_NOT_FOUND = 4,        /**< DS1307 device not found on the I2C bus. */
     DS1307_DATA_SIZE_ERROR = 5,  /**< The size of the data to be written or read is incorrect. */
+    DS1307_INVALID_PARAM = 6,    /**< A parameter is outside the range supported by the DS1307. */
+    DS1307_CIRCUIT_OPEN = 7,     /**< The circuit breaker is open: the call failed fast without touching the bus. */
 } DS1307_Status_t;
 
 /**
@@ -566,16 +600,345 @@ typedef struct
     DS1307_Time_t time; /**< Time information (Hour, Min, Sec). */
 } DS1307_DateTime_t;
 
+/**
+ * @brief Hour format written by the DS1307_Write* functions.
+ */
+typedef enum
+{
+    DS1307_HOURS_KEEP = 0,       /**< Keep the 12/24-hour mode the RTC is in (costs one extra read). */
+    DS1307_HOURS_24 = 1,         /**< Switch to 24-hour mode. */
+    DS1307_HOURS_12 = 2          /**< Switch to 12-hour mode with AM/PM. */
+} DS1307_HourMode_t;
+
+/**
+ * @brief Clock halt (CH) setting written by the DS1307_Write* functions.
+ */
+typedef enum
+{
+    DS1307_CH_KEEP = 0,          /**< Keep the CH bit as it is (costs one extra read). */
+    DS1307_CH_RUN = 1,           /**< Clear CH: the oscillator runs. */
+    DS1307_CH_HALT = 2           /**< Set CH: the oscillator is stopped. */
+} DS1307_ClockHalt_t;
+
+/**
+ * @brief DS1307 device handle, see struct DS1307_Handle_s.
+ */
+typedef struct DS1307_Handle_s DS1307_Handle_t;
+
+/**
+ * @brief Completion callback of the asynchronous (_IT) API.
+ * Called from the transfer-complete or error interrupt of the backend once the
+ * transfer started by an _IT function has finished.
+ * @param[in] dev Pointer to the DS1307 device handle that started the transfer.
+ * @param[in] status DS1307_OK if the transfer completed, or an error code.
+ * @param[in] userData User pointer given when the transfer was started.
+ */
+typedef void (*DS1307_Callback_t)(DS1307_Handle_t *dev, DS1307_Status_t status, void *userData);
+
+/**
+ * @brief Bus transport used by the driver to reach the DS1307.
+ * The driver never talks to the I2C peripheral directly; every register access goes
+ * through one of these operations. A backend fills this table for its bus (STM32 HAL,
+ * Linux i2c-dev, ...) and passes it to DS1307_InitTransport() together with its bus
+ * context pointer, which is handed back unchanged as the first argument of every call.
+ * The timeout of the blocking operations is in microseconds; backends with a coarser
+ * time base round it up.
+ */
+typedef struct
+{
+    /**
+     * Reads @p len consecutive registers starting at @p regAdd into @p data
+     * (pointer write followed by a repeated-start read).
+     */
+    DS1307_Status_t (*ReadRegs)(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, uint32_t timeout);
+
+    /**
+     * Writes @p len bytes from @p data to consecutive registers starting at @p regAdd
+     * in a single transaction.
+     */
+    DS1307_Status_t (*WriteRegs)(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, uint32_t timeout);
+
+    /**
+     * Checks that a device acknowledges @p devAddr on the bus.
+     */
+    DS1307_Status_t (*Probe)(void *bus, uint8_t devAddr, uint32_t timeout);
+
+    /**
+     * Starts a non-blocking register block read and returns immediately. When the
+     * transfer finishes the backend calls DS1307_AsyncComplete() with @p dev.
+     * May be NULL if the backend has no asynchronous mode.
+     */
+    DS1307_Status_t (*ReadRegsAsync)(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, DS1307_Handle_t *dev);
+
+    /**
+     * Starts a non-blocking register block write and returns immediately. When the
+     * transfer finishes the backend calls DS1307_AsyncComplete() with @p dev.
+     * May be NULL if the backend has no asynchronous mode.
+     */
+    DS1307_Status_t (*WriteRegsAsync)(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, DS1307_Handle_t *dev);
+} DS1307_Transport_t;
+
+/**
+ * @brief Transfer statistics kept per DS1307 device.
+ */
+typedef struct
+{
+    uint32_t Transactions; /**< Number of bus transactions issued. */
+    uint32_t Errors;       /**< Number of transactions that did not return DS1307_OK. */
+    uint32_t Retries;      /**< Number of transactions repeating a failed one. */
+    uint32_t Recoveries;   /**< Number of bus clear / peripheral re-init sequences run. */
+    uint32_t Rejected;     /**< Number of operations failed fast by the open circuit breaker. */
+} DS1307_Stats_t;
+
+/**
+ * @brief State of the asynchronous transfer in flight on a device.
+ */
+typedef struct
+{
+    volatile uint8_t busy;  /**< Non-zero while a transfer is in flight. */
+    uint8_t op;             /**< Internal code of the started operation (decode to apply). */
+    void *dst;              /**< Destination structure or buffer of the operation. */
+    DS1307_Callback_t cb;   /**< Completion callback. */
+    void *userData;         /**< User pointer passed to the callback. */
+    uint8_t raw[7];         /**< Raw register buffer used by the time/date reads. */
+} DS1307_Async_t;
+
+/**
+ * @brief Raw snapshot of the timekeeping registers 0x00-0x06 (seconds to year) as read
+ *        from the device, before any decoding.
+ */
+typedef struct
+{
+    uint8_t reg[7]; /**< Register contents, indexed by D_DS1307_REG_SEC..D_DS1307_REG_YEAR. */
+} DS1307_Snapshot_t;
+
+/**
+ * @brief State of the SQW-triggered snapshot sampler.
+ * The sampler is a single-producer / single-consumer ring: the SQW edge and transfer
+ * complete interrupts fill slots, the application drains them with DS1307_Sampler_Pop().
+ */
+typedef struct
+{
+    DS1307_Snapshot_t *slots;    /**< Caller-provided ring storage. */
+    uint16_t size;               /**< Number of slots in the ring (one is kept free). */
+    volatile uint16_t head;      /**< Next slot to be filled by the sampler. */
+    volatile uint16_t tail;      /**< Oldest slot not yet consumed. */
+    volatile uint8_t active;     /**< Non-zero while edges trigger sampling. */
+    volatile uint32_t overruns;  /**< Edges dropped because the ring was full or the bus busy. */
+} DS1307_Sampler_t;
+
+/**
+ * @brief State of the SQW-driven software clock.
+ * The clock holds the current date and time in RAM (binary, 24-hour) and is advanced by
+ * one second on every SQW edge, so reading it never touches the bus.
+ */
+typedef struct
+{
+    DS1307_DateTime_t now;            /**< Current date and time, binary 24-hour format. */
+    volatile uint32_t seq;            /**< Update sequence counter, odd while now is being written. */
+    volatile uint32_t ticks;          /**< Number of SQW edges seen since the clock was started. */
+    volatile uint32_t sinceSync;      /**< Seconds advanced since the last hardware resynchronisation. */
+    uint32_t resyncInterval;          /**< Seconds between hardware resynchronisations, 0 for never. */
+    volatile uint8_t resyncPending;   /**< Set by the edge handler when a resynchronisation is due. */
+    volatile uint8_t active;          /**< Non-zero while the software clock is running. */
+    volatile uint8_t syncReady;       /**< Set when syncValue holds a fresh hardware reading to apply. */
+    DS1307_DateTime_t syncValue;      /**< Hardware reading handed from the task to the edge handler. */
+    uint32_t syncTicks;               /**< Value of ticks when syncValue was read. */
+} DS1307_SoftClock_t;
+
+/**
+ * @brief Free-running monotonic tick counter used to interpolate between RTC seconds.
+ * The counter may wrap; the driver only uses differences modulo 2^32, which stay valid as
+ * long as the counter does not wrap between two SQW edges or two re-alignments.
+ */
+typedef struct
+{
+    uint32_t (*Now)(void *ctx); /**< Returns the current counter value. */
+    void *ctx;                  /**< Context pointer passed to Now. */
+    uint32_t hz;                /**< Counter frequency in ticks per second. */
+} DS1307_TickSource_t;
+
+/**
+ * @brief State of the sub-second timestamp interpolator.
+ * The interpolator anchors on the last RTC second boundary (an SQW edge or a detected
+ * seconds change) and adds the ticks elapsed since then.
+ */
+typedef struct
+{
+    DS1307_TickSource_t src;          /**< Tick source used for interpolation. */
+    volatile uint32_t anchorEpoch;    /**< Unix time of the anchored second boundary. */
+    volatile uint32_t anchorTick;     /**< Counter value at the anchored second boundary. */
+    volatile uint32_t seq;            /**< Update sequence counter, odd while the anchor is written. */
+    volatile uint8_t active;          /**< Non-zero once an anchor is available. */
+    volatile uint8_t edges;           /**< Set once SQW edges re-anchor the interpolator every second. */
+} DS1307_SubSec_t;
+
+/**
+ * @brief Shadow copy of the register file 0x00-0x3F.
+ * Bit n of each bitmap refers to register n. Only the control register and the RAM
+ * (0x07-0x3F) are cached: the timekeeping registers 0x00-0x06 change on their own and are
+ * always read from the device.
+ */
+typedef struct
+{
+    uint8_t reg[DS1307_MAX_BUFF_SIZE]; /**< Last known or locally modified register contents. */
+    uint64_t valid;                    /**< Registers whose shadow content is known. */
+    uint64_t dirty;                    /**< Registers modified locally and not yet written. */
+} DS1307_Shadow_t;
+
+/**
+ * @brief Adaptive transaction timeout state of a device.
+ * The timeout of a transaction is slackUs plus DS1307_TIMEOUT_MARGIN times its bytes on the
+ * wire (address, register and data bytes) times the per-byte latency, capped at the
+ * ceiling. The per-byte latency is the p99 learned from the successful transactions timed
+ * on clock, or the nominal 9 bit times at busHz until DS1307_TIMEOUT_MIN_SAMPLES are
+ * known. With neither, every transaction gets the ceiling.
+ */
+typedef struct
+{
+    DS1307_TickSource_t clock;              /**< Times the transactions; nothing is learned without Now. */
+    uint32_t busHz;                         /**< Nominal SCL frequency, 0 if unknown. */
+    uint32_t slackUs;                       /**< Fixed allowance added to every timeout (interrupt and scheduling latency). */
+    uint32_t ceilingUs;                     /**< Hard ceiling of every timeout, 0 for DS1307_TIMEOUT milliseconds. */
+    uint16_t hist[DS1307_TIMEOUT_BUCKETS];  /**< Histogram of the per-byte latency of successful transactions. */
+    uint16_t samples;                       /**< Samples in hist. */
+    uint32_t p99NsPerByte;                  /**< Upper bound of the bucket holding the 99th percentile, 0 until enough samples. */
+} DS1307_Timeout_t;
+
+/**
+ * @brief Retry, bus recovery and circuit breaker policy of a device.
+ * A failed blocking transaction is repeated up to maxRetries times. Before a retry that
+ * follows a timeout, or a second DS1307_BUSY in a row, the bus is cleared and the
+ * peripheral re-initialized through the hooks; every retry then waits backoffUs, doubled at
+ * each further retry. After breakerThreshold consecutive failed operations the breaker
+ * opens: calls fail fast with DS1307_CIRCUIT_OPEN for cooldownUs, then a single trial
+ * operation decides whether it closes or opens again. The all-zero policy left by
+ * DS1307_Init(), or by DS1307_InitTransport() without a policy, disables all of this.
+ */
+typedef struct
+{
+    uint8_t maxRetries;                          /**< Retries after a failed transaction, 0 for none. */
+    uint32_t backoffUs;                          /**< Delay before the first retry in microseconds, doubled at each further retry. */
+    uint32_t backoffMaxUs;                       /**< Ceiling of the retry delay, 0 for none. */
+    void (*Delay)(void *ctx, uint32_t us);       /**< Waits for the retry delay, or NULL to retry at once. */
+    DS1307_Status_t (*BusClear)(void *ctx);      /**< Frees a stuck SDA (9 SCL pulses then a STOP, by GPIO), or NULL. Retries stop if it fails. */
+    DS1307_Status_t (*Reinit)(void *ctx);        /**< Resets and re-initializes the I2C peripheral, or NULL. Retries stop if it fails. */
+    void *ctx;                                   /**< Context pointer passed to the hooks. */
+    uint8_t breakerThreshold;                    /**< Consecutive failed operations that open the breaker, 0 to disable it. */
+    uint32_t cooldownUs;                         /**< Time the open breaker fails calls fast, in microseconds. */
+    DS1307_TickSource_t clock;                   /**< Time base of the cooldown; the breaker is disabled without Now. */
+} DS1307_RecoveryPolicy_t;
+
+/**
+ * @brief States of the circuit breaker.
+ */
+typedef enum
+{
+    DS1307_BREAKER_CLOSED = 0,  /**< Transactions reach the bus. */
+    DS1307_BREAKER_OPEN,        /**< Operations fail fast until the cooldown has elapsed. */
+    DS1307_BREAKER_HALF_OPEN    /**< One trial operation, without retries, is in progress. */
+} DS1307_BreakerState_t;
+
+/**
+ * @brief Recovery policy and circuit breaker state of a device.
+ */
+typedef struct
+{
+    DS1307_RecoveryPolicy_t policy;  /**< Policy set with DS1307_SetRecovery(). */
+    uint8_t failures;                /**< Consecutive failed operations. */
+    DS1307_BreakerState_t state;     /**< Circuit breaker state. */
+    uint32_t openedAt;               /**< Clock counter value when the breaker last opened. */
+} DS1307_Recovery_t;
+
+#ifndef DS1307_NO_METRICS
+/**
+ * @brief APIs with their own latency histogram in the device metrics.
+ */
+typedef enum
+{
+    DS1307_API_OTHER = 0,       /**< Transfers of every other function (init, shadow flushes, date reads, ...). */
+    DS1307_API_READ_TIME,       /**< DS1307_ReadTime_Bin/BCD() and their _IT variants. */
+    DS1307_API_READ_DATETIME,   /**< DS1307_ReadDateTime_Bin/BCD() and their _IT variants. */
+    DS1307_API_WRITE_REG,       /**< DS1307_WriteReg(), DS1307_WriteReg_IT() and the setters built on them. */
+    DS1307_API_NVRAM,           /**< DS1307_NvramRead() and DS1307_NvramWrite() bursts. */
+    DS1307_API_COUNT            /**< Number of APIs. */
+} DS1307_Api_t;
+
+/**
+ * @brief Counters and latency histograms of a device.
+ * A transfer is one driver-level register access, with all its retries; its latency runs
+ * from the first attempt to the final status. The transaction, retry and rejection counts
+ * are those of the device statistics, copied by DS1307_Metrics_Snapshot().
+ */
+typedef struct
+{
+    DS1307_Stats_t stats;                                        /**< Transfer statistics of the device (dev->stats). */
+    uint32_t bytesRead;                                          /**< Register bytes read by successful transfers. */
+    uint32_t bytesWritten;                                       /**< Register bytes written by successful transfers. */
+    uint32_t errors[DS1307_METRICS_STATUSES];                    /**< stats.Errors by status; DS1307_CIRCUIT_OPEN holds stats.Rejected. */
+    uint32_t latency[DS1307_API_COUNT][DS1307_METRICS_BUCKETS];  /**< Transfers by latency; bucket 0 includes 0 us and the last bucket everything longer. */
+    uint64_t busyUs[DS1307_API_COUNT];                           /**< Total latency of the transfers of each API, in microseconds. */
+} DS1307_Metrics_t;
+
+/**
+ * @brief Metrics state of a device.
+ */
+typedef struct
+{
+    DS1307_Metrics_t data;        /**< Counters and histograms. */
+    DS1307_TickSource_t clock;    /**< Times the transfers; the histograms stay empty without Now. */
+    uint8_t api;                  /**< API the next blocking transfer is attributed to. */
+    uint8_t asyncApi;             /**< API of the asynchronous transfer in flight. */
+    uint8_t asyncLen;             /**< Register bytes of the asynchronous transfer in flight. */
+    uint8_t asyncWrite;           /**< Non-zero if the asynchronous transfer in flight is a write. */
+    uint32_t asyncStart;          /**< Clock counter value when the asynchronous transfer started. */
+} DS1307_MetricsState_t;
+#endif
+
+/**
+ * @brief DS1307 device handle.
+ * One handle is kept per RTC and passed to every driver function, so a single firmware
+ * image can drive several DS1307 devices on several buses. The handle is filled by
+ * DS1307_Init() / DS1307_InitTransport(); its fields should be treated as read-only by
+ * the application.
+ */
+struct DS1307_Handle_s
+{
+    const DS1307_Transport_t *transport; /**< Bus operations used to reach the device. */
+    void *bus;                           /**< Backend bus context (I2C_HandleTypeDef * for the HAL backend). */
+    uint8_t addr;                        /**< 7-bit slave address of the device. */
+    DS1307_Shadow_t shadow;              /**< Shadow register file. */
+    uint8_t oscStopped;                  /**< Set by init if CH was set: the oscillator had stopped and the time is not valid. */
+    DS1307_Stats_t stats;                /**< Transfer statistics. */
+    DS1307_Async_t async;                /**< Asynchronous transfer state. */
+    DS1307_Sampler_t sampler;            /**< SQW-triggered snapshot sampler state. */
+    DS1307_SoftClock_t softClock;        /**< SQW-driven software clock state. */
+    DS1307_SubSec_t subSec;              /**< Sub-second timestamp interpolator state. */
+    DS1307_Recovery_t recovery;          /**< Retry, bus recovery and circuit breaker state. */
+    DS1307_Timeout_t timeout;            /**< Adaptive transaction timeout state. */
+#ifndef DS1307_NO_METRICS
+    DS1307_MetricsState_t metrics;       /**< Counters and latency histograms. */
+#endif
+};
+
+
 
 /**
  * @brief Initializes the DS1307 RTC with the specified I2C handler and square wave output setting.
  * This function initializes the DS1307 real-time clock (RTC) by configuring its I2C 
  * handler and setting the square wave output (SQW/OUT) according to the provided 
- * configuration. The initialization process includes resetting the CH bit to enable 
- * the oscillator and configuring the square wave output frequency.
+ * configuration. The initialization keeps the running time: the seconds and the
+ * control register are read in one burst, the CH bit is cleared only if it is set
+ * (keeping the seconds value), and the control register is written only when it differs
+ * from sqwOut. A warm boot therefore costs a single read transaction.
+ * dev->oscStopped reports whether the oscillator had been halted, i.e. whether the time
+ * was lost (battery backup failure) or never set. The recovery policy is cleared; to
+ * initialize with one, call DS1307_InitTransport() with DS1307_Transport_HAL.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[in] handler Pointer to an I2C_HandleTypeDef structure that contains the configuration 
  *                    information for the I2C peripheral to be used for communication with 
- *                    the DS1307 RTC.
+ *                    the DS1307 RTC. The handle is referenced by the device handle and must
+ *                    outlive it.
  * @param[in] sqwOut Square wave output configuration. This parameter sets the frequency of 
  *                    the square wave output or disables it. The configuration should be 
  *                    specified using the DS1307_SQWO_t enumeration.
@@ -583,35 +946,156 @@ typedef struct
  *         success, or an error code if the initialization fails. Specifically, it returns 
  *         DS1307_NOT_FOUND if the DS1307 RTC is not detected.
  */
-DS1307_Status_t DS1307_Init(I2C_HandleTypeDef *handler, DS1307_SQWO_t sqwOut);
+#ifndef DS1307_NO_HAL
+DS1307_Status_t DS1307_Init(DS1307_Handle_t *dev, I2C_HandleTypeDef *handler, DS1307_SQWO_t sqwOut);
+#endif
+
+/**
+ * @brief Initializes the DS1307 RTC over an arbitrary bus transport.
+ * This function performs the same initialization sequence as DS1307_Init() but uses the
+ * supplied transport for every bus access instead of the STM32 HAL. It is the entry point
+ * for non-HAL backends (Linux i2c-dev, simulators, ...).
+ * The handle is cleared first and then given the recovery policy, so the initialization
+ * transfers already run under it; pass the same policy again when re-initializing.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] transport Pointer to the transport operations. Must remain valid while the
+ *                      driver is in use.
+ * @param[in] bus Backend-specific bus context passed back to every transport operation.
+ * @param[in] sqwOut Square wave output configuration, see DS1307_SQWO_t.
+ * @param[in] policy Recovery policy copied into the handle as by DS1307_SetRecovery(), or
+ *                   NULL for none.
+ * @return DS1307_Status_t Status of the initialization operation. Returns DS1307_OK on
+ *         success, DS1307_NOT_FOUND if the DS1307 RTC is not detected, or the status of
+ *         the failed register write.
+ */
+DS1307_Status_t DS1307_InitTransport(DS1307_Handle_t *dev, const DS1307_Transport_t *transport, void *bus, DS1307_SQWO_t sqwOut,
+                                     const DS1307_RecoveryPolicy_t *policy);
+
+/**
+ * @brief Checks whether the DS1307 acknowledges its slave address.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @return DS1307_Status_t Returns DS1307_OK if the device answers, DS1307_NOT_FOUND
+ *         otherwise.
+ */
+DS1307_Status_t DS1307_Probe(DS1307_Handle_t *dev);
+
+/**
+ * @brief Sets the retry, bus recovery and circuit breaker policy of a device.
+ * DS1307_InitTransport() takes the policy as a parameter and DS1307_Init() clears it; this
+ * function changes it at any time afterwards. The breaker is closed and its failure count
+ * cleared. The policy applies to the blocking transfers; asynchronous transfers and
+ * DS1307_Probe() bypass it, so a probe can check the device while the breaker is open.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] policy Policy to copy into the handle.
+ */
+void DS1307_SetRecovery(DS1307_Handle_t *dev, const DS1307_RecoveryPolicy_t *policy);
+
+/**
+ * @brief Enables adaptive transaction timeouts.
+ * Must be called after DS1307_Init() / DS1307_InitTransport(), which leave every transaction
+ * with the DS1307_TIMEOUT ceiling. The learned latencies are cleared. Backends round the
+ * timeouts to the resolution of their bus layer; on Linux i2c-dev that is 10 ms, which is
+ * then also the shortest timeout.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] clock Tick source timing the transactions, or NULL to use busHz only.
+ * @param[in] busHz Nominal SCL frequency used until latencies are learned, 0 if unknown.
+ * @param[in] slackUs Fixed allowance added to every timeout, in microseconds.
+ * @param[in] ceilingUs Hard ceiling of every timeout in microseconds, 0 for DS1307_TIMEOUT
+ *                      milliseconds.
+ */
+void DS1307_SetTimeouts(DS1307_Handle_t *dev, const DS1307_TickSource_t *clock, uint32_t busHz, uint32_t slackUs, uint32_t ceilingUs);
+
+#ifndef DS1307_NO_METRICS
+/**
+ * @brief Sets the tick source timing the transfers for the latency histograms.
+ * DS1307_Init() / DS1307_InitTransport() clear the metrics and leave them without a clock:
+ * counters run, histograms stay empty.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] clock Tick source, or NULL to stop timing.
+ */
+void DS1307_Metrics_SetClock(DS1307_Handle_t *dev, const DS1307_TickSource_t *clock);
+
+/**
+ * @brief Copies the counters and histograms of a device, optionally clearing them.
+ * The device statistics (dev->stats) are part of the metrics: they are copied into the
+ * snapshot and cleared with the rest. Not atomic with respect to an asynchronous
+ * completion of the same device.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] snapshot Receives the metrics, or NULL to only clear them.
+ * @param[in] reset Non-zero to clear the metrics after the copy.
+ */
+void DS1307_Metrics_Snapshot(DS1307_Handle_t *dev, DS1307_Metrics_t *snapshot, uint8_t reset);
+#endif
 
 /**
  * @brief Reads data from a specified register of the DS1307 RTC.
  * 
  * This function reads data from a specific register of the DS1307 real-time clock (RTC)
  * and stores it in the provided buffer. It uses I2C communication to access the register
- * and retrieves the requested number of bytes.
+ * and retrieves the requested number of bytes directly into the caller's buffer.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[in] regAdd The address of the register to read from.
  * @param[out] dataRead Pointer to the buffer where the read data will be stored.
  * @param[in] readLen The number of bytes to read from the register.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success,
- *         or an error code if the operation fails.
+ *         or an error code if the operation fails. Returns DS1307_DATA_SIZE_ERROR if
+ *         readLen is 0 or the read would run past register 0x3F.
  */
-DS1307_Status_t DS1307_ReadReg(uint8_t regAdd, uint8_t *dataRead, uint8_t readLen);
+DS1307_Status_t DS1307_ReadReg(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t *dataRead, uint8_t readLen);
 
 /**
  * @brief Writes data to a specified register of the DS1307 RTC.
  * This function writes a specified number of bytes to a register in the DS1307 real-time 
- * clock (RTC) using I2C communication. It first checks if the data size exceeds the maximum 
- * buffer size and then performs the write operation if valid.
+ * clock (RTC) using I2C communication. It first checks that the write stays inside the
+ * register file and then transfers the caller's buffer directly.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[in] regAdd The address of the register to write to.
  * @param[in] dataWrite Pointer to the buffer containing the data to be written.
  * @param[in] writeLen The number of bytes to write to the register.
  * @return DS1307_Status_t Status of the write operation. Returns DS1307_OK on success, 
  *         or an error code if the operation fails. Specifically, returns DS1307_DATA_SIZE_ERROR 
- *         if the data length exceeds the maximum buffer size.
+ *         if writeLen is 0 or the write would run past register 0x3F.
+ */
+DS1307_Status_t DS1307_WriteReg(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t *dataWrite, uint8_t writeLen);
+
+/**
+ * @brief Sets the date and time of the DS1307 RTC in one transaction.
+ * The binary values are encoded to BCD and registers 0x00-0x06 are written in a single
+ * burst, so the RTC cannot roll over between the fields and no torn value is ever
+ * visible. The internal divider chain is reset by the write to the seconds register.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] dataWrite Binary date and time, hour in 24-hour format. A Day of 0 is
+ *                      replaced by the weekday of the date (1 = Sunday).
+ * @param[in] hourMode Hour format to store, or DS1307_HOURS_KEEP.
+ * @param[in] clockHalt CH bit to store, or DS1307_CH_KEEP.
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_INVALID_PARAM if a field is
+ *         out of range, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_WriteDateTime(DS1307_Handle_t *dev, const DS1307_DateTime_t *dataWrite, DS1307_HourMode_t hourMode, DS1307_ClockHalt_t clockHalt);
+
+/**
+ * @brief Sets the time of the DS1307 RTC in one transaction.
+ * Registers 0x00-0x02 are written in a single burst; the date is not touched.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] dataWrite Binary time, hour in 24-hour format.
+ * @param[in] hourMode Hour format to store, or DS1307_HOURS_KEEP.
+ * @param[in] clockHalt CH bit to store, or DS1307_CH_KEEP.
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_INVALID_PARAM if a field is
+ *         out of range, or the status of the failed transfer.
  */
-DS1307_Status_t DS1307_WriteReg(uint8_t regAdd, uint8_t *dataWrite, uint8_t writeLen);
+DS1307_Status_t DS1307_WriteTime(DS1307_Handle_t *dev, const DS1307_Time_t *dataWrite, DS1307_HourMode_t hourMode, DS1307_ClockHalt_t clockHalt);
+
+/**
+ * @brief Sets the date of the DS1307 RTC in one transaction.
+ * Registers 0x03-0x06 are written in a single burst; the time, the CH bit and the hour
+ * format are not touched.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] dataWrite Binary date. A Day of 0 is replaced by the weekday of the date
+ *                      (1 = Sunday).
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_INVALID_PARAM if a field is
+ *         out of range, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_WriteDate(DS1307_Handle_t *dev, const DS1307_Date_t *dataWrite);
 
 /**
  * @brief Reads the current time from the DS1307 RTC in binary format.
@@ -619,80 +1103,535 @@ DS1307_Status_t DS1307_WriteReg(uint8_t regAdd, uint8_t *dataWrite, uint8_t writ
  * This function reads the seconds, minutes, and hours from the DS1307 real-time 
  * clock (RTC) in binary format and stores the values in the provided DS1307_Time_t 
  * structure.
+ * The CH bit and the 12/24-hour control bits are masked off, and the hour is always
+ * returned in 24-hour format whatever mode the RTC runs in.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_Time_t structure where the read time values 
  *                      will be stored. The structure's fields are updated with the 
  *                      current time read from the RTC.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
  *         or an error code if the operation fails. 
  */
-DS1307_Status_t DS1307_ReadTime_Bin(DS1307_Time_t* dataRead);
+DS1307_Status_t DS1307_ReadTime_Bin(DS1307_Handle_t *dev, DS1307_Time_t* dataRead);
 
 /**
  * @brief Reads the current time from the DS1307 RTC in BCD format.
  * This function reads the seconds, minutes, and hours from the DS1307 real-time 
  * clock (RTC) in Binary-Coded Decimal (BCD) format and stores the values in the 
  * provided DS1307_Time_t structure.
+ * The CH bit and the 12/24-hour control bits are masked off, and the hour is always
+ * returned in 24-hour format whatever mode the RTC runs in.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_Time_t structure where the read time values 
  *                      will be stored. The structure's fields are updated with the 
  *                      current time read from the RTC in BCD format.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
  *         or an error code if the operation fails.
  */
-DS1307_Status_t DS1307_ReadTime_BCD(DS1307_Time_t* dataRead);
+DS1307_Status_t DS1307_ReadTime_BCD(DS1307_Handle_t *dev, DS1307_Time_t* dataRead);
 
 /**
  * @brief Reads the current date from the DS1307 RTC in binary format.
  * This function reads the day, date, month, and year from the DS1307 real-time 
  * clock (RTC) in binary format and stores the values in the provided DS1307_Date_t 
  * structure.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_Date_t structure where the read date values 
  *                      will be stored. The structure's fields are updated with the 
  *                      current date read from the RTC in binary format.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
  *         or an error code if the operation fails.
  */
-DS1307_Status_t DS1307_ReadDate_Bin(DS1307_Date_t* dataRead);
+DS1307_Status_t DS1307_ReadDate_Bin(DS1307_Handle_t *dev, DS1307_Date_t* dataRead);
 
 /**
  * @brief Reads the current date from the DS1307 RTC in BCD format.
  * This function reads the day, date, month, and year from the DS1307 real-time 
  * clock (RTC) in Binary-Coded Decimal (BCD) format and stores the values in the 
  * provided DS1307_Date_t structure.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_Date_t structure where the read date values 
  *                      will be stored. The structure's fields are updated with the 
  *                      current date read from the RTC in BCD format.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
  *         or an error code if the operation fails.
  */
-DS1307_Status_t DS1307_ReadDate_BCD(DS1307_Date_t* dataRead);
+DS1307_Status_t DS1307_ReadDate_BCD(DS1307_Handle_t *dev, DS1307_Date_t* dataRead);
 
 /**
  * @brief Reads the current date and time from the DS1307 RTC in binary format.
  * This function reads the date and time from the DS1307 real-time clock (RTC) in 
  * binary format and stores the values in the provided DS1307_DateTime_t structure. 
- * The function first reads the date and then reads the time.
+ * Registers 0x00-0x06 are fetched in a single I2C burst, so the date and the time are
+ * sampled at the same instant and cannot tear across a midnight rollover.
+ * The CH bit and the 12/24-hour control bits are masked off, and the hour is always
+ * returned in 24-hour format whatever mode the RTC runs in.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_DateTime_t structure where the read date and 
  *                      time values will be stored. The structure's fields are updated 
  *                      with the current date and time read from the RTC in binary format.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
- *         or an error code if the operation fails. If an error occurs during either 
- *         date or time read, the function returns the status of the last operation.
+ *         or an error code if the burst read fails.
  */
-DS1307_Status_t DS1307_ReadDateTime_Bin(DS1307_DateTime_t* dataRead);
+DS1307_Status_t DS1307_ReadDateTime_Bin(DS1307_Handle_t *dev, DS1307_DateTime_t* dataRead);
 
 /**
  * @brief Reads the current date and time from the DS1307 RTC in BCD format.
  * 
  * This function reads the date and time from the DS1307 real-time clock (RTC) in 
  * Binary-Coded Decimal (BCD) format and stores the values in the provided 
- * DS1307_DateTime_t structure. The function first reads the date and then reads the time.
+ * DS1307_DateTime_t structure. Registers 0x00-0x06 are fetched in a single I2C burst,
+ * so the date and the time are sampled at the same instant.
+ * The CH bit and the 12/24-hour control bits are masked off, and the hour is always
+ * returned in 24-hour format whatever mode the RTC runs in.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
  * @param[out] dataRead Pointer to a DS1307_DateTime_t structure where the read date and 
  *                      time values will be stored. The structure's fields are updated 
  *                      with the current date and time read from the RTC in BCD format.
  * @return DS1307_Status_t Status of the read operation. Returns DS1307_OK on success, 
- *         or an error code if the operation fails. If an error occurs during either 
- *         date or time read, the function returns the status of the last operation.
+ *         or an error code if the burst read fails.
+ */
+DS1307_Status_t DS1307_ReadDateTime_BCD(DS1307_Handle_t *dev, DS1307_DateTime_t* dataRead);
+
+/**
+ * @brief Starts a non-blocking read of consecutive DS1307 registers.
+ * The transfer runs in the background; @p callback is invoked from interrupt context once
+ * @p dataRead holds the register contents.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd The address of the register to read from.
+ * @param[out] dataRead Pointer to the buffer receiving the data. Must stay valid until the
+ *                      callback has run.
+ * @param[in] readLen The number of bytes to read.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, DS1307_BUSY if a
+ *         transfer is already in flight on the device or bus, DS1307_DATA_SIZE_ERROR for
+ *         an invalid length, or DS1307_ERROR if the transport has no asynchronous mode.
+ */
+DS1307_Status_t DS1307_ReadReg_IT(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t *dataRead, uint8_t readLen, DS1307_Callback_t callback, void *userData);
+
+/**
+ * @brief Starts a non-blocking write of consecutive DS1307 registers.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd The address of the register to write to.
+ * @param[in] dataWrite Pointer to the data to write. Must stay valid until the callback
+ *                      has run.
+ * @param[in] writeLen The number of bytes to write.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_WriteReg_IT(DS1307_Handle_t *dev, uint8_t regAdd, const uint8_t *dataWrite, uint8_t writeLen, DS1307_Callback_t callback, void *userData);
+
+/**
+ * @brief Starts a non-blocking read of the current time in binary format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadTime_Bin() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the time. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_ReadTime_Bin_IT(DS1307_Handle_t *dev, DS1307_Time_t* dataRead, DS1307_Callback_t callback, void *userData);
+
+/**
+ * @brief Starts a non-blocking read of the current time in BCD format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadTime_BCD() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the time. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_ReadTime_BCD_IT(DS1307_Handle_t *dev, DS1307_Time_t* dataRead, DS1307_Callback_t callback, void *userData);
+
+/**
+ * @brief Starts a non-blocking read of the current date in binary format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadDate_Bin() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the date. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_ReadDate_Bin_IT(DS1307_Handle_t *dev, DS1307_Date_t* dataRead, DS1307_Callback_t callback, void *userData);
+
+/**
+ * @brief Starts a non-blocking read of the current date in BCD format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadDate_BCD() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the date. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_ReadDate_BCD_IT(DS1307_Handle_t *dev, DS1307_Date_t* dataRead, DS1307_Callback_t callback, void *userData);
+
+/**
+ * @brief Starts a non-blocking read of the current date and time in binary format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadDateTime_Bin() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the date and time. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_ReadDateTime_Bin_IT(DS1307_Handle_t *dev, DS1307_DateTime_t* dataRead, DS1307_Callback_t callback, void *userData);
+
+/**
+ * @brief Starts a non-blocking read of the current date and time in BCD format.
+ * The result is stored in @p dataRead exactly as DS1307_ReadDateTime_BCD() would, then @p callback is
+ * invoked from interrupt context.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer to the structure receiving the date and time. Must stay valid until
+ *                      the callback has run.
+ * @param[in] callback Completion callback.
+ * @param[in] userData User pointer passed to the callback.
+ * @return DS1307_Status_t Returns DS1307_OK if the transfer was started, or an error code
+ *         as for DS1307_ReadReg_IT().
+ */
+DS1307_Status_t DS1307_ReadDateTime_BCD_IT(DS1307_Handle_t *dev, DS1307_DateTime_t* dataRead, DS1307_Callback_t callback, void *userData);
+
+/**
+ * @brief Reports the end of an asynchronous transfer to the driver.
+ * Called by transport backends (typically from the I2C transfer-complete or error
+ * interrupt) for the device passed to ReadRegsAsync / WriteRegsAsync. Decodes the
+ * result if needed, releases the device and invokes the user callback.
+ * @param[in,out] dev Pointer to the DS1307 device handle that started the transfer.
+ * @param[in] status DS1307_OK if the transfer completed, or an error code.
+ */
+void DS1307_AsyncComplete(DS1307_Handle_t *dev, DS1307_Status_t status);
+
+/**
+ * @brief Starts sampling the timekeeping registers on every 1 Hz SQW edge.
+ * Programs the SQW/OUT pin for a 1 Hz square wave (_1Hz) and arms the sampler. From then
+ * on each call to DS1307_Sampler_OnEdge() starts an asynchronous burst read of registers
+ * 0x00-0x06 straight into the next free ring slot; the transfer-complete interrupt only
+ * publishes the slot. With DS1307_Transport_HAL_DMA the register bytes are moved by DMA,
+ * so the CPU is not involved until a consumer drains the ring.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] slots Ring storage for the snapshots. Must stay valid until
+ *                   DS1307_Sampler_Stop(). With DMA, it must be DMA-accessible memory.
+ * @param[in] size Number of slots (at least 2; one slot is always kept free).
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_DATA_SIZE_ERROR if size is
+ *         below 2, DS1307_ERROR if the transport has no asynchronous mode, or the status
+ *         of the control register write.
+ */
+DS1307_Status_t DS1307_Sampler_Start(DS1307_Handle_t *dev, DS1307_Snapshot_t *slots, uint16_t size);
+
+/**
+ * @brief Reports a SQW edge to the sampler.
+ * Call from the EXTI interrupt of the pin wired to SQW/OUT. Starts the snapshot read if
+ * the ring has room and the device is idle, otherwise counts an overrun.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_Sampler_OnEdge(DS1307_Handle_t *dev);
+
+/**
+ * @brief Takes the oldest snapshot out of the ring.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] snapshot Pointer receiving the raw registers.
+ * @return uint8_t 1 if a snapshot was returned, 0 if the ring is empty.
+ */
+uint8_t DS1307_Sampler_Pop(DS1307_Handle_t *dev, DS1307_Snapshot_t *snapshot);
+
+/**
+ * @brief Stops the sampler. Edges are ignored afterwards; a read already in flight
+ *        still completes into the ring.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_Sampler_Stop(DS1307_Handle_t *dev);
+
+/**
+ * @brief Decodes a raw timekeeping snapshot (registers 0x00-0x06) to binary values.
+ * The seven bytes are loaded into one 64-bit word. The CH, 12/24-hour and AM/PM bits are
+ * masked and every field is converted from BCD with a single SWAR step,
+ * value - 6 * (value >> 4), applied to all bytes at once. Only a 12-hour hour needs a
+ * fix-up afterwards, done without branches. The result matches DS1307_ReadDateTime_Bin():
+ * the hour is always reported in 24-hour format. No bus access is made, so the function
+ * can be used on snapshots returned by DS1307_Sampler_Pop() or on register dumps
+ * collected elsewhere.
+ * @param[in] raw Pointer to the 7 bytes read from registers 0x00-0x06 (seconds to year).
+ * @param[out] dataRead Pointer to the DS1307_DateTime_t structure to fill.
+ */
+void DS1307_DecodeSnapshot(const uint8_t *raw, DS1307_DateTime_t *dataRead);
+
+/**
+ * @brief Converts a binary date and time to Unix time.
+ * Uses a days-from-civil computation on a year that starts on 1 March, which puts the
+ * leap day at the end of the year and needs no month table and no loop. Valid for years
+ * 2000-2099 (Year 0-99), where every year divisible by 4 is a leap year. The Day field is
+ * ignored and the fields are not range-checked.
+ * @param[in] dateTime Pointer to the binary date and time (24-hour format).
+ * @return uint32_t Seconds since 1970-01-01 00:00:00.
+ */
+uint32_t DS1307_DateTime_to_Epoch(const DS1307_DateTime_t* dateTime);
+
+/**
+ * @brief Converts Unix time to a binary date and time.
+ * Inverse of DS1307_DateTime_to_Epoch(). The day of week is computed as well, with
+ * 1 = Sunday through 7 = Saturday.
+ * @param[in] epoch Seconds since 1970-01-01 00:00:00, DS1307_EPOCH_MIN to DS1307_EPOCH_MAX.
+ * @param[out] dateTime Pointer to the DS1307_DateTime_t structure to fill (24-hour format).
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_INVALID_PARAM if epoch lies outside
+ *         the years 2000-2099.
+ */
+DS1307_Status_t DS1307_Epoch_to_DateTime(uint32_t epoch, DS1307_DateTime_t* dateTime);
+
+/**
+ * @brief Reads the current date and time from the DS1307 RTC as Unix time.
+ * Registers 0x00-0x06 are fetched in a single burst, as in DS1307_ReadDateTime_Bin().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] epoch Pointer to the seconds since 1970-01-01 00:00:00.
+ * @return DS1307_Status_t Status of the burst read operation.
+ */
+DS1307_Status_t DS1307_ReadEpoch(DS1307_Handle_t *dev, uint32_t *epoch);
+
+/**
+ * @brief Sets the DS1307 RTC from Unix time.
+ * The date, time and day of week are written with DS1307_WriteDateTime(), in a single
+ * burst. The clock is left running (CH cleared) in 24-hour mode.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] epoch Seconds since 1970-01-01 00:00:00, DS1307_EPOCH_MIN to DS1307_EPOCH_MAX.
+ * @return DS1307_Status_t Status of the burst write operation, or DS1307_INVALID_PARAM if
+ *         epoch lies outside the years 2000-2099.
+ */
+DS1307_Status_t DS1307_WriteEpoch(DS1307_Handle_t *dev, uint32_t epoch);
+
+/**
+ * @brief Starts the SQW-driven software clock.
+ * Programs the SQW/OUT pin for a 1 Hz square wave (_1Hz), reads the date and time once
+ * from the RTC and from then on keeps them in RAM. DS1307_SoftClock_Tick() must be called
+ * on every SQW edge at which the seconds register increments (the falling edge of the
+ * 1 Hz output); DS1307_SoftClock_Get() then returns the time without any bus access.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] resyncInterval Number of seconds after which the clock is re-read from the
+ *                           RTC by DS1307_SoftClock_Service(), 0 to never resynchronise.
+ * @return DS1307_Status_t Returns DS1307_OK on success, or the status of the failed
+ *         control register write or time read.
+ */
+DS1307_Status_t DS1307_SoftClock_Start(DS1307_Handle_t *dev, uint32_t resyncInterval);
+
+/**
+ * @brief Advances the software clock by one second.
+ * Call from the EXTI interrupt of the pin wired to SQW/OUT. Handles minute, hour, day,
+ * month, year and leap-year rollovers (years 2000-2099) and flags a resynchronisation
+ * once the configured interval has elapsed.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_SoftClock_Tick(DS1307_Handle_t *dev);
+
+/**
+ * @brief Returns the current date and time of the software clock.
+ * Reads only RAM; safe to call at any rate and concurrently with DS1307_SoftClock_Tick().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] dataRead Pointer receiving the date and time (binary, 24-hour format).
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_ERROR if the software clock is
+ *         not running.
+ */
+DS1307_Status_t DS1307_SoftClock_Get(DS1307_Handle_t *dev, DS1307_DateTime_t *dataRead);
+
+/**
+ * @brief Performs a pending hardware resynchronisation of the software clock.
+ * Call periodically from task context (not from an interrupt). Does nothing unless the
+ * resynchronisation interval has elapsed; otherwise re-reads the RTC in one burst and
+ * replaces the RAM copy.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @return DS1307_Status_t Returns DS1307_OK if nothing was due or the resynchronisation
+ *         succeeded, or the status of the failed read (the RAM copy is kept and the
+ *         resynchronisation is retried on the next call).
+ */
+DS1307_Status_t DS1307_SoftClock_Service(DS1307_Handle_t *dev);
+
+/**
+ * @brief Stops the software clock. SQW edges are ignored afterwards.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_SoftClock_Stop(DS1307_Handle_t *dev);
+
+/**
+ * @brief Anchors the sub-second timestamp interpolator on an RTC seconds change.
+ * Polls the timekeeping registers until the seconds value changes and records the tick
+ * counter at that instant. The change is bracketed between the previous and the current
+ * read; the anchor is placed at the midpoint of the two reads, so the alignment error is
+ * bounded by half the duration of one burst read. Call once at start-up, and again
+ * whenever drift between the tick source and the RTC should be removed if no SQW edges
+ * are delivered to DS1307_SubSec_OnEdge().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] src Tick source used for interpolation; copied into the handle.
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_TIMEOUT_ERR if no seconds
+ *         change was seen within 1.5 s (oscillator halted), or the status of a failed read.
+ */
+DS1307_Status_t DS1307_SubSec_Align(DS1307_Handle_t *dev, const DS1307_TickSource_t *src);
+
+/**
+ * @brief Re-anchors the interpolator on an SQW second edge.
+ * Call from the EXTI interrupt of the pin wired to SQW/OUT (1 Hz, falling edge) after
+ * DS1307_SubSec_Align(). Missed edges are accounted for by rounding the elapsed ticks to
+ * whole seconds.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_SubSec_OnEdge(DS1307_Handle_t *dev);
+
+/**
+ * @brief Returns the current Unix time in microseconds.
+ * Computed from the anchor and the tick source only; no bus access. Once SQW edges
+ * re-anchor the interpolator, the fraction is held at 999999 us until the next edge, so
+ * timestamps never step backwards when a slow edge arrives. The tick difference is only
+ * valid within one counter wrap (2^32 / hz ticks): an anchor older than half a wrap, or
+ * two seconds once edges are expected, is reported with DS1307_ERROR until
+ * DS1307_SubSec_OnEdge() or DS1307_SubSec_Align() replaces it. The query never modifies
+ * the anchor, so without edges run DS1307_SubSec_Align() again within half a wrap.
+ * @param[in] dev Pointer to the DS1307 device handle.
+ * @param[out] epochUs Pointer receiving microseconds since 1970-01-01 00:00:00.
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_ERROR if no valid anchor is
+ *         available.
+ */
+DS1307_Status_t DS1307_SubSec_GetUs(DS1307_Handle_t *dev, uint64_t *epochUs);
+
+/**
+ * @brief Returns the current Unix time in milliseconds.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] epochMs Pointer receiving milliseconds since 1970-01-01 00:00:00.
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_ERROR if no anchor is available.
+ */
+DS1307_Status_t DS1307_SubSec_GetMs(DS1307_Handle_t *dev, uint64_t *epochMs);
+
+/**
+ * @brief Loads registers into the shadow register file.
+ * Reads the range in one burst. Registers modified locally and not yet flushed keep their
+ * local value.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Address of the first register to load.
+ * @param[in] len Number of registers to load.
+ * @return DS1307_Status_t Status of the burst read.
+ */
+DS1307_Status_t DS1307_Shadow_Load(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t len);
+
+/**
+ * @brief Returns the value of a register, from the shadow when possible.
+ * Control and RAM registers (0x07-0x3F) are served from the shadow without bus traffic
+ * once known; timekeeping registers are always read from the device.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Register address, 0x00-0x3F.
+ * @param[out] value Pointer receiving the register value.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR for an address beyond
+ *         0x3F, or the status of the read.
+ */
+DS1307_Status_t DS1307_Shadow_Get(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t *value);
+
+/**
+ * @brief Changes bits of a control or RAM register in the shadow.
+ * The register is loaded first if its value is unknown. The change reaches the device with
+ * the next DS1307_Shadow_Flush(); setting bits to their current value marks nothing dirty.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Register address, 0x07-0x3F.
+ * @param[in] mask Bits to change.
+ * @param[in] bits New value of the bits selected by mask.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_INVALID_PARAM for a timekeeping or
+ *         out-of-range register, or the status of the load.
+ */
+DS1307_Status_t DS1307_Shadow_Modify(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t mask, uint8_t bits);
+
+/**
+ * @brief Sets a control or RAM register in the shadow.
+ * Equivalent to DS1307_Shadow_Modify() with a mask of 0xFF, without loading the register.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] regAdd Register address, 0x07-0x3F.
+ * @param[in] value New register value.
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_INVALID_PARAM for a timekeeping or
+ *         out-of-range register.
+ */
+DS1307_Status_t DS1307_Shadow_Set(DS1307_Handle_t *dev, uint8_t regAdd, uint8_t value);
+
+/**
+ * @brief Writes the dirty registers of the shadow to the device.
+ * Consecutive dirty registers are written as one burst. Runs separated by at most
+ * DS1307_SHADOW_MAX_GAP known registers are merged, rewriting the unchanged registers in
+ * between, since that is cheaper than starting another transaction.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the first failed burst; runs
+ *         not written stay dirty.
+ */
+DS1307_Status_t DS1307_Shadow_Flush(DS1307_Handle_t *dev);
+
+/**
+ * @brief Forgets the shadow contents, including unflushed changes.
+ * Use when another bus master may have changed the registers.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ */
+void DS1307_Shadow_Invalidate(DS1307_Handle_t *dev);
+
+/**
+ * @brief Selects the SQW/OUT configuration (OUT, SQWE, RS1 and RS0 bits) in the shadow.
+ * Takes effect with the next DS1307_Shadow_Flush().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] sqwOut Square wave output configuration, see DS1307_SQWO_t.
+ * @return DS1307_Status_t Status of DS1307_Shadow_Modify().
+ */
+DS1307_Status_t DS1307_SetSQW(DS1307_Handle_t *dev, DS1307_SQWO_t sqwOut);
+
+/**
+ * @brief Sets the level of SQW/OUT while the square wave is disabled (OUT bit) in the shadow.
+ * Takes effect with the next DS1307_Shadow_Flush().
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] level Non-zero for a high output.
+ * @return DS1307_Status_t Status of DS1307_Shadow_Modify().
+ */
+DS1307_Status_t DS1307_SetOUT(DS1307_Handle_t *dev, uint8_t level);
+
+/**
+ * @brief Starts or stops the oscillator (CH bit).
+ * The seconds register is volatile and not shadowed, so this is an immediate
+ * read-modify-write; the write is skipped when CH already has the requested value.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] halt Non-zero to stop the oscillator, zero to start it.
+ * @return DS1307_Status_t Status of the register access.
+ */
+DS1307_Status_t DS1307_SetClockHalt(DS1307_Handle_t *dev, uint8_t halt);
+
+/**
+ * @brief Reads from the battery-backed RAM.
+ * Served from the shadow register file when every byte is known; otherwise read straight
+ * into buf in bursts of at most DS1307_NVRAM_MAX_BURST bytes. Transfers never reach past
+ * register 0x3F, so the register pointer cannot wrap into the clock registers.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] offset Offset in the RAM, 0-55 (register 0x08 + offset).
+ * @param[out] buf Buffer receiving len bytes.
+ * @param[in] len Number of bytes to read.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR if the range is empty
+ *         or exceeds the 56 bytes of RAM, or the status of the failed burst.
+ */
+DS1307_Status_t DS1307_NvramRead(DS1307_Handle_t *dev, uint8_t offset, uint8_t *buf, uint8_t len);
+
+/**
+ * @brief Writes to the battery-backed RAM.
+ * Bytes the shadow register file already knows to hold the same value are trimmed from
+ * both ends of the range; the rest is written from buf in bursts of at most
+ * DS1307_NVRAM_MAX_BURST bytes. Transfers never reach past register 0x3F.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in] offset Offset in the RAM, 0-55 (register 0x08 + offset).
+ * @param[in] buf Buffer holding len bytes.
+ * @param[in] len Number of bytes to write.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR if the range is empty
+ *         or exceeds the 56 bytes of RAM, or the status of the failed burst.
  */
-DS1307_Status_t DS1307_ReadDateTime_BCD(DS1307_DateTime_t* dataRead);
+DS1307_Status_t DS1307_NvramWrite(DS1307_Handle_t *dev, uint8_t offset, const uint8_t *buf, uint8_t len);
 
 #endif /* _INC_DS1307_H_ */
\ No newline at end of file
@@ -0,0 +1,478 @@
+/**
+ * @file ds1307_batch.c
+ * @brief Batch decoder for raw DS1307 timekeeping snapshots.
+ * This file implements the scalar reference kernel and the SSE2 and AVX2 kernels of the
+ * batch API, and selects one of them at runtime.
+ */
+
+/* Include Files */
+#include "ds1307_batch.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DS1307_BATCH_X86
+#include <immintrin.h>
+#define DS1307_BATCH_TARGET(isa)                 __attribute__((target(isa)))
+#endif
+
+/* One 64-bit lane holding a value for each register 0x00-0x06, register 0x00 in the low byte */
+#define DS1307_BATCH_LANE(sec, min, hrs, day, date, month, year) \
+    ((long long)(((uint64_t)(year) << 48) | ((uint64_t)(month) << 40) | ((uint64_t)(date) << 32) | \
+                 ((uint64_t)(day) << 24) | ((uint64_t)(hrs) << 16) | ((uint64_t)(min) << 8) | (uint64_t)(sec)))
+
+#define DS1307_BATCH_EPOCH_2000                  10957u /**< Days from 1970-01-01 to 2000-01-01. */
+
+/**
+ * @brief Signature shared by the decoding kernels.
+ */
+typedef size_t (*DS1307_Batch_Run_t)(const DS1307_Snapshot_t *snapshots, size_t count,
+                                     const DS1307_Batch_Fields_t *out, uint8_t *valid);
+
+static DS1307_Batch_Run_t DS1307_Batch_Run = NULL; /**< Kernel in use, NULL until first selected. */
+
+/**
+ * @brief Writes the decoded fields of one snapshot to the outputs, or zeros if invalid.
+ * Shared by every kernel so that all of them produce identical outputs.
+ * @param[in] out Output arrays.
+ * @param[out] valid Optional validity flags.
+ * @param[in] index Index of the snapshot.
+ * @param[in] field Binary fields indexed by D_DS1307_REG_SEC..D_DS1307_REG_YEAR.
+ * @param[in] epoch Epoch seconds of the snapshot.
+ * @param[in] ok Non-zero if the snapshot is valid.
+ */
+static void DS1307_Batch_Store(const DS1307_Batch_Fields_t *out, uint8_t *valid, size_t index,
+                               const uint8_t *field, uint32_t epoch, uint8_t ok)
+{
+    uint8_t keep = ok ? 0xFF : 0x00; /**< Mask applied to every output. */
+
+    if (out->epoch != NULL) out->epoch[index] = ok ? epoch : 0;
+    if (out->sec != NULL)   out->sec[index] = field[D_DS1307_REG_SEC] & keep;
+    if (out->min != NULL)   out->min[index] = field[D_DS1307_REG_MIN] & keep;
+    if (out->hour != NULL)  out->hour[index] = field[D_DS1307_REG_HRS] & keep;
+    if (out->day != NULL)   out->day[index] = field[D_DS1307_REG_DAY] & keep;
+    if (out->date != NULL)  out->date[index] = field[D_DS1307_REG_DATE] & keep;
+    if (out->month != NULL) out->month[index] = field[D_DS1307_REG_MONTH] & keep;
+    if (out->year != NULL)  out->year[index] = field[D_DS1307_REG_YEAR] & keep;
+    if (valid != NULL)      valid[index] = ok ? 1 : 0;
+}
+
+/**
+ * @brief Decodes and validates one snapshot. Reference for the vector kernels.
+ * @param[in] raw Pointer to the 7 raw register bytes.
+ * @param[out] field Binary fields, hour in 24-hour format.
+ * @param[out] epoch Epoch seconds of the snapshot.
+ * @return uint8_t 1 if the snapshot is valid, 0 otherwise.
+ */
+static uint8_t DS1307_Batch_DecodeOne(const uint8_t *raw, uint8_t *field, uint32_t *epoch)
+{
+    static const uint8_t lo[7] = {0, 0, 0, 1, 1, 1, 0};             /**< Lowest valid value per register. */
+    static const uint8_t hi[7] = {59, 59, 23, 7, 31, 12, 99};       /**< Highest valid value per register. */
+    static const uint8_t mask[7] = {0x7F, 0x7F, 0x3F, 0x07, 0x3F, 0x1F, 0xFF}; /**< Value bits per register. */
+    uint8_t mode12 = (raw[D_DS1307_REG_HRS] >> D_DS1307_BIT_HRS) & 1; /**< 12-hour mode flag. */
+    uint8_t ok = 1;        /**< Validity of the snapshot. */
+    uint8_t bcd;           /**< Masked BCD value. */
+    uint8_t i;             /**< Loop index. */
+    uint32_t leap;         /**< 1 in a leap year. */
+    uint32_t month;        /**< Month, 1-12. */
+    uint32_t year;         /**< Years since 2000. */
+    uint32_t days;         /**< Days since 1970-01-01. */
+
+    for (i = 0; i < 7; i++)
+    {
+        bcd = raw[i] & mask[i];
+        if ((i == D_DS1307_REG_HRS) && mode12)
+        {
+            bcd &= (uint8_t)~(1 << D_DS1307_BIT_AMPM);
+        }
+        if (((bcd & 0x0F) > 9) || ((bcd >> 4) > 9))
+        {
+            ok = 0;
+        }
+        field[i] = (uint8_t)(bcd - 6 * (bcd >> 4));
+        if ((i == D_DS1307_REG_HRS) && mode12)
+        {
+            if ((field[i] < 1) || (field[i] > 12))
+            {
+                ok = 0;
+            }
+        }
+        else if ((field[i] < lo[i]) || (field[i] > hi[i]))
+        {
+            ok = 0;
+        }
+    }
+
+    if (mode12)
+    {
+        /* 12 AM is 00, 12 PM is 12, PM adds 12 */
+        if (field[D_DS1307_REG_HRS] == 12)
+        {
+            field[D_DS1307_REG_HRS] = 0;
+        }
+        if (raw[D_DS1307_REG_HRS] & (1 << D_DS1307_BIT_AMPM))
+        {
+            field[D_DS1307_REG_HRS] += 12;
+        }
+    }
+
+    month = field[D_DS1307_REG_MONTH];
+    year = field[D_DS1307_REG_YEAR];
+    leap = ((year & 3u) == 0) ? 1u : 0u;
+
+    /* Days in month: 30 + ((m + m / 8) & 1), February 28 + leap */
+    if (field[D_DS1307_REG_DATE] > ((month == 2u) ? (28u + leap) : (30u + ((month + (month >> 3)) & 1u))))
+    {
+        ok = 0;
+    }
+
+    /* Days before month: 30 * (m - 1) + (m + m / 8) / 2, less 2 - leap after February */
+    days = DS1307_BATCH_EPOCH_2000 + (365u * year) + ((year + 3u) >> 2) + (30u * (month - 1u)) +
+           ((month + (month >> 3)) >> 1) + field[D_DS1307_REG_DATE] - 1u;
+    if (month > 2u)
+    {
+        days -= 2u - leap;
+    }
+
+    *epoch = (((days * 24u) + field[D_DS1307_REG_HRS]) * 60u + field[D_DS1307_REG_MIN]) * 60u + field[D_DS1307_REG_SEC];
+
+    return ok;
+}
+
+/**
+ * @brief Decodes snapshots first..count-1 one at a time.
+ * Used as the scalar kernel and for the tail left over by the vector kernels.
+ * @param[in] snapshots Array of raw snapshots.
+ * @param[in] first Index of the first snapshot to decode.
+ * @param[in] count Number of snapshots in the array.
+ * @param[in] out Output arrays.
+ * @param[out] valid Optional validity flags.
+ * @return size_t Number of valid snapshots in the range.
+ */
+static size_t DS1307_Batch_Range(const DS1307_Snapshot_t *snapshots, size_t first, size_t count,
+                                 const DS1307_Batch_Fields_t *out, uint8_t *valid)
+{
+    uint8_t field[7];      /**< Decoded fields of one snapshot. */
+    uint32_t epoch;        /**< Epoch seconds of one snapshot. */
+    uint8_t ok;            /**< Validity of one snapshot. */
+    size_t good = 0;       /**< Number of valid snapshots. */
+    size_t i;              /**< Loop index. */
+
+    for (i = first; i < count; i++)
+    {
+        ok = DS1307_Batch_DecodeOne(snapshots[i].reg, field, &epoch);
+        DS1307_Batch_Store(out, valid, i, field, epoch, ok);
+        good += ok;
+    }
+
+    return good;
+}
+
+/**
+ * @brief Scalar kernel.
+ * @param[in] snapshots Array of raw snapshots.
+ * @param[in] count Number of snapshots.
+ * @param[in] out Output arrays.
+ * @param[out] valid Optional validity flags.
+ * @return size_t Number of valid snapshots.
+ */
+static size_t DS1307_Batch_Scalar(const DS1307_Snapshot_t *snapshots, size_t count,
+                                  const DS1307_Batch_Fields_t *out, uint8_t *valid)
+{
+    return DS1307_Batch_Range(snapshots, 0, count, out, valid);
+}
+
+#ifdef DS1307_BATCH_X86
+
+/**
+ * @brief SSE2 kernel, two snapshots per vector.
+ * Each snapshot is loaded as 8 bytes into its own 64-bit lane; the extra byte belongs to
+ * the next snapshot and is masked off, so the last snapshot is left to the scalar path
+ * to avoid reading past the array. The byte steps mirror DS1307_Batch_DecodeOne(); the
+ * date arithmetic is done in 64-bit lanes with _mm_mul_epu32.
+ * @param[in] snapshots Array of raw snapshots.
+ * @param[in] count Number of snapshots.
+ * @param[in] out Output arrays.
+ * @param[out] valid Optional validity flags.
+ * @return size_t Number of valid snapshots.
+ */
+DS1307_BATCH_TARGET("sse2")
+static size_t DS1307_Batch_SSE2(const DS1307_Snapshot_t *snapshots, size_t count,
+                                const DS1307_Batch_Fields_t *out, uint8_t *valid)
+{
+    const uint8_t *base = snapshots[0].reg; /**< Start of the packed snapshots. */
+    const __m128i mask24 = _mm_set1_epi64x(DS1307_BATCH_LANE(0x7F, 0x7F, 0x3F, 0x07, 0x3F, 0x1F, 0xFF));
+    const __m128i lo24 = _mm_set1_epi64x(DS1307_BATCH_LANE(0, 0, 0, 1, 1, 1, 0));
+    const __m128i lo12 = _mm_set1_epi64x(DS1307_BATCH_LANE(0, 0, 1, 1, 1, 1, 0));
+    const __m128i hi24 = _mm_set1_epi64x(DS1307_BATCH_LANE(59, 59, 23, 7, 31, 12, 99));
+    const __m128i hi12 = _mm_set1_epi64x(DS1307_BATCH_LANE(59, 59, 12, 7, 31, 12, 99));
+    const __m128i hrsSel = _mm_set1_epi64x(DS1307_BATCH_LANE(0, 0, 0xFF, 0, 0, 0, 0));
+    const __m128i bit12 = _mm_set1_epi64x(DS1307_BATCH_LANE(0, 0, 1 << D_DS1307_BIT_HRS, 0, 0, 0, 0));
+    const __m128i bitPM = _mm_set1_epi64x(DS1307_BATCH_LANE(0, 0, 1 << D_DS1307_BIT_AMPM, 0, 0, 0, 0));
+    const __m128i twelve = _mm_set1_epi64x(DS1307_BATCH_LANE(0, 0, 12, 0, 0, 0, 0));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low8 = _mm_set1_epi64x(0xFF);
+    const __m128i one = _mm_set1_epi64x(1);
+    const __m128i two = _mm_set1_epi64x(2);
+    const __m128i three = _mm_set1_epi64x(3);
+    __m128i x, m12, pm, bcd, tens, six, v, bad, range, lo, hi;
+    __m128i sec, min, hrs, date, month, year, leap, mm8, dim, adj, days, epoch;
+    uint8_t field[16];     /**< Decoded fields of the two lanes. */
+    uint64_t lane[2];      /**< Epoch seconds of the two lanes. */
+    int badMask;           /**< One bit per byte, set for a failed check. */
+    size_t good = 0;       /**< Number of valid snapshots. */
+    size_t i = 0;          /**< Index of the first snapshot of the vector. */
+    uint8_t k;             /**< Lane index. */
+    uint8_t ok;            /**< Validity of one lane. */
+
+    for (; i + 2 < count; i += 2)
+    {
+        x = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(base + 7 * i)),
+                               _mm_loadl_epi64((const __m128i *)(base + 7 * (i + 1))));
+
+        /* 12-hour lanes: drop AM/PM from the hour value, remember PM */
+        m12 = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(x, bit12), bit12), hrsSel);
+        pm = _mm_and_si128(_mm_and_si128(x, bitPM), m12);
+        bcd = _mm_and_si128(x, _mm_andnot_si128(_mm_and_si128(m12, bitPM), mask24));
+
+        /* BCD digits must be 0-9; binary = bcd - 6 * tens */
+        tens = _mm_and_si128(_mm_srli_epi16(bcd, 4), nibble);
+        bad = _mm_or_si128(_mm_cmpgt_epi8(_mm_and_si128(bcd, nibble), nine), _mm_cmpgt_epi8(tens, nine));
+        six = _mm_add_epi8(tens, tens);
+        six = _mm_add_epi8(six, _mm_add_epi8(six, six));
+        v = _mm_sub_epi8(bcd, six);
+
+        /* Per-field ranges, hour 1-12 in 12-hour lanes */
+        lo = _mm_or_si128(_mm_andnot_si128(m12, lo24), _mm_and_si128(m12, lo12));
+        hi = _mm_or_si128(_mm_andnot_si128(m12, hi24), _mm_and_si128(m12, hi12));
+        range = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, lo), v), _mm_cmpeq_epi8(_mm_min_epu8(v, hi), v));
+        bad = _mm_or_si128(bad, _mm_cmpeq_epi8(range, zero));
+
+        /* 12 AM is 00, 12 PM is 12, PM adds 12 */
+        v = _mm_andnot_si128(_mm_and_si128(_mm_cmpeq_epi8(v, twelve), m12), v);
+        v = _mm_add_epi8(v, _mm_and_si128(_mm_cmpeq_epi8(pm, bitPM), twelve));
+
+        sec = _mm_and_si128(v, low8);
+        min = _mm_and_si128(_mm_srli_epi64(v, 8 * D_DS1307_REG_MIN), low8);
+        hrs = _mm_and_si128(_mm_srli_epi64(v, 8 * D_DS1307_REG_HRS), low8);
+        date = _mm_and_si128(_mm_srli_epi64(v, 8 * D_DS1307_REG_DATE), low8);
+        month = _mm_and_si128(_mm_srli_epi64(v, 8 * D_DS1307_REG_MONTH), low8);
+        year = _mm_and_si128(_mm_srli_epi64(v, 8 * D_DS1307_REG_YEAR), low8);
+
+        /* The upper dword of every lane is zero, so 32-bit compares act on the lane */
+        leap = _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(year, three), zero), one);
+        mm8 = _mm_add_epi64(month, _mm_srli_epi64(month, 3));
+        dim = _mm_add_epi64(_mm_set1_epi64x(30), _mm_and_si128(mm8, one));
+        adj = _mm_cmpeq_epi32(month, two);
+        dim = _mm_or_si128(_mm_andnot_si128(adj, dim), _mm_and_si128(adj, _mm_add_epi64(_mm_set1_epi64x(28), leap)));
+        bad = _mm_or_si128(bad, _mm_cmpgt_epi32(date, dim));
+        adj = _mm_and_si128(_mm_cmpgt_epi32(month, two), _mm_sub_epi64(two, leap));
+
+        days = _mm_add_epi64(_mm_mul_epu32(year, _mm_set1_epi64x(365)), _mm_srli_epi64(_mm_add_epi64(year, three), 2));
+        days = _mm_add_epi64(days, _mm_mul_epu32(month, _mm_set1_epi64x(30)));
+        days = _mm_add_epi64(days, _mm_add_epi64(_mm_srli_epi64(mm8, 1), date));
+        days = _mm_sub_epi64(_mm_add_epi64(days, _mm_set1_epi64x(DS1307_BATCH_EPOCH_2000 - 30 - 1)), adj);
+
+        epoch = _mm_add_epi64(_mm_mul_epu32(days, _mm_set1_epi64x(24)), hrs);
+        epoch = _mm_add_epi64(_mm_mul_epu32(epoch, _mm_set1_epi64x(60)), min);
+        epoch = _mm_add_epi64(_mm_mul_epu32(epoch, _mm_set1_epi64x(60)), sec);
+
+        _mm_storeu_si128((__m128i *)field, v);
+        _mm_storeu_si128((__m128i *)lane, epoch);
+        badMask = _mm_movemask_epi8(bad);
+        for (k = 0; k < 2; k++)
+        {
+            ok = ((badMask >> (8 * k)) & 0x7F) == 0;
+            DS1307_Batch_Store(out, valid, i + k, &field[8 * k], (uint32_t)lane[k], ok);
+            good += ok;
+        }
+    }
+
+    return good + DS1307_Batch_Range(snapshots, i, count, out, valid);
+}
+
+/**
+ * @brief AVX2 kernel, four snapshots per vector.
+ * Same steps as DS1307_Batch_SSE2() on 256-bit vectors.
+ * @param[in] snapshots Array of raw snapshots.
+ * @param[in] count Number of snapshots.
+ * @param[in] out Output arrays.
+ * @param[out] valid Optional validity flags.
+ * @return size_t Number of valid snapshots.
+ */
+DS1307_BATCH_TARGET("avx2")
+static size_t DS1307_Batch_AVX2(const DS1307_Snapshot_t *snapshots, size_t count,
+                                const DS1307_Batch_Fields_t *out, uint8_t *valid)
+{
+    const uint8_t *base = snapshots[0].reg; /**< Start of the packed snapshots. */
+    const __m256i mask24 = _mm256_set1_epi64x(DS1307_BATCH_LANE(0x7F, 0x7F, 0x3F, 0x07, 0x3F, 0x1F, 0xFF));
+    const __m256i lo24 = _mm256_set1_epi64x(DS1307_BATCH_LANE(0, 0, 0, 1, 1, 1, 0));
+    const __m256i lo12 = _mm256_set1_epi64x(DS1307_BATCH_LANE(0, 0, 1, 1, 1, 1, 0));
+    const __m256i hi24 = _mm256_set1_epi64x(DS1307_BATCH_LANE(59, 59, 23, 7, 31, 12, 99));
+    const __m256i hi12 = _mm256_set1_epi64x(DS1307_BATCH_LANE(59, 59, 12, 7, 31, 12, 99));
+    const __m256i hrsSel = _mm256_set1_epi64x(DS1307_BATCH_LANE(0, 0, 0xFF, 0, 0, 0, 0));
+    const __m256i bit12 = _mm256_set1_epi64x(DS1307_BATCH_LANE(0, 0, 1 << D_DS1307_BIT_HRS, 0, 0, 0, 0));
+    const __m256i bitPM = _mm256_set1_epi64x(DS1307_BATCH_LANE(0, 0, 1 << D_DS1307_BIT_AMPM, 0, 0, 0, 0));
+    const __m256i twelve = _mm256_set1_epi64x(DS1307_BATCH_LANE(0, 0, 12, 0, 0, 0, 0));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i low8 = _mm256_set1_epi64x(0xFF);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i two = _mm256_set1_epi64x(2);
+    const __m256i three = _mm256_set1_epi64x(3);
+    __m128i lower, upper;
+    __m256i x, m12, pm, bcd, tens, six, v, bad, range, lo, hi;
+    __m256i sec, min, hrs, date, month, year, leap, mm8, dim, adj, days, epoch;
+    uint8_t field[32];     /**< Decoded fields of the four lanes. */
+    uint64_t lane[4];      /**< Epoch seconds of the four lanes. */
+    uint32_t badMask;      /**< One bit per byte, set for a failed check. */
+    size_t good = 0;       /**< Number of valid snapshots. */
+    size_t i = 0;          /**< Index of the first snapshot of the vector. */
+    uint8_t k;             /**< Lane index. */
+    uint8_t ok;            /**< Validity of one lane. */
+
+    for (; i + 4 < count; i += 4)
+    {
+        lower = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(base + 7 * i)),
+                                   _mm_loadl_epi64((const __m128i *)(base + 7 * (i + 1))));
+        upper = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(base + 7 * (i + 2))),
+                                   _mm_loadl_epi64((const __m128i *)(base + 7 * (i + 3))));
+        x = _mm256_inserti128_si256(_mm256_castsi128_si256(lower), upper, 1);
+
+        /* 12-hour lanes: drop AM/PM from the hour value, remember PM */
+        m12 = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(x, bit12), bit12), hrsSel);
+        pm = _mm256_and_si256(_mm256_and_si256(x, bitPM), m12);
+        bcd = _mm256_and_si256(x, _mm256_andnot_si256(_mm256_and_si256(m12, bitPM), mask24));
+
+        /* BCD digits must be 0-9; binary = bcd - 6 * tens */
+        tens = _mm256_and_si256(_mm256_srli_epi16(bcd, 4), nibble);
+        bad = _mm256_or_si256(_mm256_cmpgt_epi8(_mm256_and_si256(bcd, nibble), nine), _mm256_cmpgt_epi8(tens, nine));
+        six = _mm256_add_epi8(tens, tens);
+        six = _mm256_add_epi8(six, _mm256_add_epi8(six, six));
+        v = _mm256_sub_epi8(bcd, six);
+
+        /* Per-field ranges, hour 1-12 in 12-hour lanes */
+        lo = _mm256_or_si256(_mm256_andnot_si256(m12, lo24), _mm256_and_si256(m12, lo12));
+        hi = _mm256_or_si256(_mm256_andnot_si256(m12, hi24), _mm256_and_si256(m12, hi12));
+        range = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(v, lo), v), _mm256_cmpeq_epi8(_mm256_min_epu8(v, hi), v));
+        bad = _mm256_or_si256(bad, _mm256_cmpeq_epi8(range, zero));
+
+        /* 12 AM is 00, 12 PM is 12, PM adds 12 */
+        v = _mm256_andnot_si256(_mm256_and_si256(_mm256_cmpeq_epi8(v, twelve), m12), v);
+        v = _mm256_add_epi8(v, _mm256_and_si256(_mm256_cmpeq_epi8(pm, bitPM), twelve));
+
+        sec = _mm256_and_si256(v, low8);
+        min = _mm256_and_si256(_mm256_srli_epi64(v, 8 * D_DS1307_REG_MIN), low8);
+        hrs = _mm256_and_si256(_mm256_srli_epi64(v, 8 * D_DS1307_REG_HRS), low8);
+        date = _mm256_and_si256(_mm256_srli_epi64(v, 8 * D_DS1307_REG_DATE), low8);
+        month = _mm256_and_si256(_mm256_srli_epi64(v, 8 * D_DS1307_REG_MONTH), low8);
+        year = _mm256_and_si256(_mm256_srli_epi64(v, 8 * D_DS1307_REG_YEAR), low8);
+
+        /* The upper dword of every lane is zero, so 32-bit compares act on the lane */
+        leap = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_and_si256(year, three), zero), one);
+        mm8 = _mm256_add_epi64(month, _mm256_srli_epi64(month, 3));
+        dim = _mm256_add_epi64(_mm256_set1_epi64x(30), _mm256_and_si256(mm8, one));
+        adj = _mm256_cmpeq_epi32(month, two);
+        dim = _mm256_or_si256(_mm256_andnot_si256(adj, dim), _mm256_and_si256(adj, _mm256_add_epi64(_mm256_set1_epi64x(28), leap)));
+        bad = _mm256_or_si256(bad, _mm256_cmpgt_epi32(date, dim));
+        adj = _mm256_and_si256(_mm256_cmpgt_epi32(month, two), _mm256_sub_epi64(two, leap));
+
+        days = _mm256_add_epi64(_mm256_mul_epu32(year, _mm256_set1_epi64x(365)), _mm256_srli_epi64(_mm256_add_epi64(year, three), 2));
+        days = _mm256_add_epi64(days, _mm256_mul_epu32(month, _mm256_set1_epi64x(30)));
+        days = _mm256_add_epi64(days, _mm256_add_epi64(_mm256_srli_epi64(mm8, 1), date));
+        days = _mm256_sub_epi64(_mm256_add_epi64(days, _mm256_set1_epi64x(DS1307_BATCH_EPOCH_2000 - 30 - 1)), adj);
+
+        epoch = _mm256_add_epi64(_mm256_mul_epu32(days, _mm256_set1_epi64x(24)), hrs);
+        epoch = _mm256_add_epi64(_mm256_mul_epu32(epoch, _mm256_set1_epi64x(60)), min);
+        epoch = _mm256_add_epi64(_mm256_mul_epu32(epoch, _mm256_set1_epi64x(60)), sec);
+
+        _mm256_storeu_si256((__m256i *)field, v);
+        _mm256_storeu_si256((__m256i *)lane, epoch);
+        badMask = (uint32_t)_mm256_movemask_epi8(bad);
+        for (k = 0; k < 4; k++)
+        {
+            ok = ((badMask >> (8 * k)) & 0x7F) == 0;
+            DS1307_Batch_Store(out, valid, i + k, &field[8 * k], (uint32_t)lane[k], ok);
+            good += ok;
+        }
+    }
+
+    return good + DS1307_Batch_Range(snapshots, i, count, out, valid);
+}
+
+#endif /* DS1307_BATCH_X86 */
+
+/**
+ * @brief Selects the kernel used by the batch functions.
+ * A kernel the CPU or the build does not support is downgraded to the widest one that is
+ * available. Selecting DS1307_BATCH_SCALAR is useful to cross-check the vector kernels.
+ * @param[in] kernel Requested kernel, DS1307_BATCH_AUTO for the default.
+ * @return DS1307_Batch_Kernel_t Kernel actually selected.
+ */
+DS1307_Batch_Kernel_t DS1307_Batch_SelectKernel(DS1307_Batch_Kernel_t kernel)
+{
+#ifdef DS1307_BATCH_X86
+    __builtin_cpu_init();
+
+    if ((kernel == DS1307_BATCH_AUTO) || (kernel == DS1307_BATCH_AVX2))
+    {
+        if (__builtin_cpu_supports("avx2"))
+        {
+            DS1307_Batch_Run = DS1307_Batch_AVX2;
+            return DS1307_BATCH_AVX2;
+        }
+        kernel = DS1307_BATCH_SSE2;
+    }
+    if ((kernel == DS1307_BATCH_SSE2) && __builtin_cpu_supports("sse2"))
+    {
+        DS1307_Batch_Run = DS1307_Batch_SSE2;
+        return DS1307_BATCH_SSE2;
+    }
+#else
+    (void)kernel;
+#endif
+
+    DS1307_Batch_Run = DS1307_Batch_Scalar;
+    return DS1307_BATCH_SCALAR;
+}
+
+/**
+ * @brief Decodes and validates an array of snapshots into structure-of-arrays outputs.
+ * @param[in] snapshots Array of raw snapshots.
+ * @param[in] count Number of snapshots.
+ * @param[out] out Output arrays; each non-NULL array must hold count elements.
+ * @param[out] valid Optional array of count flags, 1 for a valid snapshot and 0 otherwise.
+ * @return size_t Number of valid snapshots.
+ */
+size_t DS1307_Batch_ToFields(const DS1307_Snapshot_t *snapshots, size_t count, const DS1307_Batch_Fields_t *out, uint8_t *valid)
+{
+    if ((snapshots == NULL) || (out == NULL) || (count == 0))
+    {
+        return 0;
+    }
+
+    if (DS1307_Batch_Run == NULL)
+    {
+        DS1307_Batch_SelectKernel(DS1307_BATCH_AUTO);
+    }
+
+    return DS1307_Batch_Run(snapshots, count, out, valid);
+}
+
+/**
+ * @brief Decodes and validates an array of snapshots into Unix epoch seconds.
+ * @param[in] snapshots Array of raw snapshots.
+ * @param[in] count Number of snapshots.
+ * @param[out] epoch Array of count epoch values; invalid snapshots give 0.
+ * @param[out] valid Optional array of count flags, 1 for a valid snapshot and 0 otherwise.
+ * @return size_t Number of valid snapshots.
+ */
+size_t DS1307_Batch_ToEpoch(const DS1307_Snapshot_t *snapshots, size_t count, uint32_t *epoch, uint8_t *valid)
+{
+    DS1307_Batch_Fields_t out = {0}; /**< Only the epoch output is requested. */
+
+    out.epoch = epoch;
+
+    return DS1307_Batch_ToFields(snapshots, count, &out, valid);
+}
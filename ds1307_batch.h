@@ -0,0 +1,92 @@
+/**
+ * @file ds1307_batch.h
+ * @brief Batch decoder for raw DS1307 timekeeping snapshots.
+ *
+ * Converts arrays of raw register snapshots (registers 0x00-0x06, as produced by the
+ * SQW sampler or shipped by collectors) to Unix epoch seconds and/or to
+ * structure-of-arrays binary fields, validating every snapshot on the way.
+ *
+ * Three kernels give bit-identical results: a portable scalar kernel, and SSE2 and AVX2
+ * kernels that process two and four snapshots per instruction, one snapshot per 64-bit
+ * lane. On x86 hosts built with GCC or Clang the widest kernel supported by the CPU is
+ * selected at runtime; every other target uses the scalar kernel.
+ *
+ * A snapshot is valid when every field is well-formed BCD and in range: seconds and
+ * minutes 0-59, hours 0-23 (1-12 in 12-hour mode), day 1-7, date 1 to the length of the
+ * month (leap years included), month 1-12 and year 0-99. The CH bit is ignored, as in
+ * DS1307_DecodeSnapshot(). Outputs of invalid snapshots are set to zero.
+ *
+ * @details
+ * Usage:
+ * @code
+ * uint32_t epoch[N];
+ * uint8_t valid[N];
+ * size_t good = DS1307_Batch_ToEpoch(snapshots, N, epoch, valid);
+ * @endcode
+ */
+
+#ifndef _INC_DS1307_BATCH_H_
+#define _INC_DS1307_BATCH_H_
+
+/* Include Files */
+#include <stddef.h>
+#include "ds1307.h"
+
+/**
+ * @brief Decoding kernels of the batch API.
+ */
+typedef enum
+{
+    DS1307_BATCH_AUTO = 0,  /**< Widest kernel supported by the CPU. */
+    DS1307_BATCH_SCALAR,    /**< Portable C kernel. */
+    DS1307_BATCH_SSE2,      /**< x86 SSE2 kernel, two snapshots per vector. */
+    DS1307_BATCH_AVX2       /**< x86 AVX2 kernel, four snapshots per vector. */
+} DS1307_Batch_Kernel_t;
+
+/**
+ * @brief Structure-of-arrays output of the batch decoder.
+ * Every pointer may be NULL, in which case that output is not produced. Fields are
+ * binary; the hour is in 24-hour format. Year is the number of years since 2000.
+ */
+typedef struct
+{
+    uint32_t *epoch;  /**< Seconds since 1970-01-01 00:00:00 UTC. */
+    uint8_t *sec;     /**< Seconds, 0-59. */
+    uint8_t *min;     /**< Minutes, 0-59. */
+    uint8_t *hour;    /**< Hours, 0-23. */
+    uint8_t *day;     /**< Day of week, 1-7. */
+    uint8_t *date;    /**< Date, 1-31. */
+    uint8_t *month;   /**< Month, 1-12. */
+    uint8_t *year;    /**< Year, 0-99. */
+} DS1307_Batch_Fields_t;
+
+/**
+ * @brief Selects the kernel used by the batch functions.
+ * A kernel the CPU or the build does not support is downgraded to the widest one that is
+ * available. Selecting DS1307_BATCH_SCALAR is useful to cross-check the vector kernels.
+ * @param[in] kernel Requested kernel, DS1307_BATCH_AUTO for the default.
+ * @return DS1307_Batch_Kernel_t Kernel actually selected.
+ */
+DS1307_Batch_Kernel_t DS1307_Batch_SelectKernel(DS1307_Batch_Kernel_t kernel);
+
+/**
+ * @brief Decodes and validates an array of snapshots into structure-of-arrays outputs.
+ * @param[in] snapshots Array of raw snapshots.
+ * @param[in] count Number of snapshots.
+ * @param[out] out Output arrays; each non-NULL array must hold count elements.
+ * @param[out] valid Optional array of count flags, 1 for a valid snapshot and 0 otherwise.
+ * @return size_t Number of valid snapshots.
+ */
+size_t DS1307_Batch_ToFields(const DS1307_Snapshot_t *snapshots, size_t count, const DS1307_Batch_Fields_t *out, uint8_t *valid);
+
+/**
+ * @brief Decodes and validates an array of snapshots into Unix epoch seconds.
+ * @param[in] snapshots Array of raw snapshots.
+ * @param[in] count Number of snapshots.
+ * @param[out] epoch Array of count epoch values; invalid snapshots give 0.
+ * @param[out] valid Optional array of count flags, 1 for a valid snapshot and 0 otherwise.
+ * @return size_t Number of valid snapshots.
+ */
+size_t DS1307_Batch_ToEpoch(const DS1307_Snapshot_t *snapshots, size_t count, uint32_t *epoch, uint8_t *valid);
+
+#endif /* _INC_DS1307_BATCH_H_ */
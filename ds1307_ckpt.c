@@ -0,0 +1,161 @@
+/**
+ * @file ds1307_ckpt.c
+ * @brief Crash-safe A/B checkpoints in the battery-backed RAM of the DS1307.
+ * This file implements the slot encoding, the recovery scan and the commit.
+ */
+
+/* Include Files */
+#include "ds1307_ckpt.h"
+#include <string.h>
+
+/**
+ * @brief Computes the CRC-16/CCITT-FALSE of a buffer (polynomial 0x1021, initial 0xFFFF).
+ * @param[in] data Buffer to checksum.
+ * @param[in] len Number of bytes.
+ * @return uint16_t CRC of the buffer.
+ */
+static uint16_t DS1307_Ckpt_Crc(const uint8_t *data, uint8_t len)
+{
+    uint16_t crc = 0xFFFF; /**< Running CRC. */
+    uint8_t bit;           /**< Bit loop index. */
+
+    while (len--)
+    {
+        crc ^= (uint16_t)(*data++ << 8);
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Checks the CRC of an encoded slot.
+ * @param[in] slot Encoded slot of size + DS1307_CKPT_OVERHEAD bytes.
+ * @param[in] size Payload bytes.
+ * @return uint8_t 1 if the slot is intact, 0 otherwise.
+ */
+static uint8_t DS1307_Ckpt_Valid(const uint8_t *slot, uint8_t size)
+{
+    uint16_t crc = DS1307_Ckpt_Crc(slot, (uint8_t)(size + 2)); /**< CRC over sequence and payload. */
+
+    return (slot[size + 2] == (uint8_t)crc) && (slot[size + 3] == (uint8_t)(crc >> 8));
+}
+
+/**
+ * @brief Describes a checkpoint area without touching the device.
+ * @param[out] ckpt Pointer to the checkpoint state to initialize.
+ * @param[in] offset NVRAM offset of the first slot.
+ * @param[in] size Payload bytes, 1 to DS1307_CKPT_MAX_PAYLOAD.
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_DATA_SIZE_ERROR if the two slots do
+ *         not fit in the RAM from offset on.
+ */
+DS1307_Status_t DS1307_Ckpt_Init(DS1307_Ckpt_t *ckpt, uint8_t offset, uint8_t size)
+{
+    if ((size == 0) || (size > DS1307_CKPT_MAX_PAYLOAD) ||
+        ((uint16_t)offset + 2u * (size + DS1307_CKPT_OVERHEAD) > DS1307_NVRAM_SIZE))
+    {
+        return DS1307_DATA_SIZE_ERROR;
+    }
+
+    ckpt->offset = offset;
+    ckpt->size = size;
+    ckpt->active = DS1307_CKPT_NONE;
+    ckpt->seq = 0;
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Finds the newest valid checkpoint, typically once at boot.
+ * Both slots are read in one burst.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] ckpt Pointer to the checkpoint state.
+ * @param[out] payload Buffer receiving size bytes of the newest checkpoint.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_NOT_FOUND if neither slot is valid
+ *         (payload untouched), or the status of the read.
+ */
+DS1307_Status_t DS1307_Ckpt_Recover(DS1307_Handle_t *dev, DS1307_Ckpt_t *ckpt, uint8_t *payload)
+{
+    uint8_t raw[DS1307_NVRAM_SIZE];                              /**< Both slots. */
+    uint8_t slotLen = (uint8_t)(ckpt->size + DS1307_CKPT_OVERHEAD); /**< Bytes per slot. */
+    const uint8_t *slot[2];                                       /**< Start of slot A and B. */
+    uint16_t seq[2];                                              /**< Sequence number of each slot. */
+    uint8_t valid[2];                                             /**< CRC result of each slot. */
+    DS1307_Status_t status;                                       /**< Status of the read. */
+    uint8_t i;                                                    /**< Slot index. */
+
+    status = DS1307_NvramRead(dev, ckpt->offset, raw, (uint8_t)(2 * slotLen));
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        slot[i] = &raw[i * slotLen];
+        seq[i] = (uint16_t)(slot[i][0] | (slot[i][1] << 8));
+        valid[i] = DS1307_Ckpt_Valid(slot[i], ckpt->size);
+    }
+
+    if (valid[0] && valid[1])
+    {
+        /* Serial number arithmetic: B is newer if it is ahead of A by less than half the range */
+        ckpt->active = ((int16_t)(uint16_t)(seq[1] - seq[0]) > 0) ? 1 : 0;
+    }
+    else if (valid[0] || valid[1])
+    {
+        ckpt->active = valid[1] ? 1 : 0;
+    }
+    else
+    {
+        ckpt->active = DS1307_CKPT_NONE;
+        return DS1307_NOT_FOUND;
+    }
+
+    ckpt->seq = seq[ckpt->active];
+    memcpy(payload, &slot[ckpt->active][2], ckpt->size);
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Stores a new checkpoint in the inactive slot.
+ * The slot is written in one burst; the active slot is never touched, so the previous
+ * checkpoint survives a power cut during the write. Call DS1307_Ckpt_Recover() first so
+ * that the sequence continues from the stored one.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] ckpt Pointer to the checkpoint state.
+ * @param[in] payload Buffer holding size bytes.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the write; on failure the
+ *         previous checkpoint stays the active one.
+ */
+DS1307_Status_t DS1307_Ckpt_Commit(DS1307_Handle_t *dev, DS1307_Ckpt_t *ckpt, const uint8_t *payload)
+{
+    uint8_t slot[DS1307_NVRAM_SIZE / 2];                          /**< Encoded slot. */
+    uint8_t slotLen = (uint8_t)(ckpt->size + DS1307_CKPT_OVERHEAD); /**< Bytes per slot. */
+    uint8_t target = (ckpt->active == 0) ? 1 : 0;                 /**< Slot to overwrite. */
+    uint16_t seq = (uint16_t)(ckpt->seq + 1);                     /**< Sequence number of the new checkpoint. */
+    uint16_t crc;                                                 /**< CRC over sequence and payload. */
+    DS1307_Status_t status;                                       /**< Status of the write. */
+
+    slot[0] = (uint8_t)seq;
+    slot[1] = (uint8_t)(seq >> 8);
+    memcpy(&slot[2], payload, ckpt->size);
+    crc = DS1307_Ckpt_Crc(slot, (uint8_t)(ckpt->size + 2));
+    slot[ckpt->size + 2] = (uint8_t)crc;
+    slot[ckpt->size + 3] = (uint8_t)(crc >> 8);
+
+    status = DS1307_NvramWrite(dev, (uint8_t)(ckpt->offset + target * slotLen), slot, slotLen);
+    if (status != DS1307_OK)
+    {
+        return status;
+    }
+
+    ckpt->active = target;
+    ckpt->seq = seq;
+
+    return DS1307_OK;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file ds1307_ckpt.h
+ * @brief Crash-safe A/B checkpoints in the battery-backed RAM of the DS1307.
+ *
+ * Two slots are laid out back to back in the RAM. Each slot holds a 16-bit sequence
+ * number, the payload and a CRC-16/CCITT over both:
+ *
+ *     | seq (2, LE) | payload (size) | crc (2, LE) |
+ *
+ * A commit writes the next sequence number into the slot that does not hold the newest
+ * checkpoint, in a single burst. A power cut during the write can only damage that slot;
+ * its CRC then fails and recovery falls back to the other one. Recovery reads both slots
+ * in one burst and picks the valid slot with the newer sequence number (serial number
+ * arithmetic, so the 16-bit counter may wrap).
+ *
+ * With the maximum payload of 24 bytes the two slots fill the 56 bytes of RAM.
+ *
+ * @details
+ * Usage:
+ * @code
+ * DS1307_Ckpt_t ckpt;
+ * DS1307_Ckpt_Init(&ckpt, 0, sizeof(state));
+ * if (DS1307_Ckpt_Recover(&rtc, &ckpt, (uint8_t *)&state) != DS1307_OK)
+ * {
+ *     // No valid checkpoint: start from defaults
+ * }
+ * ...
+ * DS1307_Ckpt_Commit(&rtc, &ckpt, (const uint8_t *)&state);
+ * @endcode
+ */
+
+#ifndef _INC_DS1307_CKPT_H_
+#define _INC_DS1307_CKPT_H_
+
+/* Include Files */
+#include "ds1307.h"
+
+#define DS1307_CKPT_OVERHEAD                     4u  /**< Sequence number and CRC bytes per slot. */
+#define DS1307_CKPT_MAX_PAYLOAD                  ((DS1307_NVRAM_SIZE / 2u) - DS1307_CKPT_OVERHEAD) /**< Largest payload, 24 bytes. */
+#define DS1307_CKPT_NONE                         0xFF /**< No slot holds a valid checkpoint. */
+
+/**
+ * @brief State of a checkpoint area.
+ */
+typedef struct
+{
+    uint8_t offset;   /**< NVRAM offset of slot A; slot B follows it. */
+    uint8_t size;     /**< Payload bytes per checkpoint. */
+    uint8_t active;   /**< Slot holding the newest valid checkpoint (0 or 1), or DS1307_CKPT_NONE. */
+    uint16_t seq;     /**< Sequence number of the newest checkpoint. */
+} DS1307_Ckpt_t;
+
+/**
+ * @brief Describes a checkpoint area without touching the device.
+ * @param[out] ckpt Pointer to the checkpoint state to initialize.
+ * @param[in] offset NVRAM offset of the first slot.
+ * @param[in] size Payload bytes, 1 to DS1307_CKPT_MAX_PAYLOAD.
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_DATA_SIZE_ERROR if the two slots do
+ *         not fit in the RAM from offset on.
+ */
+DS1307_Status_t DS1307_Ckpt_Init(DS1307_Ckpt_t *ckpt, uint8_t offset, uint8_t size);
+
+/**
+ * @brief Finds the newest valid checkpoint, typically once at boot.
+ * Both slots are read in one burst.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] ckpt Pointer to the checkpoint state.
+ * @param[out] payload Buffer receiving size bytes of the newest checkpoint.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_NOT_FOUND if neither slot is valid
+ *         (payload untouched), or the status of the read.
+ */
+DS1307_Status_t DS1307_Ckpt_Recover(DS1307_Handle_t *dev, DS1307_Ckpt_t *ckpt, uint8_t *payload);
+
+/**
+ * @brief Stores a new checkpoint in the inactive slot.
+ * The slot is written in one burst; the active slot is never touched, so the previous
+ * checkpoint survives a power cut during the write. Call DS1307_Ckpt_Recover() first so
+ * that the sequence continues from the stored one.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] ckpt Pointer to the checkpoint state.
+ * @param[in] payload Buffer holding size bytes.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the write; on failure the
+ *         previous checkpoint stays the active one.
+ */
+DS1307_Status_t DS1307_Ckpt_Commit(DS1307_Handle_t *dev, DS1307_Ckpt_t *ckpt, const uint8_t *payload);
+
+#endif /* _INC_DS1307_CKPT_H_ */
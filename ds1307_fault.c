@@ -0,0 +1,421 @@
+/**
+ * @file ds1307_fault.c
+ * @brief Fault-injecting transport wrapper for the DS1307 RTC driver.
+ * This file implements the injection rules, the fault effects and the per-API report.
+ */
+
+/* Include Files */
+#include "ds1307_fault.h"
+#include <stddef.h>
+#include <string.h>
+
+#define DS1307_FAULT_OP_READ                     0u  /**< Transaction is a register read. */
+#define DS1307_FAULT_OP_WRITE                    1u  /**< Transaction is a register write. */
+#define DS1307_FAULT_OP_PROBE                    2u  /**< Transaction is an address probe. */
+#define DS1307_FAULT_NONE                        DS1307_FAULT_KINDS /**< No fault injected. */
+#define DS1307_FAULT_BITS_PER_BYTE               9u  /**< Eight data bits and the acknowledge. */
+#define DS1307_FAULT_BITS_START_STOP             4u  /**< Bus time of a START and a STOP, in SCL periods. */
+
+/**
+ * @brief Draws the next pseudo-random number (xorshift32).
+ * @param[in,out] fault Pointer to the wrapper state.
+ * @return uint32_t Pseudo-random number.
+ */
+static uint32_t DS1307_Fault_Rand(DS1307_Fault_t *fault)
+{
+    uint32_t x = fault->seed; /**< Generator state. */
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    fault->seed = x;
+
+    return x;
+}
+
+/**
+ * @brief Decides which fault, if any, hits the next transaction.
+ * Ongoing bursts take precedence; otherwise the rules are tried in DS1307_FaultKind_t order.
+ * @param[in,out] fault Pointer to the wrapper state.
+ * @return uint8_t Fault kind, or DS1307_FAULT_NONE.
+ */
+static uint8_t DS1307_Fault_Decide(DS1307_Fault_t *fault)
+{
+    const DS1307_FaultRule_t *rule; /**< Rule of the current kind. */
+    uint8_t kind;                   /**< Fault kind index. */
+
+    fault->count++;
+
+    for (kind = 0; kind < DS1307_FAULT_KINDS; kind++)
+    {
+        if (fault->burstLeft[kind])
+        {
+            fault->burstLeft[kind]--;
+            return kind;
+        }
+    }
+
+    for (kind = 0; kind < DS1307_FAULT_KINDS; kind++)
+    {
+        rule = &fault->rule[kind];
+        if (((rule->period != 0) && ((fault->count % rule->period) == 0)) ||
+            ((rule->prob != 0) && ((DS1307_Fault_Rand(fault) & 0xFFFF) < rule->prob)))
+        {
+            fault->burstLeft[kind] = (rule->burst > 1) ? (uint16_t)(rule->burst - 1) : 0;
+            return kind;
+        }
+    }
+
+    return DS1307_FAULT_NONE;
+}
+
+/**
+ * @brief Converts bytes on the wire to bus time.
+ * @param[in] fault Pointer to the wrapper state.
+ * @param[in] bytes Bytes transferred, address included.
+ * @return uint32_t Bus time in microseconds.
+ */
+static uint32_t DS1307_Fault_BusUs(const DS1307_Fault_t *fault, uint16_t bytes)
+{
+    uint32_t bits = (uint32_t)bytes * DS1307_FAULT_BITS_PER_BYTE + DS1307_FAULT_BITS_START_STOP; /**< SCL periods. */
+
+    return (uint32_t)(((uint64_t)bits * 1000000u + fault->busHz - 1) / fault->busHz);
+}
+
+/**
+ * @brief Records a transaction in the report of the current API.
+ * @param[in,out] fault Pointer to the wrapper state.
+ * @param[in] op DS1307_FAULT_OP_* code of the transaction.
+ * @param[in] regAdd First register of the transaction.
+ * @param[in] len Length of the transaction.
+ * @param[in] kind Injected fault kind, or DS1307_FAULT_NONE.
+ * @param[in] stallUs Bus time lost to the fault, in microseconds.
+ */
+static void DS1307_Fault_Account(DS1307_Fault_t *fault, uint8_t op, uint8_t regAdd, uint8_t len, uint8_t kind, uint32_t stallUs)
+{
+    DS1307_FaultReport_t *report = &fault->report[fault->api]; /**< Report of the current API. */
+    uint8_t failed = (kind != DS1307_FAULT_NONE) && (kind != DS1307_FAULT_CORRUPT); /**< The transaction returns an error. */
+
+    report->transactions++;
+    if (fault->lastFailed && (op == fault->lastOp) && (regAdd == fault->lastReg) && (len == fault->lastLen))
+    {
+        report->retries++;
+    }
+
+    if (kind != DS1307_FAULT_NONE)
+    {
+        report->faults[kind]++;
+    }
+    if (kind == DS1307_FAULT_CORRUPT)
+    {
+        fault->callCorrupt = 1;
+    }
+    if (failed)
+    {
+        report->stallUs += stallUs;
+        if (fault->Stall != NULL)
+        {
+            fault->Stall(fault->stallCtx, stallUs);
+        }
+    }
+
+    fault->lastFailed = failed;
+    fault->lastOp = op;
+    fault->lastReg = regAdd;
+    fault->lastLen = len;
+}
+
+/**
+ * @brief Applies a fault that aborts a transaction before any byte lands.
+ * @param[in,out] fault Pointer to the wrapper state.
+ * @param[in] op DS1307_FAULT_OP_* code of the transaction.
+ * @param[in] regAdd First register of the transaction.
+ * @param[in] len Length of the transaction.
+ * @param[in] kind Injected fault kind: address or data NACK, timeout or arbitration loss.
+ * @param[in] timeout Timeout of the transaction in microseconds.
+ * @return DS1307_Status_t Status the transaction returns.
+ */
+static DS1307_Status_t DS1307_Fault_Abort(DS1307_Fault_t *fault, uint8_t op, uint8_t regAdd, uint8_t len, uint8_t kind, uint32_t timeout)
+{
+    switch (kind)
+    {
+    case DS1307_FAULT_TIMEOUT:
+        DS1307_Fault_Account(fault, op, regAdd, len, kind, timeout);
+        return DS1307_TIMEOUT_ERR;
+    case DS1307_FAULT_ARB_LOST:
+        DS1307_Fault_Account(fault, op, regAdd, len, kind, DS1307_Fault_BusUs(fault, 1));
+        return DS1307_BUSY;
+    case DS1307_FAULT_DATA_NACK: /* Pointer byte not acknowledged */
+        DS1307_Fault_Account(fault, op, regAdd, len, kind, DS1307_Fault_BusUs(fault, 2));
+        return DS1307_ERROR;
+    default:                     /* Address not acknowledged */
+        DS1307_Fault_Account(fault, op, regAdd, len, kind, DS1307_Fault_BusUs(fault, 1));
+        return DS1307_ERROR;
+    }
+}
+
+/**
+ * @brief Reads registers through the inner transport, unless a fault is injected.
+ * @param[in] bus Pointer to the DS1307_Fault_t wrapper state.
+ * @param[in] devAddr Slave address of the DS1307.
+ * @param[in] regAdd Address of the first register to read.
+ * @param[out] data Buffer receiving the register contents.
+ * @param[in] len Number of registers to read.
+ * @param[in] timeout Timeout in microseconds.
+ * @return DS1307_Status_t Status of the inner transport, or of the injected fault.
+ */
+static DS1307_Status_t DS1307_Fault_ReadRegs(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    DS1307_Fault_t *fault = (DS1307_Fault_t *)bus; /**< Wrapper state. */
+    uint8_t kind = DS1307_Fault_Decide(fault);     /**< Injected fault. */
+    DS1307_Status_t status;                        /**< Status of the inner transfer. */
+    uint32_t flip;                                 /**< Random bit position to flip. */
+
+    if ((kind != DS1307_FAULT_NONE) && (kind != DS1307_FAULT_CORRUPT))
+    {
+        return DS1307_Fault_Abort(fault, DS1307_FAULT_OP_READ, regAdd, len, kind, timeout);
+    }
+
+    status = fault->inner->ReadRegs(fault->innerBus, devAddr, regAdd, data, len, timeout);
+    if ((kind == DS1307_FAULT_CORRUPT) && (status == DS1307_OK) && (len > 0))
+    {
+        flip = DS1307_Fault_Rand(fault);
+        data[(flip >> 3) % len] ^= (uint8_t)(1u << (flip & 7));
+    }
+    else if (kind == DS1307_FAULT_CORRUPT)
+    {
+        kind = DS1307_FAULT_NONE;
+    }
+
+    DS1307_Fault_Account(fault, DS1307_FAULT_OP_READ, regAdd, len, kind, 0);
+    fault->lastFailed = (status != DS1307_OK);
+
+    return status;
+}
+
+/**
+ * @brief Writes registers through the inner transport, unless a fault is injected.
+ * A data NACK lets a random number of leading bytes land before the error.
+ * @param[in] bus Pointer to the DS1307_Fault_t wrapper state.
+ * @param[in] devAddr Slave address of the DS1307.
+ * @param[in] regAdd Address of the first register to write.
+ * @param[in] data Buffer holding the bytes to write.
+ * @param[in] len Number of registers to write.
+ * @param[in] timeout Timeout in microseconds.
+ * @return DS1307_Status_t Status of the inner transport, or of the injected fault.
+ */
+static DS1307_Status_t DS1307_Fault_WriteRegs(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    DS1307_Fault_t *fault = (DS1307_Fault_t *)bus; /**< Wrapper state. */
+    uint8_t kind = DS1307_Fault_Decide(fault);     /**< Injected fault. */
+    uint8_t frame[DS1307_MAX_BUFF_SIZE];           /**< Corrupted copy of the data. */
+    DS1307_Status_t status;                        /**< Status of the inner transfer. */
+    uint32_t flip;                                 /**< Random bit position to flip. */
+    uint8_t landed;                                /**< Bytes acknowledged before a data NACK. */
+
+    if ((kind == DS1307_FAULT_DATA_NACK) && (len > 0))
+    {
+        landed = (uint8_t)(DS1307_Fault_Rand(fault) % len);
+        if (landed > 0)
+        {
+            fault->inner->WriteRegs(fault->innerBus, devAddr, regAdd, data, landed, timeout);
+        }
+        DS1307_Fault_Account(fault, DS1307_FAULT_OP_WRITE, regAdd, len, kind, DS1307_Fault_BusUs(fault, (uint16_t)(landed + 3)));
+        return DS1307_ERROR;
+    }
+
+    if ((kind != DS1307_FAULT_NONE) && (kind != DS1307_FAULT_CORRUPT))
+    {
+        return DS1307_Fault_Abort(fault, DS1307_FAULT_OP_WRITE, regAdd, len, kind, timeout);
+    }
+
+    if ((kind == DS1307_FAULT_CORRUPT) && (len > 0) && (len <= DS1307_MAX_BUFF_SIZE))
+    {
+        memcpy(frame, data, len);
+        flip = DS1307_Fault_Rand(fault);
+        frame[(flip >> 3) % len] ^= (uint8_t)(1u << (flip & 7));
+        data = frame;
+    }
+    else
+    {
+        kind = DS1307_FAULT_NONE;
+    }
+
+    status = fault->inner->WriteRegs(fault->innerBus, devAddr, regAdd, data, len, timeout);
+
+    DS1307_Fault_Account(fault, DS1307_FAULT_OP_WRITE, regAdd, len, kind, 0);
+    fault->lastFailed = (status != DS1307_OK);
+
+    return status;
+}
+
+/**
+ * @brief Probes through the inner transport, unless a fault is injected.
+ * Corruption does not apply to a probe.
+ * @param[in] bus Pointer to the DS1307_Fault_t wrapper state.
+ * @param[in] devAddr Slave address of the DS1307.
+ * @param[in] timeout Timeout in microseconds.
+ * @return DS1307_Status_t Status of the inner transport, or of the injected fault.
+ */
+static DS1307_Status_t DS1307_Fault_Probe(void *bus, uint8_t devAddr, uint32_t timeout)
+{
+    DS1307_Fault_t *fault = (DS1307_Fault_t *)bus; /**< Wrapper state. */
+    uint8_t kind = DS1307_Fault_Decide(fault);     /**< Injected fault. */
+    DS1307_Status_t status;                        /**< Status of the inner probe. */
+
+    if ((kind != DS1307_FAULT_NONE) && (kind != DS1307_FAULT_CORRUPT))
+    {
+        return DS1307_Fault_Abort(fault, DS1307_FAULT_OP_PROBE, 0, 0, kind, timeout);
+    }
+
+    status = fault->inner->Probe(fault->innerBus, devAddr, timeout);
+
+    DS1307_Fault_Account(fault, DS1307_FAULT_OP_PROBE, 0, 0, DS1307_FAULT_NONE, 0);
+    fault->lastFailed = (status != DS1307_OK);
+
+    return status;
+}
+
+/**
+ * @brief Starts an asynchronous read through the inner transport, unless a fault is
+ *        injected, in which case the failure is reported as a completion at once.
+ * Corruption is not injected into asynchronous transfers.
+ * @param[in] bus Pointer to the DS1307_Fault_t wrapper state.
+ * @param[in] devAddr Slave address of the DS1307.
+ * @param[in] regAdd Address of the first register to read.
+ * @param[out] data Buffer receiving the register contents.
+ * @param[in] len Number of registers to read.
+ * @param[in,out] dev Device handle passed to DS1307_AsyncComplete().
+ * @return DS1307_Status_t Status of the inner start, DS1307_OK for an injected fault, or
+ *         DS1307_ERROR if the inner transport has no asynchronous mode.
+ */
+static DS1307_Status_t DS1307_Fault_ReadRegsAsync(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, DS1307_Handle_t *dev)
+{
+    DS1307_Fault_t *fault = (DS1307_Fault_t *)bus; /**< Wrapper state. */
+    uint8_t kind;                                  /**< Injected fault. */
+
+    if (fault->inner->ReadRegsAsync == NULL)
+    {
+        return DS1307_ERROR;
+    }
+
+    kind = DS1307_Fault_Decide(fault);
+    if ((kind != DS1307_FAULT_NONE) && (kind != DS1307_FAULT_CORRUPT))
+    {
+        DS1307_AsyncComplete(dev, DS1307_Fault_Abort(fault, DS1307_FAULT_OP_READ, regAdd, len, kind, DS1307_TIMEOUT * 1000u));
+        return DS1307_OK;
+    }
+
+    DS1307_Fault_Account(fault, DS1307_FAULT_OP_READ, regAdd, len, DS1307_FAULT_NONE, 0);
+
+    return fault->inner->ReadRegsAsync(fault->innerBus, devAddr, regAdd, data, len, dev);
+}
+
+/**
+ * @brief Starts an asynchronous write through the inner transport, unless a fault is
+ *        injected, in which case the failure is reported as a completion at once.
+ * Corruption is not injected into asynchronous transfers, and a data NACK lands no byte.
+ * @param[in] bus Pointer to the DS1307_Fault_t wrapper state.
+ * @param[in] devAddr Slave address of the DS1307.
+ * @param[in] regAdd Address of the first register to write.
+ * @param[in] data Buffer holding the bytes to write.
+ * @param[in] len Number of registers to write.
+ * @param[in,out] dev Device handle passed to DS1307_AsyncComplete().
+ * @return DS1307_Status_t Status of the inner start, DS1307_OK for an injected fault, or
+ *         DS1307_ERROR if the inner transport has no asynchronous mode.
+ */
+static DS1307_Status_t DS1307_Fault_WriteRegsAsync(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, DS1307_Handle_t *dev)
+{
+    DS1307_Fault_t *fault = (DS1307_Fault_t *)bus; /**< Wrapper state. */
+    uint8_t kind;                                  /**< Injected fault. */
+
+    if (fault->inner->WriteRegsAsync == NULL)
+    {
+        return DS1307_ERROR;
+    }
+
+    kind = DS1307_Fault_Decide(fault);
+    if ((kind != DS1307_FAULT_NONE) && (kind != DS1307_FAULT_CORRUPT))
+    {
+        DS1307_AsyncComplete(dev, DS1307_Fault_Abort(fault, DS1307_FAULT_OP_WRITE, regAdd, len, kind, DS1307_TIMEOUT * 1000u));
+        return DS1307_OK;
+    }
+
+    DS1307_Fault_Account(fault, DS1307_FAULT_OP_WRITE, regAdd, len, DS1307_FAULT_NONE, 0);
+
+    return fault->inner->WriteRegsAsync(fault->innerBus, devAddr, regAdd, data, len, dev);
+}
+
+/**
+ * @brief Transport operations that inject faults in front of another transport.
+ */
+const DS1307_Transport_t DS1307_Transport_Fault =
+{
+    DS1307_Fault_ReadRegs,
+    DS1307_Fault_WriteRegs,
+    DS1307_Fault_Probe,
+    DS1307_Fault_ReadRegsAsync,
+    DS1307_Fault_WriteRegsAsync,
+};
+
+/**
+ * @brief Wraps a transport, with no fault enabled and empty reports.
+ * @param[out] fault Pointer to the wrapper state.
+ * @param[in] inner Transport the transactions are forwarded to.
+ * @param[in] innerBus Bus context of the inner transport.
+ * @param[in] seed Seed of the pseudo-random generator, non-zero.
+ */
+void DS1307_Fault_Init(DS1307_Fault_t *fault, const DS1307_Transport_t *inner, void *innerBus, uint32_t seed)
+{
+    memset(fault, 0, sizeof(*fault));
+
+    fault->inner = inner;
+    fault->innerBus = innerBus;
+    fault->busHz = 100000u;
+    fault->seed = (seed != 0) ? seed : 1u;
+}
+
+/**
+ * @brief Attributes the following transactions to an API.
+ * @param[in,out] fault Pointer to the wrapper state.
+ * @param[in] api Report slot, below DS1307_FAULT_MAX_API.
+ */
+void DS1307_Fault_Begin(DS1307_Fault_t *fault, uint8_t api)
+{
+    fault->api = (api < DS1307_FAULT_MAX_API) ? api : 0;
+    fault->callCorrupt = 0;
+    fault->lastFailed = 0;
+}
+
+/**
+ * @brief Records the outcome of the call opened by DS1307_Fault_Begin().
+ * Further transactions are attributed to slot 0.
+ * @param[in,out] fault Pointer to the wrapper state.
+ * @param[in] status Status returned by the API.
+ */
+void DS1307_Fault_End(DS1307_Fault_t *fault, DS1307_Status_t status)
+{
+    DS1307_FaultReport_t *report = &fault->report[fault->api]; /**< Report of the call's API. */
+
+    report->calls++;
+    if (status != DS1307_OK)
+    {
+        report->lost++;
+    }
+    else if (fault->callCorrupt)
+    {
+        report->corrupted++;
+    }
+
+    fault->api = 0;
+    fault->callCorrupt = 0;
+}
+
+/**
+ * @brief Clears the reports, keeping the rules and the generator state.
+ * @param[in,out] fault Pointer to the wrapper state.
+ */
+void DS1307_Fault_ResetReport(DS1307_Fault_t *fault)
+{
+    memset(fault->report, 0, sizeof(fault->report));
+}
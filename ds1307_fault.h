@@ -0,0 +1,145 @@
+/**
+ * @file ds1307_fault.h
+ * @brief Fault-injecting transport wrapper for the DS1307 RTC driver.
+ *
+ * This backend implements DS1307_Transport_t on top of another transport (typically
+ * DS1307_Transport_Sim) and makes chosen transactions fail the way a noisy bus does:
+ * - address NACK: nothing is transferred, DS1307_ERROR;
+ * - data NACK: a write stops after a random number of bytes, which do land, DS1307_ERROR;
+ * - timeout (stuck SDA): nothing is transferred and the full timeout elapses,
+ *   DS1307_TIMEOUT_ERR;
+ * - arbitration loss: nothing is transferred, DS1307_BUSY;
+ * - corrupted byte: the transfer succeeds but one bit of one byte is flipped on the wire.
+ *
+ * Each fault kind has a rule: a probability per transaction, an optional period (every
+ * n-th transaction), and a burst length (a stuck bus fails several transactions in a row).
+ * The pseudo-random sequence is seeded, so a run can be replayed exactly.
+ *
+ * Calls can be attributed to an API by bracketing them with DS1307_Fault_Begin() and
+ * DS1307_Fault_End(). The report of each API counts transactions, injected faults,
+ * retries (a transaction repeating the previous failed one), lost samples (calls that
+ * ended with an error), silently corrupted samples and the bus time lost to faults.
+ *
+ * @details
+ * Usage:
+ * @code
+ * DS1307_Fault_t fault;
+ * DS1307_Fault_Init(&fault, &DS1307_Transport_Sim, &sim, 1234u);
+ * fault.rule[DS1307_FAULT_TIMEOUT].prob = 655;     // About 1 %
+ * fault.rule[DS1307_FAULT_TIMEOUT].burst = 3;
+ * DS1307_InitTransport(&rtc, &DS1307_Transport_Fault, &fault, _No_Output_0, NULL);
+ *
+ * DS1307_Fault_Begin(&fault, API_READ_TIME);
+ * DS1307_Fault_End(&fault, DS1307_ReadTime_Bin(&rtc, &time));
+ * ...
+ * printf("lost %lu\n", (unsigned long)fault.report[API_READ_TIME].lost);
+ * @endcode
+ */
+
+#ifndef _INC_DS1307_FAULT_H_
+#define _INC_DS1307_FAULT_H_
+
+/* Include Files */
+#include "ds1307.h"
+
+#ifndef DS1307_FAULT_MAX_API
+#define DS1307_FAULT_MAX_API                     8u  /**< Number of API report slots; slot 0 collects unattributed calls. */
+#endif
+
+/**
+ * @brief Kinds of injected faults, in order of precedence.
+ */
+typedef enum
+{
+    DS1307_FAULT_ADDR_NACK = 0, /**< The address byte is not acknowledged. */
+    DS1307_FAULT_DATA_NACK,     /**< A data byte of a write is not acknowledged. */
+    DS1307_FAULT_TIMEOUT,       /**< The bus hangs (SDA held low) until the timeout. */
+    DS1307_FAULT_ARB_LOST,      /**< Another master wins arbitration. */
+    DS1307_FAULT_CORRUPT,       /**< One bit of one byte is flipped. */
+    DS1307_FAULT_KINDS          /**< Number of fault kinds. */
+} DS1307_FaultKind_t;
+
+/**
+ * @brief When a fault kind is injected.
+ */
+typedef struct
+{
+    uint16_t prob;     /**< Probability per transaction, in 1/65536. */
+    uint32_t period;   /**< Also inject on every period-th transaction, 0 for none. */
+    uint16_t burst;    /**< Consecutive transactions hit once triggered, 0 or 1 for single faults. */
+} DS1307_FaultRule_t;
+
+/**
+ * @brief Fault statistics of one API.
+ */
+typedef struct
+{
+    uint32_t calls;                          /**< Calls closed with DS1307_Fault_End(). */
+    uint32_t transactions;                   /**< Transactions issued. */
+    uint32_t retries;                        /**< Transactions repeating the previous failed one. */
+    uint32_t faults[DS1307_FAULT_KINDS];     /**< Injected faults by kind. */
+    uint32_t lost;                           /**< Calls that returned an error status. */
+    uint32_t corrupted;                      /**< Calls that returned DS1307_OK with a corrupted byte. */
+    uint64_t stallUs;                        /**< Bus time spent in failed transactions, in microseconds. */
+} DS1307_FaultReport_t;
+
+/**
+ * @brief Bus context of the fault-injecting transport.
+ */
+typedef struct
+{
+    const DS1307_Transport_t *inner;         /**< Transport the transactions are forwarded to. */
+    void *innerBus;                          /**< Bus context of the inner transport. */
+    DS1307_FaultRule_t rule[DS1307_FAULT_KINDS]; /**< Injection rule of each fault kind. */
+    uint32_t busHz;                          /**< SCL frequency used to cost failed transactions. */
+    void (*Stall)(void *ctx, uint32_t us);   /**< Called with the time lost by each fault (e.g. to advance a simulator), or NULL. */
+    void *stallCtx;                          /**< Context pointer passed to Stall. */
+    uint32_t seed;                           /**< State of the pseudo-random generator. */
+    uint32_t count;                          /**< Transactions seen. */
+    uint16_t burstLeft[DS1307_FAULT_KINDS];  /**< Transactions left in the current burst of each kind. */
+    uint8_t api;                             /**< Report slot of the current call. */
+    uint8_t callCorrupt;                     /**< Set when the current call got a corrupted byte. */
+    uint8_t lastFailed;                      /**< Set when the previous transaction failed. */
+    uint8_t lastOp;                          /**< Operation of the previous transaction. */
+    uint8_t lastReg;                         /**< First register of the previous transaction. */
+    uint8_t lastLen;                         /**< Length of the previous transaction. */
+    DS1307_FaultReport_t report[DS1307_FAULT_MAX_API]; /**< Statistics of each API. */
+} DS1307_Fault_t;
+
+/**
+ * @brief Transport operations that inject faults in front of another transport.
+ * The bus context is a DS1307_Fault_t pointer initialized with DS1307_Fault_Init().
+ */
+extern const DS1307_Transport_t DS1307_Transport_Fault;
+
+/**
+ * @brief Wraps a transport, with no fault enabled and empty reports.
+ * @param[out] fault Pointer to the wrapper state.
+ * @param[in] inner Transport the transactions are forwarded to.
+ * @param[in] innerBus Bus context of the inner transport.
+ * @param[in] seed Seed of the pseudo-random generator, non-zero.
+ */
+void DS1307_Fault_Init(DS1307_Fault_t *fault, const DS1307_Transport_t *inner, void *innerBus, uint32_t seed);
+
+/**
+ * @brief Attributes the following transactions to an API.
+ * @param[in,out] fault Pointer to the wrapper state.
+ * @param[in] api Report slot, below DS1307_FAULT_MAX_API.
+ */
+void DS1307_Fault_Begin(DS1307_Fault_t *fault, uint8_t api);
+
+/**
+ * @brief Records the outcome of the call opened by DS1307_Fault_Begin().
+ * Further transactions are attributed to slot 0.
+ * @param[in,out] fault Pointer to the wrapper state.
+ * @param[in] status Status returned by the API.
+ */
+void DS1307_Fault_End(DS1307_Fault_t *fault, DS1307_Status_t status);
+
+/**
+ * @brief Clears the reports, keeping the rules and the generator state.
+ * @param[in,out] fault Pointer to the wrapper state.
+ */
+void DS1307_Fault_ResetReport(DS1307_Fault_t *fault);
+
+#endif /* _INC_DS1307_FAULT_H_ */
@@ -0,0 +1,400 @@
+/**
+ * @file ds1307_hal.c
+ * @brief STM32 HAL transport backend for the DS1307 RTC driver.
+ * This file maps the DS1307_Transport_t operations onto the STM32 HAL blocking,
+ * interrupt-driven and DMA I2C memory functions, and routes the HAL completion
+ * callbacks back to the DS1307 device that started each transfer.
+ * @note The HAL status codes share their values with DS1307_Status_t
+ *       (OK, ERROR, BUSY, TIMEOUT), so they are returned unchanged.
+ * @note The HAL expects the slave address left-aligned in 8 bits, so the 7-bit
+ *       address held in the device handle is shifted before every call.
+ * @note The driver passes timeouts in microseconds; the HAL counts 1 ms ticks.
+ * @note Routing slots are claimed and released with interrupts masked, since transfers
+ *       may be started from interrupt context.
+ */
+
+/* Include Files */
+#include "ds1307_hal.h"
+
+#ifndef DS1307_NO_HAL
+
+#define DS1307_HAL_TICKS(us)                     (((us) + 999u) / 1000u) /**< Microseconds rounded up to 1 ms HAL ticks. */
+
+/**
+ * @brief Owner of the asynchronous transfer in flight on one I2C peripheral.
+ */
+typedef struct
+{
+    I2C_HandleTypeDef *hi2c;        /**< I2C peripheral handle, NULL if the slot is unused. */
+    DS1307_Handle_t *volatile dev;  /**< Device whose transfer is in flight, NULL if idle. */
+} DS1307_HAL_Route_t;
+
+/**
+ * @brief Routing table from I2C handle to the DS1307 device owning its transfer.
+ */
+static DS1307_HAL_Route_t DS1307_HAL_Routes[DS1307_HAL_MAX_BUSES];
+
+/**
+ * @brief Finds the routing slot of an I2C handle, optionally allocating a free one.
+ * @param[in] hi2c I2C peripheral handle.
+ * @param[in] create Non-zero to allocate a slot if none exists yet.
+ * @return DS1307_HAL_Route_t* Pointer to the slot, or NULL if none is available.
+ */
+static DS1307_HAL_Route_t *DS1307_HAL_FindRoute(I2C_HandleTypeDef *hi2c, uint8_t create)
+{
+    DS1307_HAL_Route_t *freeSlot = NULL; /**< First unused slot. */
+
+    for (int i = 0; i < DS1307_HAL_MAX_BUSES; i++)
+    {
+        if (DS1307_HAL_Routes[i].hi2c == hi2c)
+        {
+            return &DS1307_HAL_Routes[i];
+        }
+        if ((freeSlot == NULL) && (DS1307_HAL_Routes[i].hi2c == NULL))
+        {
+            freeSlot = &DS1307_HAL_Routes[i];
+        }
+    }
+
+    if (create && (freeSlot != NULL))
+    {
+        freeSlot->hi2c = hi2c;
+        return freeSlot;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Claims the routing slot of a bus for a device before starting a transfer.
+ * @param[in] hi2c I2C peripheral handle.
+ * @param[in] dev DS1307 device starting the transfer.
+ * @return DS1307_HAL_Route_t* Pointer to the claimed slot, or NULL if the bus already has
+ *         a DS1307 transfer in flight or the routing table is full.
+ */
+static DS1307_HAL_Route_t *DS1307_HAL_Claim(I2C_HandleTypeDef *hi2c, DS1307_Handle_t *dev)
+{
+    uint32_t primask = __get_PRIMASK(); /**< Interrupt mask of the caller. */
+    DS1307_HAL_Route_t *route;          /**< Slot of the bus. */
+
+    /* An interrupt starting a transfer (e.g. the SQW sampler) must not slip in between the
+       check and the set, nor allocate the same free slot */
+    __disable_irq();
+    route = DS1307_HAL_FindRoute(hi2c, 1);
+    if ((route != NULL) && (route->dev == NULL))
+    {
+        route->dev = dev;
+    }
+    else
+    {
+        route = NULL;
+    }
+    __set_PRIMASK(primask);
+
+    return route;
+}
+
+/**
+ * @brief Releases the routing slot of a bus after a transfer failed to start.
+ * The slot is left alone unless @p dev still owns it.
+ * @param[in,out] route Routing slot claimed with DS1307_HAL_Claim().
+ * @param[in] dev DS1307 device that claimed the slot.
+ */
+static void DS1307_HAL_Release(DS1307_HAL_Route_t *route, DS1307_Handle_t *dev)
+{
+    uint32_t primask = __get_PRIMASK(); /**< Interrupt mask of the caller. */
+
+    __disable_irq();
+    if (route->dev == dev)
+    {
+        route->dev = NULL;
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Releases the routing slot of a bus and completes the transfer of its owner.
+ * @param[in] hi2c I2C peripheral handle reported by the HAL callback.
+ * @param[in] status Completion status to report.
+ * @return uint8_t 1 if a DS1307 transfer was completed, 0 otherwise.
+ */
+static uint8_t DS1307_HAL_Complete(I2C_HandleTypeDef *hi2c, DS1307_Status_t status)
+{
+    DS1307_HAL_Route_t *route = DS1307_HAL_FindRoute(hi2c, 0); /**< Slot of the bus. */
+    DS1307_Handle_t *dev;                                      /**< Owner of the transfer. */
+
+    if ((route == NULL) || (route->dev == NULL))
+    {
+        return 0; /**< Not a DS1307 transfer. */
+    }
+
+    /* Free the bus before completing, so the callback may start the next transfer */
+    dev = route->dev;
+    route->dev = NULL;
+    DS1307_AsyncComplete(dev, status);
+
+    return 1;
+}
+
+/**
+ * @brief Reads consecutive DS1307 registers with HAL_I2C_Mem_Read.
+ * @param[in] bus Pointer to the I2C_HandleTypeDef of the bus.
+ * @param[in] devAddr 7-bit slave address of the DS1307.
+ * @param[in] regAdd Address of the first register to read.
+ * @param[out] data Buffer receiving the register contents.
+ * @param[in] len Number of registers to read.
+ * @param[in] timeout Timeout in microseconds, rounded up to whole HAL ticks.
+ * @return DS1307_Status_t Status returned by the HAL.
+ */
+static DS1307_Status_t DS1307_HAL_ReadRegs(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    return (DS1307_Status_t)HAL_I2C_Mem_Read((I2C_HandleTypeDef *)bus, (uint16_t)(devAddr << 1), regAdd, I2C_MEMADD_SIZE_8BIT, data, len, DS1307_HAL_TICKS(timeout));
+}
+
+/**
+ * @brief Writes consecutive DS1307 registers with HAL_I2C_Mem_Write.
+ * @param[in] bus Pointer to the I2C_HandleTypeDef of the bus.
+ * @param[in] devAddr 7-bit slave address of the DS1307.
+ * @param[in] regAdd Address of the first register to write.
+ * @param[in] data Buffer holding the bytes to write.
+ * @param[in] len Number of registers to write.
+ * @param[in] timeout Timeout in microseconds, rounded up to whole HAL ticks.
+ * @return DS1307_Status_t Status returned by the HAL.
+ */
+static DS1307_Status_t DS1307_HAL_WriteRegs(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    return (DS1307_Status_t)HAL_I2C_Mem_Write((I2C_HandleTypeDef *)bus, (uint16_t)(devAddr << 1), regAdd, I2C_MEMADD_SIZE_8BIT, (uint8_t *)data, len, DS1307_HAL_TICKS(timeout));
+}
+
+/**
+ * @brief Checks that the DS1307 acknowledges its address with HAL_I2C_IsDeviceReady.
+ * @param[in] bus Pointer to the I2C_HandleTypeDef of the bus.
+ * @param[in] devAddr 7-bit slave address of the DS1307.
+ * @param[in] timeout Timeout in microseconds, rounded up to whole HAL ticks.
+ * @return DS1307_Status_t Status returned by the HAL.
+ */
+static DS1307_Status_t DS1307_HAL_Probe(void *bus, uint8_t devAddr, uint32_t timeout)
+{
+    return (DS1307_Status_t)HAL_I2C_IsDeviceReady((I2C_HandleTypeDef *)bus, (uint16_t)(devAddr << 1), 1, DS1307_HAL_TICKS(timeout));
+}
+
+/**
+ * @brief Starts a non-blocking register transfer in interrupt or DMA mode.
+ * @param[in] bus Pointer to the I2C_HandleTypeDef of the bus.
+ * @param[in] devAddr 7-bit slave address of the DS1307.
+ * @param[in] regAdd Address of the first register.
+ * @param[in,out] data Buffer to read into or write from.
+ * @param[in] len Number of registers to transfer.
+ * @param[in] dev DS1307 device to complete when the transfer ends.
+ * @param[in] write Non-zero for a write, zero for a read.
+ * @param[in] dma Non-zero to use the _DMA HAL functions, zero for the _IT ones.
+ * @return DS1307_Status_t DS1307_OK if started, DS1307_BUSY if the bus already has a
+ *         DS1307 transfer in flight, or the status returned by the HAL.
+ */
+static DS1307_Status_t DS1307_HAL_Start(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len,
+                                        DS1307_Handle_t *dev, uint8_t write, uint8_t dma)
+{
+    I2C_HandleTypeDef *hi2c = (I2C_HandleTypeDef *)bus;      /**< I2C peripheral handle. */
+    DS1307_HAL_Route_t *route = DS1307_HAL_Claim(hi2c, dev); /**< Routing slot of the bus. */
+    uint16_t addr = (uint16_t)(devAddr << 1);                /**< Left-aligned slave address. */
+    HAL_StatusTypeDef status;                                /**< Status returned by the HAL. */
+
+    if (route == NULL)
+    {
+        return DS1307_BUSY;
+    }
+
+    if (write)
+    {
+        status = dma ? HAL_I2C_Mem_Write_DMA(hi2c, addr, regAdd, I2C_MEMADD_SIZE_8BIT, data, len)
+                     : HAL_I2C_Mem_Write_IT(hi2c, addr, regAdd, I2C_MEMADD_SIZE_8BIT, data, len);
+    }
+    else
+    {
+        status = dma ? HAL_I2C_Mem_Read_DMA(hi2c, addr, regAdd, I2C_MEMADD_SIZE_8BIT, data, len)
+                     : HAL_I2C_Mem_Read_IT(hi2c, addr, regAdd, I2C_MEMADD_SIZE_8BIT, data, len);
+    }
+
+    if (status != HAL_OK)
+    {
+        DS1307_HAL_Release(route, dev); /**< The transfer was not started, release the bus. */
+    }
+
+    return (DS1307_Status_t)status;
+}
+
+/**
+ * @brief Starts a register read with HAL_I2C_Mem_Read_IT.
+ * @see DS1307_HAL_Start
+ */
+static DS1307_Status_t DS1307_HAL_ReadRegsIT(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, DS1307_Handle_t *dev)
+{
+    return DS1307_HAL_Start(bus, devAddr, regAdd, data, len, dev, 0, 0);
+}
+
+/**
+ * @brief Starts a register write with HAL_I2C_Mem_Write_IT.
+ * @see DS1307_HAL_Start
+ */
+static DS1307_Status_t DS1307_HAL_WriteRegsIT(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, DS1307_Handle_t *dev)
+{
+    return DS1307_HAL_Start(bus, devAddr, regAdd, (uint8_t *)data, len, dev, 1, 0);
+}
+
+/**
+ * @brief Starts a register read with HAL_I2C_Mem_Read_DMA.
+ * @see DS1307_HAL_Start
+ */
+static DS1307_Status_t DS1307_HAL_ReadRegsDMA(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, DS1307_Handle_t *dev)
+{
+    return DS1307_HAL_Start(bus, devAddr, regAdd, data, len, dev, 0, 1);
+}
+
+/**
+ * @brief Starts a register write with HAL_I2C_Mem_Write_DMA.
+ * @see DS1307_HAL_Start
+ */
+static DS1307_Status_t DS1307_HAL_WriteRegsDMA(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, DS1307_Handle_t *dev)
+{
+    return DS1307_HAL_Start(bus, devAddr, regAdd, (uint8_t *)data, len, dev, 1, 1);
+}
+
+/**
+ * @brief Transport operations backed by the STM32 HAL I2C API.
+ */
+const DS1307_Transport_t DS1307_Transport_HAL =
+{
+    DS1307_HAL_ReadRegs,
+    DS1307_HAL_WriteRegs,
+    DS1307_HAL_Probe,
+    DS1307_HAL_ReadRegsIT,
+    DS1307_HAL_WriteRegsIT,
+};
+
+/**
+ * @brief Transport operations backed by the STM32 HAL I2C API, DMA flavour.
+ */
+const DS1307_Transport_t DS1307_Transport_HAL_DMA =
+{
+    DS1307_HAL_ReadRegs,
+    DS1307_HAL_WriteRegs,
+    DS1307_HAL_Probe,
+    DS1307_HAL_ReadRegsDMA,
+    DS1307_HAL_WriteRegsDMA,
+};
+
+/**
+ * @brief Reads the HAL millisecond tick.
+ * @param[in] ctx Unused.
+ * @return uint32_t Current value of HAL_GetTick().
+ */
+static uint32_t DS1307_HAL_GetTick(void *ctx)
+{
+    (void)ctx;
+    return HAL_GetTick();
+}
+
+/**
+ * @brief Fills a tick source backed by HAL_GetTick (1 kHz).
+ * @param[out] src Pointer to the tick source to fill.
+ */
+void DS1307_HAL_TickSource_GetTick(DS1307_TickSource_t *src)
+{
+    src->Now = DS1307_HAL_GetTick;
+    src->ctx = NULL;
+    src->hz = 1000;
+}
+
+#if defined(DWT)
+/**
+ * @brief Reads the DWT cycle counter.
+ * @param[in] ctx Unused.
+ * @return uint32_t Current value of DWT->CYCCNT.
+ */
+static uint32_t DS1307_HAL_GetCycles(void *ctx)
+{
+    (void)ctx;
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief Fills a tick source backed by the DWT cycle counter (SystemCoreClock Hz).
+ * Enables the cycle counter if it is not running yet. Only available on cores with a
+ * DWT unit (Cortex-M3 and above).
+ * @param[out] src Pointer to the tick source to fill.
+ */
+void DS1307_HAL_TickSource_DWT(DS1307_TickSource_t *src)
+{
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk))
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    src->Now = DS1307_HAL_GetCycles;
+    src->ctx = NULL;
+    src->hz = SystemCoreClock;
+}
+#endif
+
+/**
+ * @brief Routes a HAL memory-read-complete event to the DS1307 device that owns it.
+ * @param[in] hi2c I2C handle passed to HAL_I2C_MemRxCpltCallback.
+ * @return uint8_t 1 if the event completed a DS1307 transfer, 0 otherwise.
+ */
+uint8_t DS1307_HAL_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    return DS1307_HAL_Complete(hi2c, DS1307_OK);
+}
+
+/**
+ * @brief Routes a HAL memory-write-complete event to the DS1307 device that owns it.
+ * @param[in] hi2c I2C handle passed to HAL_I2C_MemTxCpltCallback.
+ * @return uint8_t 1 if the event completed a DS1307 transfer, 0 otherwise.
+ */
+uint8_t DS1307_HAL_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    return DS1307_HAL_Complete(hi2c, DS1307_OK);
+}
+
+/**
+ * @brief Routes a HAL I2C error event to the DS1307 device that owns the transfer.
+ * @param[in] hi2c I2C handle passed to HAL_I2C_ErrorCallback.
+ * @return uint8_t 1 if the event failed a DS1307 transfer, 0 otherwise.
+ */
+uint8_t DS1307_HAL_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    return DS1307_HAL_Complete(hi2c, DS1307_ERROR);
+}
+
+#ifdef DS1307_HAL_CALLBACKS
+/**
+ * @brief HAL memory-read-complete callback, forwarded to the DS1307 driver.
+ * @param[in] hi2c I2C handle of the completed transfer.
+ */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    (void)DS1307_HAL_MemRxCpltCallback(hi2c);
+}
+
+/**
+ * @brief HAL memory-write-complete callback, forwarded to the DS1307 driver.
+ * @param[in] hi2c I2C handle of the completed transfer.
+ */
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    (void)DS1307_HAL_MemTxCpltCallback(hi2c);
+}
+
+/**
+ * @brief HAL I2C error callback, forwarded to the DS1307 driver.
+ * @param[in] hi2c I2C handle of the failed transfer.
+ */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    (void)DS1307_HAL_ErrorCallback(hi2c);
+}
+#endif /* DS1307_HAL_CALLBACKS */
+
+#endif /* DS1307_NO_HAL */
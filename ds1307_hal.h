@@ -0,0 +1,96 @@
+/**
+ * @file ds1307_hal.h
+ * @brief STM32 HAL transport backend for the DS1307 RTC driver.
+ *
+ * This backend implements DS1307_Transport_t on top of the STM32 HAL blocking
+ * I2C memory functions (HAL_I2C_Mem_Read / HAL_I2C_Mem_Write). The bus context
+ * passed to DS1307_InitTransport() is a pointer to the I2C_HandleTypeDef of the
+ * peripheral the DS1307 is connected to. DS1307_Init() selects this backend
+ * automatically.
+ *
+ * The asynchronous (_IT) driver API is built on HAL_I2C_Mem_Read_IT /
+ * HAL_I2C_Mem_Write_IT, or on their _DMA counterparts with
+ * DS1307_Transport_HAL_DMA. The HAL reports completion through global callbacks
+ * that only carry the I2C handle, so the backend remembers which DS1307 device
+ * handle owns the transfer in flight on each bus and routes the completion back
+ * to it.
+ * Forward the HAL callbacks to the driver in one of two ways:
+ * - define DS1307_HAL_CALLBACKS so this file provides HAL_I2C_MemRxCpltCallback,
+ *   HAL_I2C_MemTxCpltCallback and HAL_I2C_ErrorCallback itself, or
+ * - call DS1307_HAL_MemRxCpltCallback() / DS1307_HAL_MemTxCpltCallback() /
+ *   DS1307_HAL_ErrorCallback() from the application's own HAL callbacks. They
+ *   return 1 when the event belonged to a DS1307 transfer.
+ */
+
+#ifndef _INC_DS1307_HAL_H_
+#define _INC_DS1307_HAL_H_
+
+/* Include Files */
+#include "ds1307.h"
+
+#ifndef DS1307_NO_HAL
+
+/**
+ * @brief Maximum number of I2C peripherals with DS1307 asynchronous transfers in flight.
+ */
+#ifndef DS1307_HAL_MAX_BUSES
+#define DS1307_HAL_MAX_BUSES                     2
+#endif
+
+/**
+ * @brief Transport operations backed by the STM32 HAL I2C API.
+ * Blocking operations use the polling HAL functions, asynchronous operations use the
+ * _IT functions. The bus context is an I2C_HandleTypeDef pointer.
+ */
+extern const DS1307_Transport_t DS1307_Transport_HAL;
+
+/**
+ * @brief Transport operations backed by the STM32 HAL I2C API, DMA flavour.
+ * Identical to DS1307_Transport_HAL except that asynchronous transfers use
+ * HAL_I2C_Mem_Read_DMA / HAL_I2C_Mem_Write_DMA, so the data bytes are moved without
+ * CPU involvement. Requires DMA channels linked to the I2C handle in CubeMX. The same
+ * completion callbacks are used (the HAL reports DMA completion through them too).
+ * Pass it to DS1307_InitTransport() with the I2C handle as bus context.
+ */
+extern const DS1307_Transport_t DS1307_Transport_HAL_DMA;
+
+/**
+ * @brief Fills a tick source backed by HAL_GetTick (1 kHz).
+ * @param[out] src Pointer to the tick source to fill.
+ */
+void DS1307_HAL_TickSource_GetTick(DS1307_TickSource_t *src);
+
+#if defined(DWT)
+/**
+ * @brief Fills a tick source backed by the DWT cycle counter (SystemCoreClock Hz).
+ * Enables the cycle counter if it is not running yet. Only available on cores with a
+ * DWT unit (Cortex-M3 and above).
+ * @param[out] src Pointer to the tick source to fill.
+ */
+void DS1307_HAL_TickSource_DWT(DS1307_TickSource_t *src);
+#endif
+
+/**
+ * @brief Routes a HAL memory-read-complete event to the DS1307 device that owns it.
+ * @param[in] hi2c I2C handle passed to HAL_I2C_MemRxCpltCallback.
+ * @return uint8_t 1 if the event completed a DS1307 transfer, 0 otherwise.
+ */
+uint8_t DS1307_HAL_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+
+/**
+ * @brief Routes a HAL memory-write-complete event to the DS1307 device that owns it.
+ * @param[in] hi2c I2C handle passed to HAL_I2C_MemTxCpltCallback.
+ * @return uint8_t 1 if the event completed a DS1307 transfer, 0 otherwise.
+ */
+uint8_t DS1307_HAL_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+
+/**
+ * @brief Routes a HAL I2C error event to the DS1307 device that owns the transfer.
+ * @param[in] hi2c I2C handle passed to HAL_I2C_ErrorCallback.
+ * @return uint8_t 1 if the event failed a DS1307 transfer, 0 otherwise.
+ */
+uint8_t DS1307_HAL_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+#endif /* DS1307_NO_HAL */
+
+#endif /* _INC_DS1307_HAL_H_ */
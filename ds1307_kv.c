@@ -0,0 +1,599 @@
+/**
+ * @file ds1307_kv.c
+ * @brief Compact key-value store in the battery-backed RAM of the DS1307.
+ * This file implements the record layout, the index, compaction, the ordered diff write
+ * and the recovery of a store torn by a power cut.
+ */
+
+/* Include Files */
+#include "ds1307_kv.h"
+#include <string.h>
+
+/**
+ * @brief Walks the records of an image and builds the key index.
+ * The walk stops at the used count, or earlier at a record that runs past it or has an
+ * impossible key: the records before that point form the consistent prefix. A key with
+ * two live records, left by a power cut before the older one was retired, resolves to
+ * the later record.
+ * @param[in] image Region image.
+ * @param[in] size Bytes in the region.
+ * @param[out] index Offset of the live record of each key, 0 if absent.
+ * @return uint8_t End of the consistent prefix, equal to the used count for a well-formed
+ *         store, or 0 if the image does not hold a store.
+ */
+static uint8_t DS1307_Kv_Index(const uint8_t *image, uint8_t size, uint8_t *index)
+{
+    uint8_t used = image[1]; /**< Bytes in use including the header. */
+    uint8_t pos;             /**< Offset of the current record. */
+    uint8_t key;             /**< Key of the current record. */
+
+    memset(index, 0, DS1307_KV_KEY_MAX + 1);
+
+    if (image[0] != DS1307_KV_MAGIC)
+    {
+        return 0;
+    }
+    if (used > size)
+    {
+        used = size;
+    }
+
+    for (pos = DS1307_KV_HEADER; pos < used; pos = (uint8_t)(pos + DS1307_KV_RECORD + image[pos + 1]))
+    {
+        key = image[pos];
+        if (((uint16_t)pos + DS1307_KV_RECORD > used) ||
+            ((uint16_t)pos + DS1307_KV_RECORD + image[pos + 1] > used) ||
+            (key > DS1307_KV_KEY_MAX))
+        {
+            break; /**< Record runs past the used area or has an impossible key. */
+        }
+        if (key != DS1307_KV_DEAD)
+        {
+            index[key] = pos;
+        }
+    }
+
+    return pos;
+}
+
+/**
+ * @brief Removes the superseded records of an image.
+ * @param[in,out] image Region image, compacted in place.
+ * @param[in] index Index of the image.
+ * @param[in] drop Key whose live record is removed as well, or DS1307_KV_DEAD for none.
+ */
+static void DS1307_Kv_Compact(uint8_t *image, const uint8_t *index, uint8_t drop)
+{
+    uint8_t used = image[1];         /**< Bytes in use before compaction. */
+    uint8_t src = DS1307_KV_HEADER;  /**< Offset of the record being examined. */
+    uint8_t dst = DS1307_KV_HEADER;  /**< Offset where the next live record goes. */
+    uint8_t recLen;                  /**< Bytes of the current record. */
+    uint8_t key;                     /**< Key of the current record. */
+
+    while (src < used)
+    {
+        key = image[src];
+        recLen = (uint8_t)(DS1307_KV_RECORD + image[src + 1]);
+        if ((key != DS1307_KV_DEAD) && (key != drop) && (index[key] == src))
+        {
+            memmove(&image[dst], &image[src], recLen);
+            dst = (uint8_t)(dst + recLen);
+        }
+        src = (uint8_t)(src + recLen);
+    }
+
+    image[1] = dst;
+}
+
+/**
+ * @brief Writes the bytes of a new image that differ from the stored one within a range,
+ *        in one burst.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] kv Pointer to the store state; the stored image follows on success and is
+ *                   marked stale on failure, as the device may then hold any mix of bytes.
+ * @param[in] image New region image.
+ * @param[in] from First byte of the range.
+ * @param[in] to One past the last byte of the range.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the failed write.
+ */
+static DS1307_Status_t DS1307_Kv_Write(DS1307_Handle_t *dev, DS1307_Kv_t *kv, const uint8_t *image, uint8_t from, uint8_t to)
+{
+    DS1307_Status_t status; /**< Status of the write. */
+    uint8_t first = from;   /**< First differing byte. */
+    uint8_t last = to;      /**< One past the last differing byte. */
+
+    while ((first < last) && (kv->image[first] == image[first]))
+    {
+        first++;
+    }
+    while ((last > first) && (kv->image[last - 1] == image[last - 1]))
+    {
+        last--;
+    }
+    if (first == last)
+    {
+        return DS1307_OK; /**< Nothing changed. */
+    }
+
+    status = DS1307_NvramWrite(dev, (uint8_t)(kv->offset + first), &image[first], (uint8_t)(last - first));
+    if (status != DS1307_OK)
+    {
+        kv->stale = 1;
+        return status;
+    }
+
+    memcpy(&kv->image[first], &image[first], last - first);
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Moves the device from the stored image to a new one in power-cut-safe order.
+ * First the bytes from the old used count on, which hold new records nobody reads yet;
+ * then the used count, a single byte that publishes them; last the bytes before the old
+ * used count, which retire superseded records. Apart from a compaction in one rewrite,
+ * every update changes at most one byte before the old used count, so a power cut at any
+ * point leaves the store as it was before or after the update, at worst with an unretired
+ * record that the index resolves to the newer one.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] kv Pointer to the store state; image and index follow what was written.
+ * @param[in] image New region image.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the failed write.
+ */
+static DS1307_Status_t DS1307_Kv_Commit(DS1307_Handle_t *dev, DS1307_Kv_t *kv, const uint8_t *image)
+{
+    DS1307_Status_t status;       /**< Status of the writes. */
+    uint8_t used = kv->image[1];  /**< Used count stored on the device. */
+
+    if (used > kv->size)
+    {
+        used = kv->size;
+    }
+
+    status = DS1307_Kv_Write(dev, kv, image, used, kv->size);
+    if (status == DS1307_OK)
+    {
+        status = DS1307_Kv_Write(dev, kv, image, 1, 2);
+    }
+    if (status == DS1307_OK)
+    {
+        status = DS1307_Kv_Write(dev, kv, image, DS1307_KV_HEADER, used);
+    }
+
+    DS1307_Kv_Index(kv->image, kv->size, kv->index);
+
+    return status;
+}
+
+/**
+ * @brief Tells whether the record at an offset is the live record of its key.
+ * @param[in] kv Pointer to the store state.
+ * @param[in] pos Offset of the record.
+ * @return uint8_t 1 if live, 0 for a retired or superseded record.
+ */
+static uint8_t DS1307_Kv_Live(const DS1307_Kv_t *kv, uint8_t pos)
+{
+    return (uint8_t)((kv->image[pos] != DS1307_KV_DEAD) && (kv->index[kv->image[pos]] == pos));
+}
+
+/**
+ * @brief Reclaims the space of superseded records until a record of need bytes fits.
+ * Takes one small step at a time, each a write of one byte or of bytes nobody reads yet,
+ * so that a power cut at any point leaves every live record in place. At the first hole,
+ * a retired or superseded record, where one applies:
+ * - a superseded record is retired;
+ * - a hole at the end of the records is dropped by lowering the used count;
+ * - a hole followed by another one absorbs it by growing its length byte;
+ * - a later live record that fits the hole exactly, or with room for a record header to
+ *   spare, is copied into the hole body, the hole header is turned into the record's
+ *   header (length first, key last) and the old copy is retired; the index resolves the
+ *   two copies to the later one meanwhile.
+ * Failing that, the same is tried at the following holes, then the record after the
+ * first hole is copied past the used area, published and retired, and its old place
+ * joins the hole. Only when none of this fits is the rest compacted in one rewrite,
+ * which a power cut can leave with the records it was moving lost.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] kv Pointer to the store state; image and index follow what was written.
+ * @param[in] need Bytes needed past the used area. Compaction must be able to free them.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the failed write.
+ */
+static DS1307_Status_t DS1307_Kv_Defrag(DS1307_Handle_t *dev, DS1307_Kv_t *kv, uint16_t need)
+{
+    uint8_t image[DS1307_NVRAM_SIZE];   /**< New region image. */
+    DS1307_Status_t status = DS1307_OK; /**< Status of the writes. */
+    uint8_t used;                       /**< Bytes in use. */
+    uint8_t tail;                       /**< First hole whose next record fits past the used area, 0 if none. */
+    uint8_t done;                       /**< Set once a step was taken. */
+    uint8_t p;                          /**< Offset of the hole. */
+    uint8_t q;                          /**< Offset of the record after the hole. */
+    uint8_t r;                          /**< Offset of the record moved into the hole. */
+    uint8_t d;                          /**< Bytes of the hole. */
+    uint8_t n;                          /**< Bytes of the moved record. */
+
+    while ((status == DS1307_OK) && (kv->image[1] + need > kv->size))
+    {
+        memcpy(image, kv->image, kv->size);
+        used = image[1];
+        tail = 0;
+        done = 0;
+
+        for (p = DS1307_KV_HEADER; (p < used) && !done; p = (uint8_t)(p + DS1307_KV_RECORD + image[p + 1]))
+        {
+            if (DS1307_Kv_Live(kv, p))
+            {
+                continue;
+            }
+            d = (uint8_t)(DS1307_KV_RECORD + image[p + 1]);
+            q = (uint8_t)(p + d);
+            done = 1;
+
+            if (image[p] != DS1307_KV_DEAD)
+            {
+                image[p] = DS1307_KV_DEAD;
+                status = DS1307_Kv_Write(dev, kv, image, p, (uint8_t)(p + 1));
+            }
+            else if (q >= used)
+            {
+                image[1] = p;
+                status = DS1307_Kv_Write(dev, kv, image, 1, 2);
+            }
+            else if (!DS1307_Kv_Live(kv, q))
+            {
+                if (image[q] != DS1307_KV_DEAD)
+                {
+                    image[q] = DS1307_KV_DEAD;
+                    status = DS1307_Kv_Write(dev, kv, image, q, (uint8_t)(q + 1));
+                }
+                else
+                {
+                    image[p + 1] = (uint8_t)(d + image[q + 1]);
+                    status = DS1307_Kv_Write(dev, kv, image, (uint8_t)(p + 1), (uint8_t)(p + 2));
+                }
+            }
+            else
+            {
+                for (r = q; r < used; r = (uint8_t)(r + DS1307_KV_RECORD + image[r + 1]))
+                {
+                    n = (uint8_t)(DS1307_KV_RECORD + image[r + 1]);
+                    if (DS1307_Kv_Live(kv, r) && ((n == d) || (n + DS1307_KV_RECORD <= d)))
+                    {
+                        break;
+                    }
+                }
+                if (r >= used)
+                {
+                    if ((tail == 0) && (used + DS1307_KV_RECORD + image[q + 1] <= kv->size))
+                    {
+                        tail = p;
+                    }
+                    done = 0;
+                    continue;
+                }
+
+                /* Hole body: the value, then the header of what is left of the hole */
+                memcpy(&image[p + DS1307_KV_RECORD], &image[r + DS1307_KV_RECORD], n - DS1307_KV_RECORD);
+                if (d != n)
+                {
+                    image[p + n] = DS1307_KV_DEAD;
+                    image[p + n + 1] = (uint8_t)(d - n - DS1307_KV_RECORD);
+                }
+                status = DS1307_Kv_Write(dev, kv, image, (uint8_t)(p + DS1307_KV_RECORD), q);
+                if (status == DS1307_OK)
+                {
+                    image[p + 1] = image[r + 1];
+                    status = DS1307_Kv_Write(dev, kv, image, (uint8_t)(p + 1), (uint8_t)(p + 2));
+                }
+                if (status == DS1307_OK)
+                {
+                    image[p] = image[r];
+                    status = DS1307_Kv_Write(dev, kv, image, p, (uint8_t)(p + 1));
+                }
+                if (status == DS1307_OK)
+                {
+                    image[r] = DS1307_KV_DEAD;
+                    status = DS1307_Kv_Write(dev, kv, image, r, (uint8_t)(r + 1));
+                }
+                if ((status == DS1307_OK) && (d != n) && (r == q))
+                {
+                    /* The rest of the hole and the retired copy are adjacent: join them */
+                    image[p + n + 1] = (uint8_t)(d - DS1307_KV_RECORD);
+                    status = DS1307_Kv_Write(dev, kv, image, (uint8_t)(p + n + 1), (uint8_t)(p + n + 2));
+                }
+            }
+        }
+
+        if (!done && (tail != 0))
+        {
+            p = tail;
+            d = (uint8_t)(DS1307_KV_RECORD + image[p + 1]);
+            q = (uint8_t)(p + d);
+            n = (uint8_t)(DS1307_KV_RECORD + image[q + 1]);
+
+            memcpy(&image[used], &image[q], n);
+            status = DS1307_Kv_Write(dev, kv, image, used, (uint8_t)(used + n));
+            if (status == DS1307_OK)
+            {
+                image[1] = (uint8_t)(used + n);
+                status = DS1307_Kv_Write(dev, kv, image, 1, 2);
+            }
+            if (status == DS1307_OK)
+            {
+                image[q] = DS1307_KV_DEAD;
+                status = DS1307_Kv_Write(dev, kv, image, q, (uint8_t)(q + 1));
+            }
+            if (status == DS1307_OK)
+            {
+                image[p + 1] = (uint8_t)(d + n - DS1307_KV_RECORD);
+                status = DS1307_Kv_Write(dev, kv, image, (uint8_t)(p + 1), (uint8_t)(p + 2));
+            }
+        }
+        else if (!done)
+        {
+            /* No room for a safe step: compact the rest in one rewrite */
+            DS1307_Kv_Compact(image, kv->index, DS1307_KV_DEAD);
+            status = DS1307_Kv_Commit(dev, kv, image);
+        }
+
+        DS1307_Kv_Index(kv->image, kv->size, kv->index);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Reads the region and brings it back to a well-formed store.
+ * A region without the magic byte is formatted empty, writing the used count before the
+ * magic so that a power cut leaves it unformatted. A store whose records stop making
+ * sense before the used count, after a power cut during a compaction, is truncated to its
+ * consistent prefix with a single-byte write.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] kv Pointer to the store state, offset and size set.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the failed transfer.
+ */
+static DS1307_Status_t DS1307_Kv_Load(DS1307_Handle_t *dev, DS1307_Kv_t *kv)
+{
+    uint8_t image[DS1307_NVRAM_SIZE]; /**< Repaired region image. */
+    DS1307_Status_t status;           /**< Status of the transfers. */
+    uint8_t end;                      /**< End of the consistent prefix. */
+
+    status = DS1307_NvramRead(dev, kv->offset, kv->image, kv->size);
+    if (status != DS1307_OK)
+    {
+        kv->stale = 1;
+        return status;
+    }
+    kv->stale = 0;
+
+    end = DS1307_Kv_Index(kv->image, kv->size, kv->index);
+    if ((end != 0) && (end == kv->image[1]))
+    {
+        return DS1307_OK;
+    }
+
+    memcpy(image, kv->image, kv->size);
+    if (end == 0)
+    {
+        /* Not a store: format it empty */
+        image[0] = DS1307_KV_MAGIC;
+        image[1] = DS1307_KV_HEADER;
+        status = DS1307_Kv_Write(dev, kv, image, 1, 2);
+        if (status == DS1307_OK)
+        {
+            status = DS1307_Kv_Write(dev, kv, image, 0, 1);
+        }
+    }
+    else
+    {
+        /* Keep the consistent prefix */
+        image[1] = end;
+        status = DS1307_Kv_Write(dev, kv, image, 1, 2);
+    }
+
+    DS1307_Kv_Index(kv->image, kv->size, kv->index);
+
+    return status;
+}
+
+/**
+ * @brief Loads the store from the device and builds the index.
+ * The region is read in one burst. If it does not hold a store (first use, or RAM lost
+ * with the backup supply), it is formatted empty. If a power cut during a compaction left
+ * records that do not make sense, the records before them are kept.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] kv Pointer to the store state.
+ * @param[in] offset NVRAM offset of the region.
+ * @param[in] size Bytes in the region, at least DS1307_KV_HEADER + DS1307_KV_RECORD.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR if the region does not
+ *         fit in the RAM, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Kv_Init(DS1307_Handle_t *dev, DS1307_Kv_t *kv, uint8_t offset, uint8_t size)
+{
+    if ((size < DS1307_KV_HEADER + DS1307_KV_RECORD) || ((uint16_t)offset + size > DS1307_NVRAM_SIZE))
+    {
+        return DS1307_DATA_SIZE_ERROR;
+    }
+
+    kv->offset = offset;
+    kv->size = size;
+
+    return DS1307_Kv_Load(dev, kv);
+}
+
+/**
+ * @brief Looks up a key. No bus access.
+ * @param[in] kv Pointer to the store state.
+ * @param[in] key Key, 1 to DS1307_KV_KEY_MAX.
+ * @param[out] value Buffer receiving the value.
+ * @param[in,out] len Capacity of value on input, length of the value on output.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_NOT_FOUND if the key is absent,
+ *         DS1307_DATA_SIZE_ERROR if value is too small (len is set to the length needed),
+ *         or DS1307_INVALID_PARAM for an invalid key.
+ */
+DS1307_Status_t DS1307_Kv_Get(const DS1307_Kv_t *kv, uint8_t key, uint8_t *value, uint8_t *len)
+{
+    uint8_t pos;      /**< Offset of the record. */
+    uint8_t valueLen; /**< Length of the stored value. */
+
+    if ((key == DS1307_KV_DEAD) || (key > DS1307_KV_KEY_MAX))
+    {
+        return DS1307_INVALID_PARAM;
+    }
+
+    pos = kv->index[key];
+    if (pos == 0)
+    {
+        return DS1307_NOT_FOUND;
+    }
+
+    valueLen = kv->image[pos + 1];
+    if (valueLen > *len)
+    {
+        *len = valueLen;
+        return DS1307_DATA_SIZE_ERROR;
+    }
+
+    memcpy(value, &kv->image[pos + DS1307_KV_RECORD], valueLen);
+    *len = valueLen;
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Stores a value under a key.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] kv Pointer to the store state.
+ * @param[in] key Key, 1 to DS1307_KV_KEY_MAX.
+ * @param[in] value Buffer holding the value.
+ * @param[in] len Length of the value.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR if the value does not
+ *         fit even after compaction (the store is unchanged), DS1307_INVALID_PARAM for an
+ *         invalid key, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Kv_Set(DS1307_Handle_t *dev, DS1307_Kv_t *kv, uint8_t key, const uint8_t *value, uint8_t len)
+{
+    uint8_t image[DS1307_NVRAM_SIZE]; /**< New region image. */
+    DS1307_Status_t status;           /**< Status of the transfers. */
+    uint16_t need = (uint16_t)(DS1307_KV_RECORD + len); /**< Bytes of the new record. */
+    uint8_t pos;                      /**< Offset of the current record. */
+    uint8_t used;                     /**< Bytes in use. */
+    uint8_t diff = 0;                 /**< Value bytes that change in place. */
+    uint8_t i;                        /**< Loop index. */
+
+    if ((key == DS1307_KV_DEAD) || (key > DS1307_KV_KEY_MAX))
+    {
+        return DS1307_INVALID_PARAM;
+    }
+    if (kv->stale)
+    {
+        status = DS1307_Kv_Load(dev, kv);
+        if (status != DS1307_OK)
+        {
+            return status;
+        }
+    }
+
+    memcpy(image, kv->image, kv->size);
+    pos = kv->index[key];
+
+    if ((pos != 0) && (image[pos + 1] == len))
+    {
+        for (i = 0; i < len; i++)
+        {
+            diff = (uint8_t)(diff + (image[pos + DS1307_KV_RECORD + i] != value[i]));
+        }
+        if (diff <= 1)
+        {
+            /* A single-byte write cannot tear: update in place */
+            memcpy(&image[pos + DS1307_KV_RECORD], value, len);
+            return DS1307_Kv_Commit(dev, kv, image);
+        }
+    }
+
+    if (image[1] + need > kv->size)
+    {
+        /* Make room, keeping the old record so that the key survives a power cut before
+           the new one is published, unless only its space makes room */
+        DS1307_Kv_Compact(image, kv->index, DS1307_KV_DEAD);
+        if (image[1] + need > kv->size)
+        {
+            if (pos == 0)
+            {
+                return DS1307_DATA_SIZE_ERROR;
+            }
+            memcpy(image, kv->image, kv->size);
+            DS1307_Kv_Compact(image, kv->index, key);
+            if (image[1] + need > kv->size)
+            {
+                return DS1307_DATA_SIZE_ERROR;
+            }
+            memcpy(image, kv->image, kv->size);
+            image[pos] = DS1307_KV_DEAD;
+            status = DS1307_Kv_Commit(dev, kv, image);
+            if (status != DS1307_OK)
+            {
+                return status;
+            }
+        }
+
+        status = DS1307_Kv_Defrag(dev, kv, need);
+        if (status != DS1307_OK)
+        {
+            return status;
+        }
+        memcpy(image, kv->image, kv->size);
+        pos = kv->index[key];
+    }
+
+    /* Append the new record, then retire the old one */
+    used = image[1];
+    image[used] = key;
+    image[used + 1] = len;
+    memcpy(&image[used + DS1307_KV_RECORD], value, len);
+    image[1] = (uint8_t)(used + need);
+    if (pos != 0)
+    {
+        image[pos] = DS1307_KV_DEAD;
+    }
+
+    return DS1307_Kv_Commit(dev, kv, image);
+}
+
+/**
+ * @brief Removes a key.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] kv Pointer to the store state.
+ * @param[in] key Key, 1 to DS1307_KV_KEY_MAX.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_NOT_FOUND if the key is absent,
+ *         DS1307_INVALID_PARAM for an invalid key, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Kv_Delete(DS1307_Handle_t *dev, DS1307_Kv_t *kv, uint8_t key)
+{
+    uint8_t image[DS1307_NVRAM_SIZE]; /**< New region image. */
+    DS1307_Status_t status;           /**< Status of the reload. */
+    uint8_t pos;                      /**< Offset of the record. */
+
+    if ((key == DS1307_KV_DEAD) || (key > DS1307_KV_KEY_MAX))
+    {
+        return DS1307_INVALID_PARAM;
+    }
+
+    if (kv->stale)
+    {
+        status = DS1307_Kv_Load(dev, kv);
+        if (status != DS1307_OK)
+        {
+            return status;
+        }
+    }
+
+    pos = kv->index[key];
+    if (pos == 0)
+    {
+        return DS1307_NOT_FOUND;
+    }
+
+    memcpy(image, kv->image, kv->size);
+    image[pos] = DS1307_KV_DEAD;
+
+    return DS1307_Kv_Commit(dev, kv, image);
+}
@@ -0,0 +1,120 @@
+/**
+ * @file ds1307_kv.h
+ * @brief Compact key-value store in the battery-backed RAM of the DS1307.
+ *
+ * Lets several subsystems keep a few persistent bytes each in the 56-byte RAM without
+ * agreeing on addresses. The region holds a 2-byte header followed by TLV records:
+ *
+ *     | magic | used | key | len | value (len) | key | len | value | ...
+ *
+ * `used` counts the bytes in use including the header. A record whose key is
+ * DS1307_KV_DEAD has been superseded and is reclaimed by compaction.
+ *
+ * The store keeps a RAM image of the region and an index from key to record, both built
+ * by DS1307_Kv_Init() from a single burst read. DS1307_Kv_Get() is then an O(1) lookup
+ * with no bus access. A value that differs from the stored one in a single byte is
+ * updated in place; any other value appends a record and retires the old one, and the
+ * region is compacted only when the append would not fit. Every update computes the new
+ * image and writes only the bytes that differ.
+ *
+ * Updates survive a power cut. The new record is written past the used area first, then
+ * `used` is published with a single-byte write, and only then is the old record retired,
+ * with another single-byte write; if that last write is lost, the later of two live
+ * records wins. Compaction moves one record at a time into a hole left by superseded
+ * records, or past the used area, writing its copy before retiring the original, so a
+ * cut during it loses nothing either. Two cases are the exception. When the value only
+ * fits in the space of the old one, the old record is retired first, and a cut before
+ * the new one is published loses the key. When the region is too full for any record to
+ * move, the rest is compacted in one rewrite, and a cut during it can lose the records
+ * it was moving; DS1307_Kv_Init() then keeps the records before the first one that does
+ * not make sense. After a failed write the image is reloaded from the device before the
+ * next update.
+ *
+ * @details
+ * Usage:
+ * @code
+ * DS1307_Kv_t kv;
+ * uint8_t boots[2], len = sizeof(boots);
+ * DS1307_Kv_Init(&rtc, &kv, 0, DS1307_NVRAM_SIZE);
+ * if (DS1307_Kv_Get(&kv, KEY_BOOTS, boots, &len) != DS1307_OK) { boots[0] = boots[1] = 0; }
+ * ...
+ * DS1307_Kv_Set(&rtc, &kv, KEY_BOOTS, boots, sizeof(boots));
+ * @endcode
+ */
+
+#ifndef _INC_DS1307_KV_H_
+#define _INC_DS1307_KV_H_
+
+/* Include Files */
+#include "ds1307.h"
+
+#ifndef DS1307_KV_KEY_MAX
+#define DS1307_KV_KEY_MAX                        31u   /**< Largest key; keys are 1 to DS1307_KV_KEY_MAX. */
+#endif
+#define DS1307_KV_MAGIC                          0x6B  /**< First byte of a formatted region. */
+#define DS1307_KV_DEAD                           0x00  /**< Key of a superseded record. */
+#define DS1307_KV_HEADER                         2u    /**< Header bytes: magic and used. */
+#define DS1307_KV_RECORD                         2u    /**< Record overhead: key and length. */
+
+/**
+ * @brief State of a key-value store.
+ */
+typedef struct
+{
+    uint8_t offset;                          /**< NVRAM offset of the region. */
+    uint8_t size;                            /**< Bytes in the region. */
+    uint8_t image[DS1307_NVRAM_SIZE];        /**< Copy of the region as stored on the device. */
+    uint8_t index[DS1307_KV_KEY_MAX + 1];    /**< Offset of the live record of each key in image, 0 if absent. */
+    uint8_t stale;                           /**< Set after a failed transfer: image is reloaded before the next update. */
+} DS1307_Kv_t;
+
+/**
+ * @brief Loads the store from the device and builds the index.
+ * The region is read in one burst. If it does not hold a store (first use, or RAM lost
+ * with the backup supply), it is formatted empty. If a power cut during a compaction left
+ * records that do not make sense, the records before them are kept.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] kv Pointer to the store state.
+ * @param[in] offset NVRAM offset of the region.
+ * @param[in] size Bytes in the region, at least DS1307_KV_HEADER + DS1307_KV_RECORD.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR if the region does not
+ *         fit in the RAM, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Kv_Init(DS1307_Handle_t *dev, DS1307_Kv_t *kv, uint8_t offset, uint8_t size);
+
+/**
+ * @brief Looks up a key. No bus access.
+ * @param[in] kv Pointer to the store state.
+ * @param[in] key Key, 1 to DS1307_KV_KEY_MAX.
+ * @param[out] value Buffer receiving the value.
+ * @param[in,out] len Capacity of value on input, length of the value on output.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_NOT_FOUND if the key is absent,
+ *         DS1307_DATA_SIZE_ERROR if value is too small (len is set to the length needed),
+ *         or DS1307_INVALID_PARAM for an invalid key.
+ */
+DS1307_Status_t DS1307_Kv_Get(const DS1307_Kv_t *kv, uint8_t key, uint8_t *value, uint8_t *len);
+
+/**
+ * @brief Stores a value under a key.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] kv Pointer to the store state.
+ * @param[in] key Key, 1 to DS1307_KV_KEY_MAX.
+ * @param[in] value Buffer holding the value.
+ * @param[in] len Length of the value.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR if the value does not
+ *         fit even after compaction (the store is unchanged), DS1307_INVALID_PARAM for an
+ *         invalid key, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Kv_Set(DS1307_Handle_t *dev, DS1307_Kv_t *kv, uint8_t key, const uint8_t *value, uint8_t len);
+
+/**
+ * @brief Removes a key.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] kv Pointer to the store state.
+ * @param[in] key Key, 1 to DS1307_KV_KEY_MAX.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_NOT_FOUND if the key is absent,
+ *         DS1307_INVALID_PARAM for an invalid key, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Kv_Delete(DS1307_Handle_t *dev, DS1307_Kv_t *kv, uint8_t key);
+
+#endif /* _INC_DS1307_KV_H_ */
@@ -0,0 +1,388 @@
+/**
+ * @file ds1307_linux.c
+ * @brief Linux i2c-dev transport backend for the DS1307 RTC driver.
+ * This file maps the DS1307_Transport_t operations onto ioctl(I2C_RDWR) combined
+ * transactions, with an SMBus I2C block fallback for SMBus-only adapters.
+ */
+
+/* O_CLOEXEC and clock_gettime() are POSIX.1-2008, hidden by a strict -std=c99/c11 build */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+/* Include Files */
+#include "ds1307_linux.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+/**
+ * @brief Maps an errno value from the i2c-dev layer to a DS1307 status code.
+ * @param[in] err errno value reported by ioctl().
+ * @return DS1307_Status_t Matching driver status.
+ */
+static DS1307_Status_t DS1307_Linux_Status(int err)
+{
+    switch (err)
+    {
+    case ETIMEDOUT:
+        return DS1307_TIMEOUT_ERR;
+    case EAGAIN:  /* Arbitration lost */
+    case EBUSY:
+        return DS1307_BUSY;
+    default:      /* ENXIO / EREMOTEIO: address or data NACK */
+        return DS1307_ERROR;
+    }
+}
+
+/**
+ * @brief Programs the adapter timeout if it differs from the last one set.
+ * I2C_TIMEOUT is expressed in units of 10 ms: the timeout is rounded up to the next unit,
+ * at least one, and the unit count is what gets compared, so adaptive timeouts that vary
+ * within the same 10 ms cost no ioctl.
+ * @param[in,out] bus Pointer to the bus context.
+ * @param[in] timeout Timeout in microseconds.
+ */
+static void DS1307_Linux_SetTimeout(DS1307_Linux_t *bus, uint32_t timeout)
+{
+    uint32_t units = timeout / 10000u + ((timeout % 10000u) != 0); /**< Timeout in 10 ms units. */
+
+    if (units == 0)
+    {
+        units = 1;
+    }
+    if (units != bus->timeout)
+    {
+        if (ioctl(bus->fd, I2C_TIMEOUT, (unsigned long)units) == 0)
+        {
+            bus->timeout = units;
+        }
+    }
+}
+
+/**
+ * @brief Selects the slave address for SMBus ioctls if it differs from the current one.
+ * @param[in,out] bus Pointer to the bus context.
+ * @param[in] devAddr Slave address of the DS1307.
+ * @return DS1307_Status_t Returns DS1307_OK on success, or an error code.
+ */
+static DS1307_Status_t DS1307_Linux_SetSlave(DS1307_Linux_t *bus, uint8_t devAddr)
+{
+    if (devAddr != bus->slaveAddr)
+    {
+        if (ioctl(bus->fd, I2C_SLAVE, (unsigned long)devAddr) < 0)
+        {
+            return DS1307_Linux_Status(errno);
+        }
+        bus->slaveAddr = devAddr;
+    }
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Runs one SMBus I2C block transfer of at most I2C_SMBUS_BLOCK_MAX bytes.
+ * @param[in] bus Pointer to the bus context.
+ * @param[in] readWrite I2C_SMBUS_READ or I2C_SMBUS_WRITE.
+ * @param[in] regAdd Address of the first register.
+ * @param[in,out] data Buffer to read into or write from.
+ * @param[in] len Number of bytes to transfer.
+ * @return DS1307_Status_t Returns DS1307_OK on success, or an error code.
+ */
+static DS1307_Status_t DS1307_Linux_SmbusBlock(DS1307_Linux_t *bus, uint8_t readWrite, uint8_t regAdd, uint8_t *data, uint8_t len)
+{
+    union i2c_smbus_data block;         /**< SMBus block buffer, block[0] holds the length. */
+    struct i2c_smbus_ioctl_data args;   /**< I2C_SMBUS ioctl arguments. */
+
+    block.block[0] = len;
+    if (readWrite == I2C_SMBUS_WRITE)
+    {
+        memcpy(&block.block[1], data, len);
+    }
+
+    args.read_write = readWrite;
+    args.command = regAdd;
+    args.size = I2C_SMBUS_I2C_BLOCK_DATA;
+    args.data = &block;
+
+    if (ioctl(bus->fd, I2C_SMBUS, &args) < 0)
+    {
+        return DS1307_Linux_Status(errno);
+    }
+
+    if (readWrite == I2C_SMBUS_READ)
+    {
+        memcpy(data, &block.block[1], len);
+    }
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Splits a register block transfer into SMBus I2C block transfers.
+ * @param[in] bus Pointer to the bus context.
+ * @param[in] devAddr Slave address of the DS1307.
+ * @param[in] readWrite I2C_SMBUS_READ or I2C_SMBUS_WRITE.
+ * @param[in] regAdd Address of the first register.
+ * @param[in,out] data Buffer to read into or write from.
+ * @param[in] len Number of bytes to transfer.
+ * @return DS1307_Status_t Returns DS1307_OK on success, or the first error code.
+ */
+static DS1307_Status_t DS1307_Linux_Smbus(DS1307_Linux_t *bus, uint8_t devAddr, uint8_t readWrite, uint8_t regAdd, uint8_t *data, uint8_t len)
+{
+    DS1307_Status_t status; /**< Status of the current chunk. */
+    uint8_t chunk;          /**< Size of the current chunk. */
+
+    status = DS1307_Linux_SetSlave(bus, devAddr);
+
+    while ((status == DS1307_OK) && (len > 0))
+    {
+        chunk = (len > I2C_SMBUS_BLOCK_MAX) ? I2C_SMBUS_BLOCK_MAX : len;
+        status = DS1307_Linux_SmbusBlock(bus, readWrite, regAdd, data, chunk);
+        regAdd += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Reads consecutive DS1307 registers in one I2C_RDWR combined transaction.
+ * @param[in] bus Pointer to the DS1307_Linux_t bus context.
+ * @param[in] devAddr Slave address of the DS1307.
+ * @param[in] regAdd Address of the first register to read.
+ * @param[out] data Buffer receiving the register contents.
+ * @param[in] len Number of registers to read.
+ * @param[in] timeout Timeout in microseconds.
+ * @return DS1307_Status_t Returns DS1307_OK on success, or an error code.
+ */
+static DS1307_Status_t DS1307_Linux_ReadRegs(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    DS1307_Linux_t *linuxBus = (DS1307_Linux_t *)bus; /**< Bus context. */
+    struct i2c_msg msgs[2];                            /**< Pointer write + repeated-start read. */
+    struct i2c_rdwr_ioctl_data xfer;                   /**< I2C_RDWR ioctl arguments. */
+
+    DS1307_Linux_SetTimeout(linuxBus, timeout);
+
+    if (linuxBus->useSmbus)
+    {
+        return DS1307_Linux_Smbus(linuxBus, devAddr, I2C_SMBUS_READ, regAdd, data, len);
+    }
+
+    msgs[0].addr = devAddr;
+    msgs[0].flags = 0;
+    msgs[0].len = 1;
+    msgs[0].buf = &regAdd;
+
+    msgs[1].addr = devAddr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = len;
+    msgs[1].buf = data;
+
+    xfer.msgs = msgs;
+    xfer.nmsgs = 2;
+
+    if (ioctl(linuxBus->fd, I2C_RDWR, &xfer) < 0)
+    {
+        return DS1307_Linux_Status(errno);
+    }
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Writes consecutive DS1307 registers in one I2C_RDWR message.
+ * @param[in] bus Pointer to the DS1307_Linux_t bus context.
+ * @param[in] devAddr Slave address of the DS1307.
+ * @param[in] regAdd Address of the first register to write.
+ * @param[in] data Buffer holding the bytes to write.
+ * @param[in] len Number of registers to write (at most DS1307_MAX_BUFF_SIZE).
+ * @param[in] timeout Timeout in microseconds.
+ * @return DS1307_Status_t Returns DS1307_OK on success, or an error code.
+ */
+static DS1307_Status_t DS1307_Linux_WriteRegs(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    DS1307_Linux_t *linuxBus = (DS1307_Linux_t *)bus; /**< Bus context. */
+    uint8_t frame[DS1307_MAX_BUFF_SIZE + 1];           /**< Register pointer followed by the payload. */
+    struct i2c_msg msg;                                /**< Single write message. */
+    struct i2c_rdwr_ioctl_data xfer;                   /**< I2C_RDWR ioctl arguments. */
+
+    if (len > DS1307_MAX_BUFF_SIZE)
+    {
+        return DS1307_DATA_SIZE_ERROR;
+    }
+
+    DS1307_Linux_SetTimeout(linuxBus, timeout);
+
+    if (linuxBus->useSmbus)
+    {
+        memcpy(frame, data, len);
+        return DS1307_Linux_Smbus(linuxBus, devAddr, I2C_SMBUS_WRITE, regAdd, frame, len);
+    }
+
+    frame[0] = regAdd;
+    memcpy(&frame[1], data, len);
+
+    msg.addr = devAddr;
+    msg.flags = 0;
+    msg.len = (uint16_t)(len + 1);
+    msg.buf = frame;
+
+    xfer.msgs = &msg;
+    xfer.nmsgs = 1;
+
+    if (ioctl(linuxBus->fd, I2C_RDWR, &xfer) < 0)
+    {
+        return DS1307_Linux_Status(errno);
+    }
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Checks that the DS1307 acknowledges its address with a one-byte read.
+ * @param[in] bus Pointer to the DS1307_Linux_t bus context.
+ * @param[in] devAddr Slave address of the DS1307.
+ * @param[in] timeout Timeout in microseconds.
+ * @return DS1307_Status_t Returns DS1307_OK if the device answers, or an error code.
+ */
+static DS1307_Status_t DS1307_Linux_Probe(void *bus, uint8_t devAddr, uint32_t timeout)
+{
+    DS1307_Linux_t *linuxBus = (DS1307_Linux_t *)bus; /**< Bus context. */
+    union i2c_smbus_data byte;                         /**< SMBus receive-byte buffer. */
+    struct i2c_smbus_ioctl_data args;                  /**< I2C_SMBUS ioctl arguments. */
+    uint8_t value;                                     /**< Discarded byte read from the device. */
+    struct i2c_msg msg;                                /**< Single read message. */
+    struct i2c_rdwr_ioctl_data xfer;                   /**< I2C_RDWR ioctl arguments. */
+
+    DS1307_Linux_SetTimeout(linuxBus, timeout);
+
+    if (linuxBus->useSmbus)
+    {
+        if (DS1307_Linux_SetSlave(linuxBus, devAddr) != DS1307_OK)
+        {
+            return DS1307_ERROR;
+        }
+        args.read_write = I2C_SMBUS_READ;
+        args.command = 0;
+        args.size = I2C_SMBUS_BYTE;
+        args.data = &byte;
+        return (ioctl(linuxBus->fd, I2C_SMBUS, &args) < 0) ? DS1307_Linux_Status(errno) : DS1307_OK;
+    }
+
+    msg.addr = devAddr;
+    msg.flags = I2C_M_RD;
+    msg.len = 1;
+    msg.buf = &value;
+
+    xfer.msgs = &msg;
+    xfer.nmsgs = 1;
+
+    return (ioctl(linuxBus->fd, I2C_RDWR, &xfer) < 0) ? DS1307_Linux_Status(errno) : DS1307_OK;
+}
+
+/**
+ * @brief Transport operations backed by Linux i2c-dev.
+ */
+const DS1307_Transport_t DS1307_Transport_Linux =
+{
+    DS1307_Linux_ReadRegs,
+    DS1307_Linux_WriteRegs,
+    DS1307_Linux_Probe,
+    NULL, /* No asynchronous mode */
+    NULL,
+};
+
+/**
+ * @brief Opens an I2C adapter for use by the DS1307 driver.
+ * @param[out] bus Pointer to the bus context to initialize.
+ * @param[in] path Path of the adapter device node, e.g. "/dev/i2c-1".
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_NOT_FOUND if the
+ *         device node cannot be opened, or DS1307_ERROR if the adapter supports
+ *         neither plain I2C nor SMBus I2C block transfers.
+ */
+DS1307_Status_t DS1307_Linux_Open(DS1307_Linux_t *bus, const char *path)
+{
+    unsigned long funcs = 0; /**< Adapter functionality bitmap. */
+
+    memset(bus, 0, sizeof(*bus));
+
+    bus->fd = open(path, O_RDWR | O_CLOEXEC);
+    if (bus->fd < 0)
+    {
+        return DS1307_NOT_FOUND;
+    }
+
+    if (ioctl(bus->fd, I2C_FUNCS, &funcs) < 0)
+    {
+        funcs = I2C_FUNC_I2C; /* Assume a plain I2C adapter if the query is not supported */
+    }
+
+    if (funcs & I2C_FUNC_I2C)
+    {
+        bus->useSmbus = 0;
+    }
+    else if ((funcs & I2C_FUNC_SMBUS_I2C_BLOCK) == I2C_FUNC_SMBUS_I2C_BLOCK)
+    {
+        bus->useSmbus = 1;
+    }
+    else
+    {
+        DS1307_Linux_Close(bus);
+        return DS1307_ERROR;
+    }
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Closes an adapter opened with DS1307_Linux_Open().
+ * @param[in,out] bus Pointer to the bus context to close.
+ */
+void DS1307_Linux_Close(DS1307_Linux_t *bus)
+{
+    if (bus->fd >= 0)
+    {
+        close(bus->fd);
+    }
+    bus->fd = -1;
+}
+
+/**
+ * @brief Reads CLOCK_MONOTONIC in microseconds, truncated to 32 bits.
+ * @param[in] ctx Unused.
+ * @return uint32_t Current monotonic time in microseconds modulo 2^32.
+ */
+static uint32_t DS1307_Linux_Micros(void *ctx)
+{
+    struct timespec ts; /**< Current monotonic time. */
+
+    (void)ctx;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint32_t)(((uint64_t)ts.tv_sec * 1000000u) + ((uint64_t)ts.tv_nsec / 1000u));
+}
+
+/**
+ * @brief Fills a tick source backed by clock_gettime(CLOCK_MONOTONIC), in microseconds.
+ * The 32-bit counter wraps every 71 minutes, far longer than the interval between
+ * SQW edges or re-alignments.
+ * @param[out] src Pointer to the tick source to fill.
+ */
+void DS1307_Linux_TickSource(DS1307_TickSource_t *src)
+{
+    src->Now = DS1307_Linux_Micros;
+    src->ctx = NULL;
+    src->hz = 1000000u;
+}
+
+#endif /* __linux__ */
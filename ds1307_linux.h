@@ -0,0 +1,86 @@
+/**
+ * @file ds1307_linux.h
+ * @brief Linux i2c-dev transport backend for the DS1307 RTC driver.
+ *
+ * This backend implements DS1307_Transport_t on top of a /dev/i2c-N character
+ * device. Register reads are issued as one ioctl(I2C_RDWR) holding a register
+ * pointer write followed by a repeated-start read, so each DS1307_ReadReg() costs a
+ * single syscall and the bus is never released between the two phases. Register
+ * writes are a single I2C_RDWR message. The adapter file descriptor is opened once
+ * and kept open across calls.
+ *
+ * Adapters that only implement SMBus (for example the i2c-stub test module) are
+ * detected at open time through I2C_FUNCS; transfers then fall back to SMBus I2C
+ * block reads and writes of at most 32 bytes each.
+ *
+ * The kernel takes adapter timeouts in units of 10 ms, so each transport timeout is
+ * rounded up to the next 10 ms: the effective floor is 10 ms, however short the timeouts
+ * computed by DS1307_SetTimeouts().
+ *
+ * @details
+ * Usage:
+ * @code
+ * DS1307_Linux_t bus;
+ * if (DS1307_Linux_Open(&bus, "/dev/i2c-1") == DS1307_OK)
+ * {
+ *     DS1307_InitTransport(&rtc, &DS1307_Transport_Linux, &bus, _No_Output_0, NULL);
+ * }
+ * @endcode
+ *
+ * Testing without hardware: load the stub adapter with
+ * `modprobe i2c-stub chip_addr=0x68` and open the /dev/i2c-N node it creates,
+ * or interpose ioctl() with an LD_PRELOAD shim that services I2C_RDWR.
+ */
+
+#ifndef _INC_DS1307_LINUX_H_
+#define _INC_DS1307_LINUX_H_
+
+/* Include Files */
+#include "ds1307.h"
+
+#ifdef __linux__
+
+/**
+ * @brief Bus context of the Linux i2c-dev backend.
+ */
+typedef struct
+{
+    int fd;               /**< File descriptor of the opened /dev/i2c-N adapter, -1 when closed. */
+    uint8_t useSmbus;     /**< Non-zero when the adapter lacks I2C_RDWR and SMBus block transfers are used. */
+    uint8_t slaveAddr;    /**< Slave address last selected with I2C_SLAVE (SMBus mode only), 0 if none. */
+    uint32_t timeout;     /**< Adapter timeout last programmed with I2C_TIMEOUT, in 10 ms units, 0 if none. */
+} DS1307_Linux_t;
+
+/**
+ * @brief Transport operations backed by Linux i2c-dev.
+ * The bus context is a DS1307_Linux_t pointer opened with DS1307_Linux_Open().
+ */
+extern const DS1307_Transport_t DS1307_Transport_Linux;
+
+/**
+ * @brief Opens an I2C adapter for use by the DS1307 driver.
+ * @param[out] bus Pointer to the bus context to initialize.
+ * @param[in] path Path of the adapter device node, e.g. "/dev/i2c-1".
+ * @return DS1307_Status_t Returns DS1307_OK on success, DS1307_NOT_FOUND if the
+ *         device node cannot be opened, or DS1307_ERROR if the adapter supports
+ *         neither plain I2C nor SMBus I2C block transfers.
+ */
+DS1307_Status_t DS1307_Linux_Open(DS1307_Linux_t *bus, const char *path);
+
+/**
+ * @brief Closes an adapter opened with DS1307_Linux_Open().
+ * @param[in,out] bus Pointer to the bus context to close.
+ */
+void DS1307_Linux_Close(DS1307_Linux_t *bus);
+
+/**
+ * @brief Fills a tick source backed by clock_gettime(CLOCK_MONOTONIC), in microseconds.
+ * The 32-bit counter wraps every 71 minutes, far longer than the interval between
+ * SQW edges or re-alignments.
+ * @param[out] src Pointer to the tick source to fill.
+ */
+void DS1307_Linux_TickSource(DS1307_TickSource_t *src);
+
+#endif /* __linux__ */
+
+#endif /* _INC_DS1307_LINUX_H_ */
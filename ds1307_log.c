@@ -0,0 +1,406 @@
+/**
+ * @file ds1307_log.c
+ * @brief Ring-buffer event log in the battery-backed RAM of the DS1307.
+ * This file implements the record encoding, the ring walk and the diff write.
+ */
+
+/* Include Files */
+#include "ds1307_log.h"
+#include <string.h>
+
+#define DS1307_LOG_START                         1u    /**< Header offset of the ring start. */
+#define DS1307_LOG_END                           2u    /**< Header offset of the ring end. */
+#define DS1307_LOG_BASE                          3u    /**< Header offset of the base epoch. */
+
+/**
+ * @brief Reads the base epoch from the header of an image.
+ * @param[in] image Region image.
+ * @return uint32_t Base epoch.
+ */
+static uint32_t DS1307_Log_GetBase(const uint8_t *image)
+{
+    const uint8_t *base = &image[DS1307_LOG_BASE]; /**< Little-endian base epoch. */
+
+    return (uint32_t)base[0] | ((uint32_t)base[1] << 8) | ((uint32_t)base[2] << 16) | ((uint32_t)base[3] << 24);
+}
+
+/**
+ * @brief Stores the base epoch in the header of an image.
+ * @param[out] image Region image.
+ * @param[in] epoch Base epoch.
+ */
+static void DS1307_Log_SetBase(uint8_t *image, uint32_t epoch)
+{
+    image[DS1307_LOG_BASE] = (uint8_t)epoch;
+    image[DS1307_LOG_BASE + 1] = (uint8_t)(epoch >> 8);
+    image[DS1307_LOG_BASE + 2] = (uint8_t)(epoch >> 16);
+    image[DS1307_LOG_BASE + 3] = (uint8_t)(epoch >> 24);
+}
+
+/**
+ * @brief Decodes the record at a position of the ring.
+ * @param[in] image Region image.
+ * @param[in] cap Bytes in the ring.
+ * @param[in] pos Ring position of the record.
+ * @param[in] avail Bytes of the used area from pos on.
+ * @param[out] code Event code.
+ * @param[out] delta Seconds since the previous record.
+ * @return uint8_t Length of the record, or 0 if it is malformed or runs past avail.
+ */
+static uint8_t DS1307_Log_Decode(const uint8_t *image, uint8_t cap, uint8_t pos, uint8_t avail,
+                                 uint8_t *code, uint32_t *delta)
+{
+    const uint8_t *ring = &image[DS1307_LOG_HEADER]; /**< Start of the ring. */
+    uint8_t len = 1;                                 /**< Bytes consumed. */
+    uint8_t byte;                                    /**< Current varint byte. */
+
+    if (avail < 2)
+    {
+        return 0;
+    }
+
+    *code = ring[pos];
+    *delta = 0;
+    do
+    {
+        if ((len >= avail) || (len >= DS1307_LOG_MAX_RECORD))
+        {
+            return 0;
+        }
+        byte = ring[(pos + len) % cap];
+        *delta |= (uint32_t)(byte & 0x7F) << (7 * (len - 1));
+        len++;
+    } while (byte & 0x80);
+
+    return len;
+}
+
+/**
+ * @brief Walks the records of the image and updates the count and the newest time.
+ * @param[in,out] log Pointer to the log state.
+ * @return uint8_t 1 if the image holds a well-formed log, 0 otherwise.
+ */
+static uint8_t DS1307_Log_Scan(DS1307_Log_t *log)
+{
+    const uint8_t *image = log->image;                    /**< Region image. */
+    uint8_t cap = (uint8_t)(log->size - DS1307_LOG_HEADER); /**< Bytes in the ring. */
+    uint8_t start = image[DS1307_LOG_START];              /**< Ring position of the oldest record. */
+    uint8_t end = image[DS1307_LOG_END];                  /**< Ring position of the first free byte. */
+    uint8_t used;                                         /**< Bytes of records. */
+    uint8_t done;                                         /**< Bytes walked so far. */
+    uint8_t len;                                          /**< Length of the current record. */
+    uint8_t code;                                         /**< Event code of the current record. */
+    uint32_t delta;                                       /**< Delta of the current record. */
+
+    log->count = 0;
+    log->last = DS1307_Log_GetBase(image);
+
+    if ((image[0] != DS1307_LOG_MAGIC) || (start >= cap) || (end >= cap))
+    {
+        return 0;
+    }
+
+    used = (uint8_t)((end + cap - start) % cap);
+
+    for (done = 0; done < used; done = (uint8_t)(done + len))
+    {
+        len = DS1307_Log_Decode(image, cap, (uint8_t)((start + done) % cap), (uint8_t)(used - done), &code, &delta);
+        if (len == 0)
+        {
+            return 0;
+        }
+        log->count++;
+        log->last += delta;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Writes the bytes of a part of a new image that differ from the stored one.
+ * Differing runs separated by at most DS1307_SHADOW_MAX_GAP unchanged bytes are merged
+ * into one burst.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] log Pointer to the log state; its image follows each written run, and is
+ *                   marked stale on failure, as the device may then hold any mix of bytes.
+ * @param[in] image New region image.
+ * @param[in] first First byte of the part to write.
+ * @param[in] last One past the last byte of the part to write.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the failed write.
+ */
+static DS1307_Status_t DS1307_Log_Commit(DS1307_Handle_t *dev, DS1307_Log_t *log, const uint8_t *image,
+                                         uint8_t first, uint8_t last)
+{
+    DS1307_Status_t status; /**< Status of the writes. */
+    uint8_t end;            /**< One past the last differing byte of the run. */
+    uint8_t next;           /**< Candidate byte to extend the run. */
+
+    for (; first < last; first = end)
+    {
+        if (log->image[first] == image[first])
+        {
+            end = (uint8_t)(first + 1);
+            continue;
+        }
+
+        /* Extend over differing bytes, and over short gaps of unchanged ones */
+        end = (uint8_t)(first + 1);
+        for (next = end; (next < last) && ((uint8_t)(next - end) <= DS1307_SHADOW_MAX_GAP); next++)
+        {
+            if (log->image[next] != image[next])
+            {
+                end = (uint8_t)(next + 1);
+            }
+        }
+
+        status = DS1307_NvramWrite(dev, (uint8_t)(log->offset + first), &image[first], (uint8_t)(end - first));
+        if (status != DS1307_OK)
+        {
+            log->stale = 1;
+            return status;
+        }
+        memcpy(&log->image[first], &image[first], end - first);
+    }
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Reads the region and formats it empty if it does not hold a well-formed log.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] log Pointer to the log state, with offset and size set.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the failed transfer.
+ */
+static DS1307_Status_t DS1307_Log_Load(DS1307_Handle_t *dev, DS1307_Log_t *log)
+{
+    uint8_t image[DS1307_NVRAM_SIZE]; /**< Empty log, when formatting. */
+    DS1307_Status_t status;           /**< Status of the transfers. */
+
+    status = DS1307_NvramRead(dev, log->offset, log->image, log->size);
+    if (status != DS1307_OK)
+    {
+        /* Unknown contents: read as empty until reloaded */
+        memset(log->image, 0, DS1307_LOG_HEADER);
+        log->stale = 1;
+        DS1307_Log_Scan(log);
+        return status;
+    }
+    log->stale = 0;
+
+    if (DS1307_Log_Scan(log))
+    {
+        return DS1307_OK;
+    }
+
+    /* Not a log: format it empty */
+    memcpy(image, log->image, log->size);
+    memset(image, 0, DS1307_LOG_HEADER);
+    image[0] = DS1307_LOG_MAGIC;
+
+    status = DS1307_Log_Commit(dev, log, image, 0, DS1307_LOG_HEADER);
+    DS1307_Log_Scan(log);
+
+    return status;
+}
+
+/**
+ * @brief Loads the log from the device.
+ * The region is read in one burst. If it does not hold a well-formed log (first use, or RAM
+ * lost with the backup supply), it is formatted empty.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] log Pointer to the log state.
+ * @param[in] offset NVRAM offset of the region.
+ * @param[in] size Bytes in the region, greater than DS1307_LOG_HEADER + DS1307_LOG_MAX_RECORD.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR if the region does not
+ *         fit in the RAM, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Log_Init(DS1307_Handle_t *dev, DS1307_Log_t *log, uint8_t offset, uint8_t size)
+{
+    if ((size <= DS1307_LOG_HEADER + DS1307_LOG_MAX_RECORD) || ((uint16_t)offset + size > DS1307_NVRAM_SIZE))
+    {
+        return DS1307_DATA_SIZE_ERROR;
+    }
+
+    log->offset = offset;
+    log->size = size;
+
+    return DS1307_Log_Load(dev, log);
+}
+
+/**
+ * @brief Appends an event, evicting the oldest ones if the ring is full.
+ * Times are kept monotonic: an event older than the newest record (clock set back) is
+ * stored with the time of the newest record.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] log Pointer to the log state.
+ * @param[in] code Event code.
+ * @param[in] epoch Time of the event, seconds since 1970-01-01 00:00:00.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Log_Append(DS1307_Handle_t *dev, DS1307_Log_t *log, uint8_t code, uint32_t epoch)
+{
+    uint8_t image[DS1307_NVRAM_SIZE];                        /**< New region image. */
+    uint8_t *ring = &image[DS1307_LOG_HEADER];               /**< Start of the ring. */
+    uint8_t cap = (uint8_t)(log->size - DS1307_LOG_HEADER);  /**< Bytes in the ring. */
+    uint8_t start;                                           /**< Ring position of the oldest record. */
+    uint8_t end;                                             /**< Ring position of the first free byte. */
+    uint8_t used;                                            /**< Bytes of records. */
+    uint32_t base;                                           /**< Time before the oldest record. */
+    uint32_t delta;                                          /**< Seconds since the newest record. */
+    uint32_t oldDelta;                                       /**< Delta of an evicted record. */
+    uint8_t record[DS1307_LOG_MAX_RECORD];                   /**< Encoded record. */
+    uint8_t len = 0;                                         /**< Length of the encoded record. */
+    uint8_t oldLen;                                          /**< Length of an evicted record. */
+    uint8_t oldCode;                                         /**< Code of an evicted record. */
+    uint8_t i;                                               /**< Record byte index. */
+    DS1307_Status_t status;                                  /**< Status of the transfers. */
+
+    if (log->stale)
+    {
+        status = DS1307_Log_Load(dev, log);
+        if (status != DS1307_OK)
+        {
+            return status;
+        }
+    }
+
+    memcpy(image, log->image, log->size);
+    start = image[DS1307_LOG_START];
+    end = image[DS1307_LOG_END];
+    used = (uint8_t)((end + cap - start) % cap);
+    base = DS1307_Log_GetBase(image);
+
+    if (used == 0)
+    {
+        /* Empty log: anchor the base at the new event */
+        base = epoch;
+        delta = 0;
+    }
+    else
+    {
+        delta = (epoch > log->last) ? (epoch - log->last) : 0;
+    }
+
+    record[len++] = code;
+    do
+    {
+        record[len] = (uint8_t)(delta & 0x7F);
+        delta >>= 7;
+        if (delta)
+        {
+            record[len] |= 0x80;
+        }
+        len++;
+    } while (delta);
+
+    /* Evict the oldest records; one ring byte always stays free */
+    while ((uint16_t)used + len >= cap)
+    {
+        oldLen = DS1307_Log_Decode(image, cap, start, used, &oldCode, &oldDelta);
+        if (oldLen == 0)
+        {
+            start = end; /**< Unreadable ring (failed format): drop it. */
+            used = 0;
+            break;
+        }
+        base += oldDelta;
+        start = (uint8_t)((start + oldLen) % cap);
+        used = (uint8_t)(used - oldLen);
+    }
+
+    /* Release the evicted bytes (or anchor an empty log) before reusing them */
+    image[DS1307_LOG_START] = start;
+    DS1307_Log_SetBase(image, base);
+    status = DS1307_Log_Commit(dev, log, image, 0, DS1307_LOG_HEADER);
+
+    /* Write the record into free bytes, then publish it with a single-byte write of end */
+    if (status == DS1307_OK)
+    {
+        for (i = 0; i < len; i++)
+        {
+            ring[(end + i) % cap] = record[i];
+        }
+        status = DS1307_Log_Commit(dev, log, image, DS1307_LOG_HEADER, log->size);
+    }
+    if (status == DS1307_OK)
+    {
+        image[DS1307_LOG_END] = (uint8_t)((end + len) % cap);
+        status = DS1307_Log_Commit(dev, log, image, 0, DS1307_LOG_HEADER);
+    }
+
+    DS1307_Log_Scan(log);
+
+    return status;
+}
+
+/**
+ * @brief Decodes the newest records, oldest first. No bus access.
+ * @param[in] log Pointer to the log state.
+ * @param[out] records Array receiving the records.
+ * @param[in] max Capacity of records.
+ * @return uint8_t Number of records stored, the smaller of max and the log count.
+ */
+uint8_t DS1307_Log_Read(const DS1307_Log_t *log, DS1307_LogRecord_t *records, uint8_t max)
+{
+    uint8_t cap = (uint8_t)(log->size - DS1307_LOG_HEADER); /**< Bytes in the ring. */
+    uint8_t start = log->image[DS1307_LOG_START];           /**< Ring position of the oldest record. */
+    uint8_t end = log->image[DS1307_LOG_END];               /**< Ring position of the first free byte. */
+    uint8_t used = (uint8_t)((end + cap - start) % cap);    /**< Bytes of records. */
+    uint32_t epoch = DS1307_Log_GetBase(log->image);        /**< Time of the current record. */
+    uint8_t skip = (log->count > max) ? (uint8_t)(log->count - max) : 0; /**< Older records left out. */
+    uint8_t n = 0;                                          /**< Records stored. */
+    uint8_t i;                                              /**< Records walked so far. */
+    uint8_t done;                                           /**< Bytes walked so far. */
+    uint8_t len;                                            /**< Length of the current record. */
+    uint8_t code;                                           /**< Event code of the current record. */
+    uint32_t delta;                                         /**< Delta of the current record. */
+
+    for (i = 0, done = 0; (i < log->count) && (done < used) && (n < max); i++, done = (uint8_t)(done + len))
+    {
+        len = DS1307_Log_Decode(log->image, cap, (uint8_t)((start + done) % cap), (uint8_t)(used - done), &code, &delta);
+        if (len == 0)
+        {
+            break; /**< Malformed record: the image no longer matches the count. */
+        }
+        epoch += delta;
+        if (skip)
+        {
+            skip--;
+            continue;
+        }
+        records[n].epoch = epoch;
+        records[n].code = code;
+        n++;
+    }
+
+    return n;
+}
+
+/**
+ * @brief Removes all records.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] log Pointer to the log state.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Log_Clear(DS1307_Handle_t *dev, DS1307_Log_t *log)
+{
+    uint8_t image[DS1307_NVRAM_SIZE]; /**< New region image. */
+    DS1307_Status_t status;           /**< Status of the transfers. */
+
+    if (log->stale)
+    {
+        status = DS1307_Log_Load(dev, log);
+        if (status != DS1307_OK)
+        {
+            return status;
+        }
+    }
+
+    memcpy(image, log->image, log->size);
+    image[DS1307_LOG_START] = image[DS1307_LOG_END];
+
+    status = DS1307_Log_Commit(dev, log, image, 0, DS1307_LOG_HEADER);
+    DS1307_Log_Scan(log);
+
+    return status;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file ds1307_log.h
+ * @brief Ring-buffer event log in the battery-backed RAM of the DS1307.
+ *
+ * Keeps the most recent events (resets, brown-outs, faults) across power loss. The region
+ * holds a 7-byte header followed by a byte ring of variable-length records:
+ *
+ *     | magic | start | end | base (4, LE) | ring ...
+ *
+ * `start` and `end` are the ring positions of the oldest record and of the first free
+ * byte; one byte of the ring is kept free so that a full ring differs from an empty one.
+ * Each record is an event code followed by the time elapsed since the previous record,
+ * as an unsigned LEB128 varint (7 bits per byte). The first record is relative to `base`,
+ * so `base` is always the time just before the oldest record and evicting that record only
+ * advances `base` by its delta. Events up to ~2 minutes apart take 2 bytes, and events up
+ * to ~4.5 hours apart 3 bytes, instead of the 8 of a code plus a full BCD stamp: a 56-byte
+ * region holds up to 24 of the former, or 16 of the latter.
+ *
+ * An append first moves `start` and `base` past the records it evicts, then writes the new
+ * record into free bytes, and publishes it by writing `end` alone. Each step writes only the
+ * bytes that changed. A power cut therefore never leaves a malformed ring: at worst the
+ * record being appended is lost, or a cut between `start` and `base` shifts the decoded
+ * times. After a failed write the image is reloaded from the device before the next
+ * update. Records are decoded to epoch seconds by DS1307_Log_Read() from a RAM image, with
+ * no bus access.
+ *
+ * @details
+ * Usage:
+ * @code
+ * DS1307_Log_t log;
+ * uint32_t now;
+ * DS1307_Log_Init(&rtc, &log, 0, DS1307_NVRAM_SIZE);
+ * DS1307_ReadEpoch(&rtc, &now);
+ * DS1307_Log_Append(&rtc, &log, EVT_BROWNOUT, now);
+ * ...
+ * DS1307_LogRecord_t rec[8];
+ * uint8_t n = DS1307_Log_Read(&log, rec, 8);
+ * @endcode
+ */
+
+#ifndef _INC_DS1307_LOG_H_
+#define _INC_DS1307_LOG_H_
+
+/* Include Files */
+#include "ds1307.h"
+
+#define DS1307_LOG_MAGIC                         0x4C  /**< First byte of a formatted region. */
+#define DS1307_LOG_HEADER                        7u    /**< Header bytes: magic, start, end and base. */
+#define DS1307_LOG_MAX_RECORD                    6u    /**< Longest record: code and a 5-byte varint. */
+
+/**
+ * @brief Decoded log record.
+ */
+typedef struct
+{
+    uint32_t epoch;   /**< Time of the event, seconds since 1970-01-01 00:00:00. */
+    uint8_t code;     /**< Event code. */
+} DS1307_LogRecord_t;
+
+/**
+ * @brief State of an event log.
+ */
+typedef struct
+{
+    uint8_t offset;                      /**< NVRAM offset of the region. */
+    uint8_t size;                        /**< Bytes in the region. */
+    uint8_t count;                       /**< Records in the log. */
+    uint32_t last;                       /**< Time of the newest record. */
+    uint8_t image[DS1307_NVRAM_SIZE];    /**< Copy of the region as stored on the device. */
+    uint8_t stale;                       /**< Set after a failed transfer: image is reloaded before the next update. */
+} DS1307_Log_t;
+
+/**
+ * @brief Loads the log from the device.
+ * The region is read in one burst. If it does not hold a well-formed log (first use, or RAM
+ * lost with the backup supply), it is formatted empty.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[out] log Pointer to the log state.
+ * @param[in] offset NVRAM offset of the region.
+ * @param[in] size Bytes in the region, greater than DS1307_LOG_HEADER + DS1307_LOG_MAX_RECORD.
+ * @return DS1307_Status_t Returns DS1307_OK, DS1307_DATA_SIZE_ERROR if the region does not
+ *         fit in the RAM, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Log_Init(DS1307_Handle_t *dev, DS1307_Log_t *log, uint8_t offset, uint8_t size);
+
+/**
+ * @brief Appends an event, evicting the oldest ones if the ring is full.
+ * Times are kept monotonic: an event older than the newest record (clock set back) is
+ * stored with the time of the newest record.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] log Pointer to the log state.
+ * @param[in] code Event code.
+ * @param[in] epoch Time of the event, seconds since 1970-01-01 00:00:00.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Log_Append(DS1307_Handle_t *dev, DS1307_Log_t *log, uint8_t code, uint32_t epoch);
+
+/**
+ * @brief Decodes the newest records, oldest first. No bus access.
+ * @param[in] log Pointer to the log state.
+ * @param[out] records Array receiving the records.
+ * @param[in] max Capacity of records.
+ * @return uint8_t Number of records stored, the smaller of max and the log count.
+ */
+uint8_t DS1307_Log_Read(const DS1307_Log_t *log, DS1307_LogRecord_t *records, uint8_t max);
+
+/**
+ * @brief Removes all records.
+ * @param[in,out] dev Pointer to the DS1307 device handle.
+ * @param[in,out] log Pointer to the log state.
+ * @return DS1307_Status_t Returns DS1307_OK, or the status of the failed transfer.
+ */
+DS1307_Status_t DS1307_Log_Clear(DS1307_Handle_t *dev, DS1307_Log_t *log);
+
+#endif /* _INC_DS1307_LOG_H_ */
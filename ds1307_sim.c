@@ -0,0 +1,507 @@
+/**
+ * @file ds1307_sim.c
+ * @brief Behavioural DS1307 model as a host-side transport backend.
+ * This file implements the register file, the BCD counting chain, the SQW/OUT level and
+ * the DS1307_Transport_t operations on top of them.
+ */
+
+/* Include Files */
+#include "ds1307_sim.h"
+#include <stddef.h>
+
+#define DS1307_SIM_US_PER_SEC                    1000000u /**< Microseconds per second. */
+#define DS1307_SIM_BITS_PER_BYTE                 9u       /**< Eight data bits and the acknowledge. */
+#define DS1307_SIM_BITS_START_STOP               2u       /**< Bus time of a START or STOP, in SCL periods. */
+
+/**
+ * @brief Bits of each timekeeping and control register that exist; the others read 0.
+ */
+static const uint8_t DS1307_Sim_WriteMask[8] =
+{
+    0xFF, /* Seconds: CH and 00-59 */
+    0x7F, /* Minutes: 00-59 */
+    0x7F, /* Hours: 12/24, AM/PM or 20 h, 00-19 */
+    0x07, /* Day: 1-7 */
+    0x3F, /* Date: 01-31 */
+    0x1F, /* Month: 01-12 */
+    0xFF, /* Year: 00-99 */
+    0x93, /* Control: OUT, SQWE, RS1-RS0 */
+};
+
+/**
+ * @brief Increments a BCD value.
+ * @param[in] bcd BCD value.
+ * @return uint8_t bcd + 1 in BCD, 0x99 rolling over to 0x00.
+ */
+static uint8_t DS1307_Sim_BcdInc(uint8_t bcd)
+{
+    bcd++;
+    if ((bcd & 0x0F) > 0x09)
+    {
+        bcd = (uint8_t)(bcd + 0x06);
+    }
+
+    return (bcd > 0x99) ? 0x00 : bcd;
+}
+
+/**
+ * @brief Returns the last date of a month, in BCD.
+ * @param[in] month Month in BCD, 0x01-0x12.
+ * @param[in] year Year in BCD, 0x00-0x99; divisible by 4 means leap year.
+ * @return uint8_t Number of days of the month in BCD.
+ */
+static uint8_t DS1307_Sim_LastDate(uint8_t month, uint8_t year)
+{
+    static const uint8_t lastDate[12] = { 0x31, 0x28, 0x31, 0x30, 0x31, 0x30, 0x31, 0x31, 0x30, 0x31, 0x30, 0x31 }; /**< Indexed by month - 1. */
+    uint8_t binYear = (uint8_t)((year >> 4) * 10 + (year & 0x0F)); /**< Year in binary. */
+    uint8_t binMonth = (uint8_t)((month >> 4) * 10 + (month & 0x0F)); /**< Month in binary. */
+
+    if ((binMonth == 0) || (binMonth > 12))
+    {
+        return 0x31; /**< Invalid month: count up to 31 as the chip would not stop anyway. */
+    }
+    if ((binMonth == 2) && ((binYear & 3) == 0))
+    {
+        return 0x29;
+    }
+
+    return lastDate[binMonth - 1];
+}
+
+/**
+ * @brief Advances the time registers by one second, with the carries of the counting chain.
+ * @param[in,out] reg Register file.
+ */
+static void DS1307_Sim_Tick(uint8_t *reg)
+{
+    uint8_t hours = reg[D_DS1307_REG_HRS]; /**< Hours register. */
+    uint8_t hour;                          /**< Hour field of the hours register. */
+
+    /* Seconds, keeping CH (clear, since the clock is running) */
+    if ((reg[D_DS1307_REG_SEC] & 0x7F) != 0x59)
+    {
+        reg[D_DS1307_REG_SEC] = DS1307_Sim_BcdInc(reg[D_DS1307_REG_SEC] & 0x7F);
+        return;
+    }
+    reg[D_DS1307_REG_SEC] = 0x00;
+
+    /* Minutes */
+    if (reg[D_DS1307_REG_MIN] != 0x59)
+    {
+        reg[D_DS1307_REG_MIN] = DS1307_Sim_BcdInc(reg[D_DS1307_REG_MIN]);
+        return;
+    }
+    reg[D_DS1307_REG_MIN] = 0x00;
+
+    /* Hours */
+    if (hours & (1 << D_DS1307_BIT_HRS))
+    {
+        /* 12-hour mode: 11 -> 12 toggles AM/PM, 12 -> 1; the date changes at 11 PM -> 12 AM */
+        hour = hours & 0x1F;
+        if (hour == 0x11)
+        {
+            reg[D_DS1307_REG_HRS] = (uint8_t)((hours & 0x60) ^ (1 << D_DS1307_BIT_AMPM)) | 0x12;
+            if (!(hours & (1 << D_DS1307_BIT_AMPM)))
+            {
+                return; /**< 11 AM -> 12 PM. */
+            }
+        }
+        else
+        {
+            reg[D_DS1307_REG_HRS] = (uint8_t)(hours & 0x60) | ((hour == 0x12) ? 0x01 : DS1307_Sim_BcdInc(hour));
+            return;
+        }
+    }
+    else
+    {
+        if (hours != 0x23)
+        {
+            reg[D_DS1307_REG_HRS] = DS1307_Sim_BcdInc(hours);
+            return;
+        }
+        reg[D_DS1307_REG_HRS] = 0x00;
+    }
+
+    /* Day of week */
+    reg[D_DS1307_REG_DAY] = (reg[D_DS1307_REG_DAY] >= 7) ? 1 : (uint8_t)(reg[D_DS1307_REG_DAY] + 1);
+
+    /* Date, month and year */
+    if (reg[D_DS1307_REG_DATE] < DS1307_Sim_LastDate(reg[D_DS1307_REG_MONTH], reg[D_DS1307_REG_YEAR]))
+    {
+        reg[D_DS1307_REG_DATE] = DS1307_Sim_BcdInc(reg[D_DS1307_REG_DATE]);
+        return;
+    }
+    reg[D_DS1307_REG_DATE] = 0x01;
+
+    if (reg[D_DS1307_REG_MONTH] < 0x12)
+    {
+        reg[D_DS1307_REG_MONTH] = DS1307_Sim_BcdInc(reg[D_DS1307_REG_MONTH]);
+        return;
+    }
+    reg[D_DS1307_REG_MONTH] = 0x01;
+
+    reg[D_DS1307_REG_YEAR] = DS1307_Sim_BcdInc(reg[D_DS1307_REG_YEAR]);
+}
+
+/**
+ * @brief Brings virtual time up to date with the host tick source, if there is one.
+ * @param[in,out] sim Pointer to the model state.
+ */
+static void DS1307_Sim_Sync(DS1307_Sim_t *sim)
+{
+    uint32_t hostNow; /**< Host counter value. */
+
+    if (sim->host != NULL)
+    {
+        hostNow = sim->host->Now(sim->host->ctx);
+        DS1307_Sim_Advance(sim, (uint64_t)(uint32_t)(hostNow - sim->hostLast) * DS1307_SIM_US_PER_SEC / sim->host->hz * sim->scale);
+        sim->hostLast = hostNow;
+    }
+}
+
+/**
+ * @brief Charges the bus time of a transfer to virtual time.
+ * @param[in,out] sim Pointer to the model state.
+ * @param[in] bytes Bytes on the wire, address bytes included.
+ * @param[in] starts Number of START conditions (2 with a repeated start).
+ */
+static void DS1307_Sim_Bus(DS1307_Sim_t *sim, uint16_t bytes, uint8_t starts)
+{
+    uint32_t bits; /**< SCL periods of the transfer. */
+
+    if (sim->busHz != 0)
+    {
+        bits = (uint32_t)bytes * DS1307_SIM_BITS_PER_BYTE + (uint32_t)(starts + 1) * DS1307_SIM_BITS_START_STOP;
+        DS1307_Sim_Advance(sim, ((uint64_t)bits * DS1307_SIM_US_PER_SEC + sim->busHz - 1) / sim->busHz);
+    }
+}
+
+/**
+ * @brief Reads consecutive registers of the model.
+ * The time registers are latched when the transfer starts; the register pointer then
+ * auto-increments and wraps from 0x3F to 0x00.
+ * @param[in] bus Pointer to the DS1307_Sim_t model.
+ * @param[in] devAddr Slave address.
+ * @param[in] regAdd Address of the first register to read.
+ * @param[out] data Buffer receiving the register contents.
+ * @param[in] len Number of registers to read.
+ * @param[in] timeout Unused: the model never stretches the clock.
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_ERROR if the address is not
+ *         acknowledged.
+ */
+static DS1307_Status_t DS1307_Sim_ReadRegs(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    DS1307_Sim_t *sim = (DS1307_Sim_t *)bus; /**< Model state. */
+    uint8_t latch[D_DS1307_REG_CTRL];        /**< Secondary buffer of the time registers. */
+    uint8_t i;                               /**< Byte index. */
+
+    (void)timeout;
+
+    if (devAddr != sim->addr)
+    {
+        return DS1307_ERROR;
+    }
+
+    DS1307_Sim_Sync(sim);
+    for (i = 0; i < D_DS1307_REG_CTRL; i++)
+    {
+        latch[i] = sim->reg[i];
+    }
+
+    sim->pointer = regAdd & (DS1307_MAX_BUFF_SIZE - 1);
+    for (i = 0; i < len; i++)
+    {
+        data[i] = (sim->pointer < D_DS1307_REG_CTRL) ? latch[sim->pointer] : sim->reg[sim->pointer];
+        sim->pointer = (uint8_t)((sim->pointer + 1) & (DS1307_MAX_BUFF_SIZE - 1));
+    }
+
+    /* Address and pointer write, then address and data after the repeated start */
+    DS1307_Sim_Bus(sim, (uint16_t)(len + 3), 2);
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Writes consecutive registers of the model.
+ * The register pointer auto-increments and wraps from 0x3F to 0x00. Writing the seconds
+ * register resets the countdown chain.
+ * @param[in] bus Pointer to the DS1307_Sim_t model.
+ * @param[in] devAddr Slave address.
+ * @param[in] regAdd Address of the first register to write.
+ * @param[in] data Buffer holding the bytes to write.
+ * @param[in] len Number of registers to write.
+ * @param[in] timeout Unused: the model never stretches the clock.
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_ERROR if the address is not
+ *         acknowledged.
+ */
+static DS1307_Status_t DS1307_Sim_WriteRegs(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    DS1307_Sim_t *sim = (DS1307_Sim_t *)bus; /**< Model state. */
+    uint8_t i;                               /**< Byte index. */
+
+    (void)timeout;
+
+    if (devAddr != sim->addr)
+    {
+        return DS1307_ERROR;
+    }
+
+    DS1307_Sim_Sync(sim);
+
+    sim->pointer = regAdd & (DS1307_MAX_BUFF_SIZE - 1);
+    for (i = 0; i < len; i++)
+    {
+        if (sim->pointer <= D_DS1307_REG_CTRL)
+        {
+            sim->reg[sim->pointer] = data[i] & DS1307_Sim_WriteMask[sim->pointer];
+            if (sim->pointer == D_DS1307_REG_SEC)
+            {
+                sim->phaseUs = 0;
+            }
+        }
+        else
+        {
+            sim->reg[sim->pointer] = data[i];
+        }
+        sim->pointer = (uint8_t)((sim->pointer + 1) & (DS1307_MAX_BUFF_SIZE - 1));
+    }
+
+    /* Address, pointer and data */
+    DS1307_Sim_Bus(sim, (uint16_t)(len + 2), 1);
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Checks that the model acknowledges an address.
+ * @param[in] bus Pointer to the DS1307_Sim_t model.
+ * @param[in] devAddr Slave address.
+ * @param[in] timeout Unused.
+ * @return DS1307_Status_t Returns DS1307_OK if devAddr is the model's address,
+ *         DS1307_ERROR otherwise.
+ */
+static DS1307_Status_t DS1307_Sim_Probe(void *bus, uint8_t devAddr, uint32_t timeout)
+{
+    DS1307_Sim_t *sim = (DS1307_Sim_t *)bus; /**< Model state. */
+
+    (void)timeout;
+
+    if (devAddr != sim->addr)
+    {
+        return DS1307_ERROR;
+    }
+
+    DS1307_Sim_Sync(sim);
+    DS1307_Sim_Bus(sim, 1, 1);
+
+    return DS1307_OK;
+}
+
+/**
+ * @brief Runs a register read and reports its completion at once.
+ * @param[in] bus Pointer to the DS1307_Sim_t model.
+ * @param[in] devAddr Slave address.
+ * @param[in] regAdd Address of the first register to read.
+ * @param[out] data Buffer receiving the register contents.
+ * @param[in] len Number of registers to read.
+ * @param[in,out] dev Device handle passed to DS1307_AsyncComplete().
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_ERROR if the address is not
+ *         acknowledged (no completion is reported).
+ */
+static DS1307_Status_t DS1307_Sim_ReadRegsAsync(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, DS1307_Handle_t *dev)
+{
+    DS1307_Status_t status = DS1307_Sim_ReadRegs(bus, devAddr, regAdd, data, len, 0); /**< Status of the transfer. */
+
+    if (status == DS1307_OK)
+    {
+        DS1307_AsyncComplete(dev, status);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Runs a register write and reports its completion at once.
+ * @param[in] bus Pointer to the DS1307_Sim_t model.
+ * @param[in] devAddr Slave address.
+ * @param[in] regAdd Address of the first register to write.
+ * @param[in] data Buffer holding the bytes to write.
+ * @param[in] len Number of registers to write.
+ * @param[in,out] dev Device handle passed to DS1307_AsyncComplete().
+ * @return DS1307_Status_t Returns DS1307_OK, or DS1307_ERROR if the address is not
+ *         acknowledged (no completion is reported).
+ */
+static DS1307_Status_t DS1307_Sim_WriteRegsAsync(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, DS1307_Handle_t *dev)
+{
+    DS1307_Status_t status = DS1307_Sim_WriteRegs(bus, devAddr, regAdd, data, len, 0); /**< Status of the transfer. */
+
+    if (status == DS1307_OK)
+    {
+        DS1307_AsyncComplete(dev, status);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Transport operations backed by the DS1307 model.
+ */
+const DS1307_Transport_t DS1307_Transport_Sim =
+{
+    DS1307_Sim_ReadRegs,
+    DS1307_Sim_WriteRegs,
+    DS1307_Sim_Probe,
+    DS1307_Sim_ReadRegsAsync,
+    DS1307_Sim_WriteRegsAsync,
+};
+
+/**
+ * @brief Puts the model in its power-on state.
+ * Time reads 2000-01-01 00:00:00 with CH set, the control register holds 0x03, the RAM
+ * holds arbitrary bytes, the slave address is D_DS1307_ADDR and virtual time is manual
+ * with instantaneous transfers.
+ * @param[out] sim Pointer to the model state.
+ */
+void DS1307_Sim_Init(DS1307_Sim_t *sim)
+{
+    uint32_t noise = 0x2545F491u; /**< Xorshift state filling the RAM. */
+    uint8_t i;                    /**< Register index. */
+
+    sim->reg[D_DS1307_REG_SEC] = 1 << D_DS1307_BIT_CH;
+    sim->reg[D_DS1307_REG_MIN] = 0x00;
+    sim->reg[D_DS1307_REG_HRS] = 0x00;
+    sim->reg[D_DS1307_REG_DAY] = 0x01;
+    sim->reg[D_DS1307_REG_DATE] = 0x01;
+    sim->reg[D_DS1307_REG_MONTH] = 0x01;
+    sim->reg[D_DS1307_REG_YEAR] = 0x00;
+    sim->reg[D_DS1307_REG_CTRL] = (1 << D_DS1307_BIT_RS1) | (1 << D_DS1307_BIT_RS0);
+    for (i = D_DS1307_REG_RAM01; i < DS1307_MAX_BUFF_SIZE; i++)
+    {
+        noise ^= noise << 13;
+        noise ^= noise >> 17;
+        noise ^= noise << 5;
+        sim->reg[i] = (uint8_t)noise;
+    }
+
+    sim->pointer = 0;
+    sim->addr = D_DS1307_ADDR;
+    sim->nowUs = 0;
+    sim->phaseUs = 0;
+    sim->busHz = 0;
+    sim->host = NULL;
+    sim->hostLast = 0;
+    sim->scale = 1;
+    sim->onEdge = NULL;
+    sim->edgeCtx = NULL;
+}
+
+/**
+ * @brief Advances virtual time.
+ * Unless CH is set, the time registers count every elapsed second, calling onEdge at each
+ * 1 Hz falling edge.
+ * @param[in,out] sim Pointer to the model state.
+ * @param[in] us Microseconds to advance.
+ */
+void DS1307_Sim_Advance(DS1307_Sim_t *sim, uint64_t us)
+{
+    uint64_t step; /**< Microseconds up to the next second boundary, or what is left. */
+
+    while (us > 0)
+    {
+        if (sim->reg[D_DS1307_REG_SEC] & (1 << D_DS1307_BIT_CH))
+        {
+            sim->nowUs += us; /**< Oscillator halted: the counting chain does not move. */
+            return;
+        }
+
+        step = DS1307_SIM_US_PER_SEC - sim->phaseUs;
+        if (us < step)
+        {
+            sim->phaseUs += (uint32_t)us;
+            sim->nowUs += us;
+            return;
+        }
+
+        us -= step;
+        sim->nowUs += step;
+        sim->phaseUs = 0;
+        DS1307_Sim_Tick(sim->reg);
+
+        if ((sim->onEdge != NULL) && (sim->reg[D_DS1307_REG_CTRL] & (1 << D_DS1307_BIT_SQWE)) &&
+            ((sim->reg[D_DS1307_REG_CTRL] & 0x03) == 0))
+        {
+            sim->onEdge(sim->edgeCtx);
+        }
+    }
+}
+
+/**
+ * @brief Drives virtual time from a host tick source.
+ * Before each transfer, virtual time advances by the host time elapsed since the previous
+ * one, multiplied by scale.
+ * @param[in,out] sim Pointer to the model state.
+ * @param[in] host Tick source of the host (e.g. DS1307_Linux_TickSource()), or NULL to
+ *                 return to manual virtual time. Must outlive the model.
+ * @param[in] scale Virtual microseconds per host microsecond, 1 for real time.
+ */
+void DS1307_Sim_Realtime(DS1307_Sim_t *sim, const DS1307_TickSource_t *host, uint32_t scale)
+{
+    sim->host = host;
+    sim->scale = scale;
+    if (host != NULL)
+    {
+        sim->hostLast = host->Now(host->ctx);
+    }
+}
+
+/**
+ * @brief Returns the level of the SQW/OUT pin at the current virtual time.
+ * With SQWE clear the pin follows OUT. With SQWE set it is a square wave at the rate
+ * selected by RS1-RS0, low for the first half of each period; it is held low while CH is
+ * set.
+ * @param[in] sim Pointer to the model state.
+ * @return uint8_t 1 if the pin is high, 0 if it is low.
+ */
+uint8_t DS1307_Sim_SqwLevel(const DS1307_Sim_t *sim)
+{
+    static const uint16_t rateHz[4] = { 1u, 4096u, 8192u, 32768u }; /**< Square wave rate indexed by RS1-RS0. */
+    uint8_t ctrl = sim->reg[D_DS1307_REG_CTRL];                     /**< Control register. */
+    uint64_t halfPeriods;                                           /**< Half periods since the last second boundary. */
+
+    if (!(ctrl & (1 << D_DS1307_BIT_SQWE)))
+    {
+        return (ctrl >> D_DS1307_BIT_OUT) & 1;
+    }
+    if (sim->reg[D_DS1307_REG_SEC] & (1 << D_DS1307_BIT_CH))
+    {
+        return 0;
+    }
+
+    /* Every rate divides the crystal frequency, so each second starts on a falling edge */
+    halfPeriods = (uint64_t)sim->phaseUs * 2u * rateHz[ctrl & 0x03] / DS1307_SIM_US_PER_SEC;
+
+    return (uint8_t)(halfPeriods & 1);
+}
+
+/**
+ * @brief Reads virtual time in microseconds, truncated to 32 bits.
+ * @param[in] ctx Pointer to the DS1307_Sim_t model.
+ * @return uint32_t Virtual time in microseconds modulo 2^32.
+ */
+static uint32_t DS1307_Sim_Micros(void *ctx)
+{
+    return (uint32_t)((const DS1307_Sim_t *)ctx)->nowUs;
+}
+
+/**
+ * @brief Fills a tick source that reads virtual time, in microseconds.
+ * Lets the sub-second interpolator and other timing code run on the simulated time base.
+ * @param[in] sim Pointer to the model state, which must outlive the tick source.
+ * @param[out] src Pointer to the tick source to fill.
+ */
+void DS1307_Sim_TickSource(DS1307_Sim_t *sim, DS1307_TickSource_t *src)
+{
+    src->Now = DS1307_Sim_Micros;
+    src->ctx = sim;
+    src->hz = DS1307_SIM_US_PER_SEC;
+}
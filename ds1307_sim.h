@@ -0,0 +1,126 @@
+/**
+ * @file ds1307_sim.h
+ * @brief Behavioural DS1307 model as a host-side transport backend.
+ *
+ * This backend implements DS1307_Transport_t on a software model of the chip, so the
+ * whole driver can run, be tested and be profiled without hardware. The model covers:
+ * - the 64-byte register file, with the bits the datasheet shows as 0 reading back as 0;
+ * - the register pointer, auto-incremented after every byte and wrapping from 0x3F to 0x00;
+ * - the secondary buffer: the time registers are latched at the start of each read, so a
+ *   burst read is a consistent snapshot while the clock keeps running;
+ * - the oscillator: CH stops the clock, and a write to the seconds register resets the
+ *   countdown chain;
+ * - BCD time keeping in 12-hour and 24-hour mode, with month lengths and the leap years
+ *   of 2000-2099 (every year divisible by 4), rolling from 99 to 00;
+ * - the control register and the SQW/OUT level (OUT, SQWE, RS1-RS0);
+ * - the power-on state: 2000-01-01 00:00:00, day 1, with CH set, control 0x03 and
+ *   arbitrary RAM contents.
+ *
+ * Time is virtual. It only moves when DS1307_Sim_Advance() is called, when a transfer
+ * takes its bus time (with busHz set), or, after DS1307_Sim_Realtime(), at a multiple of a
+ * host tick source. Years of RTC time can thus be simulated in seconds. The seconds tick
+ * on the falling edge of the 1 Hz square wave; onEdge is called at each of these edges
+ * when SQW/OUT is programmed for 1 Hz, in place of the EXTI interrupt. Code that polls the
+ * device until time passes, such as DS1307_SubSec_Align(), needs busHz or a host tick
+ * source: with neither, virtual time stands still.
+ *
+ * The asynchronous operations complete before returning, as if the transfer-complete
+ * interrupt fired at once.
+ *
+ * @details
+ * Usage:
+ * @code
+ * DS1307_Sim_t sim;
+ * DS1307_Handle_t rtc;
+ * DS1307_Sim_Init(&sim);
+ * sim.busHz = 100000u; // Charge each transfer its 100 kHz bus time
+ * DS1307_InitTransport(&rtc, &DS1307_Transport_Sim, &sim, _1Hz, NULL);
+ * DS1307_WriteEpoch(&rtc, 1700000000u);
+ * DS1307_Sim_Advance(&sim, 86400ull * 1000000u); // One day later
+ * @endcode
+ */
+
+#ifndef _INC_DS1307_SIM_H_
+#define _INC_DS1307_SIM_H_
+
+/* Include Files */
+#include "ds1307.h"
+
+/**
+ * @brief Callback invoked by the model at each falling edge of the 1 Hz square wave.
+ * @param[in] ctx Context pointer given in DS1307_Sim_t.
+ */
+typedef void (*DS1307_Sim_EdgeCallback_t)(void *ctx);
+
+/**
+ * @brief State of the simulated DS1307, used as the bus context of DS1307_Transport_Sim.
+ */
+typedef struct
+{
+    uint8_t reg[DS1307_MAX_BUFF_SIZE];    /**< Register file 0x00-0x3F. */
+    uint8_t pointer;                      /**< Register pointer. */
+    uint8_t addr;                         /**< Slave address the model acknowledges. */
+    uint64_t nowUs;                       /**< Virtual time since DS1307_Sim_Init(), in microseconds. */
+    uint32_t phaseUs;                     /**< Time since the last seconds increment, in microseconds. */
+    uint32_t busHz;                       /**< SCL frequency charged for each transfer, 0 for instantaneous transfers. */
+    const DS1307_TickSource_t *host;      /**< Host tick source driving virtual time, NULL if virtual time is manual. */
+    uint32_t hostLast;                    /**< Host counter value at the last update. */
+    uint32_t scale;                       /**< Virtual microseconds per host microsecond. */
+    DS1307_Sim_EdgeCallback_t onEdge;     /**< Called at each 1 Hz falling edge, or NULL. */
+    void *edgeCtx;                        /**< Context pointer passed to onEdge. */
+} DS1307_Sim_t;
+
+/**
+ * @brief Transport operations backed by the DS1307 model.
+ * The bus context is a DS1307_Sim_t pointer initialized with DS1307_Sim_Init().
+ */
+extern const DS1307_Transport_t DS1307_Transport_Sim;
+
+/**
+ * @brief Puts the model in its power-on state.
+ * Time reads 2000-01-01 00:00:00 with CH set, the control register holds 0x03, the RAM
+ * holds arbitrary bytes, the slave address is D_DS1307_ADDR and virtual time is manual
+ * with instantaneous transfers.
+ * @param[out] sim Pointer to the model state.
+ */
+void DS1307_Sim_Init(DS1307_Sim_t *sim);
+
+/**
+ * @brief Advances virtual time.
+ * Unless CH is set, the time registers count every elapsed second, calling onEdge at each
+ * 1 Hz falling edge.
+ * @param[in,out] sim Pointer to the model state.
+ * @param[in] us Microseconds to advance.
+ */
+void DS1307_Sim_Advance(DS1307_Sim_t *sim, uint64_t us);
+
+/**
+ * @brief Drives virtual time from a host tick source.
+ * Before each transfer, virtual time advances by the host time elapsed since the previous
+ * one, multiplied by scale.
+ * @param[in,out] sim Pointer to the model state.
+ * @param[in] host Tick source of the host (e.g. DS1307_Linux_TickSource()), or NULL to
+ *                 return to manual virtual time. Must outlive the model.
+ * @param[in] scale Virtual microseconds per host microsecond, 1 for real time.
+ */
+void DS1307_Sim_Realtime(DS1307_Sim_t *sim, const DS1307_TickSource_t *host, uint32_t scale);
+
+/**
+ * @brief Returns the level of the SQW/OUT pin at the current virtual time.
+ * With SQWE clear the pin follows OUT. With SQWE set it is a square wave at the rate
+ * selected by RS1-RS0, low for the first half of each period; it is held low while CH is
+ * set.
+ * @param[in] sim Pointer to the model state.
+ * @return uint8_t 1 if the pin is high, 0 if it is low.
+ */
+uint8_t DS1307_Sim_SqwLevel(const DS1307_Sim_t *sim);
+
+/**
+ * @brief Fills a tick source that reads virtual time, in microseconds.
+ * Lets the sub-second interpolator and other timing code run on the simulated time base.
+ * @param[in] sim Pointer to the model state, which must outlive the tick source.
+ * @param[out] src Pointer to the tick source to fill.
+ */
+void DS1307_Sim_TickSource(DS1307_Sim_t *sim, DS1307_TickSource_t *src);
+
+#endif /* _INC_DS1307_SIM_H_ */
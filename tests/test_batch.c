@@ -0,0 +1,322 @@
+/**
+ * @file test_batch.c
+ * @brief Host test and benchmark of the batch snapshot decoder.
+ *
+ * Runs every kernel the CPU supports over the same mix of well-formed and random
+ * snapshots and checks that:
+ * - all kernels give bit-identical epoch, field and validity outputs, for every array
+ *   length up to a few vectors (tail handling) and for a large array;
+ * - a snapshot is flagged valid exactly when an independent field check accepts it;
+ * - the epoch of every valid snapshot equals timegm() of its decoded fields.
+ * It then prints the decoding time per snapshot of each kernel.
+ *
+ * Build and run from the repository root:
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_batch tests/test_batch.c ds1307_batch.c ds1307.c
+ * ./test_batch > /dev/null
+ * @endcode
+ */
+
+#define _GNU_SOURCE
+#include "ds1307_batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_SNAPSHOTS  1000003u  /**< Snapshots in the large array, deliberately not a multiple of 4. */
+#define TAIL_MAX        17u       /**< Longest short array checked for tail handling. */
+#define BENCH_PASSES    20u       /**< Benchmark passes over the large array. */
+#define KERNELS         3u        /**< Scalar, SSE2 and AVX2. */
+
+static unsigned failures = 0; /**< Failed checks. */
+static uint32_t seed = 7u;    /**< Generator state. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+/**
+ * @brief Outputs of one kernel run.
+ */
+typedef struct
+{
+    uint32_t *epoch;
+    uint8_t *fields[7];
+    uint8_t *valid;
+    size_t good;
+} Run_t;
+
+static const DS1307_Batch_Kernel_t kernels[KERNELS] = {DS1307_BATCH_SCALAR, DS1307_BATCH_SSE2, DS1307_BATCH_AVX2};
+static const char *names[KERNELS] = {"scalar", "sse2", "avx2"};
+
+/**
+ * @brief Returns a pseudo-random number in [0, n).
+ */
+static uint32_t Rand(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+static uint8_t Bcd(uint32_t v)
+{
+    return (uint8_t)(((v / 10) << 4) | (v % 10));
+}
+
+/**
+ * @brief Fills a snapshot: one in four is random bytes, the rest have in-range digits
+ *        with the date drawn from 1-31 whatever the month, so some are invalid dates.
+ */
+static void Random_Snapshot(DS1307_Snapshot_t *s)
+{
+    uint8_t *r = s->reg;
+    uint8_t i;
+
+    if (Rand(4) == 0)
+    {
+        for (i = 0; i < 7; i++)
+        {
+            r[i] = (uint8_t)Rand(256);
+        }
+        return;
+    }
+    r[D_DS1307_REG_SEC] = (uint8_t)(Bcd(Rand(60)) | (Rand(2) << D_DS1307_BIT_CH));
+    r[D_DS1307_REG_MIN] = Bcd(Rand(60));
+    if (Rand(2))
+    {
+        r[D_DS1307_REG_HRS] = (uint8_t)((1 << D_DS1307_BIT_HRS) | (Rand(2) << D_DS1307_BIT_AMPM) | Bcd(1 + Rand(12)));
+    }
+    else
+    {
+        r[D_DS1307_REG_HRS] = Bcd(Rand(24));
+    }
+    r[D_DS1307_REG_DAY] = (uint8_t)(1 + Rand(7));
+    r[D_DS1307_REG_DATE] = Bcd(1 + Rand(31));
+    r[D_DS1307_REG_MONTH] = Bcd(1 + Rand(12));
+    r[D_DS1307_REG_YEAR] = Bcd(Rand(100));
+}
+
+/**
+ * @brief Decodes one BCD field, or returns -1 if a digit is not decimal.
+ */
+static int Field(uint8_t bcd)
+{
+    if ((bcd & 0x0F) > 9 || (bcd >> 4) > 9)
+    {
+        return -1;
+    }
+    return (bcd >> 4) * 10 + (bcd & 0x0F);
+}
+
+/**
+ * @brief Independent validity check of a snapshot, written from the datasheet. Bits
+ *        outside each register's value field are ignored, as the driver's masks do.
+ */
+static int Ref_Valid(const DS1307_Snapshot_t *s)
+{
+    static const uint8_t days[13] = {0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    const uint8_t *r = s->reg;
+    int sec = Field(r[D_DS1307_REG_SEC] & 0x7F);
+    int min = Field(r[D_DS1307_REG_MIN] & 0x7F);
+    int day = Field(r[D_DS1307_REG_DAY] & 0x07);
+    int date = Field(r[D_DS1307_REG_DATE] & 0x3F);
+    int month = Field(r[D_DS1307_REG_MONTH] & 0x1F);
+    int year = Field(r[D_DS1307_REG_YEAR]);
+    int hour;
+
+    if (r[D_DS1307_REG_HRS] & (1 << D_DS1307_BIT_HRS))
+    {
+        hour = Field(r[D_DS1307_REG_HRS] & 0x1F);
+        if (hour < 1 || hour > 12)
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        hour = Field(r[D_DS1307_REG_HRS] & 0x3F);
+        if (hour < 0 || hour > 23)
+        {
+            return 0;
+        }
+    }
+    if (sec < 0 || sec > 59 || min < 0 || min > 59 || day < 1 || day > 7 || month < 1 || month > 12 ||
+        year < 0 || date < 1)
+    {
+        return 0;
+    }
+    if (date > days[month] || (month == 2 && date == 29 && (year % 4) != 0))
+    {
+        return 0;
+    }
+    return 1;
+}
+
+static void Run_Alloc(Run_t *run, size_t n)
+{
+    uint8_t i;
+
+    run->epoch = malloc(n * sizeof(uint32_t));
+    run->valid = malloc(n);
+    for (i = 0; i < 7; i++)
+    {
+        run->fields[i] = malloc(n);
+    }
+}
+
+static void Run_Decode(Run_t *run, const DS1307_Snapshot_t *s, size_t n)
+{
+    DS1307_Batch_Fields_t out;
+    uint8_t i;
+
+    memset(run->epoch, 0xA5, n * sizeof(uint32_t));
+    memset(run->valid, 0xA5, n);
+    for (i = 0; i < 7; i++)
+    {
+        memset(run->fields[i], 0xA5, n);
+    }
+    out.epoch = run->epoch;
+    out.sec = run->fields[0];
+    out.min = run->fields[1];
+    out.hour = run->fields[2];
+    out.day = run->fields[3];
+    out.date = run->fields[4];
+    out.month = run->fields[5];
+    out.year = run->fields[6];
+    run->good = DS1307_Batch_ToFields(s, n, &out, run->valid);
+}
+
+static int Run_Same(const Run_t *a, const Run_t *b, size_t n)
+{
+    uint8_t i;
+
+    if (a->good != b->good || memcmp(a->epoch, b->epoch, n * sizeof(uint32_t)) || memcmp(a->valid, b->valid, n))
+    {
+        return 0;
+    }
+    for (i = 0; i < 7; i++)
+    {
+        if (memcmp(a->fields[i], b->fields[i], n))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static double Now_Ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+int main(void)
+{
+    static Run_t run[KERNELS];
+    DS1307_Snapshot_t *snaps = malloc(TEST_SNAPSHOTS * sizeof(*snaps));
+    uint8_t available[KERNELS];
+    size_t n, i, good = 0, mismatch = 0;
+    unsigned k, p;
+
+    for (i = 0; i < TEST_SNAPSHOTS; i++)
+    {
+        Random_Snapshot(&snaps[i]);
+    }
+    for (k = 0; k < KERNELS; k++)
+    {
+        available[k] = DS1307_Batch_SelectKernel(kernels[k]) == kernels[k];
+        Run_Alloc(&run[k], TEST_SNAPSHOTS);
+        fprintf(stderr, "%-6s %s\n", names[k], available[k] ? "available" : "not available, skipped");
+    }
+
+    /* Short arrays at every offset: exercises the scalar tails of the vector kernels */
+    for (n = 0; n <= TAIL_MAX; n++)
+    {
+        for (i = 0; i + n <= 64; i++)
+        {
+            for (k = 0; k < KERNELS; k++)
+            {
+                if (available[k])
+                {
+                    DS1307_Batch_SelectKernel(kernels[k]);
+                    Run_Decode(&run[k], snaps + i, n);
+                    CHECK(k == 0 || Run_Same(&run[0], &run[k], n));
+                }
+            }
+        }
+    }
+
+    /* Large array: kernels identical, validity and epoch against independent references */
+    for (k = 0; k < KERNELS; k++)
+    {
+        if (available[k])
+        {
+            DS1307_Batch_SelectKernel(kernels[k]);
+            Run_Decode(&run[k], snaps, TEST_SNAPSHOTS);
+            CHECK(k == 0 || Run_Same(&run[0], &run[k], TEST_SNAPSHOTS));
+        }
+    }
+    for (i = 0; i < TEST_SNAPSHOTS; i++)
+    {
+        int valid = Ref_Valid(&snaps[i]);
+
+        if (valid != run[0].valid[i])
+        {
+            mismatch++;
+        }
+        else if (valid)
+        {
+            struct tm tm;
+
+            memset(&tm, 0, sizeof(tm));
+            tm.tm_year = 100 + run[0].fields[6][i];
+            tm.tm_mon = run[0].fields[5][i] - 1;
+            tm.tm_mday = run[0].fields[4][i];
+            tm.tm_hour = run[0].fields[2][i];
+            tm.tm_min = run[0].fields[1][i];
+            tm.tm_sec = run[0].fields[0][i];
+            if ((uint32_t)timegm(&tm) != run[0].epoch[i])
+            {
+                mismatch++;
+            }
+            good++;
+        }
+        else if (run[0].epoch[i] != 0)
+        {
+            mismatch++;
+        }
+    }
+    CHECK(mismatch == 0);
+    CHECK(good == run[0].good);
+    fprintf(stderr, "%zu of %u snapshots valid, %zu mismatches against the references\n",
+            good, TEST_SNAPSHOTS, mismatch);
+
+    for (k = 0; k < KERNELS; k++)
+    {
+        double t0;
+
+        if (!available[k])
+        {
+            continue;
+        }
+        DS1307_Batch_SelectKernel(kernels[k]);
+        t0 = Now_Ns();
+        for (p = 0; p < BENCH_PASSES; p++)
+        {
+            DS1307_Batch_ToEpoch(snaps, TEST_SNAPSHOTS, run[k].epoch, run[k].valid);
+        }
+        fprintf(stderr, "%-6s %.2f ns/snapshot\n", names[k], (Now_Ns() - t0) / ((double)BENCH_PASSES * TEST_SNAPSHOTS));
+    }
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
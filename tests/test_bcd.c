@@ -0,0 +1,175 @@
+/**
+ * @file test_bcd.c
+ * @brief Host test and micro-benchmark of the BCD conversion layer.
+ *
+ * Checks DS1307_BCD_to_Bin() and DS1307_Bin_to_BCD() over every value 0-99, the masking
+ * of the CH, 12/24-hour and AM/PM bits by the register decoders, and times the
+ * conversions against the divide/modulo routine they replaced.
+ *
+ * The static converters are reached by including ds1307.c directly. Build and run from
+ * the repository root (the driver's debug output goes to stdout, results to stderr):
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_bcd tests/test_bcd.c
+ * ./test_bcd > /dev/null
+ * @endcode
+ */
+
+#include "../ds1307.c"
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_VALUES    4096u   /**< Values per benchmark pass. */
+#define BENCH_PASSES    20000u  /**< Benchmark passes. */
+
+static unsigned failures = 0; /**< Failed checks. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+/**
+ * @brief Binary to BCD conversion of the original driver: one divide and one modulo.
+ */
+static uint8_t Old_Bin_to_BCD(uint8_t bin)
+{
+    return (uint8_t)(((bin / 10) << 4) | (bin % 10));
+}
+
+/**
+ * @brief BCD to binary conversion with a multiply, the textbook reference.
+ */
+static uint8_t Ref_BCD_to_Bin(uint8_t bcd)
+{
+    return (uint8_t)((bcd >> 4) * 10 + (bcd & 0x0F));
+}
+
+/**
+ * @brief Monotonic time in nanoseconds.
+ */
+static double Now_Ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief Checks both converters over their whole domain.
+ */
+static void Test_Exhaustive(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < 100; i++)
+    {
+        CHECK(DS1307_Bin_to_BCD(i) == Old_Bin_to_BCD(i));
+        CHECK(DS1307_BCD_to_Bin(Old_Bin_to_BCD(i)) == i);
+    }
+}
+
+/**
+ * @brief Checks that control bits never leak into decoded fields.
+ */
+static void Test_Masking(void)
+{
+    uint8_t raw[7] = {0x80 | 0x59, 0x59, 0x23, 0x07, 0x31, 0x12, 0x99};
+    DS1307_DateTime_t dt;
+    uint8_t hour;
+
+    /* CH set: seconds must still read 59 */
+    DS1307_Raw_to_DateTime(raw, &dt, 0);
+    CHECK(dt.time.Sec == 59 && dt.time.Min == 59 && dt.time.Hour == 23);
+    CHECK(dt.date.Day == 7 && dt.date.Date == 31 && dt.date.Month == 12 && dt.date.Year == 99);
+    DS1307_Raw_to_DateTime(raw, &dt, 1);
+    CHECK(dt.time.Sec == 0x59);
+
+    /* Every hour encoded in 12-hour mode decodes to the 24-hour value */
+    for (hour = 0; hour < 24; hour++)
+    {
+        uint8_t h12 = (uint8_t)((hour % 12) ? (hour % 12) : 12);
+
+        raw[D_DS1307_REG_HRS] = (uint8_t)((1 << D_DS1307_BIT_HRS) | Old_Bin_to_BCD(h12));
+        if (hour >= 12)
+        {
+            raw[D_DS1307_REG_HRS] |= (uint8_t)(1 << D_DS1307_BIT_AMPM);
+        }
+        DS1307_Raw_to_DateTime(raw, &dt, 0);
+        CHECK(dt.time.Hour == hour);
+
+        raw[D_DS1307_REG_HRS] = Old_Bin_to_BCD(hour);
+        DS1307_Raw_to_DateTime(raw, &dt, 0);
+        CHECK(dt.time.Hour == hour);
+    }
+}
+
+/**
+ * @brief Times old and new conversions and prints nanoseconds per field.
+ */
+static void Bench(void)
+{
+    static uint8_t bin[BENCH_VALUES];
+    static uint8_t bcd[BENCH_VALUES];
+    volatile uint32_t sink = 0;
+    uint32_t acc;
+    uint32_t seed = 12345u;
+    double t0, tOld, tNew, tRef, tDec;
+    unsigned i, p;
+
+    for (i = 0; i < BENCH_VALUES; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        bin[i] = (uint8_t)((seed >> 16) % 100u);
+        bcd[i] = Old_Bin_to_BCD(bin[i]);
+    }
+
+    t0 = Now_Ns();
+    for (p = 0, acc = 0; p < BENCH_PASSES; p++)
+        for (i = 0; i < BENCH_VALUES; i++)
+            acc += Old_Bin_to_BCD((uint8_t)(bin[i] ^ (p & 1)));
+    sink += acc;
+    tOld = Now_Ns() - t0;
+
+    t0 = Now_Ns();
+    for (p = 0, acc = 0; p < BENCH_PASSES; p++)
+        for (i = 0; i < BENCH_VALUES; i++)
+            acc += DS1307_Bin_to_BCD((uint8_t)(bin[i] ^ (p & 1)));
+    sink += acc;
+    tNew = Now_Ns() - t0;
+
+    t0 = Now_Ns();
+    for (p = 0, acc = 0; p < BENCH_PASSES; p++)
+        for (i = 0; i < BENCH_VALUES; i++)
+            acc += Ref_BCD_to_Bin((uint8_t)(bcd[i] ^ (p & 1)));
+    sink += acc;
+    tRef = Now_Ns() - t0;
+
+    t0 = Now_Ns();
+    for (p = 0, acc = 0; p < BENCH_PASSES; p++)
+        for (i = 0; i < BENCH_VALUES; i++)
+            acc += DS1307_BCD_to_Bin((uint8_t)(bcd[i] ^ (p & 1)));
+    sink += acc;
+    tDec = Now_Ns() - t0;
+
+    fprintf(stderr, "bin->bcd  divide/modulo %.3f ns/field, shift/add %.3f ns/field\n",
+            tOld / ((double)BENCH_PASSES * BENCH_VALUES), tNew / ((double)BENCH_PASSES * BENCH_VALUES));
+    fprintf(stderr, "bcd->bin  multiply      %.3f ns/field, shift/sub %.3f ns/field\n",
+            tRef / ((double)BENCH_PASSES * BENCH_VALUES), tDec / ((double)BENCH_PASSES * BENCH_VALUES));
+    (void)sink;
+}
+
+int main(void)
+{
+    Test_Exhaustive();
+    Test_Masking();
+    Bench();
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
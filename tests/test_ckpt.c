@@ -0,0 +1,243 @@
+/**
+ * @file test_ckpt.c
+ * @brief Host power-cut test and commit-latency benchmark of the NVRAM checkpoints.
+ *
+ * - Cuts the power after every byte of every commit, for several payload sizes and
+ *   sequence generations, then reboots and checks that recovery returns the new payload
+ *   or the previous one, the new one whenever the commit reported success, and that the
+ *   next commit after the reboot is recovered.
+ * - Runs commits through the fault transport with NACKs injected and checks the same
+ *   invariant after every commit.
+ * - Prints the bus time of a commit at 100 kHz and 400 kHz, taken from the simulator's
+ *   virtual clock, and the host time of a commit with instantaneous transfers.
+ *
+ * Build and run from the repository root (the driver's debug output goes to stdout,
+ * results to stderr):
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_ckpt tests/test_ckpt.c ds1307_ckpt.c ds1307_sim.c ds1307_fault.c ds1307.c
+ * ./test_ckpt > /dev/null
+ * @endcode
+ */
+
+#include "ds1307_ckpt.h"
+#include "ds1307_fault.h"
+#include "tests/torn.h"
+#include <stdio.h>
+#include <time.h>
+
+#define TEAR_GENERATIONS    40u     /**< Commits torn at every byte, per payload size. */
+#define FAULT_COMMITS       5000u   /**< Commits run through the fault transport. */
+#define BENCH_COMMITS       200u    /**< Commits timed per configuration. */
+
+static unsigned failures = 0; /**< Failed checks. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+static const uint8_t sizes[] = {1, 7, 16, DS1307_CKPT_MAX_PAYLOAD}; /**< Payload sizes tested. */
+
+/**
+ * @brief Fills the payload of a generation; every generation differs in every byte.
+ */
+static void Payload(uint8_t *p, uint8_t size, uint32_t gen)
+{
+    uint8_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        p[i] = (uint8_t)(gen * 37u + i * 11u + 1u);
+    }
+}
+
+static double Now_Ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief Tears every commit at every byte and checks what a reboot recovers.
+ */
+static void Test_Tear(void)
+{
+    static Torn_t torn, saved;
+    DS1307_Handle_t rtc;
+    DS1307_Ckpt_t ckpt;
+    uint8_t prev[DS1307_CKPT_MAX_PAYLOAD], next[DS1307_CKPT_MAX_PAYLOAD], got[DS1307_CKPT_MAX_PAYLOAD];
+    unsigned long cases = 0, bad = 0;
+    uint32_t gen;
+    long cut;
+    uint8_t s;
+
+    for (s = 0; s < sizeof(sizes); s++)
+    {
+        uint8_t size = sizes[s];
+        long slot = (long)size + DS1307_CKPT_OVERHEAD;
+
+        Torn_Init(&torn);
+        for (gen = 0; gen < TEAR_GENERATIONS; gen++)
+        {
+            Payload(prev, size, gen - 1u);
+            Payload(next, size, gen);
+            for (cut = 0; cut <= slot; cut++)
+            {
+                DS1307_Status_t status;
+                uint8_t had;
+
+                saved = torn;
+                Torn_Reboot(&torn, &rtc);
+                DS1307_Ckpt_Init(&ckpt, 0, size);
+                had = DS1307_Ckpt_Recover(&rtc, &ckpt, got) == DS1307_OK;
+                Torn_Arm(&torn, cut);
+                status = DS1307_Ckpt_Commit(&rtc, &ckpt, next);
+
+                Torn_Reboot(&torn, &rtc);
+                DS1307_Ckpt_Init(&ckpt, 0, size);
+                cases++;
+                if (DS1307_Ckpt_Recover(&rtc, &ckpt, got) != DS1307_OK)
+                {
+                    bad += (had || status == DS1307_OK);
+                }
+                else if (memcmp(got, next, size) != 0 && (status == DS1307_OK || memcmp(got, prev, size) != 0))
+                {
+                    bad++;
+                }
+                else
+                {
+                    /* The commit after the reboot must land, whatever the torn slot holds */
+                    Payload(got, size, gen + 1000u);
+                    if (DS1307_Ckpt_Commit(&rtc, &ckpt, got) != DS1307_OK ||
+                        (Torn_Reboot(&torn, &rtc), DS1307_Ckpt_Init(&ckpt, 0, size),
+                         DS1307_Ckpt_Recover(&rtc, &ckpt, got)) != DS1307_OK ||
+                        (Payload(next, size, gen + 1000u), memcmp(got, next, size)) != 0)
+                    {
+                        bad++;
+                    }
+                    Payload(next, size, gen);
+                }
+                torn = saved;
+            }
+
+            /* Land this generation for good before tearing the next one */
+            Torn_Reboot(&torn, &rtc);
+            DS1307_Ckpt_Init(&ckpt, 0, size);
+            DS1307_Ckpt_Recover(&rtc, &ckpt, got);
+            CHECK(DS1307_Ckpt_Commit(&rtc, &ckpt, next) == DS1307_OK);
+        }
+    }
+    CHECK(bad == 0);
+    fprintf(stderr, "torn commits: %lu cases, %lu bad recoveries\n", cases, bad);
+}
+
+/**
+ * @brief Commits through the fault transport and checks every outcome after a reboot.
+ */
+static void Test_Fault(void)
+{
+    static DS1307_Sim_t sim;
+    DS1307_Fault_t fault;
+    DS1307_Handle_t rtc;
+    DS1307_Ckpt_t ckpt;
+    uint8_t prev[DS1307_CKPT_MAX_PAYLOAD], next[DS1307_CKPT_MAX_PAYLOAD], got[DS1307_CKPT_MAX_PAYLOAD];
+    uint8_t size = DS1307_CKPT_MAX_PAYLOAD;
+    unsigned long failed = 0, bad = 0;
+    uint32_t gen;
+
+    DS1307_Sim_Init(&sim);
+    DS1307_Fault_Init(&fault, &DS1307_Transport_Sim, &sim, 2024u);
+    DS1307_InitTransport(&rtc, &DS1307_Transport_Fault, &fault, _No_Output_0, NULL);
+    DS1307_Ckpt_Init(&ckpt, 0, size);
+    Payload(prev, size, 0);
+    CHECK(DS1307_Ckpt_Commit(&rtc, &ckpt, prev) == DS1307_OK);
+
+    for (gen = 1; gen <= FAULT_COMMITS; gen++)
+    {
+        DS1307_Status_t status;
+
+        Payload(next, size, gen);
+        fault.rule[DS1307_FAULT_ADDR_NACK].prob = 6554u;
+        fault.rule[DS1307_FAULT_DATA_NACK].prob = 6554u;
+        status = DS1307_Ckpt_Commit(&rtc, &ckpt, next);
+        fault.rule[DS1307_FAULT_ADDR_NACK].prob = 0;
+        fault.rule[DS1307_FAULT_DATA_NACK].prob = 0;
+        failed += (status != DS1307_OK);
+
+        DS1307_InitTransport(&rtc, &DS1307_Transport_Fault, &fault, _No_Output_0, NULL);
+        DS1307_Ckpt_Init(&ckpt, 0, size);
+        if (DS1307_Ckpt_Recover(&rtc, &ckpt, got) != DS1307_OK ||
+            (memcmp(got, next, size) != 0 && (status == DS1307_OK || memcmp(got, prev, size) != 0)))
+        {
+            bad++;
+        }
+        memcpy(prev, got, size);
+    }
+    CHECK(failed > 0);
+    CHECK(bad == 0);
+    fprintf(stderr, "faulty bus: %u commits, %lu failed, %lu bad recoveries\n", FAULT_COMMITS, failed, bad);
+}
+
+/**
+ * @brief Prints the bus time and the host time of one commit.
+ */
+static void Bench(void)
+{
+    static const uint32_t clocks[] = {100000u, 400000u};
+    static DS1307_Sim_t sim;
+    DS1307_Handle_t rtc;
+    DS1307_Ckpt_t ckpt;
+    uint8_t payload[DS1307_CKPT_MAX_PAYLOAD];
+    uint32_t i;
+    uint8_t s, c;
+
+    for (s = 0; s < sizeof(sizes); s++)
+    {
+        double busUs[2], t0;
+
+        for (c = 0; c < 2; c++)
+        {
+            uint64_t start;
+
+            DS1307_Sim_Init(&sim);
+            DS1307_InitTransport(&rtc, &DS1307_Transport_Sim, &sim, _No_Output_0, NULL);
+            DS1307_Ckpt_Init(&ckpt, 0, sizes[s]);
+            DS1307_Ckpt_Recover(&rtc, &ckpt, payload);
+            sim.busHz = clocks[c];
+            start = sim.nowUs;
+            for (i = 0; i < BENCH_COMMITS; i++)
+            {
+                Payload(payload, sizes[s], i);
+                DS1307_Ckpt_Commit(&rtc, &ckpt, payload);
+            }
+            busUs[c] = (double)(sim.nowUs - start) / BENCH_COMMITS;
+        }
+
+        sim.busHz = 0;
+        t0 = Now_Ns();
+        for (i = 0; i < BENCH_COMMITS * 100u; i++)
+        {
+            Payload(payload, sizes[s], i);
+            DS1307_Ckpt_Commit(&rtc, &ckpt, payload);
+        }
+        fprintf(stderr, "commit of %2u bytes: %.0f us at 100 kHz, %.0f us at 400 kHz, %.0f ns host time\n",
+                sizes[s], busUs[0], busUs[1], (Now_Ns() - t0) / (BENCH_COMMITS * 100u));
+    }
+}
+
+int main(void)
+{
+    Test_Tear();
+    Test_Fault();
+    Bench();
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
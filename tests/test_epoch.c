@@ -0,0 +1,144 @@
+/**
+ * @file test_epoch.c
+ * @brief Host test and benchmark of the epoch conversions.
+ *
+ * Round-trips every second from 2000-01-01 00:00:00 to 2099-12-31 23:59:59 through
+ * DS1307_Epoch_to_DateTime() and DS1307_DateTime_to_Epoch(), checks the date and weekday
+ * of every day against gmtime_r(), checks that both ends of the range are rejected one
+ * second outside it, and prints the time of one conversion each way.
+ *
+ * Build and run from the repository root (the driver's debug output goes to stdout,
+ * results to stderr):
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_epoch tests/test_epoch.c ds1307.c
+ * ./test_epoch > /dev/null
+ * @endcode
+ */
+
+#define _GNU_SOURCE
+#include "ds1307.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_STEP      7u          /**< Epoch stride of the benchmark, to vary every field. */
+#define BENCH_SPAN      100000000u  /**< Epoch span covered by the benchmark. */
+#define BENCH_TABLE     4096u       /**< Dates cycled through by the reverse benchmark. */
+
+static unsigned failures = 0; /**< Failed checks. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+static double Now_Ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief Round-trips every second of the range and checks each day against gmtime_r().
+ */
+static void Test_Exhaustive(void)
+{
+    DS1307_DateTime_t dt;
+    unsigned long roundTrip = 0; /**< Seconds that failed the round trip. */
+    unsigned long calendar = 0;  /**< Days that disagree with gmtime_r(). */
+    uint64_t e;
+
+    for (e = DS1307_EPOCH_MIN; e <= DS1307_EPOCH_MAX; e++)
+    {
+        if (DS1307_Epoch_to_DateTime((uint32_t)e, &dt) != DS1307_OK || DS1307_DateTime_to_Epoch(&dt) != e)
+        {
+            roundTrip++;
+        }
+        if ((e % 86400u) == 0)
+        {
+            time_t t = (time_t)e;
+            struct tm tm;
+
+            gmtime_r(&t, &tm);
+            if (tm.tm_year - 100 != dt.date.Year || tm.tm_mon + 1 != dt.date.Month || tm.tm_mday != dt.date.Date ||
+                tm.tm_wday + 1 != dt.date.Day || dt.time.Hour != 0 || dt.time.Min != 0 || dt.time.Sec != 0)
+            {
+                calendar++;
+            }
+        }
+    }
+    CHECK(roundTrip == 0);
+    CHECK(calendar == 0);
+    fprintf(stderr, "%lu seconds round-tripped, %lu failures, %lu calendar mismatches\n",
+            (unsigned long)(DS1307_EPOCH_MAX - DS1307_EPOCH_MIN + 1u), roundTrip, calendar);
+}
+
+/**
+ * @brief Checks that epochs outside 2000-2099 are rejected.
+ */
+static void Test_Range(void)
+{
+    DS1307_DateTime_t dt;
+
+    CHECK(DS1307_Epoch_to_DateTime(DS1307_EPOCH_MIN - 1u, &dt) != DS1307_OK);
+    CHECK(DS1307_Epoch_to_DateTime(DS1307_EPOCH_MAX + 1u, &dt) != DS1307_OK);
+    CHECK(DS1307_Epoch_to_DateTime(DS1307_EPOCH_MIN, &dt) == DS1307_OK && dt.date.Year == 0 && dt.date.Month == 1 &&
+          dt.date.Date == 1 && dt.date.Day == 7);
+    CHECK(DS1307_Epoch_to_DateTime(DS1307_EPOCH_MAX, &dt) == DS1307_OK && dt.date.Year == 99 &&
+          dt.date.Month == 12 && dt.date.Date == 31 && dt.time.Hour == 23 && dt.time.Sec == 59);
+}
+
+/**
+ * @brief Times each conversion direction and prints nanoseconds per conversion.
+ */
+static void Bench(void)
+{
+    static DS1307_DateTime_t table[BENCH_TABLE];
+    DS1307_DateTime_t dt;
+    volatile uint32_t sink = 0;
+    uint32_t acc = 0;
+    uint32_t n = BENCH_SPAN / BENCH_STEP;
+    uint32_t e;
+    double t0, tTo, tFrom;
+
+    t0 = Now_Ns();
+    for (e = DS1307_EPOCH_MIN; e < DS1307_EPOCH_MIN + BENCH_SPAN; e += BENCH_STEP)
+    {
+        DS1307_Epoch_to_DateTime(e, &dt);
+        acc += dt.date.Date + dt.time.Sec;
+    }
+    tTo = Now_Ns() - t0;
+    sink += acc;
+
+    for (e = 0; e < BENCH_TABLE; e++)
+    {
+        DS1307_Epoch_to_DateTime(DS1307_EPOCH_MIN + e * 769999u, &table[e]);
+    }
+    t0 = Now_Ns();
+    for (e = 0, acc = 0; e < n; e++)
+    {
+        acc += DS1307_DateTime_to_Epoch(&table[e % BENCH_TABLE]);
+    }
+    tFrom = Now_Ns() - t0;
+    sink += acc;
+
+    fprintf(stderr, "epoch->date %.2f ns/conversion, date->epoch %.2f ns/conversion\n", tTo / n, tFrom / n);
+    (void)sink;
+}
+
+int main(void)
+{
+    Test_Range();
+    Test_Exhaustive();
+    Bench();
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
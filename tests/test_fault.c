@@ -0,0 +1,319 @@
+/**
+ * @file test_fault.c
+ * @brief Host test of the fault-injecting transport and its per-API report.
+ *
+ * Every rule is set so that the faulted transactions are known in advance, and the report
+ * is checked for exact counts:
+ * - DS1307_Fault_Decide(): every period-th transaction starts a burst, an ongoing burst
+ *   takes precedence over any rule, and rules are tried in DS1307_FaultKind_t order; a
+ *   probability rule replays exactly from the same seed;
+ * - retry detection: a transaction counts as a retry only when it repeats the operation,
+ *   register and length of a failed one in the same call, including the retries of the
+ *   driver's recovery policy;
+ * - the bus time lost to each fault kind, in the report and as passed to Stall;
+ * - DS1307_Fault_End(): a call that returns an error is lost, one that returns DS1307_OK
+ *   after a corrupted byte is corrupted, and transactions outside a call go to slot 0.
+ *
+ * Build and run from the repository root (the driver's debug output goes to stdout,
+ * results to stderr):
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_fault tests/test_fault.c ds1307_fault.c ds1307_sim.c ds1307.c
+ * ./test_fault > /dev/null
+ * @endcode
+ */
+
+#include "ds1307_fault.h"
+#include "ds1307_sim.h"
+#include <stdio.h>
+#include <string.h>
+
+#define ADDR            D_DS1307_ADDR
+#define TIMEOUT_US      5000u   /**< Timeout passed to the transport, in microseconds. */
+#define API_A           1u      /**< Report slot of the first test API. */
+#define API_B           2u      /**< Report slot of the second test API. */
+
+static unsigned failures = 0; /**< Failed checks. */
+static DS1307_Sim_t sim;      /**< Simulated DS1307 behind the fault transport. */
+static DS1307_Fault_t fault;  /**< Fault transport under test. */
+static uint64_t stalled = 0;  /**< Bus time passed to Stall. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+static void Stall(void *ctx, uint32_t us)
+{
+    (void)ctx;
+    stalled += us;
+}
+
+/**
+ * @brief Starts over with a fresh simulator and a fault transport without rules.
+ */
+static void Reset(uint32_t seed)
+{
+    DS1307_Sim_Init(&sim);
+    DS1307_Fault_Init(&fault, &DS1307_Transport_Sim, &sim, seed);
+    fault.Stall = Stall;
+    stalled = 0;
+}
+
+static DS1307_Status_t Read(uint8_t reg, uint8_t len)
+{
+    uint8_t data[DS1307_MAX_BUFF_SIZE];
+
+    return DS1307_Transport_Fault.ReadRegs(&fault, ADDR, reg, data, len, TIMEOUT_US);
+}
+
+static DS1307_Status_t Write(uint8_t reg, const uint8_t *data, uint8_t len)
+{
+    return DS1307_Transport_Fault.WriteRegs(&fault, ADDR, reg, data, len, TIMEOUT_US);
+}
+
+/**
+ * @brief Runs reads and returns one character per transaction: '.' for success, 'E' for
+ *        DS1307_ERROR, 'T' for DS1307_TIMEOUT_ERR and 'B' for DS1307_BUSY.
+ */
+static const char *Trace(unsigned n)
+{
+    static char trace[64];
+    unsigned i;
+
+    for (i = 0; i < n; i++)
+    {
+        switch (Read(0, 7))
+        {
+        case DS1307_OK:          trace[i] = '.'; break;
+        case DS1307_ERROR:       trace[i] = 'E'; break;
+        case DS1307_TIMEOUT_ERR: trace[i] = 'T'; break;
+        case DS1307_BUSY:        trace[i] = 'B'; break;
+        default:                 trace[i] = '?'; break;
+        }
+    }
+    trace[n] = '\0';
+    return trace;
+}
+
+/**
+ * @brief Checks which transactions the periodic, burst and probability rules hit.
+ */
+static void Test_Decide(void)
+{
+    DS1307_FaultReport_t first;
+    uint32_t hits;
+
+    /* Every fifth transaction starts a burst of three */
+    Reset(1u);
+    fault.rule[DS1307_FAULT_TIMEOUT].period = 5;
+    fault.rule[DS1307_FAULT_TIMEOUT].burst = 3;
+    CHECK(strcmp(Trace(20), "....TTT..TTT..TTT..T") == 0);
+    CHECK(fault.report[0].transactions == 20);
+    CHECK(fault.report[0].faults[DS1307_FAULT_TIMEOUT] == 10);
+
+    /* An ongoing burst beats a rule due now; the address NACK rule is tried first */
+    Reset(1u);
+    fault.rule[DS1307_FAULT_ADDR_NACK].period = 4;
+    fault.rule[DS1307_FAULT_ARB_LOST].period = 3;
+    fault.rule[DS1307_FAULT_ARB_LOST].burst = 2;
+    CHECK(strcmp(Trace(12), "..BB.BBEBB.E") == 0);
+    CHECK(fault.report[0].faults[DS1307_FAULT_ADDR_NACK] == 2);
+    CHECK(fault.report[0].faults[DS1307_FAULT_ARB_LOST] == 6);
+
+    /* A probability of 1/4 draws about a quarter, and the same seed draws the same ones */
+    Reset(1234u);
+    fault.rule[DS1307_FAULT_ADDR_NACK].prob = 16384;
+    Trace(40);
+    Trace(40);
+    Trace(20);
+    first = fault.report[0];
+    hits = first.faults[DS1307_FAULT_ADDR_NACK];
+    CHECK(hits >= 10 && hits <= 40);
+    Reset(1234u);
+    fault.rule[DS1307_FAULT_ADDR_NACK].prob = 16384;
+    Trace(40);
+    Trace(40);
+    Trace(20);
+    CHECK(memcmp(&first, &fault.report[0], sizeof(first)) == 0);
+    fprintf(stderr, "decide: %lu of 100 transactions hit at p = 1/4\n", (unsigned long)hits);
+}
+
+/**
+ * @brief Checks which transactions count as retries.
+ */
+static void Test_Retries(void)
+{
+    static const DS1307_RecoveryPolicy_t policy = {2, 0, 0, NULL, NULL, NULL, NULL, 0, 0, {NULL, NULL, 0}};
+    DS1307_Handle_t rtc;
+    uint8_t byte = 0x5A;
+    uint8_t buf[4];
+
+    /* Even transactions time out */
+    Reset(1u);
+    fault.rule[DS1307_FAULT_TIMEOUT].period = 2;
+    CHECK(Read(0, 7) == DS1307_OK);
+    CHECK(Read(0, 7) == DS1307_TIMEOUT_ERR);
+    CHECK(Read(0, 7) == DS1307_OK);            /* Retry */
+    CHECK(Read(0, 7) == DS1307_TIMEOUT_ERR);
+    CHECK(Read(0, 3) == DS1307_OK);            /* Other length */
+    CHECK(Write(8, &byte, 1) == DS1307_TIMEOUT_ERR);
+    CHECK(Read(8, 1) == DS1307_OK);            /* Other operation */
+    CHECK(Write(9, &byte, 1) == DS1307_TIMEOUT_ERR);
+    CHECK(Write(9, &byte, 1) == DS1307_OK);    /* Retry */
+    CHECK(Read(0, 7) == DS1307_TIMEOUT_ERR);
+    DS1307_Fault_Begin(&fault, API_A);
+    CHECK(Read(0, 7) == DS1307_OK);            /* New call */
+    DS1307_Fault_End(&fault, DS1307_OK);
+    CHECK(fault.report[0].transactions == 10);
+    CHECK(fault.report[0].retries == 2);
+    CHECK(fault.report[API_A].transactions == 1);
+    CHECK(fault.report[API_A].retries == 0);
+
+    /* Through the driver: two retries of a read that keeps failing */
+    Reset(1u);
+    CHECK(DS1307_InitTransport(&rtc, &DS1307_Transport_Fault, &fault, _No_Output_0, &policy) == DS1307_OK);
+    DS1307_Fault_ResetReport(&fault);
+    fault.rule[DS1307_FAULT_ADDR_NACK].period = 1;
+    DS1307_Fault_Begin(&fault, API_B);
+    DS1307_Fault_End(&fault, DS1307_NvramRead(&rtc, 0, buf, sizeof(buf)));
+    fault.rule[DS1307_FAULT_ADDR_NACK].period = 0;
+    DS1307_Fault_Begin(&fault, API_B);
+    DS1307_Fault_End(&fault, DS1307_NvramRead(&rtc, 0, buf, sizeof(buf)));
+    CHECK(fault.report[API_B].calls == 2);
+    CHECK(fault.report[API_B].transactions == 4);
+    CHECK(fault.report[API_B].retries == 2);
+    CHECK(fault.report[API_B].lost == 1);
+    CHECK(rtc.stats.Retries == 2);
+}
+
+/**
+ * @brief Checks the bus time lost to each fault kind.
+ */
+static void Test_Stall(void)
+{
+    static const uint8_t ones[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    uint64_t before;
+    uint8_t landed;
+    uint8_t kind;
+
+    /* Bus time at 100 kHz: 9 SCL periods per byte and 4 for START and STOP */
+    Reset(99u);
+    for (kind = 0; kind < DS1307_FAULT_KINDS; kind++)
+    {
+        static const uint32_t want[DS1307_FAULT_KINDS] = {130u, 220u, TIMEOUT_US, 130u, 0u};
+
+        memset(fault.rule, 0, sizeof(fault.rule));
+        fault.rule[kind].period = 1;
+        before = fault.report[kind].stallUs;
+        DS1307_Fault_Begin(&fault, kind);
+        DS1307_Fault_End(&fault, Read(0, 7));
+        CHECK(fault.report[kind].faults[kind] == 1);
+        CHECK(fault.report[kind].stallUs - before == want[kind]);
+        CHECK((fault.report[kind].lost == 1) == (kind != DS1307_FAULT_CORRUPT));
+    }
+    CHECK(fault.report[DS1307_FAULT_CORRUPT].corrupted == 1);
+
+    /* A data NACK on a write costs the bytes that landed before it */
+    memset(fault.rule, 0, sizeof(fault.rule));
+    fault.rule[DS1307_FAULT_DATA_NACK].period = 1;
+    before = fault.report[0].stallUs;
+    CHECK(Write(D_DS1307_REG_RAM01, ones, 1) == DS1307_ERROR);
+    CHECK(fault.report[0].stallUs - before == 310u);
+    before = fault.report[0].stallUs;
+    CHECK(Write(D_DS1307_REG_RAM01, ones, 8) == DS1307_ERROR);
+    for (landed = 0; (landed < 8) && (sim.reg[D_DS1307_REG_RAM01 + landed] == 0xFF); landed++)
+    {
+    }
+    CHECK(fault.report[0].stallUs - before == (uint64_t)((landed + 3u) * 9u + 4u) * 10u);
+
+    /* 13 SCL periods at 400 kHz round up to 33 us */
+    fault.busHz = 400000u;
+    memset(fault.rule, 0, sizeof(fault.rule));
+    fault.rule[DS1307_FAULT_ARB_LOST].period = 1;
+    before = fault.report[0].stallUs;
+    CHECK(Read(0, 7) == DS1307_BUSY);
+    CHECK(fault.report[0].stallUs - before == 33u);
+
+    /* Stall saw every microsecond the reports hold */
+    before = 0;
+    for (kind = 0; kind < DS1307_FAULT_MAX_API; kind++)
+    {
+        before += fault.report[kind].stallUs;
+    }
+    CHECK(stalled == before);
+    fprintf(stderr, "stall: %llu us lost, %u byte(s) landed before a data NACK\n",
+            (unsigned long long)stalled, (unsigned)landed);
+}
+
+/**
+ * @brief Checks the attribution of lost and corrupted calls.
+ */
+static void Test_End(void)
+{
+    DS1307_Handle_t rtc;
+    uint8_t buf[8];
+    uint8_t diff = 0;
+    uint8_t i;
+
+    Reset(7u);
+
+    /* Outside a call */
+    fault.rule[DS1307_FAULT_ADDR_NACK].period = 1;
+    CHECK(Read(0, 7) == DS1307_ERROR);
+
+    DS1307_Fault_Begin(&fault, API_A);
+    DS1307_Fault_End(&fault, Read(0, 7));
+
+    /* Corrupted, then lost for another reason, then clean */
+    fault.rule[DS1307_FAULT_ADDR_NACK].period = 0;
+    fault.rule[DS1307_FAULT_CORRUPT].period = 1;
+    DS1307_Fault_Begin(&fault, API_B);
+    DS1307_Fault_End(&fault, Read(0, 7));
+    DS1307_Fault_Begin(&fault, API_B);
+    DS1307_Fault_End(&fault, (Read(0, 7) == DS1307_OK) ? DS1307_ERROR : DS1307_OK);
+    fault.rule[DS1307_FAULT_CORRUPT].period = 0;
+    DS1307_Fault_Begin(&fault, API_B);
+    DS1307_Fault_End(&fault, Read(0, 7));
+
+    CHECK(fault.report[0].calls == 0 && fault.report[0].transactions == 1);
+    CHECK(fault.report[0].faults[DS1307_FAULT_ADDR_NACK] == 1);
+    CHECK(fault.report[API_A].calls == 1 && fault.report[API_A].lost == 1);
+    CHECK(fault.report[API_A].corrupted == 0);
+    CHECK(fault.report[API_B].calls == 3 && fault.report[API_B].transactions == 3);
+    CHECK(fault.report[API_B].lost == 1 && fault.report[API_B].corrupted == 1);
+    CHECK(fault.report[API_B].faults[DS1307_FAULT_CORRUPT] == 2);
+    CHECK(fault.report[API_B].stallUs == 0);
+
+    /* A driver call that succeeds with one flipped bit */
+    CHECK(DS1307_InitTransport(&rtc, &DS1307_Transport_Fault, &fault, _No_Output_0, NULL) == DS1307_OK);
+    DS1307_Fault_ResetReport(&fault);
+    CHECK(fault.report[API_B].calls == 0);
+    fault.rule[DS1307_FAULT_CORRUPT].period = 1;
+    DS1307_Fault_Begin(&fault, API_A);
+    DS1307_Fault_End(&fault, DS1307_NvramRead(&rtc, 0, buf, sizeof(buf)));
+    for (i = 0; i < sizeof(buf); i++)
+    {
+        uint8_t x = buf[i] ^ sim.reg[D_DS1307_REG_RAM01 + i];
+
+        diff += (uint8_t)((x != 0) + ((x & (x - 1)) != 0));
+    }
+    CHECK(diff == 1);
+    CHECK(fault.report[API_A].calls == 1 && fault.report[API_A].corrupted == 1);
+    CHECK(fault.report[API_A].lost == 0);
+}
+
+int main(void)
+{
+    Test_Decide();
+    Test_Retries();
+    Test_Stall();
+    Test_End();
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
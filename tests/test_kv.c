@@ -0,0 +1,336 @@
+/**
+ * @file test_kv.c
+ * @brief Host power-cut test of the NVRAM key-value store.
+ *
+ * - Replays a transient write failure: keys 1 and 2 are set, an append of key 3 is torn
+ *   after 2 bytes, key 2 is deleted on the recovered bus, and after a reboot key 1 must
+ *   still be there.
+ * - Runs a random sequence of sets and deletes against a reference model and, at every
+ *   step, cuts the power after every byte the step writes. After each cut a reboot must
+ *   find every other key unchanged and the key of the step holding its old or its new
+ *   value (the new one whenever the call reported success). Steps that compact the region
+ *   are counted separately, split by path. The record-by-record steps of the compaction
+ *   must not lose anything. The two documented fallbacks, retiring the old record before
+ *   the new one is written and compacting in one rewrite, are allowed to lose records when
+ *   the region is too full for anything else, but the store must still load.
+ *
+ * Build and run from the repository root (the driver's debug output goes to stdout,
+ * results to stderr):
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_kv tests/test_kv.c ds1307_kv.c ds1307_sim.c ds1307.c
+ * ./test_kv > /dev/null
+ * @endcode
+ */
+
+#include "ds1307_kv.h"
+#include "tests/torn.h"
+#include <stdio.h>
+
+#define KEYS        6u      /**< Keys used by the random sequence, 1 to KEYS. */
+#define VALUE_MAX   8u      /**< Longest value used by the random sequence. */
+#define STEPS       3000u   /**< Steps of the random sequence. */
+
+static unsigned failures = 0; /**< Failed checks. */
+static uint32_t seed = 99u;   /**< Generator state. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+static unsigned rewrites = 0; /**< Writes that moved live records in place. */
+static unsigned retires = 0;  /**< Writes that retired the only record of a key. */
+
+/**
+ * @brief Reference contents of the store.
+ */
+typedef struct
+{
+    int len[KEYS + 1];                  /**< Length of each value, -1 if absent. */
+    uint8_t value[KEYS + 1][VALUE_MAX]; /**< Value of each key. */
+} Model_t;
+
+static uint32_t Rand(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+/**
+ * @brief Returns the key whose live record covers an offset of a region, 0 if none.
+ */
+static uint8_t Owner(const uint8_t *ram, const uint8_t *index, unsigned at)
+{
+    uint8_t k;
+
+    for (k = 1; k <= DS1307_KV_KEY_MAX; k++)
+    {
+        if ((index[k] != 0) && (at >= index[k]) && (at < index[k] + DS1307_KV_RECORD + ram[index[k] + 1u]))
+        {
+            return k;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Power-cut transport that also counts the writes of the two compaction fallbacks.
+ * A one-rewrite compaction lowers the used count below live records, then moves them with
+ * a burst; the other fallback retires a record that has no other copy of its key.
+ */
+static DS1307_Status_t Watch_WriteRegs(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    const uint8_t *ram = &((Torn_t *)bus)->sim.reg[D_DS1307_REG_RAM01];
+    unsigned from = (unsigned)(regAdd - D_DS1307_REG_RAM01);
+    unsigned used = (ram[1] < DS1307_NVRAM_SIZE) ? ram[1] : DS1307_NVRAM_SIZE;
+    uint8_t index[DS1307_KV_KEY_MAX + 1] = {0};
+    uint8_t copies[DS1307_KV_KEY_MAX + 1] = {0};
+    unsigned pos, i;
+
+    for (pos = DS1307_KV_HEADER; (pos + DS1307_KV_RECORD <= used) && (ram[pos] <= DS1307_KV_KEY_MAX);
+         pos += DS1307_KV_RECORD + ram[pos + 1])
+    {
+        index[ram[pos]] = (uint8_t)pos;
+        copies[ram[pos]]++;
+    }
+
+    if ((from == 1) && (len == 1))
+    {
+        /* The used count drops below a live record */
+        for (i = data[0]; i < used; i++)
+        {
+            if (Owner(ram, index, i) != 0)
+            {
+                rewrites++;
+                break;
+            }
+        }
+    }
+    else if (len == 1)
+    {
+        uint8_t k = Owner(ram, index, from);
+
+        retires += (k != 0) && (index[k] == from) && (copies[k] == 1) && (data[0] == DS1307_KV_DEAD);
+    }
+    else
+    {
+        /* A burst changes a live record in place */
+        for (i = 0; (i < len) && (from + i < used); i++)
+        {
+            if ((data[i] != ram[from + i]) && (Owner(ram, index, from + i) != 0))
+            {
+                rewrites++;
+                break;
+            }
+        }
+    }
+
+    return Torn_Transport.WriteRegs(bus, devAddr, regAdd, data, len, timeout);
+}
+
+static const DS1307_Transport_t Watch_Transport =
+{
+    Torn_ReadRegs,
+    Watch_WriteRegs,
+    Torn_Probe,
+    NULL,
+    NULL,
+};
+
+/**
+ * @brief Checks that a key holds the value of a model.
+ */
+static int Holds(const DS1307_Kv_t *kv, const Model_t *m, uint8_t key)
+{
+    uint8_t value[VALUE_MAX];
+    uint8_t len = VALUE_MAX;
+    DS1307_Status_t status = DS1307_Kv_Get(kv, key, value, &len);
+
+    if (m->len[key] < 0)
+    {
+        return status == DS1307_NOT_FOUND;
+    }
+    return (status == DS1307_OK) && (len == m->len[key]) && (memcmp(value, m->value[key], len) == 0);
+}
+
+/**
+ * @brief Replays the transient failure reported in review.
+ */
+static void Test_Transient(void)
+{
+    static Torn_t torn;
+    DS1307_Handle_t rtc;
+    DS1307_Kv_t kv;
+    uint8_t a[2] = {0x11, 0x22}, b[3] = {0x33, 0x44, 0x55}, c[4] = {1, 2, 3, 4};
+    uint8_t value[4], len = sizeof(value);
+
+    Torn_Init(&torn);
+    Torn_Reboot(&torn, &rtc);
+    CHECK(DS1307_Kv_Init(&rtc, &kv, 0, DS1307_NVRAM_SIZE) == DS1307_OK);
+    CHECK(DS1307_Kv_Set(&rtc, &kv, 1, a, sizeof(a)) == DS1307_OK);
+    CHECK(DS1307_Kv_Set(&rtc, &kv, 2, b, sizeof(b)) == DS1307_OK);
+
+    Torn_Arm(&torn, 2);
+    CHECK(DS1307_Kv_Set(&rtc, &kv, 3, c, sizeof(c)) != DS1307_OK);
+    Torn_Arm(&torn, TORN_NEVER);
+    CHECK(DS1307_Kv_Delete(&rtc, &kv, 2) == DS1307_OK);
+
+    Torn_Reboot(&torn, &rtc);
+    CHECK(DS1307_Kv_Init(&rtc, &kv, 0, DS1307_NVRAM_SIZE) == DS1307_OK);
+    CHECK(DS1307_Kv_Get(&kv, 1, value, &len) == DS1307_OK && len == 2 && value[0] == 0x11 && value[1] == 0x22);
+    len = sizeof(value);
+    CHECK(DS1307_Kv_Get(&kv, 2, value, &len) == DS1307_NOT_FOUND);
+}
+
+/**
+ * @brief Cuts the power after every byte of every step of a random sequence.
+ */
+static void Test_Tear(void)
+{
+    static Torn_t torn, saved;
+    DS1307_Handle_t rtc;
+    DS1307_Kv_t kv;
+    Model_t model, next;
+    unsigned long cases = 0, bad = 0;
+    unsigned long safeCuts = 0, safeLost = 0;         /* Record-by-record compaction */
+    unsigned long fallbackCuts = 0, fallbackLost = 0; /* Retire first, or one rewrite */
+    uint32_t step;
+    long cut, bytes;
+    uint8_t k;
+
+    Torn_Init(&torn);
+    for (k = 0; k <= KEYS; k++)
+    {
+        model.len[k] = -1;
+    }
+
+    for (step = 0; step < STEPS; step++)
+    {
+        uint8_t key = (uint8_t)(1 + Rand(KEYS));
+        uint8_t del = (model.len[key] >= 0) && (Rand(5) == 0);
+        uint8_t value[VALUE_MAX];
+        uint8_t len = (uint8_t)Rand(VALUE_MAX + 1);
+        uint8_t compacts;
+        uint8_t fallback;
+        uint8_t used;
+        DS1307_Status_t status;
+
+        next = model;
+        if ((model.len[key] >= 0) && Rand(2))
+        {
+            /* Same length, often a single changed byte */
+            len = (uint8_t)model.len[key];
+            memcpy(value, model.value[key], len);
+            if (len > 0)
+            {
+                value[Rand(len)] ^= (uint8_t)(1 + Rand(255));
+            }
+        }
+        else
+        {
+            for (k = 0; k < len; k++)
+            {
+                value[k] = (uint8_t)Rand(256);
+            }
+        }
+
+        /* Dry run: bytes written, whether the step compacts and which path it takes */
+        saved = torn;
+        Torn_Reboot(&torn, &rtc);
+        rtc.transport = &Watch_Transport;
+        CHECK(DS1307_Kv_Init(&rtc, &kv, 0, DS1307_NVRAM_SIZE) == DS1307_OK);
+        bytes = torn.written;
+        used = kv.image[1];
+        rewrites = 0;
+        retires = 0;
+        status = del ? DS1307_Kv_Delete(&rtc, &kv, key) : DS1307_Kv_Set(&rtc, &kv, key, value, len);
+        bytes = torn.written - bytes;
+        compacts = !del && (status == DS1307_OK) && (used + DS1307_KV_RECORD + len > DS1307_NVRAM_SIZE) &&
+                   (bytes > 1);
+        fallback = compacts && ((rewrites != 0) || (retires != 0));
+        if (status == DS1307_OK)
+        {
+            next.len[key] = del ? -1 : len;
+            memcpy(next.value[key], value, len);
+        }
+        else
+        {
+            CHECK(status == DS1307_DATA_SIZE_ERROR);
+        }
+
+        for (cut = 0; cut < bytes; cut++)
+        {
+            DS1307_Status_t torn_status;
+            uint8_t ok = 1;
+
+            torn = saved;
+            Torn_Reboot(&torn, &rtc);
+            DS1307_Kv_Init(&rtc, &kv, 0, DS1307_NVRAM_SIZE);
+            Torn_Arm(&torn, cut);
+            torn_status = del ? DS1307_Kv_Delete(&rtc, &kv, key) : DS1307_Kv_Set(&rtc, &kv, key, value, len);
+
+            Torn_Reboot(&torn, &rtc);
+            cases++;
+            if (DS1307_Kv_Init(&rtc, &kv, 0, DS1307_NVRAM_SIZE) != DS1307_OK)
+            {
+                bad++;
+                continue;
+            }
+            for (k = 1; k <= KEYS; k++)
+            {
+                if (k == key)
+                {
+                    ok &= Holds(&kv, &next, k) || ((torn_status != DS1307_OK) && Holds(&kv, &model, k));
+                }
+                else
+                {
+                    ok &= Holds(&kv, &model, k);
+                }
+            }
+            if (fallback)
+            {
+                fallbackCuts++;
+                fallbackLost += !ok;
+            }
+            else if (compacts)
+            {
+                safeCuts++;
+                safeLost += !ok;
+            }
+            else
+            {
+                bad += !ok;
+            }
+        }
+
+        /* Continue from the untorn step */
+        torn = saved;
+        Torn_Reboot(&torn, &rtc);
+        DS1307_Kv_Init(&rtc, &kv, 0, DS1307_NVRAM_SIZE);
+        del ? DS1307_Kv_Delete(&rtc, &kv, key) : DS1307_Kv_Set(&rtc, &kv, key, value, len);
+        model = next;
+        for (k = 1; k <= KEYS; k++)
+        {
+            CHECK(Holds(&kv, &model, k));
+        }
+    }
+    CHECK(bad == 0);
+    CHECK(safeLost == 0);
+    fprintf(stderr, "torn updates: %lu cases, %lu bad recoveries\n", cases - safeCuts - fallbackCuts, bad);
+    fprintf(stderr, "record-by-record compaction: %lu cuts, %lu lost data\n", safeCuts, safeLost);
+    fprintf(stderr, "fallbacks (retire first, one rewrite): %lu cuts, %lu lost data\n", fallbackCuts, fallbackLost);
+}
+
+int main(void)
+{
+    Test_Transient();
+    Test_Tear();
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
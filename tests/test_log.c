@@ -0,0 +1,245 @@
+/**
+ * @file test_log.c
+ * @brief Host power-cut test of the NVRAM event log.
+ *
+ * - Checks the capacity quoted in ds1307_log.h: 24 events a minute apart, 16 events ten
+ *   minutes apart.
+ * - Replays a transient write failure: an append is torn after its code byte landed, the
+ *   next append, whose code is the byte the image still holds there, runs on the
+ *   recovered bus, and after a reboot the log must read back what it reported.
+ * - Checks that DS1307_Log_Read() stops at a malformed record and after the log count.
+ * - Runs a random sequence of appends and, at every append, cuts the power after every
+ *   byte it writes. After each cut a reboot must read back the codes of the log before
+ *   or after the append (after whenever it reported success); the times must match too
+ *   unless the append evicted records, where a cut may shift them.
+ *
+ * Build and run from the repository root (the driver's debug output goes to stdout,
+ * results to stderr):
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_log tests/test_log.c ds1307_log.c ds1307_sim.c ds1307.c
+ * ./test_log > /dev/null
+ * @endcode
+ */
+
+#include "ds1307_log.h"
+#include "tests/torn.h"
+#include <stdio.h>
+
+#define STEPS       2000u   /**< Appends of the random sequence. */
+#define HISTORY     64u     /**< Events kept by the reference model. */
+#define EPOCH0      946684800u /**< 2000-01-01 00:00:00. */
+
+static unsigned failures = 0; /**< Failed checks. */
+static uint32_t seed = 7u;    /**< Generator state. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+/**
+ * @brief Events appended so far, newest last.
+ */
+typedef struct
+{
+    uint32_t n;                     /**< Events appended. */
+    DS1307_LogRecord_t rec[HISTORY]; /**< The newest events, rec[n % HISTORY] next. */
+} Model_t;
+
+static uint32_t Rand(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+/**
+ * @brief Checks that a log reads back the newest events of a model.
+ * @param[in] times Set to compare the times as well as the codes.
+ */
+static int Matches(const DS1307_Log_t *log, const Model_t *m, int times)
+{
+    DS1307_LogRecord_t rec[DS1307_NVRAM_SIZE];
+    uint8_t n = DS1307_Log_Read(log, rec, DS1307_NVRAM_SIZE);
+    uint8_t i;
+
+    if ((n != log->count) || (n > m->n) || ((n == 0) && (m->n != 0)))
+    {
+        return 0;
+    }
+    for (i = 0; i < n; i++)
+    {
+        const DS1307_LogRecord_t *e = &m->rec[(m->n - n + i) % HISTORY];
+
+        if ((rec[i].code != e->code) || (times && (rec[i].epoch != e->epoch)))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Fills a fresh log with evenly spaced events and returns how many it keeps.
+ */
+static uint8_t Capacity(uint32_t spacing)
+{
+    static Torn_t torn;
+    DS1307_Handle_t rtc;
+    DS1307_Log_t log;
+    uint32_t i;
+
+    Torn_Init(&torn);
+    Torn_Reboot(&torn, &rtc);
+    DS1307_Log_Init(&rtc, &log, 0, DS1307_NVRAM_SIZE);
+    for (i = 0; i < 100u; i++)
+    {
+        DS1307_Log_Append(&rtc, &log, (uint8_t)i, EPOCH0 + i * spacing);
+    }
+    return log.count;
+}
+
+/**
+ * @brief Replays a torn append followed by an append on the recovered bus.
+ */
+static void Test_Transient(void)
+{
+    static Torn_t torn;
+    DS1307_Handle_t rtc;
+    DS1307_Log_t log;
+    DS1307_LogRecord_t rec[4];
+
+    Torn_Init(&torn);
+    Torn_Reboot(&torn, &rtc);
+    CHECK(DS1307_Log_Init(&rtc, &log, 0, DS1307_NVRAM_SIZE) == DS1307_OK);
+    CHECK(DS1307_Log_Append(&rtc, &log, 1, EPOCH0) == DS1307_OK);
+
+    Torn_Arm(&torn, 1);
+    CHECK(DS1307_Log_Append(&rtc, &log, 2, EPOCH0 + 100000u) != DS1307_OK);
+    Torn_Arm(&torn, TORN_NEVER);
+    CHECK(DS1307_Log_Append(&rtc, &log, 0, EPOCH0 + 200000u) == DS1307_OK);
+
+    Torn_Reboot(&torn, &rtc);
+    CHECK(DS1307_Log_Init(&rtc, &log, 0, DS1307_NVRAM_SIZE) == DS1307_OK);
+    CHECK(DS1307_Log_Read(&log, rec, 4) == 2);
+    CHECK(rec[0].code == 1 && rec[0].epoch == EPOCH0);
+    CHECK(rec[1].code == 0 && rec[1].epoch == EPOCH0 + 200000u);
+}
+
+/**
+ * @brief Checks that reading stops at a malformed record and after the log count.
+ */
+static void Test_Read(void)
+{
+    static Torn_t torn;
+    DS1307_Handle_t rtc;
+    DS1307_Log_t log;
+    DS1307_LogRecord_t rec[8];
+    uint8_t i;
+
+    Torn_Init(&torn);
+    Torn_Reboot(&torn, &rtc);
+    DS1307_Log_Init(&rtc, &log, 0, DS1307_NVRAM_SIZE);
+    for (i = 0; i < 4; i++)
+    {
+        DS1307_Log_Append(&rtc, &log, i, EPOCH0 + i * 60u);
+    }
+
+    log.count = 2;
+    CHECK(DS1307_Log_Read(&log, rec, 8) == 2);
+    CHECK(rec[0].code == 0 && rec[1].code == 1);
+
+    /* Varint of the last record runs past the end of the used area */
+    log.count = 4;
+    log.image[DS1307_LOG_HEADER + 7] |= 0x80;
+    CHECK(DS1307_Log_Read(&log, rec, 8) == 3);
+}
+
+/**
+ * @brief Cuts the power after every byte of every append of a random sequence.
+ */
+static void Test_Tear(void)
+{
+    static Torn_t torn, saved;
+    DS1307_Handle_t rtc;
+    DS1307_Log_t log;
+    Model_t model, next;
+    unsigned long cases = 0, bad = 0;
+    uint32_t now = EPOCH0;
+    uint32_t step;
+    long cut, bytes;
+
+    Torn_Init(&torn);
+    model.n = 0;
+
+    for (step = 0; step < STEPS; step++)
+    {
+        static const uint32_t gaps[] = {0u, 5u, 127u, 128u, 3600u, 16383u, 16384u, 86400u * 40u};
+        uint8_t code = (uint8_t)Rand(256);
+        uint8_t before;
+        int evicts;
+        DS1307_Status_t status;
+
+        now += gaps[Rand(sizeof(gaps) / sizeof(gaps[0]))];
+        next = model;
+        next.rec[next.n % HISTORY].code = code;
+        next.rec[next.n % HISTORY].epoch = now;
+        next.n++;
+
+        /* Dry run: bytes written */
+        saved = torn;
+        Torn_Reboot(&torn, &rtc);
+        CHECK(DS1307_Log_Init(&rtc, &log, 0, DS1307_NVRAM_SIZE) == DS1307_OK);
+        before = log.count;
+        bytes = torn.written;
+        CHECK(DS1307_Log_Append(&rtc, &log, code, now) == DS1307_OK);
+        bytes = torn.written - bytes;
+        evicts = (log.count <= before);
+
+        for (cut = 0; cut < bytes; cut++)
+        {
+            DS1307_Status_t torn_status;
+
+            torn = saved;
+            Torn_Reboot(&torn, &rtc);
+            DS1307_Log_Init(&rtc, &log, 0, DS1307_NVRAM_SIZE);
+            Torn_Arm(&torn, cut);
+            torn_status = DS1307_Log_Append(&rtc, &log, code, now);
+
+            Torn_Reboot(&torn, &rtc);
+            cases++;
+            status = DS1307_Log_Init(&rtc, &log, 0, DS1307_NVRAM_SIZE);
+            if ((status != DS1307_OK) ||
+                !(Matches(&log, &next, !evicts) || ((torn_status != DS1307_OK) && Matches(&log, &model, !evicts))))
+            {
+                bad++;
+            }
+        }
+
+        /* Continue from the untorn append */
+        torn = saved;
+        Torn_Reboot(&torn, &rtc);
+        DS1307_Log_Init(&rtc, &log, 0, DS1307_NVRAM_SIZE);
+        DS1307_Log_Append(&rtc, &log, code, now);
+        model = next;
+        CHECK(Matches(&log, &model, 1));
+    }
+    CHECK(bad == 0);
+    fprintf(stderr, "torn appends: %lu cases, %lu bad recoveries\n", cases, bad);
+}
+
+int main(void)
+{
+    CHECK(Capacity(60u) == 24);
+    CHECK(Capacity(600u) == 16);
+    Test_Transient();
+    Test_Read();
+    Test_Tear();
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
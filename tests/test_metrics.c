@@ -0,0 +1,343 @@
+/**
+ * @file test_metrics.c
+ * @brief Host test of the per-device metrics.
+ *
+ * Runs the driver on the simulator, behind the fault transport for the error counts:
+ * - every API tagged in DS1307_Api_t files its transfers in its own latency histogram and
+ *   in no other, setters built on DS1307_WriteReg() included, while untagged transfers
+ *   (ReadReg, date reads, the mode read of a setter, shadow flushes, asynchronous register
+ *   reads) and calls issued after a rejected argument land in DS1307_API_OTHER;
+ * - over a seeded run with retries and a circuit breaker, errors[] sums to stats.Errors,
+ *   matches the faults injected by kind, and errors[DS1307_CIRCUIT_OPEN] equals
+ *   stats.Rejected;
+ * - a snapshot with reset clears both the metrics and dev->stats.
+ * Built with DS1307_NO_METRICS, it checks that dev->stats still counts the same run.
+ *
+ * Build and run from the repository root (the driver's debug output goes to stdout,
+ * results to stderr), with and without the metrics:
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_metrics tests/test_metrics.c ds1307_fault.c ds1307_sim.c ds1307.c
+ * ./test_metrics > /dev/null
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -DDS1307_NO_METRICS -o test_metrics tests/test_metrics.c ds1307_fault.c ds1307_sim.c ds1307.c
+ * ./test_metrics > /dev/null
+ * @endcode
+ */
+
+#include "ds1307_fault.h"
+#include "ds1307_sim.h"
+#include <stdio.h>
+#include <string.h>
+
+#define STEPS           5000u   /**< Calls of the seeded run. */
+
+static unsigned failures = 0; /**< Failed checks. */
+static uint32_t seed = 3u;    /**< Generator state. */
+static DS1307_Sim_t sim;      /**< Simulated DS1307. */
+static DS1307_Fault_t fault;  /**< Fault transport in front of the simulator. */
+static DS1307_Handle_t rtc;   /**< Driver handle under test. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+static uint32_t Rand(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+/**
+ * @brief Starts over with a fresh simulator behind the fault transport, no faults enabled.
+ */
+static void Setup(const DS1307_RecoveryPolicy_t *policy)
+{
+    DS1307_Sim_Init(&sim);
+    sim.busHz = 100000u;
+    DS1307_Fault_Init(&fault, &DS1307_Transport_Sim, &sim, 17u);
+    CHECK(DS1307_InitTransport(&rtc, &DS1307_Transport_Fault, &fault, _No_Output_0, policy) == DS1307_OK);
+}
+
+/**
+ * @brief Runs a seeded mix of calls with every fault kind enabled, advancing the clock.
+ */
+static void Faulty(void)
+{
+    uint8_t buf[16] = {0};
+    uint32_t i;
+
+    fault.rule[DS1307_FAULT_ADDR_NACK].prob = 2000;
+    fault.rule[DS1307_FAULT_DATA_NACK].prob = 2000;
+    fault.rule[DS1307_FAULT_TIMEOUT].prob = 1000;
+    fault.rule[DS1307_FAULT_TIMEOUT].burst = 8;
+    fault.rule[DS1307_FAULT_ARB_LOST].prob = 2000;
+    fault.rule[DS1307_FAULT_ARB_LOST].burst = 3;
+    for (i = 0; i < STEPS; i++)
+    {
+        switch (Rand(3))
+        {
+        case 0:
+            DS1307_ReadReg(&rtc, D_DS1307_REG_SEC, buf, 7);
+            break;
+        case 1:
+            DS1307_WriteReg(&rtc, D_DS1307_REG_RAM01, buf, (uint8_t)(1 + Rand(16)));
+            break;
+        default:
+            DS1307_NvramRead(&rtc, (uint8_t)Rand(40), buf, 16);
+            break;
+        }
+        DS1307_Sim_Advance(&sim, 500u);
+    }
+    memset(fault.rule, 0, sizeof(fault.rule));
+}
+
+/**
+ * @brief Returns a recovery policy with retries and a breaker timed on the simulator.
+ */
+static DS1307_RecoveryPolicy_t Policy(void)
+{
+    DS1307_RecoveryPolicy_t policy;
+
+    memset(&policy, 0, sizeof(policy));
+    policy.maxRetries = 2;
+    policy.breakerThreshold = 3;
+    policy.cooldownUs = 20000u;
+    DS1307_Sim_TickSource(&sim, &policy.clock);
+    return policy;
+}
+
+#ifndef DS1307_NO_METRICS
+/**
+ * @brief Transfers filed in the latency histogram of each API.
+ */
+typedef struct
+{
+    uint32_t filed[DS1307_API_COUNT]; /**< Transfers filed per API. */
+} Filed_t;
+
+static Filed_t filedBefore; /**< Histogram counts before the call. */
+
+static uint32_t Filed(uint8_t api)
+{
+    DS1307_Metrics_t m;
+    uint32_t n = 0;
+    uint8_t b;
+
+    DS1307_Metrics_Snapshot(&rtc, &m, 0);
+    for (b = 0; b < DS1307_METRICS_BUCKETS; b++)
+    {
+        n += m.latency[api][b];
+    }
+    return n;
+}
+
+/**
+ * @brief Records the histogram counts before a call.
+ */
+static void Mark(void)
+{
+    uint8_t api;
+
+    for (api = 0; api < DS1307_API_COUNT; api++)
+    {
+        filedBefore.filed[api] = Filed(api);
+    }
+}
+
+/**
+ * @brief Returns the transfers filed in an API since Mark().
+ */
+static uint32_t Delta(uint8_t api)
+{
+    return Filed(api) - filedBefore.filed[api];
+}
+
+/**
+ * @brief Checks that the calls since Mark() filed transfers in one API only.
+ */
+static int Only(uint8_t want)
+{
+    uint8_t api;
+
+    for (api = 0; api < DS1307_API_COUNT; api++)
+    {
+        uint32_t n = Delta(api);
+
+        if ((api == want) ? (n == 0) : (n != 0))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void Done(DS1307_Handle_t *dev, DS1307_Status_t status, void *userData)
+{
+    (void)dev;
+    *(DS1307_Status_t *)userData = status;
+}
+
+/**
+ * @brief Checks the histogram each API lands in.
+ */
+static void Test_Tags(void)
+{
+    DS1307_TickSource_t clock;
+    DS1307_DateTime_t dateTime;
+    DS1307_Time_t time;
+    DS1307_Date_t date;
+    DS1307_Status_t done;
+    uint8_t buf[DS1307_NVRAM_SIZE] = {1, 2, 3};
+
+    Setup(NULL);
+    DS1307_Sim_TickSource(&sim, &clock);
+    DS1307_Metrics_SetClock(&rtc, &clock);
+
+    Mark();
+    CHECK(DS1307_ReadTime_Bin(&rtc, &time) == DS1307_OK);
+    CHECK(DS1307_ReadTime_BCD(&rtc, &time) == DS1307_OK);
+    CHECK(Only(DS1307_API_READ_TIME));
+    Mark();
+    CHECK(DS1307_ReadDateTime_Bin(&rtc, &dateTime) == DS1307_OK);
+    CHECK(DS1307_ReadDateTime_BCD(&rtc, &dateTime) == DS1307_OK);
+    CHECK(Only(DS1307_API_READ_DATETIME));
+    Mark();
+    CHECK(DS1307_WriteReg(&rtc, D_DS1307_REG_RAM01, buf, 3) == DS1307_OK);
+    CHECK(Only(DS1307_API_WRITE_REG));
+
+    /* A setter built on WriteReg: the write is tagged, the read of the modes it keeps is not */
+    Mark();
+    CHECK(DS1307_WriteDateTime(&rtc, &dateTime, DS1307_HOURS_KEEP, DS1307_CH_KEEP) == DS1307_OK);
+    CHECK(Delta(DS1307_API_WRITE_REG) == 1 && Delta(DS1307_API_OTHER) == 1);
+    CHECK(Delta(DS1307_API_READ_TIME) == 0 && Delta(DS1307_API_READ_DATETIME) == 0 && Delta(DS1307_API_NVRAM) == 0);
+    Mark();
+    CHECK(DS1307_NvramWrite(&rtc, 10, buf, DS1307_NVRAM_SIZE - 10) == DS1307_OK);
+    DS1307_Shadow_Invalidate(&rtc);
+    CHECK(DS1307_NvramRead(&rtc, 0, buf, DS1307_NVRAM_SIZE) == DS1307_OK);
+    CHECK(Only(DS1307_API_NVRAM));
+
+    /* Untagged paths */
+    Mark();
+    CHECK(DS1307_ReadReg(&rtc, D_DS1307_REG_SEC, buf, 8) == DS1307_OK);
+    CHECK(DS1307_ReadDate_Bin(&rtc, &date) == DS1307_OK);
+    CHECK(DS1307_SetOUT(&rtc, 1) == DS1307_OK);
+    CHECK(DS1307_Shadow_Flush(&rtc) == DS1307_OK);
+    CHECK(Only(DS1307_API_OTHER));
+
+    /* A rejected argument clears the tag before anything reaches the bus */
+    Mark();
+    CHECK(DS1307_WriteReg(&rtc, 60, buf, 8) == DS1307_DATA_SIZE_ERROR);
+    CHECK(DS1307_NvramRead(&rtc, 50, buf, 8) == DS1307_DATA_SIZE_ERROR);
+    CHECK(DS1307_NvramWrite(&rtc, 0, buf, 0) == DS1307_DATA_SIZE_ERROR);
+    CHECK(DS1307_ReadReg(&rtc, D_DS1307_REG_SEC, buf, 1) == DS1307_OK);
+    CHECK(Only(DS1307_API_OTHER));
+
+    /* Asynchronous transfers, completed at once by the simulator */
+    Mark();
+    done = DS1307_ERROR;
+    CHECK(DS1307_ReadTime_Bin_IT(&rtc, &time, Done, &done) == DS1307_OK && done == DS1307_OK);
+    CHECK(Only(DS1307_API_READ_TIME));
+    Mark();
+    done = DS1307_ERROR;
+    CHECK(DS1307_ReadDateTime_BCD_IT(&rtc, &dateTime, Done, &done) == DS1307_OK && done == DS1307_OK);
+    CHECK(Only(DS1307_API_READ_DATETIME));
+    Mark();
+    done = DS1307_ERROR;
+    CHECK(DS1307_WriteReg_IT(&rtc, D_DS1307_REG_RAM01, buf, 4, Done, &done) == DS1307_OK && done == DS1307_OK);
+    CHECK(Only(DS1307_API_WRITE_REG));
+    Mark();
+    done = DS1307_ERROR;
+    CHECK(DS1307_ReadReg_IT(&rtc, D_DS1307_REG_RAM01, buf, 4, Done, &done) == DS1307_OK && done == DS1307_OK);
+    CHECK(Only(DS1307_API_OTHER));
+}
+
+/**
+ * @brief Checks the error counts of a faulty run, then the reset.
+ */
+static void Test_Errors(void)
+{
+    DS1307_RecoveryPolicy_t policy = Policy();
+    DS1307_Metrics_t m, zero;
+    uint32_t sum = 0, before;
+    uint32_t injected[DS1307_FAULT_KINDS] = {0};
+    uint8_t i, k;
+
+    Setup(&policy);
+    DS1307_Metrics_Snapshot(&rtc, NULL, 1);
+    DS1307_Fault_ResetReport(&fault);
+    before = fault.count;
+    Faulty();
+    DS1307_Metrics_Snapshot(&rtc, &m, 0);
+
+    for (i = 0; i < DS1307_METRICS_STATUSES; i++)
+    {
+        if (i != DS1307_CIRCUIT_OPEN)
+        {
+            sum += m.errors[i];
+        }
+    }
+    for (i = 0; i < DS1307_FAULT_MAX_API; i++)
+    {
+        for (k = 0; k < DS1307_FAULT_KINDS; k++)
+        {
+            injected[k] += fault.report[i].faults[k];
+        }
+    }
+    CHECK(m.errors[DS1307_OK] == 0);
+    CHECK(sum == m.stats.Errors);
+    CHECK(m.errors[DS1307_ERROR] == injected[DS1307_FAULT_ADDR_NACK] + injected[DS1307_FAULT_DATA_NACK]);
+    CHECK(m.errors[DS1307_BUSY] == injected[DS1307_FAULT_ARB_LOST]);
+    CHECK(m.errors[DS1307_TIMEOUT_ERR] == injected[DS1307_FAULT_TIMEOUT]);
+    CHECK(m.errors[DS1307_CIRCUIT_OPEN] == m.stats.Rejected);
+    CHECK(m.stats.Rejected != 0 && m.stats.Retries != 0);
+    CHECK(m.stats.Transactions == fault.count - before);
+    fprintf(stderr, "errors: %lu transactions, %lu errors (%lu NACK, %lu busy, %lu timeout), %lu rejected\n",
+            (unsigned long)m.stats.Transactions, (unsigned long)m.stats.Errors,
+            (unsigned long)m.errors[DS1307_ERROR], (unsigned long)m.errors[DS1307_BUSY],
+            (unsigned long)m.errors[DS1307_TIMEOUT_ERR], (unsigned long)m.stats.Rejected);
+
+    /* The copy taken with the reset still holds everything; then all is clear */
+    DS1307_Metrics_Snapshot(&rtc, &zero, 1);
+    CHECK(memcmp(&zero, &m, sizeof(m)) == 0);
+    memset(&zero, 0, sizeof(zero));
+    DS1307_Metrics_Snapshot(&rtc, &m, 0);
+    CHECK(memcmp(&zero, &m, sizeof(m)) == 0);
+    CHECK(memcmp(&zero.stats, &rtc.stats, sizeof(rtc.stats)) == 0);
+}
+#else
+/**
+ * @brief Checks that the statistics still count without the metrics.
+ */
+static void Test_Stats(void)
+{
+    DS1307_RecoveryPolicy_t policy = Policy();
+    uint32_t before;
+
+    Setup(&policy);
+    memset(&rtc.stats, 0, sizeof(rtc.stats));
+    before = fault.count;
+    Faulty();
+    CHECK(rtc.stats.Transactions == fault.count - before);
+    CHECK(rtc.stats.Errors != 0 && rtc.stats.Retries != 0 && rtc.stats.Rejected != 0);
+    fprintf(stderr, "stats: %lu transactions, %lu errors, %lu rejected\n", (unsigned long)rtc.stats.Transactions,
+            (unsigned long)rtc.stats.Errors, (unsigned long)rtc.stats.Rejected);
+}
+#endif
+
+int main(void)
+{
+#ifndef DS1307_NO_METRICS
+    Test_Tags();
+    Test_Errors();
+#else
+    Test_Stats();
+#endif
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,244 @@
+/**
+ * @file test_recovery.c
+ * @brief Host test of the retry policy and circuit breaker over the fault transport.
+ *
+ * The fault transport runs in front of the simulator, and each case arms bursts of a
+ * chosen fault kind so that the failing transactions are known. The policy hooks log
+ * every call and the Delay hook advances the simulator, whose 1 MHz tick source times the
+ * breaker cooldown.
+ * - Retries: the transaction count, and the backoff delays passed to Delay, doubling from
+ *   backoffUs up to backoffMaxUs.
+ * - Bus recovery: BusClear then Reinit run before a retry that follows a timeout or a
+ *   second DS1307_BUSY in a row, never after a single DS1307_BUSY or a NACK, and a failing
+ *   hook ends the retries.
+ * - Breaker: CLOSED to OPEN after breakerThreshold failed operations; DS1307_CIRCUIT_OPEN
+ *   with no bus access until cooldownUs has elapsed, while DS1307_Probe() still reaches the
+ *   bus; then a single trial transaction, without retries, that reopens the breaker if it
+ *   fails and closes it if it succeeds.
+ *
+ * Build and run from the repository root (the driver's debug output goes to stdout,
+ * results to stderr):
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_recovery tests/test_recovery.c ds1307_fault.c ds1307_sim.c ds1307.c
+ * ./test_recovery > /dev/null
+ * @endcode
+ */
+
+#include "ds1307_fault.h"
+#include "ds1307_sim.h"
+#include <stdio.h>
+#include <string.h>
+
+#define COOLDOWN_US     50000u  /**< Breaker cooldown, in microseconds. */
+
+static unsigned failures = 0; /**< Failed checks. */
+static DS1307_Sim_t sim;      /**< Simulated DS1307 behind the fault transport. */
+static DS1307_Fault_t fault;  /**< Fault transport the driver talks to. */
+static DS1307_Handle_t rtc;   /**< Driver handle under test. */
+static char events[256];      /**< Hook calls of the current operation. */
+static uint8_t clearFails = 0; /**< Set to make BusClear fail. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+static void Log(const char *event)
+{
+    strncat(events, event, sizeof(events) - strlen(events) - 1);
+}
+
+static void Delay(void *ctx, uint32_t us)
+{
+    char event[16];
+
+    snprintf(event, sizeof(event), "D%lu ", (unsigned long)us);
+    Log(event);
+    DS1307_Sim_Advance((DS1307_Sim_t *)ctx, us);
+}
+
+static DS1307_Status_t BusClear(void *ctx)
+{
+    (void)ctx;
+    Log("C ");
+    return clearFails ? DS1307_ERROR : DS1307_OK;
+}
+
+static DS1307_Status_t Reinit(void *ctx)
+{
+    (void)ctx;
+    Log("R ");
+    return DS1307_OK;
+}
+
+/**
+ * @brief Starts over with a fresh simulator, no faults and the given policy.
+ */
+static void Setup(uint8_t maxRetries, uint32_t backoffUs, uint8_t breakerThreshold)
+{
+    DS1307_RecoveryPolicy_t policy;
+
+    memset(&policy, 0, sizeof(policy));
+    policy.maxRetries = maxRetries;
+    policy.backoffUs = backoffUs;
+    policy.backoffMaxUs = 500u;
+    policy.Delay = Delay;
+    policy.BusClear = BusClear;
+    policy.Reinit = Reinit;
+    policy.ctx = &sim;
+    policy.breakerThreshold = breakerThreshold;
+    policy.cooldownUs = COOLDOWN_US;
+    DS1307_Sim_TickSource(&sim, &policy.clock);
+
+    DS1307_Sim_Init(&sim);
+    DS1307_Fault_Init(&fault, &DS1307_Transport_Sim, &sim, 1u);
+    CHECK(DS1307_InitTransport(&rtc, &DS1307_Transport_Fault, &fault, _No_Output_0, &policy) == DS1307_OK);
+    memset(&rtc.stats, 0, sizeof(rtc.stats));
+    clearFails = 0;
+}
+
+/**
+ * @brief Fails the next n transactions with a fault kind, then reads one register.
+ * @param[out] transactions Transactions the read issued.
+ * @return DS1307_Status_t Status of the read.
+ */
+static DS1307_Status_t ReadAfter(uint8_t kind, uint16_t n, uint32_t *transactions)
+{
+    uint32_t before = fault.count;
+    DS1307_Status_t status;
+    uint8_t value;
+
+    fault.burstLeft[kind] = n;
+    events[0] = '\0';
+    status = DS1307_ReadReg(&rtc, D_DS1307_REG_RAM01, &value, 1);
+    fault.burstLeft[kind] = 0;
+    *transactions = fault.count - before;
+    return status;
+}
+
+/**
+ * @brief Checks the retries, backoff delays and bus recovery of one operation.
+ */
+static void Test_Retry(void)
+{
+    uint32_t n;
+
+    Setup(4, 100u, 0);
+
+    /* NACKs all the way: four retries, delays doubling up to the ceiling, no recovery */
+    CHECK(ReadAfter(DS1307_FAULT_ADDR_NACK, 100, &n) == DS1307_ERROR);
+    CHECK(n == 5);
+    CHECK(strcmp(events, "D100 D200 D400 D500 ") == 0);
+    CHECK(rtc.stats.Transactions == 5 && rtc.stats.Errors == 5 && rtc.stats.Retries == 4);
+    CHECK(rtc.stats.Recoveries == 0);
+
+    /* Timeouts: recovery before every retry */
+    CHECK(ReadAfter(DS1307_FAULT_TIMEOUT, 2, &n) == DS1307_OK);
+    CHECK(n == 3);
+    CHECK(strcmp(events, "C R D100 C R D200 ") == 0);
+    CHECK(rtc.stats.Recoveries == 2);
+
+    /* A single arbitration loss is retried as is; a second one clears the bus */
+    CHECK(ReadAfter(DS1307_FAULT_ARB_LOST, 1, &n) == DS1307_OK);
+    CHECK(n == 2 && strcmp(events, "D100 ") == 0);
+    CHECK(ReadAfter(DS1307_FAULT_ARB_LOST, 2, &n) == DS1307_OK);
+    CHECK(n == 3 && strcmp(events, "D100 C R D200 ") == 0);
+    CHECK(rtc.stats.Recoveries == 3);
+
+    /* Data NACKs never clear the bus */
+    CHECK(ReadAfter(DS1307_FAULT_DATA_NACK, 3, &n) == DS1307_OK);
+    CHECK(n == 4 && strcmp(events, "D100 D200 D400 ") == 0);
+
+    /* A bus that cannot be cleared ends the retries */
+    clearFails = 1;
+    CHECK(ReadAfter(DS1307_FAULT_TIMEOUT, 2, &n) == DS1307_TIMEOUT_ERR);
+    CHECK(n == 1 && strcmp(events, "C ") == 0);
+    clearFails = 0;
+
+    /* No retries, no hooks */
+    Setup(0, 100u, 0);
+    CHECK(ReadAfter(DS1307_FAULT_TIMEOUT, 1, &n) == DS1307_TIMEOUT_ERR);
+    CHECK(n == 1 && events[0] == '\0');
+}
+
+/**
+ * @brief Walks the circuit breaker through its states.
+ */
+static void Test_Breaker(void)
+{
+    DS1307_Recovery_t *recovery = &rtc.recovery;
+    uint32_t n, before;
+    unsigned long rejected = 0;
+    uint64_t opened;
+    int i;
+
+    Setup(1, 0u, 3);
+
+    /* Three failed operations, of two transactions each, open it */
+    for (i = 0; i < 3; i++)
+    {
+        CHECK(recovery->state == DS1307_BREAKER_CLOSED);
+        CHECK(ReadAfter(DS1307_FAULT_ADDR_NACK, 100, &n) == DS1307_ERROR);
+        CHECK(n == 2);
+    }
+    CHECK(recovery->state == DS1307_BREAKER_OPEN);
+    opened = sim.nowUs;
+
+    /* Fail fast without bus access until the cooldown has elapsed */
+    for (;;)
+    {
+        CHECK(ReadAfter(DS1307_FAULT_ADDR_NACK, 100, &n) == DS1307_CIRCUIT_OPEN);
+        CHECK(n == 0);
+        rejected++;
+        if (sim.nowUs - opened == COOLDOWN_US - 1u)
+        {
+            break;
+        }
+        DS1307_Sim_Advance(&sim, (sim.nowUs - opened + 4000u < COOLDOWN_US) ? 4000u : opened + COOLDOWN_US - 1u - sim.nowUs);
+    }
+    DS1307_Sim_Advance(&sim, 1u);
+    CHECK(rtc.stats.Rejected == rejected);
+    CHECK(rtc.stats.Transactions == 6);
+
+    /* A probe bypasses the breaker */
+    before = fault.count;
+    CHECK(DS1307_Probe(&rtc) == DS1307_OK);
+    CHECK(fault.count == before + 1);
+    CHECK(recovery->state == DS1307_BREAKER_OPEN);
+
+    /* A failed trial, without retry, reopens it for a full cooldown */
+    CHECK(ReadAfter(DS1307_FAULT_ADDR_NACK, 100, &n) == DS1307_ERROR);
+    CHECK(n == 1);
+    CHECK(recovery->state == DS1307_BREAKER_OPEN);
+    opened = sim.nowUs;
+    DS1307_Sim_Advance(&sim, COOLDOWN_US - 1u);
+    CHECK(ReadAfter(DS1307_FAULT_ADDR_NACK, 0, &n) == DS1307_CIRCUIT_OPEN);
+    CHECK(n == 0);
+    DS1307_Sim_Advance(&sim, 1u);
+
+    /* A successful trial closes it and clears the failure count */
+    CHECK(ReadAfter(DS1307_FAULT_ADDR_NACK, 0, &n) == DS1307_OK);
+    CHECK(n == 1);
+    CHECK(recovery->state == DS1307_BREAKER_CLOSED && recovery->failures == 0);
+
+    /* Closed again: retries are back, and one failure does not open it */
+    CHECK(ReadAfter(DS1307_FAULT_ADDR_NACK, 1, &n) == DS1307_OK);
+    CHECK(n == 2);
+    CHECK(ReadAfter(DS1307_FAULT_ADDR_NACK, 100, &n) == DS1307_ERROR);
+    CHECK(n == 2 && recovery->state == DS1307_BREAKER_CLOSED);
+    fprintf(stderr, "breaker: %lu calls rejected during a %lu us cooldown\n", rejected, (unsigned long)COOLDOWN_US);
+}
+
+int main(void)
+{
+    Test_Retry();
+    Test_Breaker();
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,294 @@
+/**
+ * @file test_sim.c
+ * @brief Self-test of the DS1307 simulator.
+ *
+ * Talks to the model through its transport only, so that the checks do not depend on
+ * the driver's own conversions:
+ * - counts continuously from 2000-01-01 to 2100-01-01, comparing the time registers
+ *   every hour with the BCD encoding of gmtime_r() (leap years, weekday, 99 to 00 rollover);
+ * - 12-hour mode rollovers at 11:59:59 AM/PM and 12:59:59;
+ * - register pointer auto-increment and the 0x3F to 0x00 wrap, for reads and writes;
+ * - CH halting the clock, and a seconds write resetting the countdown chain;
+ * - bits shown as 0 in the datasheet reading back as 0;
+ * - the SQW/OUT level, the 1 Hz edge callback and the bus time charged per transfer.
+ * It also prints how many virtual years the model runs per host second.
+ *
+ * Build and run from the repository root:
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_sim tests/test_sim.c ds1307_sim.c ds1307.c
+ * ./test_sim > /dev/null
+ * @endcode
+ */
+
+#define _GNU_SOURCE
+#include "ds1307_sim.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define US_PER_SEC      1000000ull  /**< Microseconds per second. */
+#define ADDR            D_DS1307_ADDR
+
+static unsigned failures = 0; /**< Failed checks. */
+static unsigned edges = 0;    /**< 1 Hz edges seen by the callback. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+static uint8_t Bcd(int v)
+{
+    return (uint8_t)(((v / 10) << 4) | (v % 10));
+}
+
+static DS1307_Status_t Read(DS1307_Sim_t *sim, uint8_t reg, uint8_t *data, uint8_t len)
+{
+    return DS1307_Transport_Sim.ReadRegs(sim, ADDR, reg, data, len, DS1307_TIMEOUT);
+}
+
+static DS1307_Status_t Write(DS1307_Sim_t *sim, uint8_t reg, const uint8_t *data, uint8_t len)
+{
+    return DS1307_Transport_Sim.WriteRegs(sim, ADDR, reg, data, len, DS1307_TIMEOUT);
+}
+
+/**
+ * @brief Encodes a Unix time as the seven time registers, 24-hour mode, Sunday = 1.
+ */
+static void Encode(time_t t, uint8_t *raw)
+{
+    struct tm tm;
+
+    gmtime_r(&t, &tm);
+    raw[D_DS1307_REG_SEC] = Bcd(tm.tm_sec);
+    raw[D_DS1307_REG_MIN] = Bcd(tm.tm_min);
+    raw[D_DS1307_REG_HRS] = Bcd(tm.tm_hour);
+    raw[D_DS1307_REG_DAY] = (uint8_t)(tm.tm_wday + 1);
+    raw[D_DS1307_REG_DATE] = Bcd(tm.tm_mday);
+    raw[D_DS1307_REG_MONTH] = Bcd(tm.tm_mon + 1);
+    raw[D_DS1307_REG_YEAR] = Bcd(tm.tm_year % 100);
+}
+
+static void OnEdge(void *ctx)
+{
+    (void)ctx;
+    edges++;
+}
+
+static double Now_Ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief Runs the clock through the whole century, checking it every hour.
+ */
+static void Test_Century(void)
+{
+    static DS1307_Sim_t sim;
+    uint8_t want[7], got[7];
+    unsigned long bad = 0;
+    time_t t = DS1307_EPOCH_MIN;
+    double t0;
+
+    DS1307_Sim_Init(&sim);
+    Encode(t, want);
+    CHECK(Write(&sim, 0, want, 7) == DS1307_OK);
+
+    t0 = Now_Ns();
+    while (t < (time_t)DS1307_EPOCH_MAX + 1)
+    {
+        DS1307_Sim_Advance(&sim, 3600u * US_PER_SEC);
+        t += 3600;
+        Encode(t, want);
+        Read(&sim, 0, got, 7);
+        if (memcmp(want, got, 7) != 0 && bad++ < 5)
+        {
+            fprintf(stderr, "at %ld: %02X %02X %02X %02X %02X %02X %02X\n", (long)t,
+                    got[0], got[1], got[2], got[3], got[4], got[5], got[6]);
+        }
+    }
+    CHECK(bad == 0);
+    fprintf(stderr, "century: %lu hourly mismatches, %.1f virtual years per host second\n",
+            bad, 100.0 / ((Now_Ns() - t0) / 1e9));
+}
+
+/**
+ * @brief Checks the 12-hour mode rollovers.
+ */
+static void Test_12Hour(void)
+{
+    static const struct
+    {
+        uint8_t before;
+        uint8_t after;
+        uint8_t nextDay;
+    } cases[] =
+    {
+        { 0x40 | 0x20 | 0x11, 0x40 | 0x12, 1 }, /* 11 PM -> 12 AM, next day */
+        { 0x40 | 0x11, 0x40 | 0x20 | 0x12, 0 }, /* 11 AM -> 12 PM */
+        { 0x40 | 0x20 | 0x12, 0x40 | 0x20 | 0x01, 0 }, /* 12 PM -> 1 PM */
+        { 0x40 | 0x12, 0x40 | 0x01, 0 },        /* 12 AM -> 1 AM */
+        { 0x40 | 0x09, 0x40 | 0x10, 0 },        /* 9 AM -> 10 AM */
+    };
+    DS1307_Sim_t sim;
+    uint8_t raw[7];
+    uint8_t i;
+
+    DS1307_Sim_Init(&sim);
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        /* 28 Feb 2023, a Tuesday: the next day is 1 March */
+        uint8_t set[7] = {0x59, 0x59, cases[i].before, 0x03, 0x28, 0x02, 0x23};
+
+        Write(&sim, 0, set, 7);
+        DS1307_Sim_Advance(&sim, US_PER_SEC);
+        Read(&sim, 0, raw, 7);
+        CHECK(raw[0] == 0x00 && raw[1] == 0x00 && raw[2] == cases[i].after);
+        CHECK(raw[3] == (cases[i].nextDay ? 0x04 : 0x03));
+        CHECK(raw[4] == (cases[i].nextDay ? 0x01 : 0x28) && raw[5] == (cases[i].nextDay ? 0x03 : 0x02));
+    }
+}
+
+/**
+ * @brief Checks pointer auto-increment and wrap, write masks and the power-on state.
+ */
+static void Test_Registers(void)
+{
+    DS1307_Sim_t sim;
+    uint8_t raw[8];
+    uint8_t ones[8] = {0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    uint8_t data[3] = {0xA1, 0x12, 0x34};
+
+    DS1307_Sim_Init(&sim);
+    Read(&sim, 0, raw, 8);
+    CHECK(raw[0] == 0x80 && raw[1] == 0 && raw[2] == 0 && raw[3] == 1 && raw[4] == 1 && raw[5] == 1 && raw[6] == 0);
+    CHECK(raw[7] == 0x03);
+
+    /* A read from 0x3E returns 0x3E, 0x3F, then the seconds and minutes */
+    sim.reg[0x3E] = 0x5A;
+    sim.reg[0x3F] = 0xA5;
+    Read(&sim, 0x3E, raw, 4);
+    CHECK(raw[0] == 0x5A && raw[1] == 0xA5 && raw[2] == 0x80 && raw[3] == 0x00);
+
+    /* A write from 0x3F wraps the same way */
+    Write(&sim, 0x3F, data, 3);
+    CHECK(sim.reg[0x3F] == 0xA1 && sim.reg[0] == 0x12 && sim.reg[1] == 0x34);
+
+    /* Bits that do not exist read back as 0 */
+    Write(&sim, 0, ones, 8);
+    Read(&sim, 0, raw, 8);
+    CHECK(raw[1] == 0x7F && raw[2] == 0x7F && raw[3] == 0x07 && raw[4] == 0x3F && raw[5] == 0x1F);
+    CHECK(raw[6] == 0xFF && raw[7] == 0x93);
+
+    /* Another slave address is not acknowledged */
+    CHECK(DS1307_Transport_Sim.Probe(&sim, ADDR, DS1307_TIMEOUT) == DS1307_OK);
+    CHECK(DS1307_Transport_Sim.Probe(&sim, (uint8_t)(ADDR + 2), DS1307_TIMEOUT) != DS1307_OK);
+}
+
+/**
+ * @brief Checks CH and the countdown chain reset by a seconds write.
+ */
+static void Test_Oscillator(void)
+{
+    DS1307_Sim_t sim;
+    uint8_t raw[1];
+    uint8_t sec;
+
+    DS1307_Sim_Init(&sim);
+    DS1307_Sim_Advance(&sim, 5 * US_PER_SEC);
+    Read(&sim, 0, raw, 1);
+    CHECK(raw[0] == 0x80);
+
+    sec = 0x10;
+    Write(&sim, 0, &sec, 1);
+    DS1307_Sim_Advance(&sim, 3 * US_PER_SEC);
+    Read(&sim, 0, raw, 1);
+    CHECK(raw[0] == 0x13);
+
+    /* 0.7 s into a second, a seconds write restarts the full second */
+    DS1307_Sim_Advance(&sim, 700000u);
+    Write(&sim, 0, &sec, 1);
+    DS1307_Sim_Advance(&sim, 999999u);
+    Read(&sim, 0, raw, 1);
+    CHECK(raw[0] == 0x10);
+    DS1307_Sim_Advance(&sim, 1u);
+    Read(&sim, 0, raw, 1);
+    CHECK(raw[0] == 0x11);
+
+    /* Halting freezes the count */
+    sec = 0x80 | 0x30;
+    Write(&sim, 0, &sec, 1);
+    DS1307_Sim_Advance(&sim, 10 * US_PER_SEC);
+    Read(&sim, 0, raw, 1);
+    CHECK(raw[0] == 0xB0);
+}
+
+/**
+ * @brief Checks the SQW/OUT level, the edge callback and the bus time.
+ */
+static void Test_Sqw(void)
+{
+    DS1307_Sim_t sim;
+    uint8_t ctrl;
+    uint8_t sec = 0x00;
+    uint8_t raw[7];
+    uint64_t t0;
+
+    DS1307_Sim_Init(&sim);
+    Write(&sim, 0, &sec, 1);
+
+    /* SQWE clear: the pin follows OUT */
+    ctrl = 1 << D_DS1307_BIT_OUT;
+    Write(&sim, D_DS1307_REG_CTRL, &ctrl, 1);
+    CHECK(DS1307_Sim_SqwLevel(&sim) == 1);
+    ctrl = 0;
+    Write(&sim, D_DS1307_REG_CTRL, &ctrl, 1);
+    CHECK(DS1307_Sim_SqwLevel(&sim) == 0);
+
+    /* 1 Hz: low for the first half of each second, one callback per falling edge */
+    ctrl = 1 << D_DS1307_BIT_SQWE;
+    Write(&sim, D_DS1307_REG_CTRL, &ctrl, 1);
+    sim.onEdge = OnEdge;
+    DS1307_Sim_Advance(&sim, 250000u);
+    CHECK(DS1307_Sim_SqwLevel(&sim) == 0);
+    DS1307_Sim_Advance(&sim, 500000u);
+    CHECK(DS1307_Sim_SqwLevel(&sim) == 1);
+    DS1307_Sim_Advance(&sim, 10 * US_PER_SEC);
+    CHECK(edges == 10);
+
+    /* 4096 Hz: the level changes every 122 us */
+    ctrl = (1 << D_DS1307_BIT_SQWE) | (1 << D_DS1307_BIT_RS0);
+    Write(&sim, D_DS1307_REG_CTRL, &ctrl, 1);
+    DS1307_Sim_Advance(&sim, US_PER_SEC - sim.phaseUs + 30u);
+    CHECK(DS1307_Sim_SqwLevel(&sim) == 0);
+    DS1307_Sim_Advance(&sim, 122u);
+    CHECK(DS1307_Sim_SqwLevel(&sim) == 1);
+    CHECK(edges == 10);
+
+    /* A 7-byte read at 100 kHz: 10 bytes of 9 bits, two starts and a stop of 2 bits each */
+    sim.busHz = 100000u;
+    t0 = sim.nowUs;
+    Read(&sim, 0, raw, 7);
+    CHECK(sim.nowUs - t0 == 960u);
+}
+
+int main(void)
+{
+    Test_Registers();
+    Test_12Hour();
+    Test_Oscillator();
+    Test_Sqw();
+    Test_Century();
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
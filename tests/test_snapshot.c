@@ -0,0 +1,161 @@
+/**
+ * @file test_snapshot.c
+ * @brief Host test and benchmark of the SWAR snapshot decoder.
+ *
+ * Checks that DS1307_DecodeSnapshot() returns the same fields as the per-field path of
+ * DS1307_ReadDateTime_Bin() for random well-formed snapshots, with the CH bit and both
+ * hour modes exercised, and times the two decoders.
+ *
+ * The static per-field decoder is reached by including ds1307.c directly. Build and run
+ * from the repository root (the driver's debug output goes to stdout, results to stderr):
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_snapshot tests/test_snapshot.c
+ * ./test_snapshot > /dev/null
+ * @endcode
+ */
+
+#include "../ds1307.c"
+#include <stdio.h>
+#include <time.h>
+
+#define TEST_SNAPSHOTS  1000000u  /**< Random snapshots compared. */
+#define BENCH_SNAPSHOTS 4096u     /**< Snapshots per benchmark pass. */
+#define BENCH_PASSES    5000u     /**< Benchmark passes. */
+
+static unsigned failures = 0; /**< Failed checks. */
+static uint32_t seed = 1u;    /**< Generator state. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+/**
+ * @brief Returns a pseudo-random number in [0, n).
+ */
+static uint32_t Rand(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+/**
+ * @brief Monotonic time in nanoseconds.
+ */
+static double Now_Ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief Fills a random well-formed snapshot; CH and the hour mode are random too.
+ */
+static void Random_Snapshot(uint8_t *raw)
+{
+    uint8_t hour = (uint8_t)Rand(24);
+
+    raw[D_DS1307_REG_SEC] = (uint8_t)(DS1307_Bin_to_BCD((uint8_t)Rand(60)) | (Rand(2) << D_DS1307_BIT_CH));
+    raw[D_DS1307_REG_MIN] = DS1307_Bin_to_BCD((uint8_t)Rand(60));
+    if (Rand(2))
+    {
+        uint8_t h12 = (uint8_t)((hour % 12) ? (hour % 12) : 12);
+
+        raw[D_DS1307_REG_HRS] = (uint8_t)((1 << D_DS1307_BIT_HRS) | ((hour >= 12) << D_DS1307_BIT_AMPM) |
+                                          DS1307_Bin_to_BCD(h12));
+    }
+    else
+    {
+        raw[D_DS1307_REG_HRS] = DS1307_Bin_to_BCD(hour);
+    }
+    raw[D_DS1307_REG_DAY] = (uint8_t)(1 + Rand(7));
+    raw[D_DS1307_REG_DATE] = DS1307_Bin_to_BCD((uint8_t)(1 + Rand(31)));
+    raw[D_DS1307_REG_MONTH] = DS1307_Bin_to_BCD((uint8_t)(1 + Rand(12)));
+    raw[D_DS1307_REG_YEAR] = DS1307_Bin_to_BCD((uint8_t)Rand(100));
+}
+
+/**
+ * @brief Compares the SWAR decoder with the per-field decoder.
+ */
+static void Test_Equivalence(void)
+{
+    uint8_t raw[7];
+    DS1307_DateTime_t a, b;
+    uint32_t i;
+
+    for (i = 0; i < TEST_SNAPSHOTS; i++)
+    {
+        Random_Snapshot(raw);
+        memset(&a, 0, sizeof(a));
+        memset(&b, 0, sizeof(b));
+        DS1307_DecodeSnapshot(raw, &a);
+        DS1307_Raw_to_DateTime(raw, &b, 0);
+        if (memcmp(&a, &b, sizeof(a)) != 0)
+        {
+            CHECK(memcmp(&a, &b, sizeof(a)) == 0);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Times both decoders and prints nanoseconds per snapshot.
+ */
+static void Bench(void)
+{
+    static uint8_t raw[BENCH_SNAPSHOTS][7];
+    DS1307_DateTime_t dt;
+    volatile uint32_t sink = 0;
+    uint32_t acc;
+    double t0, tField, tSwar;
+    unsigned i, p;
+
+    for (i = 0; i < BENCH_SNAPSHOTS; i++)
+    {
+        Random_Snapshot(raw[i]);
+    }
+
+    t0 = Now_Ns();
+    for (p = 0, acc = 0; p < BENCH_PASSES; p++)
+    {
+        for (i = 0; i < BENCH_SNAPSHOTS; i++)
+        {
+            DS1307_Raw_to_DateTime(raw[i], &dt, 0);
+            acc += dt.time.Sec + dt.time.Hour + dt.date.Date + dt.date.Year;
+        }
+    }
+    sink += acc;
+    tField = Now_Ns() - t0;
+
+    t0 = Now_Ns();
+    for (p = 0, acc = 0; p < BENCH_PASSES; p++)
+    {
+        for (i = 0; i < BENCH_SNAPSHOTS; i++)
+        {
+            DS1307_DecodeSnapshot(raw[i], &dt);
+            acc += dt.time.Sec + dt.time.Hour + dt.date.Date + dt.date.Year;
+        }
+    }
+    sink += acc;
+    tSwar = Now_Ns() - t0;
+
+    fprintf(stderr, "per-field %.2f ns/snapshot, SWAR %.2f ns/snapshot\n",
+            tField / ((double)BENCH_PASSES * BENCH_SNAPSHOTS), tSwar / ((double)BENCH_PASSES * BENCH_SNAPSHOTS));
+    (void)sink;
+}
+
+int main(void)
+{
+    Test_Equivalence();
+    Bench();
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
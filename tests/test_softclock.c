@@ -0,0 +1,407 @@
+/**
+ * @file test_softclock.c
+ * @brief Host test of the SQW-driven time keeping: software clock, sub-second
+ *        interpolator and snapshot sampler.
+ *
+ * The simulator's onEdge callback stands in for the EXTI interrupt of the SQW/OUT pin.
+ * - Checks DS1307_DateTime_Increment() against gmtime_r() at the end of every day from
+ *   2000 to 2099 (month, year, leap-year and 99 to 00 rollovers, weekday) and at random
+ *   times of day.
+ * - Makes the software clock lag the RTC with a dropped edge and checks that the
+ *   resynchronisation restores it: a reading that an edge straddles is dropped, and a
+ *   reading whose edge is handled late is advanced by that edge when applied.
+ * - Runs DS1307_SubSec_GetUs() on a 168 MHz tick source, which wraps every 25.6 s, over
+ *   five minutes of small random steps: timestamps must never go backwards and must stay
+ *   within 2 ms of the simulated time. A stale anchor must be reported without the query
+ *   dropping it, and a gap of three seconds in the edges must make DS1307_SubSec_OnEdge()
+ *   drop it.
+ * - Counts sampler overruns with a transport that completes reads only when told to: an
+ *   edge while the previous read is in flight, and an edge with the ring full.
+ *
+ * The static DS1307_DateTime_Increment() is reached by including ds1307.c directly. Build
+ * and run from the repository root (the driver's debug output goes to stdout, results to
+ * stderr):
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_softclock tests/test_softclock.c ds1307_sim.c
+ * ./test_softclock > /dev/null
+ * @endcode
+ */
+
+#define _GNU_SOURCE
+#include "../ds1307.c"
+#include "ds1307_sim.h"
+#include <stdio.h>
+#include <time.h>
+
+#define US_PER_SEC      1000000ull  /**< Microseconds per second. */
+#define FAST_MHZ        168u        /**< Frequency of the fast tick source, in MHz. */
+#define EPOCH0          1709164790u /**< 2024-02-28 23:59:50, ten seconds before a leap day. */
+
+static unsigned failures = 0; /**< Failed checks. */
+static uint32_t seed = 5u;    /**< Generator state. */
+
+static DS1307_Sim_t sim;      /**< Simulated DS1307. */
+static DS1307_Handle_t rtc;   /**< Driver handle on the simulator. */
+static unsigned drop = 0;     /**< Edges the clock must miss. */
+static uint8_t defer = 0;     /**< Set to hold edges back instead of handling them. */
+static unsigned deferred = 0; /**< Edges held back. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+static uint32_t Rand(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+/**
+ * @brief Fills a date and time from a Unix time, with Sunday = 1 and a two-digit year.
+ */
+static void FromEpoch(time_t t, DS1307_DateTime_t *dt)
+{
+    struct tm tm;
+
+    gmtime_r(&t, &tm);
+    dt->time.Sec = (uint8_t)tm.tm_sec;
+    dt->time.Min = (uint8_t)tm.tm_min;
+    dt->time.Hour = (uint8_t)tm.tm_hour;
+    dt->date.Day = (uint8_t)(tm.tm_wday + 1);
+    dt->date.Date = (uint8_t)tm.tm_mday;
+    dt->date.Month = (uint8_t)(tm.tm_mon + 1);
+    dt->date.Year = (uint8_t)(tm.tm_year % 100);
+}
+
+static int Same(const DS1307_DateTime_t *a, const DS1307_DateTime_t *b)
+{
+    return (a->time.Sec == b->time.Sec) && (a->time.Min == b->time.Min) && (a->time.Hour == b->time.Hour) &&
+           (a->date.Day == b->date.Day) && (a->date.Date == b->date.Date) &&
+           (a->date.Month == b->date.Month) && (a->date.Year == b->date.Year);
+}
+
+/**
+ * @brief Checks that the software clock shows what the model's registers hold.
+ */
+static int Matches(void)
+{
+    DS1307_DateTime_t soft, hard;
+
+    DS1307_Raw_to_DateTime(sim.reg, &hard, 0);
+    return (DS1307_SoftClock_Get(&rtc, &soft) == DS1307_OK) && Same(&soft, &hard);
+}
+
+/**
+ * @brief Advances virtual time to a given distance before the next 1 Hz edge.
+ */
+static void BeforeEdge(uint32_t us)
+{
+    DS1307_Sim_Advance(&sim, US_PER_SEC - sim.phaseUs - us);
+}
+
+static void ClockEdge(void *ctx)
+{
+    (void)ctx;
+    if (drop)
+    {
+        drop--;
+    }
+    else if (defer)
+    {
+        deferred++;
+    }
+    else
+    {
+        DS1307_SoftClock_Tick(&rtc);
+    }
+}
+
+/**
+ * @brief Checks DS1307_DateTime_Increment() against gmtime_r().
+ */
+static void Test_Increment(void)
+{
+    DS1307_DateTime_t dt, want;
+    unsigned long bad = 0;
+    time_t t;
+    uint32_t i;
+
+    /* The last second of every day of the century */
+    for (t = DS1307_EPOCH_MIN + 86399; t <= (time_t)DS1307_EPOCH_MAX; t += 86400)
+    {
+        FromEpoch(t, &dt);
+        FromEpoch(t + 1, &want);
+        DS1307_DateTime_Increment(&dt);
+        bad += !Same(&dt, &want);
+    }
+
+    /* Random seconds, most of them inside a minute or an hour */
+    for (i = 0; i < 1000000u; i++)
+    {
+        t = DS1307_EPOCH_MIN + (time_t)(((uint64_t)Rand(1u << 16) << 16 | Rand(1u << 16)) %
+                                        (DS1307_EPOCH_MAX - DS1307_EPOCH_MIN));
+        FromEpoch(t, &dt);
+        FromEpoch(t + 1, &want);
+        DS1307_DateTime_Increment(&dt);
+        bad += !Same(&dt, &want);
+    }
+
+    CHECK(bad == 0);
+    fprintf(stderr, "increment: %lu mismatches with gmtime_r\n", bad);
+}
+
+/**
+ * @brief Resynchronises a lagging software clock across edges that land during the read.
+ */
+static void Test_Resync(void)
+{
+    DS1307_SoftClock_t *clock = &rtc.softClock;
+
+    DS1307_Sim_Init(&sim);
+    sim.busHz = 100000u; /* A 7-byte read takes 960 us */
+    CHECK(DS1307_InitTransport(&rtc, &DS1307_Transport_Sim, &sim, _1Hz, NULL) == DS1307_OK);
+    CHECK(DS1307_WriteEpoch(&rtc, EPOCH0) == DS1307_OK);
+    CHECK(DS1307_SoftClock_Start(&rtc, 5) == DS1307_OK);
+    sim.onEdge = ClockEdge;
+    CHECK(Matches());
+
+    /* A missed edge leaves the clock a second behind until the resynchronisation */
+    drop = 1;
+    DS1307_Sim_Advance(&sim, 3 * US_PER_SEC);
+    CHECK(!Matches());
+    DS1307_Sim_Advance(&sim, 3 * US_PER_SEC);
+    CHECK(clock->resyncPending);
+
+    /* An edge 300 us into the read straddles it: the reading is dropped */
+    BeforeEdge(300u);
+    CHECK(DS1307_SoftClock_Service(&rtc) == DS1307_OK);
+    CHECK(!clock->syncReady && clock->resyncPending);
+
+    /* Mid-second the read is clean; the next edge applies it */
+    DS1307_Sim_Advance(&sim, 400000u);
+    CHECK(DS1307_SoftClock_Service(&rtc) == DS1307_OK);
+    CHECK(clock->syncReady && !clock->resyncPending);
+    BeforeEdge(0u);
+    CHECK(!clock->syncReady);
+    CHECK(Matches());
+
+    /* Lag again, then let the edge after the latch be handled only once the read is done */
+    drop = 1;
+    DS1307_Sim_Advance(&sim, 6 * US_PER_SEC);
+    CHECK(clock->resyncPending && !Matches());
+    BeforeEdge(300u);
+    defer = 1;
+    CHECK(DS1307_SoftClock_Service(&rtc) == DS1307_OK);
+    defer = 0;
+    CHECK(deferred == 1 && clock->syncReady);
+    DS1307_SoftClock_Tick(&rtc);
+    CHECK(Matches());
+
+    /* And it keeps counting from there */
+    DS1307_Sim_Advance(&sim, 20 * US_PER_SEC);
+    CHECK(Matches());
+    sim.onEdge = NULL;
+}
+
+static uint32_t Fast_Now(void *ctx)
+{
+    return (uint32_t)(((const DS1307_Sim_t *)ctx)->nowUs * FAST_MHZ);
+}
+
+static void SubSecEdge(void *ctx)
+{
+    (void)ctx;
+    DS1307_SubSec_OnEdge(&rtc);
+}
+
+/**
+ * @brief Checks sub-second timestamps on a fast, often wrapping tick source.
+ */
+static void Test_SubSec(void)
+{
+    const DS1307_TickSource_t fast = {Fast_Now, &sim, FAST_MHZ * 1000000u};
+    uint64_t start, us, last = 0, err, worst = 0;
+    unsigned long backwards = 0, errors = 0, i;
+
+    DS1307_Sim_Init(&sim);
+    sim.busHz = 400000u;
+    CHECK(DS1307_InitTransport(&rtc, &DS1307_Transport_Sim, &sim, _1Hz, NULL) == DS1307_OK);
+    CHECK(DS1307_WriteEpoch(&rtc, EPOCH0) == DS1307_OK);
+    start = sim.nowUs - sim.phaseUs;
+    CHECK(DS1307_SubSec_Align(&rtc, &fast) == DS1307_OK);
+    sim.onEdge = SubSecEdge;
+
+    /* Edges hold the fraction from the first one on */
+    BeforeEdge(0u);
+    for (i = 0; i < 200000u; i++)
+    {
+        DS1307_Sim_Advance(&sim, 1u + Rand(3000u));
+        if (DS1307_SubSec_GetUs(&rtc, &us) != DS1307_OK)
+        {
+            errors++;
+            continue;
+        }
+        backwards += (us < last);
+        last = us;
+        err = (us > EPOCH0 * US_PER_SEC + (sim.nowUs - start)) ? us - (EPOCH0 * US_PER_SEC + (sim.nowUs - start))
+                                                                : (EPOCH0 * US_PER_SEC + (sim.nowUs - start)) - us;
+        worst = (err > worst) ? err : worst;
+    }
+    CHECK(errors == 0);
+    CHECK(backwards == 0);
+    CHECK(worst <= 2000u);
+    fprintf(stderr, "sub-second: %lu queries over %.0f s, %lu backwards, worst error %llu us\n",
+            i, (double)(sim.nowUs - start) / 1e6, backwards, (unsigned long long)worst);
+
+    /* Edges stop: the stale anchor is reported, but only the edge handler drops it */
+    sim.onEdge = NULL;
+    DS1307_Sim_Advance(&sim, 2500000u);
+    CHECK(DS1307_SubSec_GetUs(&rtc, &us) == DS1307_ERROR);
+    CHECK(rtc.subSec.active);
+    sim.onEdge = SubSecEdge;
+    DS1307_Sim_Advance(&sim, US_PER_SEC);
+    CHECK(!rtc.subSec.active);
+    CHECK(DS1307_SubSec_GetUs(&rtc, &us) == DS1307_ERROR);
+
+    /* A new alignment brings it back */
+    sim.onEdge = NULL;
+    CHECK(DS1307_SubSec_Align(&rtc, &fast) == DS1307_OK);
+    CHECK(DS1307_SubSec_GetUs(&rtc, &us) == DS1307_OK);
+}
+
+/**
+ * @brief Simulator whose asynchronous reads complete only when Slow_Complete() is called.
+ */
+typedef struct
+{
+    DS1307_Sim_t sim;          /**< Simulated DS1307, first so it can stand in for the model. */
+    DS1307_Handle_t *pending;  /**< Device with a read in flight, or NULL. */
+} Slow_t;
+
+static Slow_t slow; /**< Bus context of Slow_Transport. */
+
+static DS1307_Status_t Slow_ReadRegs(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    return DS1307_Transport_Sim.ReadRegs(&((Slow_t *)bus)->sim, devAddr, regAdd, data, len, timeout);
+}
+
+static DS1307_Status_t Slow_WriteRegs(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    return DS1307_Transport_Sim.WriteRegs(&((Slow_t *)bus)->sim, devAddr, regAdd, data, len, timeout);
+}
+
+static DS1307_Status_t Slow_Probe(void *bus, uint8_t devAddr, uint32_t timeout)
+{
+    return DS1307_Transport_Sim.Probe(&((Slow_t *)bus)->sim, devAddr, timeout);
+}
+
+static DS1307_Status_t Slow_ReadRegsAsync(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, DS1307_Handle_t *dev)
+{
+    Slow_t *s = (Slow_t *)bus;
+    DS1307_Status_t status;
+
+    if (s->pending != NULL)
+    {
+        return DS1307_BUSY;
+    }
+    status = Slow_ReadRegs(bus, devAddr, regAdd, data, len, DS1307_TIMEOUT);
+    if (status == DS1307_OK)
+    {
+        s->pending = dev;
+    }
+    return status;
+}
+
+static const DS1307_Transport_t Slow_Transport =
+{
+    Slow_ReadRegs,
+    Slow_WriteRegs,
+    Slow_Probe,
+    Slow_ReadRegsAsync,
+    NULL,
+};
+
+/**
+ * @brief Fires the transfer-complete interrupt of the read in flight.
+ */
+static void Slow_Complete(void)
+{
+    DS1307_Handle_t *dev = slow.pending;
+
+    slow.pending = NULL;
+    DS1307_AsyncComplete(dev, DS1307_OK);
+}
+
+static void SamplerEdge(void *ctx)
+{
+    (void)ctx;
+    DS1307_Sampler_OnEdge(&rtc);
+}
+
+/**
+ * @brief Counts the edges the sampler drops.
+ */
+static void Test_Sampler(void)
+{
+    DS1307_Snapshot_t slots[4], snap;
+    uint8_t sec;
+    int i;
+
+    DS1307_Sim_Init(&slow.sim);
+    slow.pending = NULL;
+    CHECK(DS1307_InitTransport(&rtc, &Slow_Transport, &slow, _1Hz, NULL) == DS1307_OK);
+    CHECK(DS1307_WriteEpoch(&rtc, EPOCH0) == DS1307_OK);
+    CHECK(DS1307_Sampler_Start(&rtc, slots, 4) == DS1307_OK);
+    slow.sim.onEdge = SamplerEdge;
+
+    /* An edge while the previous read is in flight is an overrun */
+    DS1307_Sim_Advance(&slow.sim, US_PER_SEC);
+    CHECK(slow.pending != NULL);
+    DS1307_Sim_Advance(&slow.sim, US_PER_SEC);
+    CHECK(rtc.sampler.overruns == 1);
+    Slow_Complete();
+
+    /* Three slots fill the ring; the fourth edge finds it full */
+    for (i = 0; i < 3; i++)
+    {
+        DS1307_Sim_Advance(&slow.sim, US_PER_SEC);
+        if (slow.pending != NULL)
+        {
+            Slow_Complete();
+        }
+    }
+    CHECK(rtc.sampler.overruns == 2);
+
+    /* Draining a slot makes room for the next edge */
+    CHECK(DS1307_Sampler_Pop(&rtc, &snap) == 1);
+    sec = snap.reg[D_DS1307_REG_SEC];
+    DS1307_Sim_Advance(&slow.sim, US_PER_SEC);
+    CHECK(slow.pending != NULL);
+    Slow_Complete();
+    CHECK(rtc.sampler.overruns == 2);
+
+    /* The snapshots are of edges 1, 3, 4 and 6 */
+    CHECK(sec == 0x51);
+    CHECK(DS1307_Sampler_Pop(&rtc, &snap) == 1 && snap.reg[D_DS1307_REG_SEC] == 0x53);
+    CHECK(DS1307_Sampler_Pop(&rtc, &snap) == 1 && snap.reg[D_DS1307_REG_SEC] == 0x54);
+    CHECK(DS1307_Sampler_Pop(&rtc, &snap) == 1 && snap.reg[D_DS1307_REG_SEC] == 0x56);
+    CHECK(DS1307_Sampler_Pop(&rtc, &snap) == 0);
+    fprintf(stderr, "sampler: %lu overruns\n", (unsigned long)rtc.sampler.overruns);
+}
+
+int main(void)
+{
+    Test_Increment();
+    Test_Resync();
+    Test_SubSec();
+    Test_Sampler();
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
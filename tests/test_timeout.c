@@ -0,0 +1,259 @@
+/**
+ * @file test_timeout.c
+ * @brief Host test of the adaptive transaction timeouts.
+ *
+ * The simulator sits behind a transport that enforces the timeout it is given: a transfer
+ * whose bus time exceeds it fails with DS1307_TIMEOUT_ERR, and a dead device holds the bus
+ * for the whole timeout.
+ * - After learning on short transfers at 100 kHz, 56-byte NVRAM bursts must never time out.
+ * - A dead device must fail within slackUs plus the nominal bound (DS1307_TIMEOUT_MARGIN
+ *   times 9 bit times per byte at busHz) before anything is learned, and within twice that
+ *   once the learned p99, rounded up to a power-of-two bucket, has replaced it.
+ * - A 1 kHz clock, as filled by DS1307_HAL_TickSource_GetTick(), must still give timeouts
+ *   that no transfer exceeds, even when every transfer starts right after a tick and ends
+ *   before the next.
+ *
+ * Build and run from the repository root (the driver's debug output goes to stdout,
+ * results to stderr):
+ * @code
+ * gcc -std=gnu99 -O2 -I. -DDS1307_NO_HAL -o test_timeout tests/test_timeout.c ds1307_sim.c ds1307.c
+ * ./test_timeout > /dev/null
+ * @endcode
+ */
+
+#include "ds1307_sim.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SLACK_US        50u     /**< Slack passed to DS1307_SetTimeouts(), in microseconds. */
+#define LEARN           200u    /**< Transactions of a learning phase. */
+
+static unsigned failures = 0; /**< Failed checks. */
+static uint32_t seed = 11u;   /**< Generator state. */
+static DS1307_Sim_t sim;      /**< Simulated DS1307 behind the enforcing transport. */
+static DS1307_Handle_t rtc;   /**< Driver handle under test. */
+static uint8_t dead = 0;      /**< Set to make the device hold the bus until the timeout. */
+static unsigned long starved = 0; /**< Transfers of a live device that exceeded their timeout. */
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+static uint32_t Rand(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+/**
+ * @brief Fails a transfer that took longer than its timeout, as a bus layer would.
+ */
+static DS1307_Status_t Enforce(uint64_t start, uint32_t timeout, DS1307_Status_t status)
+{
+    if (dead)
+    {
+        DS1307_Sim_Advance(&sim, timeout);
+        return DS1307_TIMEOUT_ERR;
+    }
+    if (sim.nowUs - start > timeout)
+    {
+        starved++;
+        return DS1307_TIMEOUT_ERR;
+    }
+    return status;
+}
+
+static DS1307_Status_t Strict_ReadRegs(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    uint64_t start = sim.nowUs;
+
+    if (dead)
+    {
+        return Enforce(start, timeout, DS1307_ERROR);
+    }
+    return Enforce(start, timeout, DS1307_Transport_Sim.ReadRegs(bus, devAddr, regAdd, data, len, timeout));
+}
+
+static DS1307_Status_t Strict_WriteRegs(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    uint64_t start = sim.nowUs;
+
+    if (dead)
+    {
+        return Enforce(start, timeout, DS1307_ERROR);
+    }
+    return Enforce(start, timeout, DS1307_Transport_Sim.WriteRegs(bus, devAddr, regAdd, data, len, timeout));
+}
+
+static DS1307_Status_t Strict_Probe(void *bus, uint8_t devAddr, uint32_t timeout)
+{
+    return DS1307_Transport_Sim.Probe(bus, devAddr, timeout);
+}
+
+static const DS1307_Transport_t Strict_Transport =
+{
+    Strict_ReadRegs,
+    Strict_WriteRegs,
+    Strict_Probe,
+    NULL,
+    NULL,
+};
+
+static uint32_t Millis(void *ctx)
+{
+    return (uint32_t)(((const DS1307_Sim_t *)ctx)->nowUs / 1000u);
+}
+
+/**
+ * @brief Starts over at a given bus speed, with adaptive timeouts timed on a clock.
+ */
+static void Setup(uint32_t busHz, const DS1307_TickSource_t *clock)
+{
+    DS1307_Sim_Init(&sim);
+    sim.busHz = busHz;
+    dead = 0;
+    starved = 0;
+    CHECK(DS1307_InitTransport(&rtc, &Strict_Transport, &sim, _No_Output_0, NULL) == DS1307_OK);
+    DS1307_SetTimeouts(&rtc, clock, busHz, SLACK_US, 0);
+}
+
+/**
+ * @brief Issues a random mix of the short transfers an application makes.
+ * @param[in] align Set to start every transfer right after a 1 ms tick.
+ */
+static void Learn(uint8_t align)
+{
+    uint8_t buf[8] = {0};
+    uint32_t i;
+
+    for (i = 0; i < LEARN; i++)
+    {
+        if (align)
+        {
+            DS1307_Sim_Advance(&sim, 1000u - sim.nowUs % 1000u);
+        }
+        switch (Rand(3))
+        {
+        case 0:
+            CHECK(DS1307_ReadReg(&rtc, D_DS1307_REG_SEC, buf, 1) == DS1307_OK);
+            break;
+        case 1:
+            CHECK(DS1307_ReadReg(&rtc, D_DS1307_REG_SEC, buf, 7) == DS1307_OK);
+            break;
+        default:
+            CHECK(DS1307_WriteReg(&rtc, D_DS1307_REG_RAM01, buf, 8) == DS1307_OK);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Writes and reads back the whole NVRAM in single 56-byte bursts.
+ */
+static void Bursts(uint8_t align)
+{
+    uint8_t out[DS1307_NVRAM_SIZE], in[DS1307_NVRAM_SIZE];
+    int i;
+
+    for (i = 0; i < 10; i++)
+    {
+        memset(out, 0x30 + i, sizeof(out));
+        if (align)
+        {
+            DS1307_Sim_Advance(&sim, 1000u - sim.nowUs % 1000u);
+        }
+        CHECK(DS1307_WriteReg(&rtc, D_DS1307_REG_RAM01, out, DS1307_NVRAM_SIZE) == DS1307_OK);
+        CHECK(DS1307_ReadReg(&rtc, D_DS1307_REG_RAM01, in, DS1307_NVRAM_SIZE) == DS1307_OK);
+        CHECK(memcmp(in, out, sizeof(out)) == 0);
+    }
+}
+
+/**
+ * @brief Returns how long a one-byte read of a dead device takes to fail.
+ */
+static uint64_t DeadRead(void)
+{
+    uint64_t start = sim.nowUs;
+    uint8_t value;
+
+    dead = 1;
+    CHECK(DS1307_ReadReg(&rtc, D_DS1307_REG_SEC, &value, 1) == DS1307_TIMEOUT_ERR);
+    dead = 0;
+    return sim.nowUs - start;
+}
+
+/**
+ * @brief Learns at 100 kHz on a 1 MHz clock, then sends bursts.
+ */
+static void Test_Burst(void)
+{
+    DS1307_TickSource_t clock;
+
+    DS1307_Sim_TickSource(&sim, &clock);
+    Setup(100000u, &clock);
+    Learn(0);
+    CHECK(rtc.timeout.p99NsPerByte != 0);
+    Bursts(0);
+    CHECK(starved == 0);
+    fprintf(stderr, "100 kHz: learned %lu ns/byte, %lu starved transfers\n",
+            (unsigned long)rtc.timeout.p99NsPerByte, starved);
+}
+
+/**
+ * @brief Times the failure of a dead device before and after learning.
+ */
+static void Test_Dead(void)
+{
+    const uint32_t busHz = 400000u;
+    const uint64_t nominal = (uint64_t)DS1307_TIMEOUT_MARGIN * 9u * 4u * 1000000u / busHz; /* 1-byte read: 4 bytes */
+    DS1307_TickSource_t clock;
+    uint64_t before, after;
+
+    DS1307_Sim_TickSource(&sim, &clock);
+    Setup(busHz, &clock);
+    before = DeadRead();
+    CHECK(before <= SLACK_US + nominal);
+    Learn(0);
+    CHECK(rtc.timeout.p99NsPerByte != 0);
+    after = DeadRead();
+    CHECK(after <= SLACK_US + 2u * nominal);
+    CHECK(starved == 0);
+    fprintf(stderr, "dead device at 400 kHz: %llu us nominal, %llu us learned, against %u us fixed\n",
+            (unsigned long long)before, (unsigned long long)after, DS1307_TIMEOUT * 1000u);
+}
+
+/**
+ * @brief Learns on a 1 kHz clock with every transfer shorter than a tick.
+ */
+static void Test_Coarse(void)
+{
+    const DS1307_TickSource_t clock = {Millis, &sim, 1000u};
+    uint64_t dead;
+
+    Setup(400000u, &clock);
+    Learn(1);
+    CHECK(rtc.timeout.p99NsPerByte != 0);
+    Bursts(1);
+    Learn(1);
+    dead = DeadRead();
+    CHECK(dead <= DS1307_TIMEOUT * 1000u);
+    CHECK(starved == 0);
+    fprintf(stderr, "1 kHz clock: learned %lu ns/byte, %lu starved transfers, dead device %llu us\n",
+            (unsigned long)rtc.timeout.p99NsPerByte, starved, (unsigned long long)dead);
+}
+
+int main(void)
+{
+    Test_Burst();
+    Test_Dead();
+    Test_Coarse();
+
+    fprintf(stderr, "%s: %u failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file torn.h
+ * @brief Power-cut transport for the host tests of the NVRAM stores.
+ *
+ * Wraps the simulator and lets a given number of written bytes land, counted across
+ * transactions; the write that crosses the budget lands only its leading bytes and
+ * fails, and every transfer after it fails too, as if the supply had dropped. A power
+ * cycle is then simulated by clearing the cut and re-initializing the driver handle on
+ * the same model, whose RAM keeps what landed.
+ */
+
+#ifndef _INC_TORN_H_
+#define _INC_TORN_H_
+
+#include "ds1307_sim.h"
+#include <string.h>
+
+#define TORN_NEVER  (-1L)   /**< Budget that never cuts the power. */
+
+/**
+ * @brief State of the power-cut transport; the model comes first so that it can stand
+ *        in for the simulator's bus context.
+ */
+typedef struct
+{
+    DS1307_Sim_t sim;   /**< Simulated DS1307. */
+    long budget;        /**< Bytes still allowed to land, or TORN_NEVER. */
+    uint8_t dead;       /**< Set once the budget ran out: every transfer fails. */
+    long written;       /**< Bytes that landed since Torn_Init(). */
+} Torn_t;
+
+static DS1307_Status_t Torn_ReadRegs(void *bus, uint8_t devAddr, uint8_t regAdd, uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    Torn_t *t = (Torn_t *)bus;
+
+    if (t->dead)
+    {
+        return DS1307_ERROR;
+    }
+    return DS1307_Transport_Sim.ReadRegs(&t->sim, devAddr, regAdd, data, len, timeout);
+}
+
+static DS1307_Status_t Torn_WriteRegs(void *bus, uint8_t devAddr, uint8_t regAdd, const uint8_t *data, uint8_t len, uint32_t timeout)
+{
+    Torn_t *t = (Torn_t *)bus;
+
+    if (t->dead)
+    {
+        return DS1307_ERROR;
+    }
+    if (t->budget != TORN_NEVER && (long)len > t->budget)
+    {
+        if (t->budget > 0)
+        {
+            DS1307_Transport_Sim.WriteRegs(&t->sim, devAddr, regAdd, data, (uint8_t)t->budget, timeout);
+            t->written += t->budget;
+        }
+        t->budget = 0;
+        t->dead = 1;
+        return DS1307_ERROR;
+    }
+    if (t->budget != TORN_NEVER)
+    {
+        t->budget -= len;
+    }
+    t->written += len;
+    return DS1307_Transport_Sim.WriteRegs(&t->sim, devAddr, regAdd, data, len, timeout);
+}
+
+static DS1307_Status_t Torn_Probe(void *bus, uint8_t devAddr, uint32_t timeout)
+{
+    Torn_t *t = (Torn_t *)bus;
+
+    return t->dead ? DS1307_ERROR : DS1307_Transport_Sim.Probe(&t->sim, devAddr, timeout);
+}
+
+static const DS1307_Transport_t Torn_Transport =
+{
+    Torn_ReadRegs,
+    Torn_WriteRegs,
+    Torn_Probe,
+    NULL,
+    NULL,
+};
+
+/**
+ * @brief Powers the model up for the first time, with the RAM zeroed.
+ */
+static void Torn_Init(Torn_t *t)
+{
+    DS1307_Sim_Init(&t->sim);
+    memset(&t->sim.reg[D_DS1307_REG_RAM01], 0, DS1307_NVRAM_SIZE);
+    t->budget = TORN_NEVER;
+    t->dead = 0;
+    t->written = 0;
+}
+
+/**
+ * @brief Cuts the power after budget more written bytes. With TORN_NEVER, restores the
+ *        bus without a reboot, as after a transient write failure.
+ */
+static void Torn_Arm(Torn_t *t, long budget)
+{
+    t->budget = budget;
+    t->dead = 0;
+}
+
+/**
+ * @brief Restores the power and boots a fresh driver handle on the same model.
+ */
+static void Torn_Reboot(Torn_t *t, DS1307_Handle_t *dev)
+{
+    t->budget = TORN_NEVER;
+    t->dead = 0;
+    DS1307_InitTransport(dev, &Torn_Transport, t, _No_Output_0, NULL);
+}
+
+#endif /* _INC_TORN_H_ */